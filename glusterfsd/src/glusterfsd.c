@@ -199,6 +199,21 @@ static struct argp_option gf_options[] = {
 	 "Do not purge the cache on file open"},
         {"global-timer-wheel", ARGP_GLOBAL_TIMER_WHEEL, "BOOL",
          OPTION_ARG_OPTIONAL, "Instantiate process global timer-wheel"},
+        {"iobuf-hugepages", ARGP_IOBUF_HUGEPAGES_KEY, "off|thp|hugetlb", 0,
+         "Back large iobuf arenas with huge pages [default: off]"},
+        {"iobuf-numa", ARGP_IOBUF_NUMA_KEY, "BOOL", OPTION_ARG_OPTIONAL,
+         "Keep iobuf arenas per NUMA node [default: off]"},
+        {"timer-dispatch-threads", ARGP_TIMER_DISPATCH_THREADS_KEY,
+         "INTEGER", 0, "Run timer callbacks on INTEGER threads instead of "
+         "the timer thread [default: 0]"},
+        {"event-batch-size", ARGP_EVENT_BATCH_SIZE_KEY, "INTEGER", 0,
+         "Dispatch up to INTEGER events per wakeup of an event thread "
+         "[default: 1]"},
+        {"event-affinity", ARGP_EVENT_AFFINITY_KEY, "BOOL",
+         OPTION_ARG_OPTIONAL, "Keep every connection on the event thread it "
+         "was assigned to [default: off]"},
+        {"event-cpus", ARGP_EVENT_CPUS_KEY, "CPULIST", 0,
+         "Pin the event threads to the cpus in CPULIST, e.g. \"0-3,8\""},
         {"thin-client", ARGP_THIN_CLIENT_KEY, 0, 0,
          "Enables thin mount and connects via gfproxyd daemon"},
 
@@ -1204,6 +1219,84 @@ parse_opts (int key, char *arg, struct argp_state *state)
                 cmd_args->global_timer_wheel = 1;
                 break;
 
+        case ARGP_IOBUF_HUGEPAGES_KEY:
+                if (strcmp (arg, "off") == 0) {
+                        cmd_args->iobuf_hugepages = GF_IOBUF_HUGEPAGES_OFF;
+                        break;
+                }
+                if (strcmp (arg, "thp") == 0) {
+                        cmd_args->iobuf_hugepages = GF_IOBUF_HUGEPAGES_THP;
+                        break;
+                }
+                if (strcmp (arg, "hugetlb") == 0) {
+                        cmd_args->iobuf_hugepages = GF_IOBUF_HUGEPAGES_HUGETLB;
+                        break;
+                }
+
+                argp_failure (state, -1, 0,
+                              "unknown iobuf-hugepages setting \"%s\"", arg);
+                break;
+
+        case ARGP_IOBUF_NUMA_KEY:
+                if (!arg)
+                        arg = "yes";
+
+                if (gf_string2boolean (arg, &b) == 0) {
+                        cmd_args->iobuf_numa = b;
+                        break;
+                }
+
+                argp_failure (state, -1, 0,
+                              "unknown iobuf-numa setting \"%s\"", arg);
+                break;
+
+        case ARGP_TIMER_DISPATCH_THREADS_KEY:
+                if (gf_string2int (arg, &cmd_args->timer_dispatch_threads)) {
+                        argp_failure (state, -1, 0,
+                                      "unknown timer dispatch thread count "
+                                      "%s", arg);
+                } else if ((cmd_args->timer_dispatch_threads < 0) ||
+                           (cmd_args->timer_dispatch_threads >
+                            GF_TIMER_MAX_DISPATCH_THREADS)) {
+                        argp_failure (state, -1, 0,
+                                      "Invalid timer dispatch thread count "
+                                      "%s. Valid range: [\"0, %d\"]", arg,
+                                      GF_TIMER_MAX_DISPATCH_THREADS);
+                }
+
+                break;
+
+        case ARGP_EVENT_BATCH_SIZE_KEY:
+                if (gf_string2int (arg, &cmd_args->event_batch_size)) {
+                        argp_failure (state, -1, 0,
+                                      "unknown event batch size %s", arg);
+                } else if ((cmd_args->event_batch_size < 1) ||
+                           (cmd_args->event_batch_size > EVENT_MAX_BATCH)) {
+                        argp_failure (state, -1, 0,
+                                      "Invalid event batch size %s. "
+                                      "Valid range: [\"1, %d\"]", arg,
+                                      EVENT_MAX_BATCH);
+                }
+
+                break;
+
+        case ARGP_EVENT_AFFINITY_KEY:
+                if (!arg)
+                        arg = "yes";
+
+                if (gf_string2boolean (arg, &b) == 0) {
+                        cmd_args->event_affinity = b;
+                        break;
+                }
+
+                argp_failure (state, -1, 0,
+                              "unknown event-affinity setting \"%s\"", arg);
+                break;
+
+        case ARGP_EVENT_CPUS_KEY:
+                cmd_args->event_cpus = gf_strdup (arg);
+                break;
+
 	case ARGP_GID_TIMEOUT_KEY:
 		if (!gf_string2int(arg, &cmd_args->gid_timeout)) {
 			cmd_args->gid_timeout_set = _gf_true;
@@ -2605,6 +2698,33 @@ main (int argc, char *argv[])
                 goto out;
         cmd = &ctx->cmd_args;
 
+        /* the pool was created with the defaults, before any iobuf is in
+           use */
+        if (cmd->iobuf_hugepages || cmd->iobuf_numa) {
+                ret = iobuf_pool_set_arena_policy (ctx->iobuf_pool,
+                                                   cmd->iobuf_hugepages,
+                                                   cmd->iobuf_numa);
+                if (ret)
+                        goto out;
+        }
+
+        if (cmd->event_batch_size > 1)
+                event_pool_set_batch_size (ctx->event_pool,
+                                           cmd->event_batch_size);
+
+        /* no fd is registered yet */
+        if (cmd->event_affinity) {
+                ret = event_pool_set_affinity (ctx->event_pool, 1);
+                if (ret)
+                        goto out;
+        }
+
+        if (cmd->event_cpus) {
+                ret = event_pool_set_cpus (ctx->event_pool, cmd->event_cpus);
+                if (ret)
+                        goto out;
+        }
+
         if (cmd->print_xlatordir) {
                 /* XLATORDIR passed through a -D flag to GCC */
                 printf ("%s\n", XLATORDIR);
@@ -105,6 +105,12 @@ enum argp_option_keys {
         ARGP_PRINT_XLATORDIR_KEY          = 183,
         ARGP_PRINT_STATEDUMPDIR_KEY       = 184,
         ARGP_PRINT_LOGDIR_KEY             = 185,
+        ARGP_IOBUF_HUGEPAGES_KEY          = 186,
+        ARGP_IOBUF_NUMA_KEY               = 187,
+        ARGP_TIMER_DISPATCH_THREADS_KEY   = 188,
+        ARGP_EVENT_BATCH_SIZE_KEY         = 189,
+        ARGP_EVENT_AFFINITY_KEY           = 190,
+        ARGP_EVENT_CPUS_KEY               = 191,
 };
 
 struct _gfd_vol_top_priv {
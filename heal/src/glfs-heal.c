@@ -685,13 +685,26 @@ glfsh_print_heal_status (dict_t *dict, char *path, uuid_t gfid,
         char            *status         = NULL;
         char            *value          = NULL;
         char            gfid_str[64]    = {0};
+        uint64_t        pending_size    = 0;
+        uint64_t        size            = 0;
 
         ret = dict_get_str (dict, "heal-info", &value);
         if (ret || (!strcmp (value, "no-heal")))
                 return 0;
 
         if (!strcmp (value, "heal")) {
-                ret = gf_asprintf (&status, " ");
+                /* Disperse reports how much data still has to be rebuilt
+                 * when it only needs to heal some regions of a file. */
+                if (!dict_get_uint64 (dict, "heal-info-pending",
+                                      &pending_size) &&
+                    !dict_get_uint64 (dict, "heal-info-size", &size) &&
+                    (pending_size < size)) {
+                        ret = gf_asprintf (&status, " - %"PRIu64" of %"PRIu64
+                                           " bytes need heal\n",
+                                           pending_size, size);
+                } else {
+                        ret = gf_asprintf (&status, " ");
+                }
                 if (ret < 0)
                         goto out;
         } else if (!strcmp (value, "possibly-healing")) {
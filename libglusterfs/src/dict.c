@@ -29,12 +29,16 @@
 #include "libglusterfs-messages.h"
 
 #include "glusterfs-fops.h"
+#include "iobuf.h"
 
 struct dict_cmp {
         dict_t *dict;
         gf_boolean_t (*value_ignore) (char *k);
 };
 
+static int
+__dict_index_resize (dict_t *this, int32_t count);
+
 #define VALIDATE_DATA_AND_LOG(data, type, key, ret_val) do {                 \
                 if (!data || !data->data) {                             \
                         gf_msg_callingfn ("dict", GF_LOG_WARNING, EINVAL, \
@@ -75,33 +79,16 @@ get_new_dict_full (int size_hint)
                 return NULL;
         }
 
-        dict->hash_size = size_hint;
-        if (size_hint == 1) {
-                /*
-                 * This is the only case we ever see currently.  If we ever
-                 * need to support resizing the hash table, the resize function
-                 * will have to take into account the possibility that
-                 * "members" is not separately allocated (i.e. don't just call
-                 * realloc() blindly.
-                 */
-                dict->members = &dict->members_internal;
-        }
-        else {
-                /*
-                 * We actually need to allocate space for size_hint *pointers*
-                 * but we actually allocate space for one *structure*.  Since
-                 * a data_pair_t consists of five pointers, we're wasting four
-                 * pointers' worth for N=1, and will overrun what we allocated
-                 * for N>5.  If anybody ever starts using size_hint, we'll need
-                 * to fix this.
-                 */
-                GF_ASSERT (size_hint <=
-                           (sizeof(data_pair_t) / sizeof(data_pair_t *)));
-                dict->members = mem_get0 (THIS->ctx->dict_pair_pool);
-                if (!dict->members) {
-                        mem_put (dict);
-                        return NULL;
-                }
+        /*
+         * Small dicts keep their first DICT_INLINE_PAIRS pairs inside the
+         * dict_t and are looked up by scanning them. Only when a dict is
+         * expected to grow past DICT_INDEX_THRESHOLD keys is the open
+         * addressed index allocated up front, otherwise it is set up on
+         * demand by dict_set().
+         */
+        if (size_hint > DICT_INDEX_THRESHOLD) {
+                /* failing that is fine, it is retried as the dict grows */
+                (void) __dict_index_resize (dict, size_hint);
         }
 
         LOCK_INIT (&dict->lock);
@@ -245,6 +232,9 @@ data_destroy (data_t *data)
                 if (!data->is_static)
                         GF_FREE (data->data);
 
+                if (data->iobref)
+                        iobref_unref (data->iobref);
+
                 data->len = 0xbabababa;
                 if (!data->is_const)
                         mem_put (data);
@@ -284,11 +274,332 @@ err_out:
         return NULL;
 }
 
+/*
+ * Keys which accompany most fops in xdata. Their hashes are computed once
+ * and pairs for them point at the interned string instead of a private
+ * copy of the key.
+ */
+static struct dict_interned_key {
+        char     *key;
+        uint32_t  len;
+        uint32_t  hash;
+} dict_interned_keys[] = {
+        { GF_CONTENT_KEY, },
+        { GFID_XATTR_KEY, },
+        { GLUSTERFS_INTERNAL_FOP_KEY, },
+        { GLUSTERFS_DURABLE_OP, },
+        { GLUSTERFS_WRITE_IS_APPEND, },
+        { GLUSTERFS_WRITE_UPDATE_ATOMIC, },
+        { GLUSTERFS_OPEN_FD_COUNT, },
+        { GLUSTERFS_ACTIVE_FD_COUNT, },
+        { GLUSTERFS_INODELK_COUNT, },
+        { GLUSTERFS_ENTRYLK_COUNT, },
+        { GLUSTERFS_POSIXLK_COUNT, },
+        { GLUSTERFS_PARENT_ENTRYLK, },
+        { GLUSTERFS_INODELK_DOM_COUNT, },
+        { GF_PREOP_PARENT_KEY, },
+        { GF_PREOP_CHECK_FAILED, },
+        { GF_GFIDLESS_LOOKUP, },
+        { GF_AFR_DIRTY, },
+        { GF_XATTROP_INDEX_GFID, },
+        { GF_XATTROP_INDEX_COUNT, },
+        { GF_XATTROP_DIRTY_GFID, },
+        { GF_XATTROP_DIRTY_COUNT, },
+        { GF_XATTR_PATHINFO_KEY, },
+        { GF_XATTR_NODE_UUID_KEY, },
+        { VIRTUAL_GFID_XATTR_KEY, },
+        { QUOTA_SIZE_KEY, },
+        { QUOTA_LIMIT_KEY, },
+        { QUOTA_LIMIT_OBJECTS_KEY, },
+        { GET_ANCESTRY_PATH_KEY, },
+        { GET_ANCESTRY_DENTRY_KEY, },
+        { "trusted.glusterfs.dht", },
+        { "trusted.glusterfs.dht.linkto", },
+        { "trusted.ec.version", },
+        { "trusted.ec.size", },
+        { "trusted.ec.dirty", },
+        { "trusted.ec.config", },
+        { "link-count", },
+};
+
+#define DICT_INTERNED_SLOTS    128
+
+static uint8_t        dict_interned_index[DICT_INTERNED_SLOTS];
+static pthread_once_t dict_interned_once = PTHREAD_ONCE_INIT;
+
+/* cheap probe start, the keys mostly differ in length and their tail */
+static uint32_t
+dict_interned_slot (const char *key, uint32_t len)
+{
+        return (len * 131 + key[len - 1] * 31 + key[len >> 1]) &
+                (DICT_INTERNED_SLOTS - 1);
+}
+
+static void
+dict_interned_init (void)
+{
+        struct dict_interned_key *ikey = NULL;
+        uint32_t                  slot = 0;
+        int                       i = 0;
+
+        for (i = 0; i < sizeof (dict_interned_keys) /
+                    sizeof (dict_interned_keys[0]); i++) {
+                ikey = &dict_interned_keys[i];
+                ikey->len = strlen (ikey->key);
+                ikey->hash = SuperFastHash (ikey->key, ikey->len);
+
+                slot = dict_interned_slot (ikey->key, ikey->len);
+                while (dict_interned_index[slot])
+                        slot = (slot + 1) & (DICT_INTERNED_SLOTS - 1);
+                dict_interned_index[slot] = i + 1;
+        }
+}
+
+/*
+ * Hash of @key. Well known keys are matched against the interned table
+ * first, which saves hashing them and lets dict_set() share the interned
+ * copy of the key through @interned.
+ */
+static uint32_t
+dict_key_hash (char *key, char **interned)
+{
+        struct dict_interned_key *ikey = NULL;
+        uint32_t                  len = strlen (key);
+        uint32_t                  slot = 0;
+
+        if (interned)
+                *interned = NULL;
+
+        if (!len)
+                goto out;
+
+        pthread_once (&dict_interned_once, dict_interned_init);
+
+        slot = dict_interned_slot (key, len);
+        while (dict_interned_index[slot]) {
+                ikey = &dict_interned_keys[dict_interned_index[slot] - 1];
+                if ((ikey->len == len) && !memcmp (ikey->key, key, len)) {
+                        if (interned)
+                                *interned = ikey->key;
+                        return ikey->hash;
+                }
+                slot = (slot + 1) & (DICT_INTERNED_SLOTS - 1);
+        }
+out:
+        return SuperFastHash (key, len);
+}
+
+static data_pair_t *
+__dict_pair_new (dict_t *this)
+{
+        data_pair_t *pair = NULL;
+        int          i = 0;
+
+        for (i = 0; i < DICT_INLINE_PAIRS; i++) {
+                if (this->inline_used & (1 << i))
+                        continue;
+
+                this->inline_used |= (1 << i);
+                pair = &this->inline_pairs[i];
+                memset (pair, 0, sizeof (*pair));
+                return pair;
+        }
+
+        return mem_get0 (THIS->ctx->dict_pair_pool);
+}
+
+static void
+__dict_pair_free (dict_t *this, data_pair_t *pair)
+{
+        if (!pair->key_interned && !pair->key_borrowed)
+                GF_FREE (pair->key);
+
+        if ((pair >= this->inline_pairs) &&
+            (pair < this->inline_pairs + DICT_INLINE_PAIRS)) {
+                this->inline_used &= ~(1 << (pair - this->inline_pairs));
+                return;
+        }
+
+        mem_put (pair);
+}
+
+/*
+ * dict_add() can leave several pairs with the same key, of which lookups
+ * have to find the newest. So a pair takes over the slot of an older one
+ * for its key, which then moves further down the probe sequence.
+ */
+static void
+__dict_index_insert (dict_t *this, data_pair_t *pair)
+{
+        data_pair_t *older = NULL;
+        uint32_t     mask = this->hash_size - 1;
+        uint32_t     slot = pair->key_hash & mask;
+
+        while ((older = this->members[slot])) {
+                if ((older->key_hash == pair->key_hash) &&
+                    !strcmp (older->key, pair->key)) {
+                        this->members[slot] = pair;
+                        pair = older;
+                }
+                slot = (slot + 1) & mask;
+        }
+
+        this->members[slot] = pair;
+}
+
+/* linear probing, so close the gap by shifting back whatever follows */
+static void
+__dict_index_remove (dict_t *this, data_pair_t *pair)
+{
+        uint32_t mask = this->hash_size - 1;
+        uint32_t slot = pair->key_hash & mask;
+        uint32_t next = 0;
+        uint32_t home = 0;
+
+        while (this->members[slot] != pair) {
+                if (!this->members[slot])
+                        return;
+                slot = (slot + 1) & mask;
+        }
+
+        next = slot;
+        for (;;) {
+                next = (next + 1) & mask;
+                if (!this->members[next])
+                        break;
+
+                home = this->members[next]->key_hash & mask;
+                /* entries whose home lies cyclically in (slot, next] have
+                 * to stay where they are */
+                if ((slot <= next) ? ((slot < home) && (home <= next))
+                                   : ((slot < home) || (home <= next)))
+                        continue;
+
+                this->members[slot] = this->members[next];
+                slot = next;
+        }
+
+        this->members[slot] = NULL;
+}
+
+static int
+__dict_index_resize (dict_t *this, int32_t count)
+{
+        data_pair_t **members = NULL;
+        data_pair_t  *pair = NULL;
+        int32_t       size = 16;
+
+        while (size < (count * 2))
+                size *= 2;
+
+        if (size <= this->hash_size)
+                return 0;
+
+        members = GF_CALLOC (size, sizeof (*members),
+                             gf_common_mt_dict_index_t);
+        if (!members)
+                return -1;
+
+        GF_FREE (this->members);
+        this->members = members;
+        this->hash_size = size;
+
+        /* oldest first, newer duplicates then take over their slots */
+        for (pair = this->members_list; pair && pair->next; pair = pair->next)
+                ;
+        for (; pair; pair = pair->prev)
+                __dict_index_insert (this, pair);
+
+        return 0;
+}
+
+static void
+__dict_pair_link (dict_t *this, data_pair_t *pair)
+{
+        pair->next = this->members_list;
+        pair->prev = NULL;
+        if (this->members_list)
+                this->members_list->prev = pair;
+        this->members_list = pair;
+        this->count++;
+
+        if (this->max_count < this->count)
+                this->max_count = this->count;
+
+        if (this->hash_size && ((this->count * 2) <= this->hash_size)) {
+                __dict_index_insert (this, pair);
+                return;
+        }
+
+        /* a small dict is just scanned, if the index cannot be had
+         * it keeps being scanned */
+        if (this->count > DICT_INDEX_THRESHOLD) {
+                if (__dict_index_resize (this, this->count) && this->members) {
+                        GF_FREE (this->members);
+                        this->members = NULL;
+                        this->hash_size = 0;
+                }
+        }
+}
+
+static void
+__dict_pair_unlink (dict_t *this, data_pair_t *pair)
+{
+        if (this->hash_size)
+                __dict_index_remove (this, pair);
+
+        if (pair->prev)
+                pair->prev->next = pair->next;
+        else
+                this->members_list = pair->next;
+
+        if (pair->next)
+                pair->next->prev = pair->prev;
+
+        this->count--;
+}
+
+/*
+ * Adds a new pair for @key, which is used as is if @key_owned, shared if
+ * @interned and copied otherwise.
+ */
+static data_pair_t *
+__dict_pair_add (dict_t *this, char *key, uint32_t hash, char *interned,
+                 data_t *value, gf_boolean_t key_owned)
+{
+        data_pair_t *pair = NULL;
+
+        pair = __dict_pair_new (this);
+        if (!pair)
+                return NULL;
+
+        if (key_owned) {
+                pair->key = key;
+        } else if (interned) {
+                pair->key = interned;
+                pair->key_interned = 1;
+        } else {
+                pair->key = gf_strdup (key);
+                if (!pair->key) {
+                        __dict_pair_free (this, pair);
+                        return NULL;
+                }
+        }
+
+        pair->key_hash = hash;
+        pair->value = data_ref (value);
+
+        __dict_pair_link (this, pair);
+
+        return pair;
+}
+
 static data_pair_t *
 dict_lookup_common (dict_t *this, char *key, uint32_t hash)
 {
-        int hashval = 0;
-        data_pair_t *pair;
+        data_pair_t *pair = NULL;
+        uint32_t     mask = 0;
+        uint32_t     slot = 0;
 
         if (!this || !key) {
                 gf_msg_callingfn ("dict", GF_LOG_WARNING, EINVAL,
@@ -297,15 +608,20 @@ dict_lookup_common (dict_t *this, char *key, uint32_t hash)
                 return NULL;
         }
 
-        /* If the divisor is 1, the modulo is always 0,
-         * in such case avoid hash calculation.
-         */
-        if (this->hash_size != 1)
-                hashval = hash % this->hash_size;
+        if (!this->hash_size) {
+                for (pair = this->members_list; pair; pair = pair->next) {
+                        if ((hash == pair->key_hash) &&
+                            !strcmp (pair->key, key))
+                                return pair;
+                }
 
-        for (pair = this->members[hashval]; pair != NULL; pair = pair->hash_next) {
-                if (pair->key && (hash == pair->key_hash) &&
-                    !strcmp (pair->key, key))
+                return NULL;
+        }
+
+        mask = this->hash_size - 1;
+        for (slot = hash & mask; (pair = this->members[slot]);
+             slot = (slot + 1) & mask) {
+                if ((hash == pair->key_hash) && !strcmp (pair->key, key))
                         return pair;
         }
 
@@ -325,7 +641,7 @@ dict_lookup (dict_t *this, char *key, data_t **data)
         data_pair_t *tmp = NULL;
         uint32_t hash = 0;
 
-        hash = SuperFastHash (key, strlen (key));
+        hash = dict_key_hash (key, NULL);
 
         LOCK (&this->lock);
         {
@@ -341,29 +657,10 @@ dict_lookup (dict_t *this, char *key, data_t **data)
 }
 
 static int32_t
-dict_set_lk (dict_t *this, char *key, data_t *value, gf_boolean_t replace)
+dict_set_hashed_lk (dict_t *this, char *key, uint32_t hash, char *interned,
+                    data_t *value, gf_boolean_t replace)
 {
-        int hashval = 0;
-        data_pair_t *pair;
-        char key_free = 0;
-        int ret = 0;
-        uint32_t hash = 0;
-
-        if (!key) {
-                ret = gf_asprintf (&key, "ref:%p", value);
-                if (-1 == ret) {
-                        return -1;
-                }
-                key_free = 1;
-        }
-
-        /* If the divisor is 1, the modulo is always 0,
-         * in such case avoid hash calculation.
-         */
-        hash = SuperFastHash (key, strlen (key));
-        if (this->hash_size != 1) {
-                hashval = (hash % this->hash_size);
-        }
+        data_pair_t *pair = NULL;
 
         /* Search for a existing key if 'replace' is asked for */
         if (replace) {
@@ -373,63 +670,56 @@ dict_set_lk (dict_t *this, char *key, data_t *value, gf_boolean_t replace)
                         data_t *unref_data = pair->value;
                         pair->value = data_ref (value);
                         data_unref (unref_data);
-                        if (key_free)
-                                GF_FREE (key);
                         /* Indicates duplicate key */
                         return 0;
                 }
         }
 
-        if (this->free_pair_in_use) {
-                pair = mem_get0 (THIS->ctx->dict_pair_pool);
-                if (!pair) {
-                        if (key_free)
-                                GF_FREE (key);
-                        return -1;
-                }
-        }
-        else {
-                pair = &this->free_pair;
-                this->free_pair_in_use = _gf_true;
+        pair = __dict_pair_add (this, key, hash, interned, value, _gf_false);
+        if (!pair)
+                return -1;
+
+        return 0;
+}
+
+static int32_t
+dict_set_lk (dict_t *this, char *key, data_t *value, gf_boolean_t replace)
+{
+        data_pair_t *pair = NULL;
+        char *interned = NULL;
+        int ret = 0;
+        uint32_t hash = 0;
+
+        if (key) {
+                hash = dict_key_hash (key, &interned);
+                return dict_set_hashed_lk (this, key, hash, interned, value,
+                                           replace);
         }
 
-        if (key_free) {
-                /* It's ours.  Use it. */
-                pair->key = key;
-                key_free = 0;
+        ret = gf_asprintf (&key, "ref:%p", value);
+        if (-1 == ret) {
+                return -1;
         }
-        else {
-                pair->key = (char *) GF_CALLOC (1, strlen (key) + 1,
-                                                gf_common_mt_char);
-                if (!pair->key) {
-                        if (pair == &this->free_pair) {
-                                this->free_pair_in_use = _gf_false;
-                        }
-                        else {
-                                mem_put (pair);
-                        }
-                        return -1;
+
+        hash = dict_key_hash (key, NULL);
+        if (replace) {
+                pair = dict_lookup_common (this, key, hash);
+                if (pair) {
+                        data_t *unref_data = pair->value;
+                        pair->value = data_ref (value);
+                        data_unref (unref_data);
+                        GF_FREE (key);
+                        return 0;
                 }
-                strcpy (pair->key, key);
         }
-        pair->key_hash = hash;
-        pair->value = data_ref (value);
-
-        pair->hash_next = this->members[hashval];
-        this->members[hashval] = pair;
-
-        pair->next = this->members_list;
-        pair->prev = NULL;
-        if (this->members_list)
-                this->members_list->prev = pair;
-        this->members_list = pair;
-        this->count++;
 
-        if (key_free)
+        /* It's ours.  Use it. */
+        pair = __dict_pair_add (this, key, hash, NULL, value, _gf_true);
+        if (!pair) {
                 GF_FREE (key);
+                return -1;
+        }
 
-        if (this->max_count < this->count)
-                this->max_count = this->count;
         return 0;
 }
 
@@ -457,6 +747,65 @@ dict_set (dict_t *this,
 }
 
 
+/*
+ * Same as dict_set (), except that @key is not copied: it points into one
+ * of the buffers of @iobref, on which the dict keeps a reference. A dict
+ * only ever refers to a single iobref, keys living anywhere else are
+ * copied as usual.
+ */
+int32_t
+dict_set_iobref (dict_t *this, char *key, data_t *value,
+                 struct iobref *iobref)
+{
+        data_pair_t *pair = NULL;
+        data_t      *unref_data = NULL;
+        char        *interned = NULL;
+        uint32_t     hash = 0;
+        int32_t      ret = -1;
+
+        if (!this || !key || !value || !iobref) {
+                gf_msg_callingfn ("dict", GF_LOG_WARNING, EINVAL,
+                                  LG_MSG_INVALID_ARG, "!this || !key || "
+                                  "!value || !iobref");
+                return -1;
+        }
+
+        hash = dict_key_hash (key, &interned);
+
+        LOCK (&this->lock);
+        {
+                if (!interned && !this->iobref)
+                        this->iobref = iobref_ref (iobref);
+
+                if (interned || (this->iobref != iobref)) {
+                        ret = dict_set_hashed_lk (this, key, hash, interned,
+                                                  value, _gf_true);
+                        goto unlock;
+                }
+
+                pair = dict_lookup_common (this, key, hash);
+                if (pair) {
+                        unref_data = pair->value;
+                        pair->value = data_ref (value);
+                        data_unref (unref_data);
+                        ret = 0;
+                        goto unlock;
+                }
+
+                pair = __dict_pair_add (this, key, hash, NULL, value,
+                                        _gf_true);
+                if (!pair)
+                        goto unlock;
+
+                pair->key_borrowed = 1;
+                ret = 0;
+        }
+unlock:
+        UNLOCK (&this->lock);
+
+        return ret;
+}
+
 int32_t
 dict_add (dict_t *this, char *key, data_t *value)
 {
@@ -492,7 +841,7 @@ dict_get (dict_t *this, char *key)
                 return NULL;
         }
 
-        hash = SuperFastHash (key, strlen (key));
+        hash = dict_key_hash (key, NULL);
 
         LOCK (&this->lock);
         {
@@ -529,7 +878,7 @@ dict_key_count (dict_t *this)
 void
 dict_del (dict_t *this, char *key)
 {
-        int hashval = 0;
+        data_pair_t *pair = NULL;
         uint32_t hash = 0;
 
         if (!this || !key) {
@@ -538,48 +887,15 @@ dict_del (dict_t *this, char *key)
                 return;
         }
 
-        LOCK (&this->lock);
-
-        /* If the divisor is 1, the modulo is always 0,
-         * in such case avoid hash calculation.
-         */
-        hash = SuperFastHash (key, strlen (key));
-        if (this->hash_size != 1)
-                hashval = hash % this->hash_size;
-
-        data_pair_t *pair = this->members[hashval];
-        data_pair_t *prev = NULL;
-
-        while (pair) {
-                if ((hash == pair->key_hash) && strcmp (pair->key, key) == 0) {
-                        if (prev)
-                                prev->hash_next = pair->hash_next;
-                        else
-                                this->members[hashval] = pair->hash_next;
-
-                        data_unref (pair->value);
+        hash = dict_key_hash (key, NULL);
 
-                        if (pair->prev)
-                                pair->prev->next = pair->next;
-                        else
-                                this->members_list = pair->next;
-
-                        if (pair->next)
-                                pair->next->prev = pair->prev;
-
-                        GF_FREE (pair->key);
-                        if (pair == &this->free_pair) {
-                                this->free_pair_in_use = _gf_false;
-                        }
-                        else {
-                                mem_put (pair);
-                        }
-                        this->count--;
-                        break;
-                }
+        LOCK (&this->lock);
 
-                prev = pair;
-                pair = pair->hash_next;
+        pair = dict_lookup_common (this, key, hash);
+        if (pair) {
+                __dict_pair_unlink (this, pair);
+                data_unref (pair->value);
+                __dict_pair_free (this, pair);
         }
 
         UNLOCK (&this->lock);
@@ -607,17 +923,15 @@ dict_destroy (dict_t *this)
         while (prev) {
                 pair = pair->next;
                 data_unref (prev->value);
-                GF_FREE (prev->key);
-                if (prev != &this->free_pair) {
-                        mem_put (prev);
-                }
+                __dict_pair_free (this, prev);
                 total_pairs++;
                 prev = pair;
         }
 
-        if (this->members != &this->members_internal) {
-                mem_put (this->members);
-        }
+        GF_FREE (this->members);
+
+        if (this->iobref)
+                iobref_unref (this->iobref);
 
         GF_FREE (this->extra_free);
         free (this->extra_stdfree);
@@ -972,6 +1286,36 @@ data_from_dynptr (void *value, int32_t len)
         return data;
 }
 
+/*
+ * The data points into one of the buffers of @iobref (a received message,
+ * say), which is kept around for as long as the data is. @value has to be
+ * NUL terminated for GF_DATA_TYPE_STR.
+ */
+data_t *
+data_from_iobref (void *value, int32_t len, gf_dict_data_type_t type,
+                  struct iobref *iobref)
+{
+        data_t *data = NULL;
+
+        if (!value || !iobref) {
+                gf_msg_callingfn ("dict", GF_LOG_WARNING, EINVAL,
+                                  LG_MSG_INVALID_ARG, "!value || !iobref");
+                return NULL;
+        }
+
+        data = get_new_data ();
+        if (!data)
+                return NULL;
+
+        data->is_static = 1;
+        data->len = len;
+        data->data = value;
+        data->data_type = type;
+        data->iobref = iobref_ref (iobref);
+
+        return data;
+}
+
 data_t *
 bin_to_data (void *value, int32_t len)
 {
@@ -1351,10 +1695,29 @@ dict_keys_join (void *value, int size, dict_t *dict,
 	return len;
 }
 
+/* pairs are copied with their precomputed hash and, for interned keys,
+ * without copying the key either */
 static int
-dict_copy_one (dict_t *unused, char *key, data_t *value, void *newdict)
+dict_copy_pairs (dict_t *dict, dict_t *new)
 {
-        return dict_set ((dict_t *)newdict, key, (value));
+        data_pair_t *pair = NULL;
+        int          ret = 0;
+
+        LOCK (&new->lock);
+        {
+                for (pair = dict->members_list; pair; pair = pair->next) {
+                        ret = dict_set_hashed_lk (new, pair->key,
+                                                  pair->key_hash,
+                                                  pair->key_interned ?
+                                                  pair->key : NULL,
+                                                  pair->value, _gf_true);
+                        if (ret < 0)
+                                break;
+                }
+        }
+        UNLOCK (&new->lock);
+
+        return ret;
 }
 
 dict_t *
@@ -1368,9 +1731,10 @@ dict_copy (dict_t *dict,
         }
 
         if (!new)
-                new = get_new_dict_full (dict->hash_size);
+                new = get_new_dict_full (dict->count);
 
-        dict_foreach (dict, dict_copy_one, new);
+        if (new)
+                dict_copy_pairs (dict, new);
 
         return new;
 }
@@ -1404,7 +1768,7 @@ dict_copy_with_ref (dict_t *dict,
                 new = local_new;
         }
 
-        dict_foreach (dict, dict_copy_one, new);
+        dict_copy_pairs (dict, new);
 fail:
         return new;
 }
@@ -1436,7 +1800,7 @@ dict_get_with_ref (dict_t *this, char *key, data_t **data)
                 goto err;
         }
 
-        hash = SuperFastHash (key, strlen (key));
+        hash = dict_key_hash (key, NULL);
 
         LOCK (&this->lock);
         {
@@ -2064,7 +2428,7 @@ _dict_modify_flag (dict_t *this, char *key, int flag, int op)
         uint32_t        hash            = 0;
         data_pair_t     *pair           = NULL;
         char            *ptr            = NULL;
-        int             hashval         = 0;
+        char            *interned       = NULL;
 
         if (!this || !key) {
                 gf_msg_callingfn ("dict", GF_LOG_WARNING, EINVAL,
@@ -2080,7 +2444,7 @@ _dict_modify_flag (dict_t *this, char *key, int flag, int op)
          */
         GF_ASSERT(flag >= 0 && flag < DICT_MAX_FLAGS);
 
-        hash = SuperFastHash (key, strlen (key));
+        hash = dict_key_hash (key, &interned);
         LOCK (&this->lock);
         {
                 pair = dict_lookup_common (this, key, hash);
@@ -2119,47 +2483,15 @@ _dict_modify_flag (dict_t *this, char *key, int flag, int op)
                         else
                                 BIT_CLEAR((unsigned char *)(data->data), flag);
 
-                        if (this->free_pair_in_use) {
-                                pair = mem_get0 (THIS->ctx->dict_pair_pool);
-                                if (!pair) {
-                                        gf_msg("dict", GF_LOG_ERROR, ENOMEM,
-                                               LG_MSG_NO_MEMORY,
-                                               "unable to allocate dict pair");
-                                        ret = -ENOMEM;
-                                        goto err;
-                                }
-                        } else {
-                                pair = &this->free_pair;
-                                this->free_pair_in_use = _gf_true;
-                        }
-
-                        pair->key = (char *)GF_CALLOC(1, strlen (key) + 1,
-                                                      gf_common_mt_char);
-                        if (!pair->key) {
+                        pair = __dict_pair_add (this, key, hash, interned,
+                                                data, _gf_false);
+                        if (!pair) {
                                 gf_msg("dict", GF_LOG_ERROR, ENOMEM,
                                        LG_MSG_NO_MEMORY,
                                        "unable to allocate dict pair");
                                 ret = -ENOMEM;
                                 goto err;
                         }
-                        strcpy (pair->key, key);
-                        pair->key_hash = hash;
-                        pair->value = data_ref (data);
-
-                        hashval = hash % this->hash_size;
-                        pair->hash_next = this->members[hashval];
-                        this->members[hashval] = pair;
-
-                        pair->next = this->members_list;
-                        pair->prev = NULL;
-                        if (this->members_list)
-                                this->members_list->prev = pair;
-                        this->members_list = pair;
-                        this->count++;
-
-
-                        if (this->max_count < this->count)
-                                this->max_count = this->count;
                 }
         }
 
@@ -2168,16 +2500,6 @@ _dict_modify_flag (dict_t *this, char *key, int flag, int op)
 
 err:
         UNLOCK (&this->lock);
-        if (pair) {
-                if (pair->key)
-                        free(pair->key);
-
-                if (pair == &this->free_pair) {
-                        this->free_pair_in_use = _gf_false;
-                } else {
-                        mem_put (pair);
-                }
-        }
 
         if (data)
                 data_destroy(data);
@@ -2738,7 +3060,7 @@ dict_rename_key (dict_t *this, char *key, char *replace_key)
         if (strcmp (key, replace_key) == 0)
                 return 0;
 
-        hash = SuperFastHash (key, strlen (key));
+        hash = dict_key_hash (key, NULL);
 
         LOCK (&this->lock);
         {
@@ -3427,7 +3749,7 @@ dict_has_key_from_array (dict_t *dict, char **strings, gf_boolean_t *result)
         LOCK (&dict->lock);
         {
                 for (i = 0; strings[i]; i++) {
-                        hash = SuperFastHash (strings[i], strlen (strings[i]));
+                        hash = dict_key_hash (strings[i], NULL);
                         if (dict_lookup_common (dict, strings[i], hash)) {
                                 *result = _gf_true;
                                 goto unlock;
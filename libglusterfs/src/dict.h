@@ -22,6 +22,8 @@ typedef struct _data data_t;
 typedef struct _dict dict_t;
 typedef struct _data_pair data_pair_t;
 
+struct iobref;
+
 
 #define GF_PROTOCOL_DICT_SERIALIZE(this,from_dict,to,len,ope,labl) do { \
                 int    _ret     = 0;                                     \
@@ -75,31 +77,38 @@ struct _data {
         gf_atomic_t    refcount;
         gf_lock_t      lock;
         gf_dict_data_type_t data_type;
+        struct iobref *iobref;          /* holds what data points into */
 };
 
+/* pairs stored inside the dict_t itself before falling back to the pool */
+#define DICT_INLINE_PAIRS      5
+/* past this many keys lookups go through the open addressed index */
+#define DICT_INDEX_THRESHOLD   8
+
 struct _data_pair {
-        struct _data_pair *hash_next;
         struct _data_pair *prev;
         struct _data_pair *next;
         data_t            *value;
         char              *key;
         uint32_t           key_hash;
+        unsigned char      key_interned:1;  /* key is not ours to free */
+        unsigned char      key_borrowed:1;  /* key points into dict's iobref */
 };
 
 struct _dict {
         unsigned char   is_static:1;
-        int32_t         hash_size;
+        int32_t         hash_size;      /* slots in members, 0 if none */
         int32_t         count;
         gf_atomic_t     refcount;
-        data_pair_t   **members;
+        data_pair_t   **members;        /* open addressed, by key_hash */
         data_pair_t    *members_list;
         char           *extra_free;
         char           *extra_stdfree;
         gf_lock_t       lock;
-        data_pair_t    *members_internal;
-        data_pair_t     free_pair;
-        gf_boolean_t    free_pair_in_use;
+        uint32_t        inline_used;    /* bitmap of inline_pairs */
+        data_pair_t     inline_pairs[DICT_INLINE_PAIRS];
         uint64_t        max_count;
+        struct iobref  *iobref;         /* holds what borrowed keys point into */
 };
 
 typedef gf_boolean_t (*dict_match_t) (dict_t *d, char *k, data_t *v,
@@ -112,6 +121,9 @@ void data_destroy (data_t *data);
 int32_t dict_set (dict_t *this, char *key, data_t *value);
 /* function to set a new key/value pair (without checking for duplicate) */
 int32_t dict_add (dict_t *this, char *key, data_t *value);
+/* like dict_set, but key is not copied: it lives in a buffer of iobref */
+int32_t dict_set_iobref (dict_t *this, char *key, data_t *value,
+                         struct iobref *iobref);
 
 int dict_get_with_ref (dict_t *this, char *key, data_t **data);
 data_t *dict_get (dict_t *this, char *key);
@@ -139,6 +151,8 @@ data_t *int_to_data (int64_t value);
 data_t *str_to_data (char *value);
 data_t *data_from_dynstr (char *value);
 data_t *data_from_dynptr (void *value, int32_t len);
+data_t *data_from_iobref (void *value, int32_t len,
+                          gf_dict_data_type_t type, struct iobref *iobref);
 data_t *bin_to_data (void *value, int32_t len);
 data_t *static_str_to_data (char *value);
 data_t *static_bin_to_data (void *value);
@@ -21,11 +21,14 @@
 #include "mem-pool.h"
 #include "common-utils.h"
 #include "syscall.h"
+#include "statedump.h"
 #include "libglusterfs-messages.h"
 
 
 #ifdef HAVE_SYS_EPOLL_H
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sched.h>
 
 
 struct event_slot_epoll {
@@ -36,6 +39,10 @@ struct event_slot_epoll {
 	int do_close;
 	int in_handler;
         int handled_error;
+        int owned;      /* a batched dispatch runs the handler */
+        int rearm;      /* ... and will re-arm the fd once it returns */
+        int worker;     /* index of the worker polling it, affinity mode */
+        int added;      /* fd is in the epoll instance of that worker */
 	void *data;
 	event_handler_t handler;
 	gf_lock_t lock;
@@ -46,6 +53,133 @@ struct event_thread_data {
         int    event_index;
 };
 
+
+/* ev_data->idx of the wakeup eventfd of a worker */
+#define EVENT_WORKER_WAKEUP -1
+
+
+static int
+event_slot_epfd (struct event_pool *event_pool, struct event_slot_epoll *slot)
+{
+        if (event_pool->affinity)
+                return event_pool->workers[slot->worker].epfd;
+
+        return event_pool->fd;
+}
+
+
+static int
+__event_worker_init (struct event_pool *event_pool, int i)
+{
+        struct event_worker *worker = &event_pool->workers[i];
+        struct epoll_event   epoll_event = {0, };
+        struct event_data   *ev_data = (void *)&epoll_event.data;
+
+        if (worker->epfd != -1)
+                return 0;
+
+        worker->wakefd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (worker->wakefd == -1)
+                goto err;
+
+        worker->epfd = epoll_create (event_pool->count);
+        if (worker->epfd == -1)
+                goto err;
+
+        epoll_event.events = EPOLLIN;
+        ev_data->idx = EVENT_WORKER_WAKEUP;
+        ev_data->gen = 0;
+
+        if (epoll_ctl (worker->epfd, EPOLL_CTL_ADD, worker->wakefd,
+                       &epoll_event) == -1)
+                goto err;
+
+        return 0;
+err:
+        gf_msg ("epoll", GF_LOG_ERROR, errno, LG_MSG_EPOLL_FD_CREATE_FAILED,
+                "epoll fd creation failed for thread with index %d", i + 1);
+
+        if (worker->epfd != -1)
+                sys_close (worker->epfd);
+        if (worker->wakefd != -1)
+                sys_close (worker->wakefd);
+        worker->epfd = -1;
+        worker->wakefd = -1;
+
+        return -1;
+}
+
+
+/* Picks the worker with the fewest fds, among the ones which are not
+ * about to exit. */
+static int
+__event_worker_pick (struct event_pool *event_pool, int exclude)
+{
+        int count = event_pool->eventthreadcount;
+        int best = -1;
+        int i = 0;
+
+        if (count > EVENT_MAX_THREADS)
+                count = EVENT_MAX_THREADS;
+
+        for (i = 0; i < count; i++) {
+                if (i == exclude)
+                        continue;
+
+                if ((best != -1) &&
+                    (event_pool->workers[i].connections >=
+                     event_pool->workers[best].connections))
+                        continue;
+
+                if (__event_worker_init (event_pool, i))
+                        continue;
+
+                best = i;
+        }
+
+        return best;
+}
+
+
+static void
+event_worker_wakeup (struct event_pool *event_pool, int i)
+{
+        if (event_pool->workers[i].wakefd != -1)
+                eventfd_write (event_pool->workers[i].wakefd, 1);
+}
+
+
+static void
+__event_worker_pin (struct event_pool *event_pool, int i, pthread_t thread)
+{
+        cpu_set_t  cpuset;
+        int        cpu = -1;
+        int        ret = 0;
+
+        CPU_ZERO (&cpuset);
+
+        if (event_pool->cpu_count) {
+                cpu = event_pool->cpus[i % event_pool->cpu_count];
+                CPU_SET (cpu, &cpuset);
+        } else if (event_pool->workers[i].cpu != -1) {
+                /* unpin */
+                for (ret = 0; ret < CPU_SETSIZE; ret++)
+                        CPU_SET (ret, &cpuset);
+        } else {
+                return;
+        }
+
+        ret = pthread_setaffinity_np (thread, sizeof (cpuset), &cpuset);
+        if (ret) {
+                gf_msg ("epoll", GF_LOG_WARNING, ret, LG_MSG_INVALID_ARG,
+                        "failed to pin thread with index %d to cpu %d",
+                        i + 1, cpu);
+                return;
+        }
+
+        event_pool->workers[i].cpu = cpu;
+}
+
 static struct event_slot_epoll *
 __event_newtable (struct event_pool *event_pool, int table_idx)
 {
@@ -70,7 +204,7 @@ __event_newtable (struct event_pool *event_pool, int table_idx)
 
 
 static int
-__event_slot_alloc (struct event_pool *event_pool, int fd)
+__event_slot_alloc (struct event_pool *event_pool, int fd, int worker)
 {
         int  i = 0;
 	int  table_idx = -1;
@@ -115,7 +249,10 @@ __event_slot_alloc (struct event_pool *event_pool, int fd)
 			LOCK_INIT (&table[i].lock);
 
 			table[i].fd = fd;
+			table[i].worker = worker;
 			event_pool->slots_used[table_idx]++;
+			if (event_pool->affinity)
+				event_pool->workers[worker].connections++;
 
 			break;
 		}
@@ -129,11 +266,19 @@ static int
 event_slot_alloc (struct event_pool *event_pool, int fd)
 {
 	int  idx = -1;
+        int  worker = 0;
 
 	pthread_mutex_lock (&event_pool->mutex);
 	{
-		idx = __event_slot_alloc (event_pool, fd);
+                if (event_pool->affinity) {
+                        worker = __event_worker_pick (event_pool, -1);
+                        if (worker == -1)
+                                goto unlock;
+                }
+
+		idx = __event_slot_alloc (event_pool, fd, worker);
 	}
+unlock:
 	pthread_mutex_unlock (&event_pool->mutex);
 
 	return idx;
@@ -163,6 +308,8 @@ __event_slot_dealloc (struct event_pool *event_pool, int idx)
         slot->handled_error = 0;
         slot->in_handler = 0;
 	event_pool->slots_used[table_idx]--;
+        if (event_pool->affinity)
+                event_pool->workers[slot->worker].connections--;
 
 	return;
 }
@@ -238,6 +385,7 @@ event_pool_new_epoll (int count, int eventthreadcount)
 {
         struct event_pool *event_pool = NULL;
         int                epfd = -1;
+        int                i = 0;
 
         event_pool = GF_CALLOC (1, sizeof (*event_pool),
                                 gf_common_mt_event_pool);
@@ -264,6 +412,20 @@ event_pool_new_epoll (int count, int eventthreadcount)
         event_pool->eventthreadcount = eventthreadcount;
         event_pool->auto_thread_count = 0;
 
+        GF_ATOMIC_INIT (event_pool->stats.wakeups, 0);
+        GF_ATOMIC_INIT (event_pool->stats.events, 0);
+        GF_ATOMIC_INIT (event_pool->stats.rearms, 0);
+        GF_ATOMIC_INIT (event_pool->stats.deferred, 0);
+        for (i = 0; i < EVENT_BATCH_HIST; i++)
+                GF_ATOMIC_INIT (event_pool->stats.batch_hist[i], 0);
+
+        for (i = 0; i < EVENT_MAX_THREADS; i++) {
+                event_pool->workers[i].epfd = -1;
+                event_pool->workers[i].wakefd = -1;
+                event_pool->workers[i].cpu = -1;
+                GF_ATOMIC_INIT (event_pool->workers[i].events, 0);
+        }
+
         pthread_mutex_init (&event_pool->mutex, NULL);
 
 out:
@@ -373,11 +535,13 @@ event_register_epoll (struct event_pool *event_pool, int fd,
 		ev_data->idx = idx;
 		ev_data->gen = slot->gen;
 
-		ret = epoll_ctl (event_pool->fd, EPOLL_CTL_ADD, fd,
-				 &epoll_event);
+		ret = epoll_ctl (event_slot_epfd (event_pool, slot),
+				 EPOLL_CTL_ADD, fd, &epoll_event);
 		/* check ret after UNLOCK() to avoid deadlock in
 		   event_slot_unref()
 		*/
+		if (ret == 0)
+			slot->added = 1;
 	}
 	UNLOCK (&slot->lock);
 
@@ -410,16 +574,19 @@ event_unregister_epoll_common (struct event_pool *event_pool, int fd,
 
 	LOCK (&slot->lock);
 	{
-                ret = epoll_ctl (event_pool->fd, EPOLL_CTL_DEL, fd, NULL);
+                ret = epoll_ctl (event_slot_epfd (event_pool, slot),
+                                 EPOLL_CTL_DEL, fd, NULL);
 
                 if (ret == -1) {
                         gf_msg ("epoll", GF_LOG_ERROR, errno,
                                 LG_MSG_EPOLL_FD_DEL_FAILED, "fail to del "
                                 "fd(=%d) from epoll fd(=%d)", fd,
-                                event_pool->fd);
+                                event_slot_epfd (event_pool, slot));
                         goto unlock;
                 }
 
+                slot->added = 0;
+
 		slot->do_close = do_close;
 		slot->gen++; /* detect unregister in dispatch_handler() */
         }
@@ -480,6 +647,16 @@ event_select_on_epoll (struct event_pool *event_pool, int fd, int idx,
 		ev_data->idx = idx;
 		ev_data->gen = slot->gen;
 
+                if (slot->owned) {
+                        /* the batched dispatch re-arms the fd with the
+                         * updated events when the handler returns */
+                        if (!slot->in_handler) {
+                                slot->rearm = 1;
+                                GF_ATOMIC_INC (event_pool->stats.deferred);
+                        }
+                        goto unlock;
+                }
+
 		if (slot->in_handler)
 			/*
 			 * in_handler indicates at least one thread
@@ -495,8 +672,8 @@ event_select_on_epoll (struct event_pool *event_pool, int fd, int idx,
 			 */
 			goto unlock;
 
-		ret = epoll_ctl (event_pool->fd, EPOLL_CTL_MOD, fd,
-				 &epoll_event);
+		ret = epoll_ctl (event_slot_epfd (event_pool, slot),
+				 EPOLL_CTL_MOD, fd, &epoll_event);
 		if (ret == -1) {
 			gf_msg ("epoll", GF_LOG_ERROR, errno,
                                 LG_MSG_EPOLL_FD_MODIFY_FAILED, "failed to "
@@ -514,9 +691,71 @@ out:
 }
 
 
+/* Ends the ownership of a batched dispatch over the slot: the fd gets
+ * re-armed once, if event_handled () was called for it meanwhile, with
+ * whatever events event_select_on () left in the slot. */
+static void
+event_slot_rearm (struct event_pool *event_pool, struct event_slot_epoll *slot,
+                  int fd, int idx, int gen)
+{
+        struct epoll_event epoll_event = {0, };
+        struct event_data *ev_data     = (void *)&epoll_event.data;
+        int                ret         = 0;
+
+	LOCK (&slot->lock);
+	{
+                slot->owned = 0;
+
+                if (!slot->rearm)
+                        goto unlock;
+                slot->rearm = 0;
+
+                /* unregistered by the handler, or handled by yet
+                 * another event_handled () */
+                if ((gen != slot->gen) || (slot->fd != fd) ||
+                    slot->in_handler)
+                        goto unlock;
+
+                epoll_event.events = slot->events;
+                ev_data->idx = idx;
+                ev_data->gen = gen;
+
+                ret = epoll_ctl (event_slot_epfd (event_pool, slot),
+                                 EPOLL_CTL_MOD, fd, &epoll_event);
+                GF_ATOMIC_INC (event_pool->stats.rearms);
+                if (ret == -1) {
+			gf_msg ("epoll", GF_LOG_ERROR, errno,
+                                LG_MSG_EPOLL_FD_MODIFY_FAILED, "failed to "
+                                "modify fd(=%d) events to %d", fd,
+                                epoll_event.events);
+                }
+	}
+unlock:
+	UNLOCK (&slot->lock);
+}
+
+
+static void
+event_account_wakeup (struct event_pool *event_pool, int count)
+{
+        int bucket = 0;
+
+        while ((bucket < EVENT_BATCH_HIST - 1) && (count >> (bucket + 1)))
+                bucket++;
+
+        GF_ATOMIC_INC (event_pool->stats.wakeups);
+        GF_ATOMIC_ADD (event_pool->stats.events, count);
+        GF_ATOMIC_INC (event_pool->stats.batch_hist[bucket]);
+
+        /* racy, but only ever grows */
+        if (count > event_pool->stats.max_batch)
+                event_pool->stats.max_batch = count;
+}
+
+
 static int
 event_dispatch_epoll_handler (struct event_pool *event_pool,
-                              struct epoll_event *event)
+                              struct epoll_event *event, int batched)
 {
         struct event_data  *ev_data = NULL;
 	struct event_slot_epoll *slot = NULL;
@@ -567,6 +806,12 @@ event_dispatch_epoll_handler (struct event_pool *event_pool,
                         slot->handled_error = (event->events
                                                & (EPOLLERR|EPOLLHUP));
                         slot->in_handler++;
+                        /* EPOLLONESHOT already keeps other pollers away
+                         * from the fd, keep it that way until handler()
+                         * returns, instead of until it calls
+                         * event_handled () */
+                        if (batched)
+                                slot->owned = 1;
                 }
 	}
 pre_unlock:
@@ -580,6 +825,9 @@ pre_unlock:
                                (event->events & (EPOLLIN|EPOLLPRI)),
                                (event->events & (EPOLLOUT)),
                                (event->events & (EPOLLERR|EPOLLHUP)));
+
+                if (batched)
+                        event_slot_rearm (event_pool, slot, fd, idx, gen);
         }
 out:
 	event_slot_unref (event_pool, slot, idx);
@@ -588,12 +836,113 @@ out:
 }
 
 
+/* Moves a slot over to the epoll instance of worker @to. A handler which
+ * is still running re-arms the fd there, with event_handled (). */
+static void
+__event_slot_move (struct event_pool *event_pool, struct event_slot_epoll *slot,
+                   int idx, int to)
+{
+        struct event_worker *from = &event_pool->workers[slot->worker];
+        struct epoll_event   epoll_event = {0, };
+        struct event_data   *ev_data = (void *)&epoll_event.data;
+        int                  ret = 0;
+
+        if (slot->added) {
+                epoll_ctl (from->epfd, EPOLL_CTL_DEL, slot->fd, NULL);
+
+                if (slot->in_handler || slot->owned)
+                        epoll_event.events = EPOLLONESHOT;
+                else
+                        epoll_event.events = slot->events;
+                ev_data->idx = idx;
+                ev_data->gen = slot->gen;
+
+                ret = epoll_ctl (event_pool->workers[to].epfd, EPOLL_CTL_ADD,
+                                 slot->fd, &epoll_event);
+                if (ret == -1) {
+                        gf_msg ("epoll", GF_LOG_ERROR, errno,
+                                LG_MSG_EPOLL_FD_ADD_FAILED, "failed to move "
+                                "fd(=%d) to thread with index %d", slot->fd,
+                                to + 1);
+                        slot->added = 0;
+                }
+        }
+
+        from->connections--;
+        event_pool->workers[to].connections++;
+        slot->worker = to;
+}
+
+
+/* Hands the fds of a worker which is about to exit over to the others,
+ * the least loaded one first. Nothing is moved when no other worker is
+ * left, as when the event pool is destroyed. */
+static void
+event_worker_migrate (struct event_pool *event_pool, int from)
+{
+	struct event_slot_epoll *table = NULL;
+	struct event_slot_epoll *slot = NULL;
+        int                      to = -1;
+        int                      moved = 0;
+        int                      i = 0;
+        int                      j = 0;
+
+	pthread_mutex_lock (&event_pool->mutex);
+	{
+                for (i = 0; i < EVENT_EPOLL_TABLES; i++) {
+                        table = event_pool->ereg[i];
+                        if (!table || !event_pool->slots_used[i])
+                                continue;
+
+                        for (j = 0; j < EVENT_EPOLL_SLOTS; j++) {
+                                slot = &table[j];
+
+                                to = 0;
+
+                                LOCK (&slot->lock);
+                                {
+                                        if ((slot->fd == -1) ||
+                                            (slot->worker != from))
+                                                goto next;
+
+                                        to = __event_worker_pick (event_pool,
+                                                                  from);
+                                        if (to == -1)
+                                                goto next;
+
+                                        __event_slot_move (event_pool, slot,
+                                                           i * EVENT_EPOLL_SLOTS + j,
+                                                           to);
+                                        moved++;
+                                }
+                        next:
+                                UNLOCK (&slot->lock);
+
+                                if (to == -1)
+                                        goto unlock;
+                        }
+                }
+	}
+unlock:
+	pthread_mutex_unlock (&event_pool->mutex);
+
+        if (moved)
+                gf_msg_debug ("epoll", 0, "moved %d fds off thread with "
+                              "index %d", moved, from + 1);
+}
+
+
 static void *
 event_dispatch_epoll_worker (void *data)
 {
-        struct epoll_event  event;
+        struct epoll_event  events[EVENT_MAX_BATCH];
         int                 ret = -1;
+        int                 batch = 1;
+        int                 epfd = -1;
+        int                 i = 0;
+        eventfd_t           wakeups = 0;
         struct event_thread_data *ev_data = data;
+        struct event_worker *worker = NULL;
 	struct event_pool  *event_pool;
         int                 myindex = -1;
         int                 timetodie = 0;
@@ -608,9 +957,20 @@ event_dispatch_epoll_worker (void *data)
         gf_msg ("epoll", GF_LOG_INFO, 0, LG_MSG_STARTED_EPOLL_THREAD, "Started"
                 " thread with index %d", myindex);
 
+        worker = &event_pool->workers[myindex - 1];
+        epfd = event_pool->fd;
+
         pthread_mutex_lock (&event_pool->mutex);
         {
                 event_pool->activethreadcount++;
+
+                /* fds are only assigned to workers which have an epoll
+                 * instance, without it this one just idles */
+                if (event_pool->affinity &&
+                    !__event_worker_init (event_pool, myindex - 1))
+                        epfd = worker->epfd;
+
+                __event_worker_pin (event_pool, myindex - 1, pthread_self ());
         }
         pthread_mutex_unlock (&event_pool->mutex);
 
@@ -635,6 +995,9 @@ event_dispatch_epoll_worker (void *data)
                         }
                         pthread_mutex_unlock (&event_pool->mutex);
                         if (timetodie) {
+                                if (event_pool->affinity)
+                                        event_worker_migrate (event_pool,
+                                                              myindex - 1);
                                 gf_msg ("epoll", GF_LOG_INFO, 0,
                                         LG_MSG_EXITED_EPOLL_THREAD, "Exited "
                                         "thread with index %d", myindex);
@@ -642,7 +1005,11 @@ event_dispatch_epoll_worker (void *data)
                         }
                 }
 
-                ret = epoll_wait (event_pool->fd, &event, 1, -1);
+                batch = event_pool->batch_size;
+                if (batch < 1 || batch > EVENT_MAX_BATCH)
+                        batch = 1;
+
+                ret = epoll_wait (epfd, events, batch, -1);
 
                 if (ret == 0)
                         /* timeout */
@@ -652,7 +1019,26 @@ event_dispatch_epoll_worker (void *data)
                         /* sys call */
                         continue;
 
-		ret = event_dispatch_epoll_handler (event_pool, &event);
+                if (ret < 0)
+                        continue;
+
+                event_account_wakeup (event_pool, ret);
+                GF_ATOMIC_ADD (worker->events, ret);
+
+                /* EPOLLONESHOT makes every fd show up at most once in a
+                 * batch, events on the same fd are dispatched in order by
+                 * whichever poller owns it at the time */
+                for (i = 0; i < ret; i++) {
+                        if (((struct event_data *)&events[i].data)->idx ==
+                            EVENT_WORKER_WAKEUP) {
+                                /* just to look at the thread count */
+                                eventfd_read (worker->wakefd, &wakeups);
+                                continue;
+                        }
+
+                        event_dispatch_epoll_handler (event_pool, &events[i],
+                                                      (batch > 1));
+                }
         }
 out:
         if (ev_data)
@@ -840,6 +1226,15 @@ event_reconfigure_threads_epoll (struct event_pool *event_pool, int value)
 
                 /* if value decreases, threads will terminate, themselves */
                 event_pool->eventthreadcount = value;
+
+                /* ... but with their own epoll instance, they may not see
+                 * another event before they are told */
+                if (event_pool->affinity) {
+                        for (i = value; i < oldthreadcount; i++) {
+                                if (event_pool->pollers[i] != 0)
+                                        event_worker_wakeup (event_pool, i);
+                        }
+                }
         }
         pthread_mutex_unlock (&event_pool->mutex);
 
@@ -858,6 +1253,14 @@ event_pool_destroy_epoll (struct event_pool *event_pool)
 
         ret = sys_close (event_pool->fd);
 
+        for (i = 0; i < EVENT_MAX_THREADS; i++) {
+                if (event_pool->workers[i].epfd != -1)
+                        sys_close (event_pool->workers[i].epfd);
+                if (event_pool->workers[i].wakefd != -1)
+                        sys_close (event_pool->workers[i].wakefd);
+        }
+        GF_FREE (event_pool->cpus);
+
         for (i = 0; i < EVENT_EPOLL_TABLES; i++) {
                 if (event_pool->ereg[i]) {
                         table = event_pool->ereg[i];
@@ -906,6 +1309,14 @@ event_handled_epoll (struct event_pool *event_pool, int fd, int idx, int gen)
 			goto post_unlock;
 		}
 
+                if (slot->owned) {
+                        /* a batched dispatch is running the handler, it
+                         * re-arms the fd once that returns */
+                        slot->rearm = 1;
+                        GF_ATOMIC_INC (event_pool->stats.deferred);
+                        goto post_unlock;
+                }
+
 		/* This call also picks up the changes made by another
 		   thread calling event_select_on_epoll() while this
 		   thread was busy in handler()
@@ -915,8 +1326,9 @@ event_handled_epoll (struct event_pool *event_pool, int fd, int idx, int gen)
                         ev_data->idx = idx;
                         ev_data->gen = gen;
 
-                        ret = epoll_ctl (event_pool->fd, EPOLL_CTL_MOD,
-                                         fd, &epoll_event);
+                        ret = epoll_ctl (event_slot_epfd (event_pool, slot),
+                                         EPOLL_CTL_MOD, fd, &epoll_event);
+                        GF_ATOMIC_INC (event_pool->stats.rearms);
                 }
 	}
 post_unlock:
@@ -928,6 +1340,120 @@ post_unlock:
 }
 
 
+/* Switches to (or from) an epoll instance per worker, which is only
+ * possible as long as no fd is registered and no worker is running. */
+static int
+event_set_affinity_epoll (struct event_pool *event_pool, int affinity)
+{
+        int ret = -1;
+        int i = 0;
+
+        pthread_mutex_lock (&event_pool->mutex);
+        {
+                if (event_pool_dispatched_unlocked (event_pool))
+                        goto unlock;
+
+                for (i = 0; i < EVENT_EPOLL_TABLES; i++) {
+                        if (event_pool->slots_used[i])
+                                goto unlock;
+                }
+
+                event_pool->affinity = affinity;
+                ret = 0;
+        }
+unlock:
+        pthread_mutex_unlock (&event_pool->mutex);
+
+        if (ret)
+                gf_msg ("epoll", GF_LOG_WARNING, EBUSY, LG_MSG_INVALID_ARG,
+                        "event affinity can only be changed before any fd "
+                        "is registered");
+
+        return ret;
+}
+
+
+static int
+event_set_cpus_epoll (struct event_pool *event_pool, int *cpus, int count)
+{
+        int *old = NULL;
+        int  i = 0;
+
+        pthread_mutex_lock (&event_pool->mutex);
+        {
+                old = event_pool->cpus;
+                event_pool->cpus = cpus;
+                event_pool->cpu_count = count;
+
+                /* the ones yet to start pin themselves */
+                for (i = 0; i < EVENT_MAX_THREADS; i++) {
+                        if (event_pool->pollers[i] != 0)
+                                __event_worker_pin (event_pool, i,
+                                                    event_pool->pollers[i]);
+                }
+        }
+        pthread_mutex_unlock (&event_pool->mutex);
+
+        GF_FREE (old);
+
+        return 0;
+}
+
+
+static void
+event_dump_epoll (struct event_pool *event_pool)
+{
+        struct event_pool_stats *stats = &event_pool->stats;
+        struct event_worker     *worker = NULL;
+        char                     key[GF_DUMP_MAX_BUF_LEN];
+        uint64_t                 wakeups = 0;
+        uint64_t                 events = 0;
+        int                      i = 0;
+
+        wakeups = GF_ATOMIC_GET (stats->wakeups);
+        events = GF_ATOMIC_GET (stats->events);
+
+        gf_proc_dump_add_section ("event-pool");
+        gf_proc_dump_write ("threads", "%d", event_pool->eventthreadcount);
+        gf_proc_dump_write ("batch_size", "%d", event_pool->batch_size);
+        gf_proc_dump_write ("affinity", "%s",
+                            event_pool->affinity ? "on" : "off");
+        gf_proc_dump_write ("wakeups", "%"PRIu64, wakeups);
+        gf_proc_dump_write ("events", "%"PRIu64, events);
+        gf_proc_dump_write ("events_per_wakeup", "%.2f",
+                            wakeups ? (double)events / wakeups : 0.0);
+        gf_proc_dump_write ("max_events_per_wakeup", "%d", stats->max_batch);
+        gf_proc_dump_write ("rearms", "%"PRIu64,
+                            GF_ATOMIC_GET (stats->rearms));
+        gf_proc_dump_write ("deferred_rearms", "%"PRIu64,
+                            GF_ATOMIC_GET (stats->deferred));
+
+        for (i = 0; i < EVENT_BATCH_HIST; i++) {
+                if (i == EVENT_BATCH_HIST - 1)
+                        snprintf (key, sizeof (key), "wakeups_%d+", 1 << i);
+                else
+                        snprintf (key, sizeof (key), "wakeups_%d-%d", 1 << i,
+                                  (2 << i) - 1);
+                gf_proc_dump_write (key, "%"PRIu64,
+                                    GF_ATOMIC_GET (stats->batch_hist[i]));
+        }
+
+        for (i = 0; i < EVENT_MAX_THREADS; i++) {
+                worker = &event_pool->workers[i];
+                if (!event_pool->pollers[i] && !worker->connections)
+                        continue;
+
+                snprintf (key, sizeof (key), "thread[%d].cpu", i + 1);
+                gf_proc_dump_write (key, "%d", worker->cpu);
+                snprintf (key, sizeof (key), "thread[%d].connections", i + 1);
+                gf_proc_dump_write (key, "%d", worker->connections);
+                snprintf (key, sizeof (key), "thread[%d].events", i + 1);
+                gf_proc_dump_write (key, "%"PRIu64,
+                                    GF_ATOMIC_GET (worker->events));
+        }
+}
+
+
 struct event_ops event_ops_epoll = {
         .new                       = event_pool_new_epoll,
         .event_register            = event_register_epoll,
@@ -938,6 +1464,9 @@ struct event_ops event_ops_epoll = {
         .event_reconfigure_threads = event_reconfigure_threads_epoll,
         .event_pool_destroy        = event_pool_destroy_epoll,
         .event_handled             = event_handled_epoll,
+        .event_dump                = event_dump_epoll,
+        .event_set_affinity        = event_set_affinity_epoll,
+        .event_set_cpus            = event_set_cpus_epoll,
 };
 
 #endif
@@ -51,6 +51,9 @@ event_pool_new (int count, int eventthreadcount)
                         event_pool->ops = &event_ops_poll;
         }
 
+        if (event_pool)
+                event_pool->batch_size = 1;
+
         return event_pool;
 }
 
@@ -302,3 +305,141 @@ event_handled (struct event_pool *event_pool, int fd, int idx, int gen)
 
         return ret;
 }
+
+
+int
+event_pool_set_batch_size (struct event_pool *event_pool, int batch_size)
+{
+        GF_VALIDATE_OR_GOTO ("event", event_pool, out);
+
+        if (batch_size > EVENT_MAX_BATCH)
+                batch_size = EVENT_MAX_BATCH;
+        if (batch_size < 1)
+                batch_size = 1;
+
+        /* picked up by the pollers on their next wakeup */
+        event_pool->batch_size = batch_size;
+
+        return 0;
+out:
+        return -1;
+}
+
+
+void
+event_pool_dump (struct event_pool *event_pool)
+{
+        if (!event_pool || !event_pool->ops->event_dump)
+                return;
+
+        event_pool->ops->event_dump (event_pool);
+}
+
+
+int
+event_pool_set_affinity (struct event_pool *event_pool, int affinity)
+{
+        int ret = -1;
+
+        GF_VALIDATE_OR_GOTO ("event", event_pool, out);
+
+        if (!event_pool->ops->event_set_affinity) {
+                gf_msg ("event", GF_LOG_WARNING, ENOTSUP, LG_MSG_INVALID_ARG,
+                        "event affinity is not supported with poll");
+                goto out;
+        }
+
+        ret = event_pool->ops->event_set_affinity (event_pool, affinity);
+out:
+        return ret;
+}
+
+
+/* Parses a list of cpus like "0-3,8,10-11" */
+static int
+event_parse_cpus (const char *str, int **cpus_p, int *count_p)
+{
+        char *dup = NULL;
+        char *tok = NULL;
+        char *saveptr = NULL;
+        char *end = NULL;
+        int  *cpus = NULL;
+        int   count = 0;
+        long  first = 0;
+        long  last = 0;
+        int   ret = -1;
+
+        dup = gf_strdup (str);
+        cpus = GF_CALLOC (EVENT_MAX_CPUS, sizeof (*cpus),
+                          gf_common_mt_event_pool);
+        if (!dup || !cpus)
+                goto out;
+
+        for (tok = strtok_r (dup, ",", &saveptr); tok;
+             tok = strtok_r (NULL, ",", &saveptr)) {
+                first = strtol (tok, &end, 10);
+                if (end == tok)
+                        goto out;
+
+                last = first;
+                if (*end == '-') {
+                        tok = end + 1;
+                        last = strtol (tok, &end, 10);
+                        if (end == tok)
+                                goto out;
+                }
+
+                if (*end || (first < 0) || (last < first) ||
+                    (last >= EVENT_MAX_CPUS) ||
+                    (count + (last - first) >= EVENT_MAX_CPUS))
+                        goto out;
+
+                for (; first <= last; first++)
+                        cpus[count++] = first;
+        }
+
+        ret = 0;
+out:
+        GF_FREE (dup);
+
+        if (ret || !count) {
+                GF_FREE (cpus);
+                cpus = NULL;
+                count = 0;
+        }
+
+        *cpus_p = cpus;
+        *count_p = count;
+
+        return ret;
+}
+
+
+/* Pins the event threads, one cpu each, to the cpus in @cpus, or
+ * unpins them when it is NULL or empty. */
+int
+event_pool_set_cpus (struct event_pool *event_pool, const char *cpus)
+{
+        int *list = NULL;
+        int  count = 0;
+        int  ret = -1;
+
+        GF_VALIDATE_OR_GOTO ("event", event_pool, out);
+
+        if (!event_pool->ops->event_set_cpus) {
+                gf_msg ("event", GF_LOG_WARNING, ENOTSUP, LG_MSG_INVALID_ARG,
+                        "pinning event threads is not supported with poll");
+                goto out;
+        }
+
+        if (cpus && event_parse_cpus (cpus, &list, &count)) {
+                gf_msg ("event", GF_LOG_ERROR, EINVAL, LG_MSG_INVALID_ARG,
+                        "invalid cpu list \"%s\"", cpus);
+                goto out;
+        }
+
+        /* the list is the event pool's from now on */
+        ret = event_pool->ops->event_set_cpus (event_pool, list, count);
+out:
+        return ret;
+}
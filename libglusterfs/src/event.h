@@ -13,6 +13,8 @@
 
 #include <pthread.h>
 
+#include "atomic.h"
+
 struct event_pool;
 struct event_ops;
 struct event_slot_poll;
@@ -29,6 +31,32 @@ typedef int (*event_handler_t) (int fd, int idx, int gen, void *data,
 #define EVENT_EPOLL_TABLES 1024
 #define EVENT_EPOLL_SLOTS 1024
 #define EVENT_MAX_THREADS  1024
+/* most events harvested by a single epoll_wait() */
+#define EVENT_MAX_BATCH    64
+/* wakeups are histogrammed by events harvested: 1, 2-3, 4-7, ... */
+#define EVENT_BATCH_HIST   7
+/* highest cpu number event threads can be pinned to, plus one */
+#define EVENT_MAX_CPUS     1024
+
+struct event_pool_stats {
+        gf_atomic_t wakeups;    /* waits which returned events */
+        gf_atomic_t events;     /* events dispatched */
+        gf_atomic_t rearms;     /* epoll_ctl (EPOLL_CTL_MOD) after an event */
+        gf_atomic_t deferred;   /* rearms folded into the one after the
+                                   handler, see event_handled_epoll () */
+        gf_atomic_t batch_hist[EVENT_BATCH_HIST];
+        int         max_batch;
+};
+
+/* an epoll thread; in affinity mode it has its own epoll instance, and
+ * every fd is assigned to one of them */
+struct event_worker {
+        int         epfd;        /* own epoll instance */
+        int         wakefd;      /* eventfd, to get it out of epoll_wait() */
+        int         connections; /* fds assigned to it */
+        int         cpu;         /* pinned to, -1 when it is not */
+        gf_atomic_t events;      /* events it dispatched */
+};
 
 struct event_pool {
 	struct event_ops *ops;
@@ -71,6 +99,20 @@ struct event_pool {
          */
         int auto_thread_count;
 
+        /* events harvested per wakeup by each epoll thread; 1 dispatches
+         * them one at a time, re-arming the fd as soon as the handler calls
+         * event_handled (), larger values keep the fd owned by the thread
+         * until its handler returns */
+        int batch_size;
+        struct event_pool_stats stats;
+
+        /* fds stay with the worker they were assigned to at registration,
+         * see event_pool_set_affinity () */
+        int affinity;
+        /* workers are pinned to these cpus, round robin */
+        int *cpus;
+        int cpu_count;
+        struct event_worker workers[EVENT_MAX_THREADS];
 };
 
 struct event_destroy_data {
@@ -100,6 +142,11 @@ struct event_ops {
         int (*event_pool_destroy) (struct event_pool *event_pool);
         int (*event_handled) (struct event_pool *event_pool, int fd, int idx,
                               int gen);
+        void (*event_dump) (struct event_pool *event_pool);
+        int (*event_set_affinity) (struct event_pool *event_pool,
+                                   int affinity);
+        int (*event_set_cpus) (struct event_pool *event_pool, int *cpus,
+                               int count);
 };
 
 struct event_pool *event_pool_new (int count, int eventthreadcount);
@@ -115,5 +162,9 @@ int event_reconfigure_threads (struct event_pool *event_pool, int value);
 int event_pool_destroy (struct event_pool *event_pool);
 int event_dispatch_destroy (struct event_pool *event_pool);
 int event_handled (struct event_pool *event_pool, int fd, int idx, int gen);
+int event_pool_set_batch_size (struct event_pool *event_pool, int batch_size);
+void event_pool_dump (struct event_pool *event_pool);
+int event_pool_set_affinity (struct event_pool *event_pool, int affinity);
+int event_pool_set_cpus (struct event_pool *event_pool, const char *cpus);
 
 #endif /* _EVENT_H_ */
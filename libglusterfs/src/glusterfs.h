@@ -99,6 +99,8 @@
 #define ZR_DUMP_FUSE            "dump-fuse"
 #define ZR_FUSE_MOUNTOPTS       "fuse-mountopts"
 #define IO_THREADS_QUEUE_SIZE_KEY "io-thread-queue-size"
+/* keys of the autoscaling state in the reply to IO_THREADS_QUEUE_SIZE_KEY */
+#define IO_THREADS_AUTOSCALE_PREFIX "io-thread-autoscale."
 
 #define GF_XATTR_CLRLK_CMD      "glusterfs.clrlk"
 #define GF_XATTR_PATHINFO_KEY   "trusted.glusterfs.pathinfo"
@@ -532,6 +534,23 @@ struct _cmd_args {
         char              *event_history;
         int                thin_client;
         uint32_t           reader_thread_count;
+
+        /* iobuf arena placement, see iobuf_pool_set_arena_policy() */
+        int                iobuf_hugepages;
+        int                iobuf_numa;
+
+        /* threads running gf_timer callbacks, 0 runs them on the timer
+         * thread itself */
+        int                timer_dispatch_threads;
+
+        /* events dispatched per wakeup of an epoll thread */
+        int                event_batch_size;
+
+        /* an epoll instance per event thread, see
+         * event_pool_set_affinity() */
+        int                event_affinity;
+        /* cpus the event threads are pinned to */
+        char              *event_cpus;
 };
 typedef struct _cmd_args cmd_args_t;
 
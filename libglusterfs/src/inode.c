@@ -17,30 +17,144 @@
 #include "list.h"
 #include <time.h>
 #include <assert.h>
+#include <urcu-bp.h>
+#include <urcu/system.h>
 #include "libglusterfs-messages.h"
 
 /* TODO:
    move latest accessed dentry to list_head of inode
 */
 
-#define INODE_DUMP_LIST(head, key_buf, key_prefix, list_type)           \
+#define INODE_DUMP_LIST(head, key_buf, key_prefix, list_type, idx)      \
         {                                                               \
-                int i = 1;                                              \
                 inode_t *inode = NULL;                                  \
                 list_for_each_entry (inode, head, list) {               \
                         gf_proc_dump_build_key(key_buf, key_prefix,     \
-                                               "%s.%d",list_type, i++); \
+                                               "%s.%d",list_type, idx++); \
                         gf_proc_dump_add_section(key_buf);              \
                         inode_dump(inode, key);                         \
                 }                                                       \
         }
 
+/* Sharded tables free retired inodes and unset dentries in batches of
+   this size, once an RCU grace period has elapsed. */
+#define INODE_RECLAIM_BATCH 64
+
+/* Walk a hash chain which may be modified concurrently by a table->lock
+   holder. The caller must be in an RCU read-side critical section, or hold
+   table->lock. */
+#define inode_list_for_each_entry_rcu(pos, head, member)                \
+        for (pos = list_entry (rcu_dereference ((head)->next),          \
+                               typeof(*pos), member);                   \
+             &pos->member != (head);                                    \
+             pos = list_entry (rcu_dereference (pos->member.next),      \
+                               typeof(*pos), member))
+
 static inode_t *
 __inode_unref (inode_t *inode);
 
 static int
 inode_table_prune (inode_table_t *table);
 
+static int
+inode_table_reclaim (inode_table_t *table, gf_boolean_t force);
+
+static void
+__inode_retire (inode_t *inode);
+
+
+static inline gf_boolean_t
+inode_table_is_sharded (inode_table_t *table)
+{
+        return (table->shard_count > 1);
+}
+
+
+static inline inode_table_shard_t *
+inode_shard (inode_t *inode)
+{
+        return &inode->table->shards[inode->shard];
+}
+
+
+/* Lock the refcount of @inode, for callers not holding table->lock. */
+static void
+inode_ref_lock (inode_t *inode)
+{
+        if (inode_table_is_sharded (inode->table))
+                pthread_mutex_lock (&inode_shard (inode)->lock);
+        else
+                pthread_mutex_lock (&inode->table->lock);
+}
+
+
+static void
+inode_ref_unlock (inode_t *inode)
+{
+        if (inode_table_is_sharded (inode->table))
+                pthread_mutex_unlock (&inode_shard (inode)->lock);
+        else
+                pthread_mutex_unlock (&inode->table->lock);
+}
+
+
+/* Lock the refcount of @inode, for callers already holding table->lock. */
+static void
+__inode_ref_lock (inode_t *inode)
+{
+        if (inode_table_is_sharded (inode->table))
+                pthread_mutex_lock (&inode_shard (inode)->lock);
+}
+
+
+static void
+__inode_ref_unlock (inode_t *inode)
+{
+        if (inode_table_is_sharded (inode->table))
+                pthread_mutex_unlock (&inode_shard (inode)->lock);
+}
+
+
+/* Whether an unref of an inode of @shard left work for the pruner. Called
+   with the shard lock held. */
+static gf_boolean_t
+__inode_shard_needs_prune (inode_table_t *table, inode_table_shard_t *shard)
+{
+        uint32_t limit = 0;
+
+        if (shard->retire_pending)
+                return _gf_true;
+
+        if (!table->lru_limit)
+                return _gf_false;
+
+        limit = table->lru_limit / table->shard_count;
+
+        return (shard->lru_size > (limit ? limit : 1));
+}
+
+
+static void
+__inode_list_add_rcu (struct list_head *new, struct list_head *head)
+{
+        new->next = head->next;
+        new->prev = head;
+        rcu_assign_pointer (head->next, new);
+        new->next->prev = new;
+}
+
+
+/* Unlink @old from a hash chain, leaving old->next intact so that RCU
+   readers standing on @old can still walk to the end of the chain. */
+static void
+__inode_list_del_rcu (struct list_head *old)
+{
+        old->next->prev = old->prev;
+        CMM_STORE_SHARED (old->prev->next, old->next);
+
+        old->prev = (void *)0xcafecafe;
+}
+
 void
 fd_dump (struct list_head *head, char *prefix);
 
@@ -90,7 +204,7 @@ __dentry_hash (dentry_t *dentry)
                             table->hashsize);
 
         list_del_init (&dentry->hash);
-        list_add (&dentry->hash, &table->name_hash[hash]);
+        __inode_list_add_rcu (&dentry->hash, &table->name_hash[hash]);
 }
 
 
@@ -116,32 +230,58 @@ __dentry_unhash (dentry_t *dentry)
                 return;
         }
 
-        list_del_init (&dentry->hash);
+        if (inode_table_is_sharded (dentry->inode->table))
+                __inode_list_del_rcu (&dentry->hash);
+        else
+                list_del_init (&dentry->hash);
+}
+
+
+static void
+__dentry_destroy (dentry_t *dentry)
+{
+        GF_FREE (dentry->name);
+        dentry->name = NULL;
+
+        mem_put (dentry);
 }
 
 
 static void
 __dentry_unset (dentry_t *dentry)
 {
+        inode_table_t *table = NULL;
+
         if (!dentry) {
                 gf_msg_callingfn (THIS->name, GF_LOG_WARNING, 0,
                                   LG_MSG_DENTRY_NOT_FOUND, "dentry not found");
                 return;
         }
 
+        table = dentry->inode->table;
+
         __dentry_unhash (dentry);
 
         list_del_init (&dentry->inode_list);
 
-        GF_FREE (dentry->name);
-        dentry->name = NULL;
-
         if (dentry->parent) {
-                __inode_unref (dentry->parent);
-                dentry->parent = NULL;
+                __inode_ref_lock (dentry->parent);
+                {
+                        __inode_unref (dentry->parent);
+                }
+                __inode_ref_unlock (dentry->parent);
         }
 
-        mem_put (dentry);
+        if (inode_table_is_sharded (table)) {
+                /* RCU readers may still be looking at the name and the
+                   parent, free the dentry only after a grace period */
+                list_add_tail (&dentry->inode_list, &table->dentry_graveyard);
+                table->dentry_graveyard_size++;
+                return;
+        }
+
+        dentry->parent = NULL;
+        __dentry_destroy (dentry);
 }
 
 
@@ -235,7 +375,10 @@ __inode_unhash (inode_t *inode)
                 return;
         }
 
-        list_del_init (&inode->hash);
+        if (inode_table_is_sharded (inode->table))
+                __inode_list_del_rcu (&inode->hash);
+        else
+                list_del_init (&inode->hash);
 }
 
 
@@ -248,6 +391,9 @@ __is_inode_hashed (inode_t *inode)
                 return 0;
         }
 
+        if (inode->retired)
+                return 0;
+
         return !list_empty (&inode->hash);
 }
 
@@ -268,7 +414,7 @@ __inode_hash (inode_t *inode)
         hash = hash_gfid (inode->gfid, 65536);
 
         list_del_init (&inode->hash);
-        list_add (&inode->hash, &table->inode_hash[hash]);
+        __inode_list_add_rcu (&inode->hash, &table->inode_hash[hash]);
 }
 
 
@@ -393,11 +539,15 @@ inode_ctx_merge (fd_t *fd, inode_t *inode, inode_t *linked_inode)
 static void
 __inode_activate (inode_t *inode)
 {
+        inode_table_shard_t *shard = NULL;
+
         if (!inode)
                 return;
 
-        list_move (&inode->list, &inode->table->active);
-        inode->table->active_size++;
+        shard = inode_shard (inode);
+
+        list_move (&inode->list, &shard->active);
+        shard->active_size++;
 }
 
 
@@ -413,8 +563,13 @@ __inode_passivate (inode_t *inode)
                 return;
         }
 
-        list_move_tail (&inode->list, &inode->table->lru);
-        inode->table->lru_size++;
+        list_move_tail (&inode->list, &inode_shard (inode)->lru);
+        inode_shard (inode)->lru_size++;
+
+        /* the dentry graph can only be touched under table->lock, which
+           is not held when a sharded table passivates an inode */
+        if (inode_table_is_sharded (inode->table))
+                return;
 
         list_for_each_entry_safe (dentry, t, &inode->dentry_list, inode_list) {
                 if (!__is_dentry_hashed (dentry))
@@ -423,29 +578,102 @@ __inode_passivate (inode_t *inode)
 }
 
 
-static void
-__inode_retire (inode_t *inode)
+static int
+__inode_retire_dentries (inode_t *inode)
 {
         dentry_t      *dentry = NULL;
         dentry_t      *t = NULL;
+        int            count = 0;
+
+        list_for_each_entry_safe (dentry, t, &inode->dentry_list, inode_list) {
+                __dentry_unset (dentry);
+                count++;
+        }
+
+        return count;
+}
+
 
+/* Caller holds table->lock, and in a sharded table also the shard lock of
+ * @inode. Unsetting the dentries of a retired inode unrefs their parents,
+ * which may live in any shard, so in a sharded table that is left to the
+ * caller, see __inode_shard_retire_dentries().
+ */
+static void
+__inode_retire (inode_t *inode)
+{
         if (!inode) {
                 gf_msg_callingfn (THIS->name, GF_LOG_WARNING, 0,
                                   LG_MSG_INODE_NOT_FOUND, "inode not found");
                 return;
         }
 
-        list_move_tail (&inode->list, &inode->table->purge);
-        inode->table->purge_size++;
+        list_move_tail (&inode->list, &inode_shard (inode)->purge);
+        inode_shard (inode)->purge_size++;
 
         __inode_unhash (inode);
+        inode->retired = _gf_true;
 
-        list_for_each_entry_safe (dentry, t, &inode->dentry_list, inode_list) {
-                __dentry_unset (dentry);
+        if (!inode_table_is_sharded (inode->table))
+                __inode_retire_dentries (inode);
+}
+
+
+/* Unset the dentries of the inodes retired in @shard. Called with
+ * table->lock held but without the shard lock.
+ */
+static int
+__inode_shard_retire_dentries (inode_table_shard_t *shard)
+{
+        inode_t *inode = NULL;
+        int      count = 0;
+
+        /* in a sharded table the purge lists only change under
+           table->lock */
+        list_for_each_entry (inode, &shard->purge, list) {
+                count += __inode_retire_dentries (inode);
+        }
+
+        return count;
+}
+
+
+/* @inode lost its last reference. */
+static void
+__inode_deactivate (inode_t *inode)
+{
+        inode_table_shard_t *shard = inode_shard (inode);
+
+        shard->active_size--;
+
+        if (inode->nlookup) {
+                __inode_passivate (inode);
+        } else if (inode_table_is_sharded (inode->table)) {
+                /* retiring needs table->lock, queue the inode at the
+                   head of lru for the pruner */
+                list_move (&inode->list, &shard->lru);
+                shard->lru_size++;
+                shard->retire_pending++;
+        } else {
+                __inode_retire (inode);
         }
 }
 
 
+/* Whether inode_table_prune() should run after @inode was unreferenced or
+ * forgotten. Classic tables always prune. Called with the refcount of
+ * @inode locked.
+ */
+static gf_boolean_t
+__inode_needs_prune (inode_t *inode)
+{
+        if (!inode_table_is_sharded (inode->table))
+                return _gf_true;
+
+        return __inode_shard_needs_prune (inode->table, inode_shard (inode));
+}
+
+
 static int
 __inode_get_xl_index (inode_t *inode, xlator_t *xlator)
 {
@@ -491,14 +719,8 @@ __inode_unref (inode_t *inode)
                 inode->_ctx[index].ref--;
         }
 
-        if (!inode->ref) {
-                inode->table->active_size--;
-
-                if (inode->nlookup)
-                        __inode_passivate (inode);
-                else
-                        __inode_retire (inode);
-        }
+        if (!inode->ref)
+                __inode_deactivate (inode);
 
         return inode;
 }
@@ -516,7 +738,7 @@ __inode_ref (inode_t *inode)
         this = THIS;
 
         if (!inode->ref) {
-                inode->table->lru_size--;
+                inode_shard (inode)->lru_size--;
                 __inode_activate (inode);
         }
 
@@ -547,19 +769,22 @@ inode_t *
 inode_unref (inode_t *inode)
 {
         inode_table_t *table = NULL;
+        gf_boolean_t   prune = _gf_false;
 
         if (!inode)
                 return NULL;
 
         table = inode->table;
 
-        pthread_mutex_lock (&table->lock);
+        inode_ref_lock (inode);
         {
                 inode = __inode_unref (inode);
+                prune = __inode_needs_prune (inode);
         }
-        pthread_mutex_unlock (&table->lock);
+        inode_ref_unlock (inode);
 
-        inode_table_prune (table);
+        if (prune)
+                inode_table_prune (table);
 
         return inode;
 }
@@ -568,18 +793,35 @@ inode_unref (inode_t *inode)
 inode_t *
 inode_ref (inode_t *inode)
 {
-        inode_table_t *table = NULL;
-
         if (!inode)
                 return NULL;
 
-        table = inode->table;
-
-        pthread_mutex_lock (&table->lock);
+        inode_ref_lock (inode);
         {
                 inode = __inode_ref (inode);
         }
-        pthread_mutex_unlock (&table->lock);
+        inode_ref_unlock (inode);
+
+        return inode;
+}
+
+
+/* Take a ref on an inode found by an RCU lookup in a sharded table. The
+ * inode may have been retired meanwhile, it is then treated as not found.
+ */
+static inode_t *
+inode_ref_rcu (inode_t *inode)
+{
+        inode_table_shard_t *shard = inode_shard (inode);
+
+        pthread_mutex_lock (&shard->lock);
+        {
+                if (inode->retired)
+                        inode = NULL;
+                else
+                        __inode_ref (inode);
+        }
+        pthread_mutex_unlock (&shard->lock);
 
         return inode;
 }
@@ -612,8 +854,13 @@ __dentry_create (inode_t *inode, inode_t *parent, const char *name)
                 goto out;
         }
 
-        if (parent)
-                newd->parent = __inode_ref (parent);
+        if (parent) {
+                __inode_ref_lock (parent);
+                {
+                        newd->parent = __inode_ref (parent);
+                }
+                __inode_ref_unlock (parent);
+        }
 
         list_add (&newd->inode_list, &inode->dentry_list);
         newd->inode = inode;
@@ -623,8 +870,24 @@ out:
 }
 
 
+static uint32_t
+inode_shard_index (inode_table_t *table, inode_t *inode)
+{
+        uint64_t key = (uintptr_t) inode;
+
+        if (table->shard_count == 1)
+                return 0;
+
+        /* inodes are allocated from a mem-pool, mix the address bits */
+        key = (key >> 4) * 0x9E3779B97F4A7C15ULL;
+
+        return (uint32_t) (key >> 32) % table->shard_count;
+}
+
+
+/* Allocates an inode which is not on any list yet, see __inode_add(). */
 static inode_t *
-__inode_create (inode_table_t *table)
+inode_create (inode_table_t *table)
 {
         inode_t  *newi = NULL;
 
@@ -641,6 +904,7 @@ __inode_create (inode_table_t *table)
         }
 
         newi->table = table;
+        newi->shard = inode_shard_index (table, newi);
 
         LOCK_INIT (&newi->lock);
 
@@ -659,15 +923,21 @@ __inode_create (inode_table_t *table)
                 goto out;
         }
 
-        list_add (&newi->list, &table->lru);
-        table->lru_size++;
-
 out:
 
         return newi;
 }
 
 
+/* Caller holds the refcount lock of @inode. */
+static void
+__inode_add (inode_t *inode)
+{
+        list_add (&inode->list, &inode_shard (inode)->lru);
+        inode_shard (inode)->lru_size++;
+}
+
+
 inode_t *
 inode_new (inode_table_t *table)
 {
@@ -680,14 +950,16 @@ inode_new (inode_table_t *table)
                 return NULL;
         }
 
-        pthread_mutex_lock (&table->lock);
+        inode = inode_create (table);
+        if (inode == NULL)
+                return NULL;
+
+        inode_ref_lock (inode);
         {
-                inode = __inode_create (table);
-                if (inode != NULL) {
-                        __inode_ref (inode);
-                }
+                __inode_add (inode);
+                __inode_ref (inode);
         }
-        pthread_mutex_unlock (&table->lock);
+        inode_ref_unlock (inode);
 
         return inode;
 }
@@ -715,14 +987,8 @@ __inode_ref_reduce_by_n (inode_t *inode, uint64_t nref)
         if (!nref)
                 inode->ref = 0;
 
-        if (!inode->ref) {
-                inode->table->active_size--;
-
-                if (inode->nlookup)
-                        __inode_passivate (inode);
-                else
-                        __inode_retire (inode);
-        }
+        if (!inode->ref)
+                __inode_deactivate (inode);
 
         return inode;
 }
@@ -769,8 +1035,9 @@ __dentry_grep (inode_table_t *table, inode_t *parent, const char *name)
 
         hash = hash_dentry (parent, name, table->hashsize);
 
-        list_for_each_entry (tmp, &table->name_hash[hash], hash) {
-                if (tmp->parent == parent && !strcmp (tmp->name, name)) {
+        inode_list_for_each_entry_rcu (tmp, &table->name_hash[hash], hash) {
+                if (CMM_LOAD_SHARED (tmp->parent) == parent &&
+                    !strcmp (tmp->name, name)) {
                         dentry = tmp;
                         break;
                 }
@@ -793,6 +1060,19 @@ inode_grep (inode_table_t *table, inode_t *parent, const char *name)
                 return NULL;
         }
 
+        if (inode_table_is_sharded (table)) {
+                rcu_read_lock ();
+                {
+                        dentry = __dentry_grep (table, parent, name);
+
+                        if (dentry)
+                                inode = inode_ref_rcu (dentry->inode);
+                }
+                rcu_read_unlock ();
+
+                return inode;
+        }
+
         pthread_mutex_lock (&table->lock);
         {
                 dentry = __dentry_grep (table, parent, name);
@@ -867,6 +1147,25 @@ inode_grep_for_gfid (inode_table_t *table, inode_t *parent, const char *name,
                 return ret;
         }
 
+        if (inode_table_is_sharded (table)) {
+                rcu_read_lock ();
+                {
+                        dentry = __dentry_grep (table, parent, name);
+
+                        if (dentry)
+                                inode = dentry->inode;
+
+                        if (inode) {
+                                gf_uuid_copy (gfid, inode->gfid);
+                                *type = inode->ia_type;
+                                ret = 0;
+                        }
+                }
+                rcu_read_unlock ();
+
+                return ret;
+        }
+
         pthread_mutex_lock (&table->lock);
         {
                 dentry = __dentry_grep (table, parent, name);
@@ -918,7 +1217,7 @@ __inode_find (inode_table_t *table, uuid_t gfid)
 
         hash = hash_gfid (gfid, 65536);
 
-        list_for_each_entry (tmp, &table->inode_hash[hash], hash) {
+        inode_list_for_each_entry_rcu (tmp, &table->inode_hash[hash], hash) {
                 if (gf_uuid_compare (tmp->gfid, gfid) == 0) {
                         inode = tmp;
                         break;
@@ -942,6 +1241,18 @@ inode_find (inode_table_t *table, uuid_t gfid)
                 return NULL;
         }
 
+        if (inode_table_is_sharded (table)) {
+                rcu_read_lock ();
+                {
+                        inode = __inode_find (table, gfid);
+                        if (inode)
+                                inode = inode_ref_rcu (inode);
+                }
+                rcu_read_unlock ();
+
+                return inode;
+        }
+
         pthread_mutex_lock (&table->lock);
         {
                 inode = __inode_find (table, gfid);
@@ -1075,6 +1386,46 @@ __inode_link (inode_t *inode, inode_t *parent, const char *name,
 }
 
 
+/* Lock-free fast path of inode_link() in a sharded table: relinking an
+ * inode which is already hashed under the same dentry, as every repeated
+ * lookup does, only takes a ref. Returns NULL when the slow path is needed.
+ */
+static inode_t *
+inode_link_rcu (inode_t *inode, inode_t *parent, const char *name,
+                struct iatt *iatt)
+{
+        inode_table_t *table = inode->table;
+        inode_t       *link_inode = NULL;
+        dentry_t      *dentry = NULL;
+
+        if (!iatt || gf_uuid_is_null (iatt->ia_gfid))
+                return NULL;
+
+        if (parent && (parent->table != table ||
+                       parent->ia_type != IA_IFDIR || !name ||
+                       !strcmp (name, ".") || !strcmp (name, "..")))
+                return NULL;
+
+        rcu_read_lock ();
+        {
+                if (__inode_find (table, iatt->ia_gfid) != inode)
+                        goto unlock;
+
+                if (parent) {
+                        dentry = __dentry_grep (table, parent, name);
+                        if (!dentry || dentry->inode != inode)
+                                goto unlock;
+                }
+
+                link_inode = inode_ref_rcu (inode);
+        }
+unlock:
+        rcu_read_unlock ();
+
+        return link_inode;
+}
+
+
 inode_t *
 inode_link (inode_t *inode, inode_t *parent, const char *name,
             struct iatt *iatt)
@@ -1090,12 +1441,23 @@ inode_link (inode_t *inode, inode_t *parent, const char *name,
 
         table = inode->table;
 
+        if (inode_table_is_sharded (table)) {
+                linked_inode = inode_link_rcu (inode, parent, name, iatt);
+                if (linked_inode)
+                        return linked_inode;
+        }
+
         pthread_mutex_lock (&table->lock);
         {
                 linked_inode = __inode_link (inode, parent, name, iatt);
 
-                if (linked_inode)
-                        __inode_ref (linked_inode);
+                if (linked_inode) {
+                        __inode_ref_lock (linked_inode);
+                        {
+                                __inode_ref (linked_inode);
+                        }
+                        __inode_ref_unlock (linked_inode);
+                }
         }
         pthread_mutex_unlock (&table->lock);
 
@@ -1108,21 +1470,17 @@ inode_link (inode_t *inode, inode_t *parent, const char *name,
 int
 inode_lookup (inode_t *inode)
 {
-        inode_table_t *table = NULL;
-
         if (!inode) {
                 gf_msg_callingfn (THIS->name, GF_LOG_WARNING, 0,
                                   LG_MSG_INODE_NOT_FOUND, "inode not found");
                 return -1;
         }
 
-        table = inode->table;
-
-        pthread_mutex_lock (&table->lock);
+        inode_ref_lock (inode);
         {
                 __inode_lookup (inode);
         }
-        pthread_mutex_unlock (&table->lock);
+        inode_ref_unlock (inode);
 
         return 0;
 }
@@ -1132,6 +1490,7 @@ int
 inode_ref_reduce_by_n (inode_t *inode, uint64_t nref)
 {
         inode_table_t *table = NULL;
+        gf_boolean_t   prune = _gf_false;
 
         if (!inode) {
                 gf_msg_callingfn (THIS->name, GF_LOG_WARNING, 0,
@@ -1141,13 +1500,15 @@ inode_ref_reduce_by_n (inode_t *inode, uint64_t nref)
 
         table = inode->table;
 
-        pthread_mutex_lock (&table->lock);
+        inode_ref_lock (inode);
         {
                 __inode_ref_reduce_by_n (inode, nref);
+                prune = __inode_needs_prune (inode);
         }
-        pthread_mutex_unlock (&table->lock);
+        inode_ref_unlock (inode);
 
-        inode_table_prune (table);
+        if (prune)
+                inode_table_prune (table);
 
         return 0;
 }
@@ -1157,6 +1518,7 @@ int
 inode_forget (inode_t *inode, uint64_t nlookup)
 {
         inode_table_t *table = NULL;
+        gf_boolean_t   prune = _gf_false;
 
         if (!inode) {
                 gf_msg_callingfn (THIS->name, GF_LOG_WARNING, 0,
@@ -1166,13 +1528,15 @@ inode_forget (inode_t *inode, uint64_t nlookup)
 
         table = inode->table;
 
-        pthread_mutex_lock (&table->lock);
+        inode_ref_lock (inode);
         {
                 __inode_forget (inode, nlookup);
+                prune = __inode_needs_prune (inode);
         }
-        pthread_mutex_unlock (&table->lock);
+        inode_ref_unlock (inode);
 
-        inode_table_prune (table);
+        if (prune)
+                inode_table_prune (table);
 
         return 0;
 }
@@ -1354,8 +1718,13 @@ inode_parent (inode_t *inode, uuid_t pargfid, const char *name)
                 if (dentry)
                         parent = dentry->parent;
 
-                if (parent)
-                        __inode_ref (parent);
+                if (parent) {
+                        __inode_ref_lock (parent);
+                        {
+                                __inode_ref (parent);
+                        }
+                        __inode_ref_unlock (parent);
+                }
         }
         pthread_mutex_unlock (&table->lock);
 
@@ -1531,43 +1900,223 @@ inode_table_set_lru_limit (inode_table_t *table, uint32_t lru_limit)
         return;
 }
 
+/* Retire the inodes queued by __inode_deactivate() and trim lru to the
+ * shard's share of lru_limit. Called with table->lock and the shard lock
+ * held.
+ */
 static int
-inode_table_prune (inode_table_t *table)
+__inode_shard_prune (inode_table_t *table, inode_table_shard_t *shard)
 {
-        int               ret = 0;
-        struct list_head  purge = {0, };
+        inode_t  *entry = NULL;
+        inode_t  *tmp = NULL;
+        uint32_t  pending = 0;
+        uint32_t  limit = 0;
+        int       ret = 0;
+
+        /* queued inodes sit at the head of lru, unless they have been
+           referenced again meanwhile */
+        pending = shard->retire_pending;
+        shard->retire_pending = 0;
+
+        list_for_each_entry_safe (entry, tmp, &shard->lru, list) {
+                if (pending == 0)
+                        break;
+                pending--;
+
+                if (entry->nlookup)
+                        continue;
+
+                shard->lru_size--;
+                __inode_retire (entry);
+
+                ret++;
+        }
+
+        if (!table->lru_limit)
+                goto out;
+
+        limit = table->lru_limit / table->shard_count;
+        if (!limit)
+                limit = 1;
+
+        if (shard->lru_size <= limit)
+                goto out;
+
+        /* trim a little below the limit, so that a shard sitting at its
+           limit does not take table->lock on every unref */
+        limit -= limit / 16;
+
+        while (shard->lru_size > limit) {
+                if (list_empty (&shard->lru)) {
+                        gf_msg_callingfn (THIS->name, GF_LOG_WARNING, 0,
+                                          LG_MSG_INVALID_INODE_LIST,
+                                          "Empty inode lru list found"
+                                          " but with (%d) lru_size",
+                                          shard->lru_size);
+                        break;
+                }
+
+                entry = list_entry (shard->lru.next, inode_t, list);
+
+                shard->lru_size--;
+                __inode_retire (entry);
+
+                ret++;
+        }
+out:
+        return ret;
+}
+
+
+static int
+inode_table_prune_shards (inode_table_t *table)
+{
+        inode_table_shard_t *shard = NULL;
+        uint32_t             i = 0;
+        int                  retired = 0;
+        int                  ret = 0;
+
+        pthread_mutex_lock (&table->lock);
+        {
+                /* unsetting the dentries of retired inodes drops refs on
+                   their parents, which can queue more inodes */
+                do {
+                        retired = 0;
+
+                        for (i = 0; i < table->shard_count; i++) {
+                                shard = &table->shards[i];
+
+                                pthread_mutex_lock (&shard->lock);
+                                {
+                                        retired += __inode_shard_prune (table,
+                                                                        shard);
+                                }
+                                pthread_mutex_unlock (&shard->lock);
+
+                                __inode_shard_retire_dentries (shard);
+                        }
+
+                        ret += retired;
+                } while (retired);
+
+                for (i = 0; i < table->shard_count; i++) {
+                        shard = &table->shards[i];
+
+                        pthread_mutex_lock (&shard->lock);
+                        {
+                                list_splice_init (&shard->purge,
+                                                  &table->graveyard);
+                                table->graveyard_size += shard->purge_size;
+                                shard->purge_size = 0;
+                        }
+                        pthread_mutex_unlock (&shard->lock);
+                }
+        }
+        pthread_mutex_unlock (&table->lock);
+
+        inode_table_reclaim (table, _gf_false);
+
+        return ret;
+}
+
+
+/* Destroy the retired inodes and unset dentries of a sharded table, after
+ * waiting for the RCU readers which could still see them. This is batched
+ * unless @force is set.
+ */
+static int
+inode_table_reclaim (inode_table_t *table, gf_boolean_t force)
+{
+        struct list_head  inodes;
+        struct list_head  dentries;
         inode_t          *del = NULL;
         inode_t          *tmp = NULL;
-        inode_t          *entry = NULL;
+        dentry_t         *dentry = NULL;
+        dentry_t         *dtmp = NULL;
+        int               ret = 0;
+
+        INIT_LIST_HEAD (&inodes);
+        INIT_LIST_HEAD (&dentries);
+
+        pthread_mutex_lock (&table->lock);
+        {
+                if (force ||
+                    table->graveyard_size >= INODE_RECLAIM_BATCH ||
+                    table->dentry_graveyard_size >= INODE_RECLAIM_BATCH) {
+                        list_splice_init (&table->graveyard, &inodes);
+                        ret = table->graveyard_size;
+                        table->graveyard_size = 0;
+
+                        list_splice_init (&table->dentry_graveyard,
+                                          &dentries);
+                        table->dentry_graveyard_size = 0;
+                }
+        }
+        pthread_mutex_unlock (&table->lock);
+
+        if (list_empty (&inodes) && list_empty (&dentries))
+                return 0;
+
+        synchronize_rcu ();
+
+        list_for_each_entry_safe (dentry, dtmp, &dentries, inode_list) {
+                list_del_init (&dentry->inode_list);
+                __dentry_destroy (dentry);
+        }
+
+        list_for_each_entry_safe (del, tmp, &inodes, list) {
+                list_del_init (&del->list);
+                __inode_forget (del, 0);
+                __inode_destroy (del);
+        }
+
+        return ret;
+}
+
+
+static int
+inode_table_prune (inode_table_t *table)
+{
+        int                  ret = 0;
+        struct list_head     purge = {0, };
+        inode_t             *del = NULL;
+        inode_t             *tmp = NULL;
+        inode_t             *entry = NULL;
+        inode_table_shard_t *shard = NULL;
 
         if (!table)
                 return -1;
 
+        if (inode_table_is_sharded (table))
+                return inode_table_prune_shards (table);
+
+        shard = &table->shards[0];
+
         INIT_LIST_HEAD (&purge);
 
         pthread_mutex_lock (&table->lock);
         {
                 while (table->lru_limit
-                       && table->lru_size > (table->lru_limit)) {
-                        if (list_empty (&table->lru)) {
+                       && shard->lru_size > (table->lru_limit)) {
+                        if (list_empty (&shard->lru)) {
                                 gf_msg_callingfn (THIS->name, GF_LOG_WARNING, 0,
                                                   LG_MSG_INVALID_INODE_LIST,
                                                   "Empty inode lru list found"
                                                   " but with (%d) lru_size",
-                                                  table->lru_size);
+                                                  shard->lru_size);
                                 break;
                         }
 
-                        entry = list_entry (table->lru.next, inode_t, list);
+                        entry = list_entry (shard->lru.next, inode_t, list);
 
-                        table->lru_size--;
+                        shard->lru_size--;
                         __inode_retire (entry);
 
                         ret++;
                 }
 
-                list_splice_init (&table->purge, &purge);
-                table->purge_size = 0;
+                list_splice_init (&shard->purge, &purge);
+                shard->purge_size = 0;
         }
         pthread_mutex_unlock (&table->lock);
 
@@ -1592,7 +2141,9 @@ __inode_table_init_root (inode_table_t *table)
         if (!table)
                 return;
 
-        root = __inode_create (table);
+        root = inode_create (table);
+
+        __inode_add (root);
 
         iatt.ia_gfid[15] = 1;
         iatt.ia_ino = 1;
@@ -1606,9 +2157,21 @@ __inode_table_init_root (inode_table_t *table)
 inode_table_t *
 inode_table_new (size_t lru_limit, xlator_t *xl)
 {
-        inode_table_t *new = NULL;
-        int            ret = -1;
-        int            i = 0;
+        return inode_table_with_shards (lru_limit, xl, 1);
+}
+
+
+/* A table with more than one shard keeps per-shard locks and lru lists,
+ * and does inode_find()/inode_grep() and repeated inode_link() without
+ * taking table->lock. The lru limit is split evenly among the shards.
+ */
+inode_table_t *
+inode_table_with_shards (size_t lru_limit, xlator_t *xl, uint32_t shard_count)
+{
+        inode_table_t       *new = NULL;
+        inode_table_shard_t *shard = NULL;
+        int                  ret = -1;
+        int                  i = 0;
 
         new = (void *)GF_CALLOC(1, sizeof (*new), gf_common_mt_inode_table_t);
         if (!new)
@@ -1621,6 +2184,13 @@ inode_table_new (size_t lru_limit, xlator_t *xl)
 
         new->hashsize = 14057; /* TODO: Random Number?? */
 
+        if (shard_count == 0)
+                shard_count = 1;
+        if (shard_count > INODE_TABLE_MAX_SHARDS)
+                shard_count = INODE_TABLE_MAX_SHARDS;
+
+        new->shard_count = shard_count;
+
         /* In case FUSE is initing the inode table. */
         if (lru_limit == 0)
                 lru_limit = DEFAULT_INODE_MEMPOOL_ENTRIES;
@@ -1647,6 +2217,11 @@ inode_table_new (size_t lru_limit, xlator_t *xl)
         if (!new->name_hash)
                 goto out;
 
+        new->shards = GF_CALLOC (shard_count, sizeof (*new->shards),
+                                 gf_common_mt_inode_table_shard_t);
+        if (!new->shards)
+                goto out;
+
         /* if number of fd open in one process is more than this,
            we may hit perf issues */
         new->fd_mem_pool = mem_pool_new (fd_t, 1024);
@@ -1663,9 +2238,17 @@ inode_table_new (size_t lru_limit, xlator_t *xl)
                 INIT_LIST_HEAD (&new->name_hash[i]);
         }
 
-        INIT_LIST_HEAD (&new->active);
-        INIT_LIST_HEAD (&new->lru);
-        INIT_LIST_HEAD (&new->purge);
+        for (i = 0; i < shard_count; i++) {
+                shard = &new->shards[i];
+
+                pthread_mutex_init (&shard->lock, NULL);
+                INIT_LIST_HEAD (&shard->active);
+                INIT_LIST_HEAD (&shard->lru);
+                INIT_LIST_HEAD (&shard->purge);
+        }
+
+        INIT_LIST_HEAD (&new->graveyard);
+        INIT_LIST_HEAD (&new->dentry_graveyard);
 
         ret = gf_asprintf (&new->name, "%s/inode", xl->name);
         if (-1 == ret) {
@@ -1683,6 +2266,7 @@ out:
                 if (new) {
                         GF_FREE (new->inode_hash);
                         GF_FREE (new->name_hash);
+                        GF_FREE (new->shards);
                         if (new->dentry_pool)
                                 mem_pool_destroy (new->dentry_pool);
                         if (new->inode_pool)
@@ -1706,6 +2290,11 @@ inode_table_ctx_free (inode_table_t *table)
         int active_count = 0;
         xlator_t *this = NULL;
         int itable_size = 0;
+        int active_size = 0;
+        int lru_size = 0;
+        int purge_size = 0;
+        inode_table_shard_t *shard = NULL;
+        uint32_t i = 0;
 
         if (!table)
                 return -1;
@@ -1713,15 +2302,20 @@ inode_table_ctx_free (inode_table_t *table)
         this = THIS;
 
         pthread_mutex_lock (&table->lock);
-        {
-                list_for_each_entry_safe (del, tmp, &table->purge, list) {
+        for (i = 0; i < table->shard_count; i++) {
+                shard = &table->shards[i];
+
+                if (inode_table_is_sharded (table))
+                        pthread_mutex_lock (&shard->lock);
+
+                list_for_each_entry_safe (del, tmp, &shard->purge, list) {
                         if (del->_ctx) {
                                 __inode_ctx_free (del);
                                 purge_count++;
                         }
                 }
 
-                list_for_each_entry_safe (del, tmp, &table->lru, list) {
+                list_for_each_entry_safe (del, tmp, &shard->lru, list) {
                         if (del->_ctx) {
                                 __inode_ctx_free (del);
                                 lru_count++;
@@ -1734,24 +2328,31 @@ inode_table_ctx_free (inode_table_t *table)
                  * inode from the new inode table, the older inode would not
                  * be used.
                  */
-                list_for_each_entry_safe (del, tmp, &table->active, list) {
+                list_for_each_entry_safe (del, tmp, &shard->active, list) {
                         if (del->_ctx) {
                                 __inode_ctx_free (del);
                                 active_count++;
                         }
                 }
+
+                active_size += shard->active_size;
+                lru_size += shard->lru_size;
+                purge_size += shard->purge_size;
+
+                if (inode_table_is_sharded (table))
+                        pthread_mutex_unlock (&shard->lock);
         }
         pthread_mutex_unlock (&table->lock);
 
         ret = purge_count + lru_count + active_count;
-        itable_size = table->active_size + table->lru_size + table->purge_size;
+        itable_size = active_size + lru_size + purge_size;
         gf_msg_callingfn (this->name, GF_LOG_INFO, 0,
                           LG_MSG_INODE_CONTEXT_FREED, "total %d (itable size: "
                           "%d) inode contexts have been freed (active: %d, ("
                           "active size: %d), lru: %d, (lru size: %d),  purge: "
                           "%d, (purge size: %d))", ret, itable_size,
-                          active_count, table->active_size, lru_count,
-                          table->lru_size, purge_count, table->purge_size);
+                          active_count, active_size, lru_count,
+                          lru_size, purge_count, purge_size);
         return ret;
 }
 
@@ -1782,7 +2383,10 @@ inode_table_destroy_all (glusterfs_ctx_t *ctx) {
 void
 inode_table_destroy (inode_table_t *inode_table) {
 
-        inode_t  *trav = NULL;
+        inode_t             *trav = NULL;
+        inode_table_shard_t *shard = NULL;
+        uint32_t             i = 0;
+        int                  busy = 0;
 
         if (inode_table == NULL)
                 return;
@@ -1810,46 +2414,69 @@ inode_table_destroy (inode_table_t *inode_table) {
          * ret = inode_table_ctx_free (inode_table);
          */
         pthread_mutex_lock (&inode_table->lock);
-        {
-                /* Process lru list first as we need to unset their dentry
-                 * entries (the ones which may not be unset during
-                 * '__inode_passivate' as they were hashed) which in turn
-                 * shall unref their parent
-                 *
-                 * These parent inodes when unref'ed may well again fall
-                 * into lru list and if we are at the end of traversing
-                 * the list, we may miss to delete/retire that entry. Hence
-                 * traverse the lru list till it gets empty.
-                 */
-                while (!list_empty (&inode_table->lru)) {
-                        trav = list_first_entry (&inode_table->lru,
-                                                 inode_t, list);
-                        __inode_forget (trav, 0);
-                        __inode_retire (trav);
-                        inode_table->lru_size--;
-                }
+        do {
+                busy = 0;
+
+                for (i = 0; i < inode_table->shard_count; i++) {
+                        shard = &inode_table->shards[i];
+
+                        if (inode_table_is_sharded (inode_table))
+                                pthread_mutex_lock (&shard->lock);
+
+                        /* Process lru list first as we need to unset their
+                         * dentry entries (the ones which may not be unset
+                         * during '__inode_passivate' as they were hashed)
+                         * which in turn shall unref their parent
+                         *
+                         * These parent inodes when unref'ed may well again
+                         * fall into lru list and if we are at the end of
+                         * traversing the list, we may miss to delete/retire
+                         * that entry. Hence traverse the lru list till it
+                         * gets empty, and all the shards till none of them
+                         * had work left.
+                         */
+                        while (!list_empty (&shard->lru)) {
+                                trav = list_first_entry (&shard->lru,
+                                                         inode_t, list);
+                                __inode_forget (trav, 0);
+                                __inode_retire (trav);
+                                shard->lru_size--;
+                                busy++;
+                        }
+                        shard->retire_pending = 0;
+
+                        while (!list_empty (&shard->active)) {
+                                trav = list_first_entry (&shard->active,
+                                                         inode_t, list);
+                                /* forget and unref the inode to retire and
+                                 * add it to purge list. By this time there
+                                 * should not be any inodes present in the
+                                 * active list except for root inode. Its a
+                                 * ref_leak otherwise. */
+                                if (trav != inode_table->root)
+                                        gf_msg_callingfn (THIS->name,
+                                                          GF_LOG_WARNING, 0,
+                                                          LG_MSG_REF_COUNT,
+                                                          "Active inode(%p) "
+                                                          "with refcount(%d) "
+                                                          "found during "
+                                                          "cleanup", trav,
+                                                          trav->ref);
+                                __inode_forget (trav, 0);
+                                __inode_ref_reduce_by_n (trav, 0);
+                                busy++;
+                        }
 
-                while (!list_empty (&inode_table->active)) {
-                        trav = list_first_entry (&inode_table->active,
-                                                 inode_t, list);
-                        /* forget and unref the inode to retire and add it to
-                         * purge list. By this time there should not be any
-                         * inodes present in the active list except for root
-                         * inode. Its a ref_leak otherwise. */
-                        if (trav != inode_table->root)
-                                gf_msg_callingfn (THIS->name, GF_LOG_WARNING, 0,
-                                                  LG_MSG_REF_COUNT,
-                                                  "Active inode(%p) with refcount"
-                                                  "(%d) found during cleanup",
-                                                  trav, trav->ref);
-                        __inode_forget (trav, 0);
-                        __inode_ref_reduce_by_n (trav, 0);
+                        if (inode_table_is_sharded (inode_table)) {
+                                pthread_mutex_unlock (&shard->lock);
+                                __inode_shard_retire_dentries (shard);
+                        }
                 }
-
-        }
+        } while (busy);
         pthread_mutex_unlock (&inode_table->lock);
 
         inode_table_prune (inode_table);
+        inode_table_reclaim (inode_table, _gf_true);
 
         GF_FREE (inode_table->inode_hash);
         GF_FREE (inode_table->name_hash);
@@ -1860,6 +2487,10 @@ inode_table_destroy (inode_table_t *inode_table) {
         if (inode_table->fd_mem_pool)
                 mem_pool_destroy (inode_table->fd_mem_pool);
 
+        for (i = 0; i < inode_table->shard_count; i++)
+                pthread_mutex_destroy (&inode_table->shards[i].lock);
+        GF_FREE (inode_table->shards);
+
         pthread_mutex_destroy (&inode_table->lock);
 
         GF_FREE (inode_table->name);
@@ -2400,8 +3031,16 @@ void
 inode_table_dump (inode_table_t *itable, char *prefix)
 {
 
-        char    key[GF_DUMP_MAX_BUF_LEN];
-        int     ret = 0;
+        char                 key[GF_DUMP_MAX_BUF_LEN];
+        int                  ret = 0;
+        inode_table_shard_t *shard = NULL;
+        uint32_t             active_size = 0;
+        uint32_t             lru_size = 0;
+        uint32_t             purge_size = 0;
+        uint32_t             i = 0;
+        int                  active = 1;
+        int                  lru = 1;
+        int                  purge = 1;
 
         if (!itable)
                 return;
@@ -2413,6 +3052,13 @@ inode_table_dump (inode_table_t *itable, char *prefix)
                 return;
         }
 
+        for (i = 0; i < itable->shard_count; i++) {
+                shard = &itable->shards[i];
+                active_size += shard->active_size;
+                lru_size += shard->lru_size;
+                purge_size += shard->purge_size;
+        }
+
         gf_proc_dump_build_key(key, prefix, "hashsize");
         gf_proc_dump_write(key, "%d", itable->hashsize);
         gf_proc_dump_build_key(key, prefix, "name");
@@ -2421,15 +3067,43 @@ inode_table_dump (inode_table_t *itable, char *prefix)
         gf_proc_dump_build_key(key, prefix, "lru_limit");
         gf_proc_dump_write(key, "%d", itable->lru_limit);
         gf_proc_dump_build_key(key, prefix, "active_size");
-        gf_proc_dump_write(key, "%d", itable->active_size);
+        gf_proc_dump_write(key, "%d", active_size);
         gf_proc_dump_build_key(key, prefix, "lru_size");
-        gf_proc_dump_write(key, "%d", itable->lru_size);
+        gf_proc_dump_write(key, "%d", lru_size);
         gf_proc_dump_build_key(key, prefix, "purge_size");
-        gf_proc_dump_write(key, "%d", itable->purge_size);
+        gf_proc_dump_write(key, "%d", purge_size);
+
+        if (inode_table_is_sharded (itable)) {
+                gf_proc_dump_build_key(key, prefix, "shard_count");
+                gf_proc_dump_write(key, "%u", itable->shard_count);
+                gf_proc_dump_build_key(key, prefix, "graveyard_size");
+                gf_proc_dump_write(key, "%u", itable->graveyard_size);
+
+                for (i = 0; i < itable->shard_count; i++) {
+                        shard = &itable->shards[i];
+                        gf_proc_dump_build_key(key, prefix, "shard.%u", i);
+                        gf_proc_dump_write(key, "active: %u, lru: %u, "
+                                           "purge: %u", shard->active_size,
+                                           shard->lru_size,
+                                           shard->purge_size);
+                }
+        }
+
+        for (i = 0; i < itable->shard_count; i++) {
+                shard = &itable->shards[i];
+
+                if (inode_table_is_sharded (itable) &&
+                    pthread_mutex_trylock (&shard->lock) != 0)
+                        continue;
 
-        INODE_DUMP_LIST(&itable->active, key, prefix, "active");
-        INODE_DUMP_LIST(&itable->lru, key, prefix, "lru");
-        INODE_DUMP_LIST(&itable->purge, key, prefix, "purge");
+                INODE_DUMP_LIST(&shard->active, key, prefix, "active",
+                                active);
+                INODE_DUMP_LIST(&shard->lru, key, prefix, "lru", lru);
+                INODE_DUMP_LIST(&shard->purge, key, prefix, "purge", purge);
+
+                if (inode_table_is_sharded (itable))
+                        pthread_mutex_unlock (&shard->lock);
+        }
 
         pthread_mutex_unlock(&itable->lock);
 }
@@ -2474,54 +3148,85 @@ out:
 void
 inode_table_dump_to_dict (inode_table_t *itable, char *prefix, dict_t *dict)
 {
-        char            key[GF_DUMP_MAX_BUF_LEN] = {0,};
-        int             ret = 0;
-        inode_t         *inode = NULL;
-        int             count = 0;
+        char                 key[GF_DUMP_MAX_BUF_LEN] = {0,};
+        int                  ret = 0;
+        inode_t             *inode = NULL;
+        inode_table_shard_t *shard = NULL;
+        uint32_t             active_size = 0;
+        uint32_t             lru_size = 0;
+        uint32_t             purge_size = 0;
+        uint32_t             i = 0;
+        int                  active = 0;
+        int                  lru = 0;
+        int                  purge = 0;
 
         ret = pthread_mutex_trylock (&itable->lock);
         if (ret)
                 return;
 
+        for (i = 0; i < itable->shard_count; i++) {
+                shard = &itable->shards[i];
+                active_size += shard->active_size;
+                lru_size += shard->lru_size;
+                purge_size += shard->purge_size;
+        }
+
         memset (key, 0, sizeof (key));
         snprintf (key, sizeof (key), "%s.itable.active_size", prefix);
-        ret = dict_set_uint32 (dict, key, itable->active_size);
+        ret = dict_set_uint32 (dict, key, active_size);
         if (ret)
                 goto out;
 
         memset (key, 0, sizeof (key));
         snprintf (key, sizeof (key), "%s.itable.lru_size", prefix);
-        ret = dict_set_uint32 (dict, key, itable->lru_size);
+        ret = dict_set_uint32 (dict, key, lru_size);
         if (ret)
                 goto out;
 
         memset (key, 0, sizeof (key));
         snprintf (key, sizeof (key), "%s.itable.purge_size", prefix);
-        ret = dict_set_uint32 (dict, key, itable->purge_size);
+        ret = dict_set_uint32 (dict, key, purge_size);
         if (ret)
                 goto out;
 
-        list_for_each_entry (inode, &itable->active, list) {
-                memset (key, 0, sizeof (key));
-                snprintf (key, sizeof (key), "%s.itable.active%d", prefix,
-                          count++);
-                inode_dump_to_dict (inode, key, dict);
-        }
-        count = 0;
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "%s.itable.shard_count", prefix);
+        ret = dict_set_uint32 (dict, key, itable->shard_count);
+        if (ret)
+                goto out;
 
-        list_for_each_entry (inode, &itable->lru, list) {
-                memset (key, 0, sizeof (key));
-                snprintf (key, sizeof (key), "%s.itable.lru%d", prefix,
-                          count++);
-                inode_dump_to_dict (inode, key, dict);
-        }
-        count = 0;
+        for (i = 0; i < itable->shard_count; i++) {
+                shard = &itable->shards[i];
+
+                if (inode_table_is_sharded (itable) &&
+                    pthread_mutex_trylock (&shard->lock) != 0)
+                        continue;
+
+                /* Unlike the statedump, the dict entries are numbered from
+                   0, which is where the CLI starts reading them. */
+                list_for_each_entry (inode, &shard->active, list) {
+                        memset (key, 0, sizeof (key));
+                        snprintf (key, sizeof (key), "%s.itable.active%d",
+                                  prefix, active++);
+                        inode_dump_to_dict (inode, key, dict);
+                }
+
+                list_for_each_entry (inode, &shard->lru, list) {
+                        memset (key, 0, sizeof (key));
+                        snprintf (key, sizeof (key), "%s.itable.lru%d",
+                                  prefix, lru++);
+                        inode_dump_to_dict (inode, key, dict);
+                }
+
+                list_for_each_entry (inode, &shard->purge, list) {
+                        memset (key, 0, sizeof (key));
+                        snprintf (key, sizeof (key), "%s.itable.purge%d",
+                                  prefix, purge++);
+                        inode_dump_to_dict (inode, key, dict);
+                }
 
-        list_for_each_entry (inode, &itable->purge, list) {
-                memset (key, 0, sizeof (key));
-                snprintf (key, sizeof (key), "%s.itable.purge%d", prefix,
-                          count++);
-                inode_dump_to_dict (inode, key, dict);
+                if (inode_table_is_sharded (itable))
+                        pthread_mutex_unlock (&shard->lock);
         }
 
 out:
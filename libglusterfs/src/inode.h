@@ -18,10 +18,14 @@
 #define LOOKUP_NOT_NEEDED 2
 
 #define DEFAULT_INODE_MEMPOOL_ENTRIES   32 * 1024
+#define INODE_TABLE_MAX_SHARDS          256
 #define INODE_PATH_FMT "<gfid:%s>"
 struct _inode_table;
 typedef struct _inode_table inode_table_t;
 
+struct _inode_table_shard;
+typedef struct _inode_table_shard inode_table_shard_t;
+
 struct _inode;
 typedef struct _inode inode_t;
 
@@ -33,6 +37,35 @@ typedef struct _dentry dentry_t;
 #include "compat-uuid.h"
 #include "fd.h"
 
+/*
+ * Every inode belongs to exactly one shard of its table for its whole
+ * lifetime.  The shard keeps the active/lru/purge lists of its inodes.
+ *
+ * In a classic table there is a single shard and everything, including
+ * the refcounts, is protected by table->lock.  In a sharded table (see
+ * inode_table_with_shards()) the refcount, nlookup and list membership of
+ * an inode are protected by its shard's lock, while table->lock only
+ * serialises updates of the gfid/dentry hashes and of the dentry graph.
+ * Lookups through the hashes are done under RCU without table->lock.
+ *
+ * Lock ordering: table->lock -> shard->lock.  A shard lock is never held
+ * while acquiring another lock, unless table->lock is held as well.
+ */
+struct _inode_table_shard {
+        pthread_mutex_t    lock;
+        struct list_head   active;      /* list of inodes currently active (in an fop) */
+        uint32_t           active_size; /* count of inodes in active list */
+        struct list_head   lru;         /* list of inodes recently used.
+                                           lru.next least recent */
+        uint32_t           lru_size;    /* count of inodes in lru list  */
+        struct list_head   purge;       /* list of inodes to be purged soon */
+        uint32_t           purge_size;  /* count of inodes in purge list */
+        uint32_t           retire_pending; /* unreferenced, forgotten inodes
+                                              queued at the head of lru, to
+                                              be retired by the next prune
+                                              (sharded tables only) */
+};
+
 struct _inode_table {
         pthread_mutex_t    lock;
         size_t             hashsize;    /* bucket size of inode hash and dentry hash */
@@ -42,13 +75,15 @@ struct _inode_table {
         uint32_t           lru_limit;   /* maximum LRU cache size */
         struct list_head  *inode_hash;  /* buckets for inode hash table */
         struct list_head  *name_hash;   /* buckets for dentry hash table */
-        struct list_head   active;      /* list of inodes currently active (in an fop) */
-        uint32_t           active_size; /* count of inodes in active list */
-        struct list_head   lru;         /* list of inodes recently used.
-                                           lru.next most recent */
-        uint32_t           lru_size;    /* count of inodes in lru list  */
-        struct list_head   purge;       /* list of inodes to be purged soon */
-        uint32_t           purge_size;  /* count of inodes in purge list */
+        uint32_t           shard_count; /* number of shards, 1 for a classic
+                                           table */
+        inode_table_shard_t *shards;    /* per-shard inode lists */
+        struct list_head   graveyard;   /* retired inodes waiting for an RCU
+                                           grace period before destruction */
+        uint32_t           graveyard_size;
+        struct list_head   dentry_graveyard; /* unset dentries waiting for an
+                                                RCU grace period */
+        uint32_t           dentry_graveyard_size;
 
         struct mem_pool   *inode_pool;  /* memory pool for inodes */
         struct mem_pool   *dentry_pool; /* memory pool for dentrys */
@@ -94,6 +129,9 @@ struct _inode {
         uint32_t             fd_count;      /* Open fd count */
         uint32_t             active_fd_count;      /* Active open fd count */
         uint32_t             ref;           /* reference count on this inode */
+        uint32_t             shard;         /* index of the owning table shard */
+        gf_boolean_t         retired;       /* unhashed and on its way to be
+                                               purged */
         ia_type_t            ia_type;       /* what kind of file */
         struct list_head     fd_list;       /* list of open files on this inode */
         struct list_head     dentry_list;   /* list of directory entries for this inode */
@@ -111,6 +149,9 @@ struct _inode {
 inode_table_t *
 inode_table_new (size_t lru_limit, xlator_t *xl);
 
+inode_table_t *
+inode_table_with_shards (size_t lru_limit, xlator_t *xl, uint32_t shard_count);
+
 void
 inode_table_destroy_all (glusterfs_ctx_t *ctx);
 
@@ -13,6 +13,10 @@
 #include "statedump.h"
 #include <stdio.h>
 #include "libglusterfs-messages.h"
+#include "syscall.h"
+#ifdef GF_LINUX_HOST_OS
+#include <sys/syscall.h>
+#endif
 
 /*
   TODO: implement destroy margins and prefetching of arenas
@@ -21,6 +25,48 @@
 #define IOBUF_ARENA_MAX_INDEX  (sizeof (gf_iobuf_init_config) /         \
                                 (sizeof (struct iobuf_init_config)))
 
+/* Upper bound on the number of iobufs, and on the bytes, a thread keeps
+   cached in the magazine of one page size class */
+#define IOBUF_MAG_MAX      32
+#define IOBUF_MAG_BYTES    (1 * GF_UNIT_MB)
+
+struct iobuf_mag {
+        int                 size;   /* capacity, 0 == bypass */
+        int                 count;
+        uint64_t            hits;
+        uint64_t            misses; /* refills from the arenas */
+        uint64_t            drains; /* batches returned to the arenas */
+        struct iobuf       *iobufs[IOBUF_MAG_MAX];
+};
+
+typedef struct iobuf_mag_list {
+        /* protected by iobuf_pool->mutex */
+        struct list_head    thr_list;
+        struct iobuf_pool  *iobuf_pool;
+        /*
+         * The magazines are only filled by their own thread. The lock is
+         * taken by other threads to drain them (iobuf_pool_prune) or to
+         * read their counters (statedump), and always after
+         * iobuf_pool->mutex.
+         */
+        pthread_spinlock_t  lock;
+        struct iobuf_mag    mags[];
+} iobuf_mag_list_t;
+
+void
+__iobuf_put (struct iobuf *iobuf, struct iobuf_arena *iobuf_arena);
+
+static void
+iobuf_mag_destructor (void *arg);
+
+static void
+__iobuf_pool_drain_mags (struct iobuf_pool *iobuf_pool, gf_boolean_t release);
+
+#define IOBUF_DEFAULT_HUGEPAGE_SIZE (2 * GF_UNIT_MB)
+
+/* from <numaif.h>, which we do not want to depend on */
+#define IOBUF_MPOL_PREFERRED 1
+
 /* Make sure this array is sorted based on pagesize */
 struct iobuf_init_config gf_iobuf_init_config[] = {
         /* { pagesize, num_pages }, */
@@ -162,9 +208,106 @@ out:
 }
 
 
+/* NUMA node of the calling thread, as an index in iobuf_pool->nodes */
+static int
+iobuf_pool_node (struct iobuf_pool *iobuf_pool)
+{
+#if defined(GF_LINUX_HOST_OS) && defined(SYS_getcpu)
+        unsigned int cpu = 0;
+        unsigned int node = 0;
+
+        if (!iobuf_pool->numa)
+                return 0;
+
+        if (syscall (SYS_getcpu, &cpu, &node, NULL) != 0)
+                return 0;
+
+        if (node >= iobuf_pool->node_cnt)
+                return 0;
+
+        return node;
+#else
+        return 0;
+#endif
+}
+
+
+/* Prefer the memory of @node for the pages of @iobuf_arena, which must not
+   have been touched yet. Failure only costs locality. */
+static void
+iobuf_arena_bind_node (struct iobuf_arena *iobuf_arena, int node)
+{
+#if defined(GF_LINUX_HOST_OS) && defined(SYS_mbind)
+        unsigned long nodemask = 1UL << node;
+
+        if (syscall (SYS_mbind, iobuf_arena->mem_base,
+                     iobuf_arena->arena_size, IOBUF_MPOL_PREFERRED,
+                     &nodemask, sizeof (nodemask) * 8, 0) != 0)
+                gf_msg_debug ("iobuf", errno, "failed to bind arena %p to "
+                              "numa node %d", iobuf_arena->mem_base, node);
+#endif
+}
+
+
+/* mmap the memory of @iobuf_arena according to the huge page policy of the
+ * pool. With MAP_HUGETLB the arena is grown to a multiple of the huge page
+ * size, so its page_count can change.
+ */
+static void *
+__iobuf_arena_map (struct iobuf_pool *iobuf_pool,
+                   struct iobuf_arena *iobuf_arena)
+{
+        void   *mem_base = MAP_FAILED;
+        size_t  size = 0;
+
+        if (iobuf_arena->arena_size < iobuf_pool->hugepage_size)
+                goto regular;
+
+#ifdef MAP_HUGETLB
+        if (iobuf_pool->hugepages == GF_IOBUF_HUGEPAGES_HUGETLB) {
+                size = iobuf_arena->arena_size + iobuf_pool->hugepage_size - 1;
+                size -= size % iobuf_pool->hugepage_size;
+
+                mem_base = mmap (NULL, size, PROT_READ|PROT_WRITE,
+                                 MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB,
+                                 -1, 0);
+                if (mem_base != MAP_FAILED) {
+                        iobuf_arena->arena_size = size;
+                        iobuf_arena->page_count = size /
+                                                  iobuf_arena->page_size;
+                        iobuf_arena->hugetlb = _gf_true;
+                        return mem_base;
+                }
+
+                /* no (more) reserved huge pages, let THP do what it can */
+                if (!iobuf_pool->hugetlb_fallbacks++)
+                        gf_msg ("iobuf", GF_LOG_WARNING, errno,
+                                LG_MSG_MAPPING_FAILED, "mapping arena with "
+                                "huge pages failed, falling back to "
+                                "transparent huge pages");
+        }
+#endif
+
+regular:
+        mem_base = mmap (NULL, iobuf_arena->arena_size,
+                         PROT_READ|PROT_WRITE,
+                         MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+
+#ifdef MADV_HUGEPAGE
+        if (mem_base != MAP_FAILED &&
+            iobuf_pool->hugepages != GF_IOBUF_HUGEPAGES_OFF &&
+            iobuf_arena->arena_size >= iobuf_pool->hugepage_size)
+                (void) madvise (mem_base, iobuf_arena->arena_size,
+                                MADV_HUGEPAGE);
+#endif
+
+        return mem_base;
+}
+
+
 struct iobuf_arena *
 __iobuf_arena_alloc (struct iobuf_pool *iobuf_pool, size_t page_size,
-                     int32_t num_iobufs)
+                     int32_t num_iobufs, int node)
 {
         struct iobuf_arena *iobuf_arena = NULL;
         size_t              rounded_size = 0;
@@ -188,16 +331,18 @@ __iobuf_arena_alloc (struct iobuf_pool *iobuf_pool, size_t page_size,
         iobuf_arena->page_count = num_iobufs;
 
         iobuf_arena->arena_size = rounded_size * num_iobufs;
+        iobuf_arena->numa_node = node;
 
-        iobuf_arena->mem_base = mmap (NULL, iobuf_arena->arena_size,
-                                      PROT_READ|PROT_WRITE,
-                                      MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        iobuf_arena->mem_base = __iobuf_arena_map (iobuf_pool, iobuf_arena);
         if (iobuf_arena->mem_base == MAP_FAILED) {
                 gf_msg (THIS->name, GF_LOG_WARNING, 0, LG_MSG_MAPPING_FAILED,
                         "mapping failed");
                 goto err;
         }
 
+        if (iobuf_pool->numa)
+                iobuf_arena_bind_node (iobuf_arena, node);
+
         if (iobuf_pool->rdma_registration) {
                 iobuf_pool->rdma_registration (iobuf_pool->device,
                                                iobuf_arena);
@@ -213,6 +358,7 @@ __iobuf_arena_alloc (struct iobuf_pool *iobuf_pool, size_t page_size,
         }
 
         iobuf_pool->arena_cnt++;
+        iobuf_pool->nodes[node].arena_cnt++;
 
         return iobuf_arena;
 
@@ -225,7 +371,8 @@ out:
 
 
 struct iobuf_arena *
-__iobuf_arena_unprune (struct iobuf_pool *iobuf_pool, size_t page_size)
+__iobuf_arena_unprune (struct iobuf_pool *iobuf_pool, size_t page_size,
+                       int node)
 {
         struct iobuf_arena *iobuf_arena  = NULL;
         struct iobuf_arena *tmp          = NULL;
@@ -241,7 +388,8 @@ __iobuf_arena_unprune (struct iobuf_pool *iobuf_pool, size_t page_size)
                 return NULL;
         }
 
-        list_for_each_entry (tmp, &iobuf_pool->purge[index], list) {
+        list_for_each_entry (tmp, &iobuf_pool->nodes[node].purge[index],
+                             list) {
                 list_del_init (&tmp->list);
                 iobuf_arena = tmp;
                 break;
@@ -253,7 +401,7 @@ out:
 
 struct iobuf_arena *
 __iobuf_pool_add_arena (struct iobuf_pool *iobuf_pool, size_t page_size,
-                        int32_t num_pages)
+                        int32_t num_pages, int node)
 {
         struct iobuf_arena *iobuf_arena  = NULL;
         int                 index        = 0;
@@ -266,18 +414,18 @@ __iobuf_pool_add_arena (struct iobuf_pool *iobuf_pool, size_t page_size,
                 return NULL;
         }
 
-        iobuf_arena = __iobuf_arena_unprune (iobuf_pool, page_size);
+        iobuf_arena = __iobuf_arena_unprune (iobuf_pool, page_size, node);
 
         if (!iobuf_arena)
                 iobuf_arena = __iobuf_arena_alloc (iobuf_pool, page_size,
-                                                   num_pages);
+                                                   num_pages, node);
 
         if (!iobuf_arena) {
                 gf_msg (THIS->name, GF_LOG_WARNING, 0, LG_MSG_ARENA_NOT_FOUND,
                         "arena not found");
                 return NULL;
         }
-        list_add (&iobuf_arena->list, &iobuf_pool->arenas[index]);
+        list_add (&iobuf_arena->list, &iobuf_pool->nodes[node].arenas[index]);
 
 
         return iobuf_arena;
@@ -295,7 +443,8 @@ iobuf_pool_add_arena (struct iobuf_pool *iobuf_pool, size_t page_size,
         pthread_mutex_lock (&iobuf_pool->mutex);
         {
                 iobuf_arena = __iobuf_pool_add_arena (iobuf_pool, page_size,
-                                                      num_pages);
+                                                      num_pages,
+                                                      iobuf_pool_node (iobuf_pool));
         }
         pthread_mutex_unlock (&iobuf_pool->mutex);
 
@@ -310,42 +459,61 @@ iobuf_pool_destroy (struct iobuf_pool *iobuf_pool)
 {
         struct iobuf_arena *iobuf_arena = NULL;
         struct iobuf_arena *tmp         = NULL;
+        struct iobuf_node  *node        = NULL;
         int                 i           = 0;
+        int                 n           = 0;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
 
+        /* no destructor must run on the magazines freed below */
+        if (iobuf_pool->mag_enabled)
+                (void) pthread_key_delete (iobuf_pool->mag_key);
+
         pthread_mutex_lock (&iobuf_pool->mutex);
         {
-                for (i = 0; i < IOBUF_ARENA_MAX_INDEX; i++) {
-                        list_for_each_entry_safe (iobuf_arena, tmp,
-                                        &iobuf_pool->arenas[i], list) {
-                                list_del_init (&iobuf_arena->list);
-                                iobuf_pool->arena_cnt--;
-
-                                __iobuf_arena_destroy (iobuf_pool, iobuf_arena);
-                        }
-                        list_for_each_entry_safe (iobuf_arena, tmp,
-                                        &iobuf_pool->purge[i], list) {
-                                list_del_init (&iobuf_arena->list);
-                                iobuf_pool->arena_cnt--;
-                                __iobuf_arena_destroy (iobuf_pool, iobuf_arena);
-                        }
-                        /* If there are no iobuf leaks, there should be no
-                         * arenas in the filled list. If at all there are any
-                         * arenas in the filled list, the below function will
-                         * assert.
-                         */
-                        list_for_each_entry_safe (iobuf_arena, tmp,
-                                        &iobuf_pool->filled[i], list) {
-                                list_del_init (&iobuf_arena->list);
-                                iobuf_pool->arena_cnt--;
-                                __iobuf_arena_destroy (iobuf_pool, iobuf_arena);
+                __iobuf_pool_drain_mags (iobuf_pool, _gf_true);
+
+                for (n = 0; n < GF_IOBUF_MAX_NUMA_NODES; n++) {
+                        node = &iobuf_pool->nodes[n];
+
+                        for (i = 0; i < IOBUF_ARENA_MAX_INDEX; i++) {
+                                list_for_each_entry_safe (iobuf_arena, tmp,
+                                                &node->arenas[i], list) {
+                                        list_del_init (&iobuf_arena->list);
+                                        iobuf_pool->arena_cnt--;
+                                        node->arena_cnt--;
+
+                                        __iobuf_arena_destroy (iobuf_pool,
+                                                               iobuf_arena);
+                                }
+                                list_for_each_entry_safe (iobuf_arena, tmp,
+                                                &node->purge[i], list) {
+                                        list_del_init (&iobuf_arena->list);
+                                        iobuf_pool->arena_cnt--;
+                                        node->arena_cnt--;
+                                        __iobuf_arena_destroy (iobuf_pool,
+                                                               iobuf_arena);
+                                }
+                                /* If there are no iobuf leaks, there should
+                                 * be no arenas in the filled list. If at all
+                                 * there are any arenas in the filled list,
+                                 * the below function will assert.
+                                 */
+                                list_for_each_entry_safe (iobuf_arena, tmp,
+                                                &node->filled[i], list) {
+                                        list_del_init (&iobuf_arena->list);
+                                        iobuf_pool->arena_cnt--;
+                                        node->arena_cnt--;
+                                        __iobuf_arena_destroy (iobuf_pool,
+                                                               iobuf_arena);
+                                }
+                                /* If there are no iobuf leaks, there shoould
+                                 * be no standard alloced arenas, iobuf_put
+                                 * will free such arenas.
+                                 * TODO: Free the stdalloc arenas forcefully
+                                 * if present?
+                                 */
                         }
-                        /* If there are no iobuf leaks, there shoould be
-                         * no standard alloced arenas, iobuf_put will free such
-                         * arenas.
-                         * TODO: Free the stdalloc arenas forcefully if present?
-                         */
                 }
         }
         pthread_mutex_unlock (&iobuf_pool->mutex);
@@ -378,7 +546,7 @@ iobuf_create_stdalloc_arena (struct iobuf_pool *iobuf_pool)
         iobuf_arena->page_size = 0x7fffffff;
 
         list_add_tail (&iobuf_arena->list,
-                       &iobuf_pool->arenas[IOBUF_ARENA_MAX_INDEX]);
+                       &iobuf_pool->nodes[0].arenas[IOBUF_ARENA_MAX_INDEX]);
 
 err:
         return;
@@ -389,6 +557,7 @@ iobuf_pool_new (void)
 {
         struct iobuf_pool  *iobuf_pool = NULL;
         int                 i          = 0;
+        int                 n          = 0;
         size_t              page_size  = 0;
         size_t              arena_size = 0;
         int32_t             num_pages  = 0;
@@ -398,13 +567,19 @@ iobuf_pool_new (void)
         if (!iobuf_pool)
                 goto out;
         INIT_LIST_HEAD (&iobuf_pool->all_arenas);
+        INIT_LIST_HEAD (&iobuf_pool->mag_threads);
         pthread_mutex_init (&iobuf_pool->mutex, NULL);
-        for (i = 0; i <= IOBUF_ARENA_MAX_INDEX; i++) {
-                INIT_LIST_HEAD (&iobuf_pool->arenas[i]);
-                INIT_LIST_HEAD (&iobuf_pool->filled[i]);
-                INIT_LIST_HEAD (&iobuf_pool->purge[i]);
+        for (n = 0; n < GF_IOBUF_MAX_NUMA_NODES; n++) {
+                for (i = 0; i <= IOBUF_ARENA_MAX_INDEX; i++) {
+                        INIT_LIST_HEAD (&iobuf_pool->nodes[n].arenas[i]);
+                        INIT_LIST_HEAD (&iobuf_pool->nodes[n].filled[i]);
+                        INIT_LIST_HEAD (&iobuf_pool->nodes[n].purge[i]);
+                }
         }
 
+        iobuf_pool->node_cnt = 1;
+        iobuf_pool->hugepage_size = IOBUF_DEFAULT_HUGEPAGE_SIZE;
+
         iobuf_pool->default_page_size  = 128 * GF_UNIT_KB;
 
         iobuf_pool->rdma_registration = NULL;
@@ -430,6 +605,16 @@ iobuf_pool_new (void)
         /* Need an arena to handle all the bigger iobuf requests */
         iobuf_create_stdalloc_arena (iobuf_pool);
 
+#if !defined(GF_DISABLE_MEMPOOL)
+        if (pthread_key_create (&iobuf_pool->mag_key,
+                                iobuf_mag_destructor) == 0)
+                iobuf_pool->mag_enabled = _gf_true;
+        else
+                gf_msg ("iobuf", GF_LOG_WARNING, 0, LG_MSG_IOBUF_NOT_FOUND,
+                        "failed to create the iobuf magazine key, per-thread "
+                        "iobuf caching is disabled");
+#endif
+
         iobuf_pool->arena_size = arena_size;
 out:
 
@@ -437,6 +622,140 @@ out:
 }
 
 
+/* Number of NUMA nodes with memory, 1 if it cannot be told */
+static int
+iobuf_numa_node_count (void)
+{
+        char        path[PATH_MAX] = {0, };
+        struct stat stbuf = {0, };
+        int         count = 0;
+
+        for (;;) {
+                snprintf (path, sizeof (path), "/sys/devices/system/node/node%d",
+                          count);
+                if (sys_stat (path, &stbuf) != 0)
+                        break;
+                count++;
+        }
+
+        return count ? count : 1;
+}
+
+
+static size_t
+iobuf_hugepage_size (void)
+{
+        FILE   *fp = NULL;
+        char    line[256] = {0, };
+        size_t  size = 0;
+
+        fp = fopen ("/proc/meminfo", "r");
+        if (!fp)
+                return IOBUF_DEFAULT_HUGEPAGE_SIZE;
+
+        while (fgets (line, sizeof (line), fp)) {
+                if (sscanf (line, "Hugepagesize: %zu kB", &size) == 1)
+                        break;
+        }
+
+        fclose (fp);
+
+        return size ? size * GF_UNIT_KB : IOBUF_DEFAULT_HUGEPAGE_SIZE;
+}
+
+
+/* Set how arenas are backed with huge pages (enum gf_iobuf_hugepages), and
+ * whether arenas are taken from the NUMA node of the calling thread. The
+ * idle arenas are mapped again, so this is best done at start-up before
+ * iobufs are handed out.
+ */
+int
+iobuf_pool_set_arena_policy (struct iobuf_pool *iobuf_pool, int hugepages,
+                             gf_boolean_t numa)
+{
+        struct iobuf_arena *iobuf_arena = NULL;
+        struct iobuf_arena *tmp         = NULL;
+        struct iobuf_node  *node        = NULL;
+        int                 node_cnt    = 1;
+        int                 i           = 0;
+        int                 n           = 0;
+        int                 ret         = -1;
+
+        GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
+
+        if (numa) {
+                node_cnt = iobuf_numa_node_count ();
+                if (node_cnt > GF_IOBUF_MAX_NUMA_NODES) {
+                        gf_msg ("iobuf", GF_LOG_WARNING, 0,
+                                LG_MSG_INVALID_ARG, "%d numa nodes found, "
+                                "more than the %d supported, not keeping "
+                                "arenas per node", node_cnt,
+                                GF_IOBUF_MAX_NUMA_NODES);
+                        numa = _gf_false;
+                        node_cnt = 1;
+                }
+        }
+
+        pthread_mutex_lock (&iobuf_pool->mutex);
+        {
+                iobuf_pool->hugepages = hugepages;
+                if (hugepages != GF_IOBUF_HUGEPAGES_OFF)
+                        iobuf_pool->hugepage_size = iobuf_hugepage_size ();
+                iobuf_pool->numa = (numa && node_cnt > 1);
+                iobuf_pool->node_cnt = node_cnt;
+
+                __iobuf_pool_drain_mags (iobuf_pool, _gf_false);
+
+                for (n = 0; n < GF_IOBUF_MAX_NUMA_NODES; n++) {
+                        node = &iobuf_pool->nodes[n];
+
+                        for (i = 0; i < IOBUF_ARENA_MAX_INDEX; i++) {
+                                list_for_each_entry_safe (iobuf_arena, tmp,
+                                                          &node->arenas[i],
+                                                          list) {
+                                        if (iobuf_arena->active_cnt)
+                                                continue;
+
+                                        list_move (&iobuf_arena->list,
+                                                   &node->purge[i]);
+                                }
+
+                                list_for_each_entry_safe (iobuf_arena, tmp,
+                                                          &node->purge[i],
+                                                          list) {
+                                        list_del_init (&iobuf_arena->list);
+                                        list_del_init (&iobuf_arena->all_list);
+                                        iobuf_pool->arena_cnt--;
+                                        node->arena_cnt--;
+                                        __iobuf_arena_destroy (iobuf_pool,
+                                                               iobuf_arena);
+                                }
+                        }
+                }
+
+                n = iobuf_pool_node (iobuf_pool);
+                for (i = 0; i < IOBUF_ARENA_MAX_INDEX; i++) {
+                        if (!list_empty (&iobuf_pool->nodes[n].arenas[i]))
+                                continue;
+
+                        __iobuf_pool_add_arena (iobuf_pool,
+                                                gf_iobuf_init_config[i].pagesize,
+                                                gf_iobuf_init_config[i].num_pages,
+                                                n);
+                }
+        }
+        pthread_mutex_unlock (&iobuf_pool->mutex);
+
+        gf_msg_debug ("iobuf", 0, "iobuf arenas: hugepages=%d (%zu bytes), "
+                      "numa nodes=%d", hugepages, iobuf_pool->hugepage_size,
+                      iobuf_pool->numa ? node_cnt : 0);
+
+        ret = 0;
+out:
+        return ret;
+}
+
+
 void
 __iobuf_arena_prune (struct iobuf_pool *iobuf_pool,
                      struct iobuf_arena *iobuf_arena, int index)
@@ -448,13 +767,14 @@ __iobuf_arena_prune (struct iobuf_pool *iobuf_pool,
          * (ie, at least few iobufs free in arena), that way, there won't
          * be spurious mmap/unmap of buffers
          */
-        if (list_empty (&iobuf_pool->arenas[index]))
+        if (list_empty (&iobuf_pool->nodes[iobuf_arena->numa_node].arenas[index]))
                 goto out;
 
         /* All cases matched, destroy */
         list_del_init (&iobuf_arena->list);
         list_del_init (&iobuf_arena->all_list);
         iobuf_pool->arena_cnt--;
+        iobuf_pool->nodes[iobuf_arena->numa_node].arena_cnt--;
 
         __iobuf_arena_destroy (iobuf_pool, iobuf_arena);
 
@@ -468,20 +788,31 @@ iobuf_pool_prune (struct iobuf_pool *iobuf_pool)
 {
         struct iobuf_arena *iobuf_arena = NULL;
         struct iobuf_arena *tmp         = NULL;
+        struct iobuf_node  *node        = NULL;
         int                 i           = 0;
+        int                 n           = 0;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
 
         pthread_mutex_lock (&iobuf_pool->mutex);
         {
-                for (i = 0; i < IOBUF_ARENA_MAX_INDEX; i++) {
-                        if (list_empty (&iobuf_pool->arenas[i])) {
-                                continue;
-                        }
-
-                        list_for_each_entry_safe (iobuf_arena, tmp,
-                                                  &iobuf_pool->purge[i], list) {
-                                __iobuf_arena_prune (iobuf_pool, iobuf_arena, i);
+                /* the cached iobufs keep their arenas active */
+                __iobuf_pool_drain_mags (iobuf_pool, _gf_false);
+
+                for (n = 0; n < GF_IOBUF_MAX_NUMA_NODES; n++) {
+                        node = &iobuf_pool->nodes[n];
+
+                        for (i = 0; i < IOBUF_ARENA_MAX_INDEX; i++) {
+                                if (list_empty (&node->arenas[i])) {
+                                        continue;
+                                }
+
+                                list_for_each_entry_safe (iobuf_arena, tmp,
+                                                          &node->purge[i],
+                                                          list) {
+                                        __iobuf_arena_prune (iobuf_pool,
+                                                             iobuf_arena, i);
+                                }
                         }
                 }
         }
@@ -498,6 +829,8 @@ __iobuf_select_arena (struct iobuf_pool *iobuf_pool, size_t page_size)
         struct iobuf_arena *iobuf_arena  = NULL;
         struct iobuf_arena *trav         = NULL;
         int                 index        = 0;
+        int                 node         = 0;
+        int                 n            = 0;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
 
@@ -509,8 +842,11 @@ __iobuf_select_arena (struct iobuf_pool *iobuf_pool, size_t page_size)
                 return NULL;
         }
 
+        node = iobuf_pool_node (iobuf_pool);
+
         /* look for unused iobuf from the head-most arena */
-        list_for_each_entry (trav, &iobuf_pool->arenas[index], list) {
+        list_for_each_entry (trav, &iobuf_pool->nodes[node].arenas[index],
+                             list) {
                 if (trav->passive_cnt) {
                         iobuf_arena = trav;
                         break;
@@ -520,7 +856,22 @@ __iobuf_select_arena (struct iobuf_pool *iobuf_pool, size_t page_size)
         if (!iobuf_arena) {
                 /* all arenas were full, find the right count to add */
                 iobuf_arena = __iobuf_pool_add_arena (iobuf_pool, page_size,
-                                                      gf_iobuf_init_config[index].num_pages);
+                                                      gf_iobuf_init_config[index].num_pages,
+                                                      node);
+        }
+
+        /* remote memory is better than none */
+        for (n = 0; !iobuf_arena && n < iobuf_pool->node_cnt; n++) {
+                if (n == node)
+                        continue;
+
+                list_for_each_entry (trav, &iobuf_pool->nodes[n].arenas[index],
+                                     list) {
+                        if (trav->passive_cnt) {
+                                iobuf_arena = trav;
+                                break;
+                        }
+                }
         }
 
 out:
@@ -565,7 +916,8 @@ __iobuf_get (struct iobuf_arena *iobuf_arena, size_t page_size)
                 }
 
                 list_del (&iobuf_arena->list);
-                list_add (&iobuf_arena->list, &iobuf_pool->filled[index]);
+                list_add (&iobuf_arena->list,
+                          &iobuf_pool->nodes[iobuf_arena->numa_node].filled[index]);
         }
 
 out:
@@ -581,7 +933,8 @@ iobuf_get_from_stdalloc (struct iobuf_pool *iobuf_pool, size_t page_size)
         int                 ret         = -1;
 
         /* The first arena in the 'MAX-INDEX' will always be used for misc */
-        list_for_each_entry (trav, &iobuf_pool->arenas[IOBUF_ARENA_MAX_INDEX],
+        list_for_each_entry (trav,
+                             &iobuf_pool->nodes[0].arenas[IOBUF_ARENA_MAX_INDEX],
                              list) {
                 iobuf_arena = trav;
                 break;
@@ -616,6 +969,249 @@ out:
 }
 
 
+static int
+iobuf_mag_size (int index)
+{
+        size_t size = 0;
+
+        size = IOBUF_MAG_BYTES / gf_iobuf_init_config[index].pagesize;
+        if (size > IOBUF_MAG_MAX)
+                size = IOBUF_MAG_MAX;
+
+        return size;
+}
+
+
+static iobuf_mag_list_t *
+iobuf_mag_list_get (struct iobuf_pool *iobuf_pool)
+{
+        iobuf_mag_list_t *mag_list = NULL;
+        int               i = 0;
+
+        if (!iobuf_pool->mag_enabled)
+                return NULL;
+
+        mag_list = pthread_getspecific (iobuf_pool->mag_key);
+        if (mag_list)
+                return mag_list;
+
+        /* not GF_CALLOC, this can be freed by the thread destructor after
+           the xlator it was accounted to is gone */
+        mag_list = CALLOC (1, sizeof (*mag_list) + IOBUF_ARENA_MAX_INDEX *
+                           sizeof (struct iobuf_mag));
+        if (!mag_list)
+                return NULL;
+
+        INIT_LIST_HEAD (&mag_list->thr_list);
+        (void) pthread_spin_init (&mag_list->lock, PTHREAD_PROCESS_PRIVATE);
+        mag_list->iobuf_pool = iobuf_pool;
+        for (i = 0; i < IOBUF_ARENA_MAX_INDEX; i++)
+                mag_list->mags[i].size = iobuf_mag_size (i);
+
+        pthread_mutex_lock (&iobuf_pool->mutex);
+        {
+                list_add (&mag_list->thr_list, &iobuf_pool->mag_threads);
+        }
+        pthread_mutex_unlock (&iobuf_pool->mutex);
+
+        (void) pthread_setspecific (iobuf_pool->mag_key, mag_list);
+
+        return mag_list;
+}
+
+
+/* Return all the iobufs cached in @mag_list to their arenas. Called with
+   iobuf_pool->mutex held. */
+static void
+__iobuf_mag_list_drain (iobuf_mag_list_t *mag_list)
+{
+        struct iobuf_mag *mag = NULL;
+        struct iobuf     *iobuf = NULL;
+        int               i = 0;
+
+        (void) pthread_spin_lock (&mag_list->lock);
+        for (i = 0; i < IOBUF_ARENA_MAX_INDEX; i++) {
+                mag = &mag_list->mags[i];
+                if (mag->count)
+                        mag->drains++;
+
+                while (mag->count) {
+                        iobuf = mag->iobufs[--mag->count];
+                        __iobuf_put (iobuf, iobuf->iobuf_arena);
+                }
+        }
+        (void) pthread_spin_unlock (&mag_list->lock);
+}
+
+
+/* Drain the magazines of all the threads, and with @release also free
+   them. Called with iobuf_pool->mutex held. */
+static void
+__iobuf_pool_drain_mags (struct iobuf_pool *iobuf_pool, gf_boolean_t release)
+{
+        iobuf_mag_list_t *mag_list = NULL;
+        iobuf_mag_list_t *tmp = NULL;
+
+        list_for_each_entry_safe (mag_list, tmp, &iobuf_pool->mag_threads,
+                                  thr_list) {
+                __iobuf_mag_list_drain (mag_list);
+
+                if (!release)
+                        continue;
+
+                list_del_init (&mag_list->thr_list);
+                (void) pthread_spin_destroy (&mag_list->lock);
+                FREE (mag_list);
+        }
+}
+
+
+static void
+iobuf_mag_destructor (void *arg)
+{
+        iobuf_mag_list_t  *mag_list = arg;
+        struct iobuf_pool *iobuf_pool = NULL;
+        int                i = 0;
+
+        iobuf_pool = mag_list->iobuf_pool;
+
+        pthread_mutex_lock (&iobuf_pool->mutex);
+        {
+                __iobuf_mag_list_drain (mag_list);
+
+                for (i = 0; i < IOBUF_ARENA_MAX_INDEX; i++) {
+                        iobuf_pool->mag_hits[i] += mag_list->mags[i].hits;
+                        iobuf_pool->mag_misses[i] += mag_list->mags[i].misses;
+                        iobuf_pool->mag_drains[i] += mag_list->mags[i].drains;
+                }
+
+                list_del_init (&mag_list->thr_list);
+        }
+        pthread_mutex_unlock (&iobuf_pool->mutex);
+
+        (void) pthread_spin_destroy (&mag_list->lock);
+        FREE (mag_list);
+}
+
+
+/* Get a passive iobuf of the page size class @index from the magazine of
+ * this thread, refilling it with half its capacity when it is empty.
+ * Returns NULL if the class is not cached, or the arenas are exhausted.
+ */
+static struct iobuf *
+iobuf_mag_get (struct iobuf_pool *iobuf_pool, int index)
+{
+        iobuf_mag_list_t   *mag_list = NULL;
+        struct iobuf_mag   *mag = NULL;
+        struct iobuf_arena *iobuf_arena = NULL;
+        struct iobuf       *iobuf = NULL;
+        struct iobuf       *batch[IOBUF_MAG_MAX];
+        size_t              page_size = 0;
+        int                 count = 0;
+        int                 i = 0;
+
+        mag_list = iobuf_mag_list_get (iobuf_pool);
+        if (!mag_list)
+                return NULL;
+
+        mag = &mag_list->mags[index];
+        if (!mag->size)
+                return NULL;
+
+        (void) pthread_spin_lock (&mag_list->lock);
+        if (mag->count) {
+                iobuf = mag->iobufs[--mag->count];
+                mag->hits++;
+        } else {
+                mag->misses++;
+        }
+        (void) pthread_spin_unlock (&mag_list->lock);
+
+        if (iobuf)
+                return iobuf;
+
+        page_size = gf_iobuf_init_config[index].pagesize;
+
+        pthread_mutex_lock (&iobuf_pool->mutex);
+        {
+                for (count = 0; count < (mag->size + 1) / 2; count++) {
+                        iobuf_arena = __iobuf_select_arena (iobuf_pool,
+                                                            page_size);
+                        if (!iobuf_arena)
+                                break;
+
+                        batch[count] = __iobuf_get (iobuf_arena, page_size);
+                        if (!batch[count])
+                                break;
+                }
+        }
+        pthread_mutex_unlock (&iobuf_pool->mutex);
+
+        if (!count)
+                return NULL;
+
+        /* only this thread adds to the magazine, so there is room */
+        (void) pthread_spin_lock (&mag_list->lock);
+        for (i = 1; i < count; i++)
+                mag->iobufs[mag->count++] = batch[i];
+        (void) pthread_spin_unlock (&mag_list->lock);
+
+        return batch[0];
+}
+
+
+/* Cache the passive @iobuf in the magazine of this thread, first returning
+ * the older half of the magazine to the arenas if it is full. Returns
+ * _gf_false if @iobuf has to be put back into its arena by the caller.
+ */
+static gf_boolean_t
+iobuf_mag_put (struct iobuf_pool *iobuf_pool, struct iobuf *iobuf, int index)
+{
+        iobuf_mag_list_t *mag_list = NULL;
+        struct iobuf_mag *mag = NULL;
+        struct iobuf     *batch[IOBUF_MAG_MAX];
+        int               count = 0;
+        int               i = 0;
+
+        mag_list = iobuf_mag_list_get (iobuf_pool);
+        if (!mag_list)
+                return _gf_false;
+
+        mag = &mag_list->mags[index];
+        if (!mag->size)
+                return _gf_false;
+
+        if (iobuf->free_ptr) {
+                iobuf->ptr = iobuf->free_ptr;
+                iobuf->free_ptr = NULL;
+        }
+
+        (void) pthread_spin_lock (&mag_list->lock);
+        if (mag->count == mag->size) {
+                count = (mag->size + 1) / 2;
+                memcpy (batch, mag->iobufs, count * sizeof (*batch));
+                memmove (mag->iobufs, mag->iobufs + count,
+                         (mag->count - count) * sizeof (*batch));
+                mag->count -= count;
+                mag->drains++;
+        }
+        mag->iobufs[mag->count++] = iobuf;
+        (void) pthread_spin_unlock (&mag_list->lock);
+
+        if (!count)
+                return _gf_true;
+
+        pthread_mutex_lock (&iobuf_pool->mutex);
+        {
+                for (i = 0; i < count; i++)
+                        __iobuf_put (batch[i], batch[i]->iobuf_arena);
+        }
+        pthread_mutex_unlock (&iobuf_pool->mutex);
+
+        return _gf_true;
+}
+
+
 struct iobuf *
 iobuf_get2 (struct iobuf_pool *iobuf_pool, size_t page_size)
 {
@@ -642,6 +1238,13 @@ iobuf_get2 (struct iobuf_pool *iobuf_pool, size_t page_size)
                 return iobuf;
         }
 
+        iobuf = iobuf_mag_get (iobuf_pool,
+                               gf_iobuf_get_arena_index (rounded_size));
+        if (iobuf) {
+                iobuf_ref (iobuf);
+                return iobuf;
+        }
+
         pthread_mutex_lock (&iobuf_pool->mutex);
         {
                 /* most eligible arena for picking an iobuf */
@@ -698,9 +1301,19 @@ iobuf_get (struct iobuf_pool *iobuf_pool)
 {
         struct iobuf       *iobuf        = NULL;
         struct iobuf_arena *iobuf_arena  = NULL;
+        int                 index        = 0;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
 
+        index = gf_iobuf_get_arena_index (iobuf_pool->default_page_size);
+        if (index != -1) {
+                iobuf = iobuf_mag_get (iobuf_pool, index);
+                if (iobuf) {
+                        iobuf_ref (iobuf);
+                        goto out;
+                }
+        }
+
         pthread_mutex_lock (&iobuf_pool->mutex);
         {
                 /* most eligible arena for picking an iobuf */
@@ -733,6 +1346,7 @@ void
 __iobuf_put (struct iobuf *iobuf, struct iobuf_arena *iobuf_arena)
 {
         struct iobuf_pool *iobuf_pool = NULL;
+        struct iobuf_node *node       = NULL;
         int                index      = 0;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_arena, out);
@@ -752,9 +1366,11 @@ __iobuf_put (struct iobuf *iobuf, struct iobuf_arena *iobuf_arena)
                 return;
         }
 
+        node = &iobuf_pool->nodes[iobuf_arena->numa_node];
+
         if (iobuf_arena->passive_cnt == 0) {
                 list_del (&iobuf_arena->list);
-                list_add_tail (&iobuf_arena->list, &iobuf_pool->arenas[index]);
+                list_add_tail (&iobuf_arena->list, &node->arenas[index]);
         }
 
         list_del_init (&iobuf->list);
@@ -770,7 +1386,7 @@ __iobuf_put (struct iobuf *iobuf, struct iobuf_arena *iobuf_arena)
 
         if (iobuf_arena->active_cnt == 0) {
                 list_del (&iobuf_arena->list);
-                list_add_tail (&iobuf_arena->list, &iobuf_pool->purge[index]);
+                list_add_tail (&iobuf_arena->list, &node->purge[index]);
                 __iobuf_arena_prune (iobuf_pool, iobuf_arena, index);
         }
 out:
@@ -783,6 +1399,7 @@ iobuf_put (struct iobuf *iobuf)
 {
         struct iobuf_arena *iobuf_arena = NULL;
         struct iobuf_pool  *iobuf_pool = NULL;
+        int                 index = 0;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf, out);
 
@@ -800,6 +1417,11 @@ iobuf_put (struct iobuf *iobuf)
                 return;
         }
 
+        /* iobufs of the stdalloc arena are not cached */
+        index = gf_iobuf_get_arena_index (iobuf_arena->page_size);
+        if (index != -1 && iobuf_mag_put (iobuf_pool, iobuf, index))
+                return;
+
         pthread_mutex_lock (&iobuf_pool->mutex);
         {
                 __iobuf_put (iobuf, iobuf_arena);
@@ -1134,6 +1756,10 @@ iobuf_arena_info_dump (struct iobuf_arena *iobuf_arena, const char *key_prefix)
         gf_proc_dump_write(key, "%"PRIu64, iobuf_arena->max_active);
         gf_proc_dump_build_key(key, key_prefix, "page_size");
         gf_proc_dump_write(key, "%"PRIu64, iobuf_arena->page_size);
+        gf_proc_dump_build_key(key, key_prefix, "numa_node");
+        gf_proc_dump_write(key, "%d", iobuf_arena->numa_node);
+        gf_proc_dump_build_key(key, key_prefix, "hugetlb");
+        gf_proc_dump_write(key, "%d", iobuf_arena->hugetlb);
         list_for_each_entry (trav, &iobuf_arena->active.list, list) {
                 gf_proc_dump_build_key(key, key_prefix,"active_iobuf.%d", i++);
                 gf_proc_dump_add_section(key);
@@ -1144,13 +1770,64 @@ out:
         return;
 }
 
+/* Dump the magazine counters of each page size class. Called with
+   iobuf_pool->mutex held. */
+static void
+iobuf_mags_dump (struct iobuf_pool *iobuf_pool)
+{
+        char              key[GF_DUMP_MAX_BUF_LEN];
+        iobuf_mag_list_t *mag_list = NULL;
+        uint64_t          hits = 0;
+        uint64_t          misses = 0;
+        uint64_t          drains = 0;
+        int               cached = 0;
+        int               threads = 0;
+        int               i = 0;
+
+        if (!iobuf_pool->mag_enabled)
+                return;
+
+        list_for_each_entry (mag_list, &iobuf_pool->mag_threads, thr_list)
+                threads++;
+
+        gf_proc_dump_write ("iobuf_pool.magazine_threads", "%d", threads);
+
+        for (i = 0; i < IOBUF_ARENA_MAX_INDEX; i++) {
+                hits = iobuf_pool->mag_hits[i];
+                misses = iobuf_pool->mag_misses[i];
+                drains = iobuf_pool->mag_drains[i];
+                cached = 0;
+
+                list_for_each_entry (mag_list, &iobuf_pool->mag_threads,
+                                     thr_list) {
+                        (void) pthread_spin_lock (&mag_list->lock);
+                        hits += mag_list->mags[i].hits;
+                        misses += mag_list->mags[i].misses;
+                        drains += mag_list->mags[i].drains;
+                        cached += mag_list->mags[i].count;
+                        (void) pthread_spin_unlock (&mag_list->lock);
+                }
+
+                snprintf (key, sizeof (key), "iobuf_pool.magazine.%zu",
+                          gf_iobuf_init_config[i].pagesize);
+                gf_proc_dump_write (key, "hits: %"PRIu64", misses: %"PRIu64
+                                    ", hit_rate: %.2f%%, drains: %"PRIu64
+                                    ", cached: %d", hits, misses,
+                                    (hits + misses) ?
+                                    (hits * 100.0) / (hits + misses) : 0.0,
+                                    drains, cached);
+        }
+}
+
 void
 iobuf_stats_dump (struct iobuf_pool *iobuf_pool)
 {
         char               msg[1024];
         struct iobuf_arena *trav = NULL;
+        struct iobuf_node  *node = NULL;
         int                i = 1;
         int                j = 0;
+        int                n = 0;
         int                ret = -1;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
@@ -1172,30 +1849,47 @@ iobuf_stats_dump (struct iobuf_pool *iobuf_pool)
                            iobuf_pool->arena_cnt);
         gf_proc_dump_write("iobuf_pool.request_misses", "%"PRId64,
                            iobuf_pool->request_misses);
+        gf_proc_dump_write("iobuf_pool.hugepages", "%d",
+                           iobuf_pool->hugepages);
+        gf_proc_dump_write("iobuf_pool.hugetlb_fallbacks", "%"PRIu64,
+                           iobuf_pool->hugetlb_fallbacks);
+        gf_proc_dump_write("iobuf_pool.numa_nodes", "%d",
+                           iobuf_pool->numa ? iobuf_pool->node_cnt : 0);
+        for (n = 0; n < iobuf_pool->node_cnt; n++) {
+                snprintf (msg, sizeof (msg), "iobuf_pool.node.%d.arena_cnt",
+                          n);
+                gf_proc_dump_write (msg, "%d",
+                                    iobuf_pool->nodes[n].arena_cnt);
+        }
 
-        for (j = 0; j < IOBUF_ARENA_MAX_INDEX; j++) {
-                list_for_each_entry (trav, &iobuf_pool->arenas[j], list) {
-                        snprintf(msg, sizeof(msg),
-                                 "arena.%d", i);
-                        gf_proc_dump_add_section(msg);
-                        iobuf_arena_info_dump(trav,msg);
-                        i++;
-                }
-                list_for_each_entry (trav, &iobuf_pool->purge[j], list) {
-                        snprintf(msg, sizeof(msg),
-                                 "purge.%d", i);
-                        gf_proc_dump_add_section(msg);
-                        iobuf_arena_info_dump(trav,msg);
-                        i++;
-                }
-                list_for_each_entry (trav, &iobuf_pool->filled[j], list) {
-                        snprintf(msg, sizeof(msg),
-                                 "filled.%d", i);
-                        gf_proc_dump_add_section(msg);
-                        iobuf_arena_info_dump(trav,msg);
-                        i++;
-                }
+        iobuf_mags_dump (iobuf_pool);
 
+        for (n = 0; n < GF_IOBUF_MAX_NUMA_NODES; n++) {
+                node = &iobuf_pool->nodes[n];
+
+                for (j = 0; j < IOBUF_ARENA_MAX_INDEX; j++) {
+                        list_for_each_entry (trav, &node->arenas[j], list) {
+                                snprintf(msg, sizeof(msg),
+                                         "arena.%d", i);
+                                gf_proc_dump_add_section(msg);
+                                iobuf_arena_info_dump(trav,msg);
+                                i++;
+                        }
+                        list_for_each_entry (trav, &node->purge[j], list) {
+                                snprintf(msg, sizeof(msg),
+                                         "purge.%d", i);
+                                gf_proc_dump_add_section(msg);
+                                iobuf_arena_info_dump(trav,msg);
+                                i++;
+                        }
+                        list_for_each_entry (trav, &node->filled[j], list) {
+                                snprintf(msg, sizeof(msg),
+                                         "filled.%d", i);
+                                gf_proc_dump_add_section(msg);
+                                iobuf_arena_info_dump(trav,msg);
+                                i++;
+                        }
+                }
         }
 
         pthread_mutex_unlock(&iobuf_pool->mutex);
@@ -21,6 +21,17 @@
 
 #define GF_RDMA_DEVICE_COUNT 8
 
+/* NUMA nodes which can have arenas of their own, on larger systems all the
+   arenas are kept on a single list */
+#define GF_IOBUF_MAX_NUMA_NODES 8
+
+/* how the arenas are backed with huge pages */
+enum gf_iobuf_hugepages {
+        GF_IOBUF_HUGEPAGES_OFF = 0,
+        GF_IOBUF_HUGEPAGES_THP,     /* madvise (MADV_HUGEPAGE) */
+        GF_IOBUF_HUGEPAGES_HUGETLB, /* MAP_HUGETLB, THP if none available */
+};
+
 /* Lets try to define the new anonymous mapping
  * flag, in case the system is still using the
  * now deprecated MAP_ANON flag.
@@ -103,17 +114,14 @@ struct iobuf_arena {
                                            (unused by itself) */
         uint64_t            alloc_cnt;  /* total allocs in this pool */
         int                 max_active; /* max active buffers at a given time */
+        int                 numa_node;  /* index in iobuf_pool->nodes */
+        gf_boolean_t        hugetlb;    /* mem_base is MAP_HUGETLB */
 };
 
 
-struct iobuf_pool {
-        pthread_mutex_t     mutex;
-        size_t              arena_size; /* size of memory region in
-                                           arena */
-        size_t              default_page_size; /* default size of iobuf */
-
+/* arenas of the memory of one NUMA node */
+struct iobuf_node {
         int                 arena_cnt;
-        struct list_head    all_arenas;
         struct list_head    arenas[GF_VARIABLE_IOBUF_COUNT];
         /* array of arenas. Each element of the array is a list of arenas
            holding iobufs of particular page_size */
@@ -123,6 +131,27 @@ struct iobuf_pool {
 
         struct list_head    purge[GF_VARIABLE_IOBUF_COUNT];
         /* array of of arenas which can be purged */
+};
+
+
+struct iobuf_pool {
+        pthread_mutex_t     mutex;
+        size_t              arena_size; /* size of memory region in
+                                           arena */
+        size_t              default_page_size; /* default size of iobuf */
+
+        int                 arena_cnt;
+        struct list_head    all_arenas;
+
+        /* arenas are taken from the node of the calling thread when numa
+           is set, otherwise all of them are kept in nodes[0] */
+        gf_boolean_t        numa;
+        int                 node_cnt;
+        struct iobuf_node   nodes[GF_IOBUF_MAX_NUMA_NODES];
+
+        int                 hugepages;  /* enum gf_iobuf_hugepages */
+        size_t              hugepage_size;
+        uint64_t            hugetlb_fallbacks; /* MAP_HUGETLB failures */
 
         uint64_t            request_misses; /* mostly the requests for higher
                                               value of iobufs */
@@ -132,10 +161,21 @@ struct iobuf_pool {
         int (*rdma_registration)(void **, void*);
         int (*rdma_deregistration)(struct list_head**, struct iobuf_arena *);
 
+        /* per-thread magazines of passive iobufs, one per page size class,
+           which are refilled from and drained to the arenas in batches */
+        gf_boolean_t        mag_enabled;
+        pthread_key_t       mag_key;
+        struct list_head    mag_threads; /* protected by mutex */
+        /* counters of the magazines of exited threads */
+        uint64_t            mag_hits[GF_VARIABLE_IOBUF_COUNT];
+        uint64_t            mag_misses[GF_VARIABLE_IOBUF_COUNT];
+        uint64_t            mag_drains[GF_VARIABLE_IOBUF_COUNT];
 };
 
 
 struct iobuf_pool *iobuf_pool_new (void);
+int iobuf_pool_set_arena_policy (struct iobuf_pool *iobuf_pool, int hugepages,
+                                 gf_boolean_t numa);
 void iobuf_pool_destroy (struct iobuf_pool *iobuf_pool);
 struct iobuf *iobuf_get (struct iobuf_pool *iobuf_pool);
 void iobuf_unref (struct iobuf *iobuf);
@@ -177,6 +177,10 @@ enum gf_common_mem_types_ {
         gf_common_volfile_t,
         gf_common_mt_mgmt_v3_lock_timer_t,
         gf_common_mt_server_cmdline_t,
+        gf_common_mt_inode_table_shard_t,
+        gf_common_mt_dict_index_t,
+        gf_common_mt_rpcsvc_fq_t,
+        gf_common_mt_rpcsvc_fq_flow_t,
         gf_common_mt_end
 };
 #endif
@@ -16,6 +16,8 @@
 #include "stack.h"
 #include "common-utils.h"
 #include "syscall.h"
+#include "timer.h"
+#include "event.h"
 
 
 #ifdef HAVE_MALLOC_H
@@ -893,6 +895,9 @@ gf_proc_dump_info (int signum, glusterfs_ctx_t *ctx)
         if (GF_PROC_DUMP_IS_OPTION_ENABLED (callpool))
                 gf_proc_dump_pending_frames (ctx->pool);
 
+        gf_timer_registry_dump (ctx);
+        event_pool_dump (ctx->event_pool);
+
         /* dictionary stats */
         gf_proc_dump_add_section ("dict");
         gf_proc_dump_dict_info (ctx);
@@ -13,12 +13,255 @@
 #include "common-utils.h"
 #include "globals.h"
 #include "timespec.h"
+#include "statedump.h"
 #include "libglusterfs-messages.h"
 
+/* anything further out than this is parked in the last slot of the top
+ * level and re-inserted when it gets cascaded down */
+#define GF_TIMER_WHEEL_SPAN \
+        (1ULL << (GF_TIMER_TVR_BITS + GF_TIMER_TVN_LEVELS * GF_TIMER_TVN_BITS))
+
+/* how long gf_timer_proc() sleeps when nothing is pending */
+#define GF_TIMER_IDLE_TICKS     (1000000000 / GF_TIMER_TICK_NS)
+
 /* fwd decl */
 static gf_timer_registry_t *
 gf_timer_registry_init (glusterfs_ctx_t *);
 
+
+static int64_t
+gf_timer_elapsed_ns (gf_timer_registry_t *reg, struct timespec *ts)
+{
+        return (ts->tv_sec - reg->epoch.tv_sec) * 1000000000LL +
+               (ts->tv_nsec - reg->epoch.tv_nsec);
+}
+
+
+/* tick in which @ts falls */
+static uint64_t
+gf_timer_ts_to_tick (gf_timer_registry_t *reg, struct timespec *ts)
+{
+        int64_t ns = gf_timer_elapsed_ns (reg, ts);
+
+        if (ns <= 0)
+                return 0;
+
+        return ns / GF_TIMER_TICK_NS;
+}
+
+
+/* first tick that starts at or after @ts, so that timers never fire early */
+static uint64_t
+gf_timer_ts_to_expiry (gf_timer_registry_t *reg, struct timespec *ts)
+{
+        int64_t ns = gf_timer_elapsed_ns (reg, ts);
+
+        if (ns <= 0)
+                return 0;
+
+        return (ns + GF_TIMER_TICK_NS - 1) / GF_TIMER_TICK_NS;
+}
+
+
+static void
+__gf_timer_add (gf_timer_registry_t *reg, gf_timer_t *event)
+{
+        struct list_head *vec = NULL;
+        uint64_t expires = event->expires;
+        uint64_t idx = 0;
+        int level = 0;
+        int shift = 0;
+
+        if (expires < reg->tick)
+                expires = reg->tick;
+
+        idx = expires - reg->tick;
+        if (idx < GF_TIMER_TVR_SIZE) {
+                vec = &reg->tv1[expires & GF_TIMER_TVR_MASK];
+                goto add;
+        }
+
+        if (idx >= GF_TIMER_WHEEL_SPAN) {
+                idx = GF_TIMER_WHEEL_SPAN - 1;
+                expires = reg->tick + idx;
+        }
+
+        for (level = 0; level < GF_TIMER_TVN_LEVELS - 1; level++) {
+                shift = GF_TIMER_TVR_BITS + (level + 1) * GF_TIMER_TVN_BITS;
+                if (idx < (1ULL << shift))
+                        break;
+        }
+
+        shift = GF_TIMER_TVR_BITS + level * GF_TIMER_TVN_BITS;
+        vec = &reg->tvn[level][(expires >> shift) & GF_TIMER_TVN_MASK];
+add:
+        list_add_tail (&event->list, vec);
+}
+
+
+static void
+__gf_timer_cascade (gf_timer_registry_t *reg, struct list_head *vec)
+{
+        struct list_head  head;
+        gf_timer_t       *event = NULL;
+        gf_timer_t       *tmp = NULL;
+
+        INIT_LIST_HEAD (&head);
+        list_splice_init (vec, &head);
+
+        list_for_each_entry_safe (event, tmp, &head, list) {
+                list_del (&event->list);
+                __gf_timer_add (reg, event);
+                reg->cascaded++;
+        }
+}
+
+
+/*
+ * Runs the next tick of the wheel, moving its timers to @expired. When the
+ * first level wraps the matching slot of the level above is cascaded down,
+ * and so on upwards.
+ */
+static void
+__gf_timer_run_tick (gf_timer_registry_t *reg, struct list_head *expired)
+{
+        struct list_head  head;
+        gf_timer_t       *event = NULL;
+        gf_timer_t       *tmp = NULL;
+        uint64_t          tick = reg->tick;
+        int               index = tick & GF_TIMER_TVR_MASK;
+        int               level = 0;
+        int               i = 0;
+
+        if (!index) {
+                for (level = 0; level < GF_TIMER_TVN_LEVELS; level++) {
+                        i = (tick >> (GF_TIMER_TVR_BITS +
+                                      level * GF_TIMER_TVN_BITS)) &
+                                GF_TIMER_TVN_MASK;
+                        __gf_timer_cascade (reg, &reg->tvn[level][i]);
+                        if (i)
+                                break;
+                }
+        }
+
+        INIT_LIST_HEAD (&head);
+        list_splice_init (&reg->tv1[index], &head);
+
+        list_for_each_entry_safe (event, tmp, &head, list) {
+                list_del (&event->list);
+                if (event->expires > tick) {
+                        /* parked beyond the span of the wheel */
+                        __gf_timer_add (reg, event);
+                        continue;
+                }
+
+                event->fired = _gf_true;
+                list_add_tail (&event->list, expired);
+                reg->pending--;
+                reg->expired++;
+        }
+
+        reg->tick++;
+}
+
+
+/*
+ * Earliest tick gf_timer_proc() has to wake up for: either the next busy
+ * slot of the first level, or the point where it wraps and the levels
+ * above have to be cascaded.
+ */
+static uint64_t
+__gf_timer_next_tick (gf_timer_registry_t *reg)
+{
+        uint64_t tick = reg->tick;
+
+        if (!reg->pending)
+                return tick + GF_TIMER_IDLE_TICKS;
+
+        /* the levels above still have to be cascaded into this round */
+        if (!(tick & GF_TIMER_TVR_MASK))
+                return tick;
+
+        do {
+                if (!list_empty (&reg->tv1[tick & GF_TIMER_TVR_MASK]))
+                        break;
+                tick++;
+        } while (tick & GF_TIMER_TVR_MASK);
+
+        return tick;
+}
+
+
+static void
+gf_timer_fire (gf_timer_t *event)
+{
+        xlator_t *old_THIS = NULL;
+
+        if (event->xl) {
+                old_THIS = THIS;
+                THIS = event->xl;
+        }
+        event->callbk (event->data);
+        GF_FREE (event);
+        if (old_THIS) {
+                THIS = old_THIS;
+        }
+}
+
+
+static void
+gf_timer_run_expired (struct list_head *expired)
+{
+        gf_timer_t *event = NULL;
+        gf_timer_t *tmp = NULL;
+
+        list_for_each_entry_safe (event, tmp, expired, list) {
+                list_del (&event->list);
+                gf_timer_fire (event);
+        }
+}
+
+
+static void
+gf_timer_deadline (gf_timer_registry_t *reg, uint64_t tick,
+                   struct timespec *deadline)
+{
+        uint64_t ns = tick * GF_TIMER_TICK_NS;
+
+        deadline->tv_sec = reg->epoch.tv_sec + ns / 1000000000;
+        deadline->tv_nsec = reg->epoch.tv_nsec + ns % 1000000000;
+        if (deadline->tv_nsec >= 1000000000) {
+                deadline->tv_sec++;
+                deadline->tv_nsec -= 1000000000;
+        }
+
+#ifdef GF_DARWIN_HOST_OS
+        /* no monotonic condition variables here, translate the deadline
+         * into wall clock time */
+        {
+                struct timespec now;
+                struct timeval  tv;
+                int64_t         delta;
+
+                timespec_now (&now);
+                delta = (deadline->tv_sec - now.tv_sec) * 1000000000LL +
+                        (deadline->tv_nsec - now.tv_nsec);
+                if (delta < 0)
+                        delta = 0;
+
+                gettimeofday (&tv, NULL);
+                TIMEVAL_TO_TIMESPEC (&tv, deadline);
+                deadline->tv_sec += delta / 1000000000;
+                deadline->tv_nsec += delta % 1000000000;
+                if (deadline->tv_nsec >= 1000000000) {
+                        deadline->tv_sec++;
+                        deadline->tv_nsec -= 1000000000;
+                }
+        }
+#endif
+}
+
+
 gf_timer_t *
 gf_timer_call_after (glusterfs_ctx_t *ctx,
                      struct timespec delta,
@@ -27,8 +270,6 @@ gf_timer_call_after (glusterfs_ctx_t *ctx,
 {
         gf_timer_registry_t *reg = NULL;
         gf_timer_t *event = NULL;
-        gf_timer_t *trav = NULL;
-        uint64_t at = 0;
 
         if ((ctx == NULL) || (ctx->cleanup_started))
         {
@@ -52,19 +293,21 @@ gf_timer_call_after (glusterfs_ctx_t *ctx,
         }
         timespec_now (&event->at);
         timespec_adjust_delta (&event->at, delta);
-        at = TS (event->at);
         event->callbk = callbk;
         event->data = data;
         event->xl = THIS;
-        LOCK (&reg->lock);
+        pthread_mutex_lock (&reg->lock);
         {
-                list_for_each_entry_reverse (trav, &reg->active, list) {
-                        if (TS (trav->at) < at)
-                                break;
-                }
-                list_add (&event->list, &trav->list);
+                event->expires = gf_timer_ts_to_expiry (reg, &event->at);
+                __gf_timer_add (reg, event);
+                reg->pending++;
+                reg->armed++;
+
+                /* wake gf_timer_proc up if it sleeps past the new timer */
+                if (event->expires < reg->wakeup)
+                        pthread_cond_signal (&reg->cond);
         }
-        UNLOCK (&reg->lock);
+        pthread_mutex_unlock (&reg->lock);
         return event;
 }
 
@@ -99,21 +342,23 @@ gf_timer_call_cancel (glusterfs_ctx_t *ctx,
         if (!reg) {
                 /* This can happen when cleanup may have just started and
                  * gf_timer_registry_destroy() sets ctx->timer to NULL.
-                 * Just bail out as success as gf_timer_proc() takes
-                 * care of cleaning up the events.
+                 * Just bail out as success as gf_timer_registry_destroy()
+                 * takes care of cleaning up the events.
                  */
                 return 0;
         }
 
-        LOCK (&reg->lock);
+        pthread_mutex_lock (&reg->lock);
         {
                 fired = event->fired;
                 if (fired)
                         goto unlock;
                 list_del (&event->list);
+                reg->pending--;
+                reg->cancelled++;
         }
 unlock:
-        UNLOCK (&reg->lock);
+        pthread_mutex_unlock (&reg->lock);
 
         if (!fired) {
                 GF_FREE (event);
@@ -127,95 +372,144 @@ static void *
 gf_timer_proc (void *data)
 {
         gf_timer_registry_t *reg = data;
-        struct timespec sleepts;
-        gf_timer_t *event = NULL;
-        gf_timer_t *tmp = NULL;
-        xlator_t   *old_THIS = NULL;
+        struct timespec      now;
+        struct timespec      deadline;
+        struct list_head     expired;
+        uint64_t             now_tick = 0;
+
+        INIT_LIST_HEAD (&expired);
 
+        pthread_mutex_lock (&reg->lock);
         while (!reg->fin) {
-                uint64_t now;
-                struct timespec now_ts;
-
-                timespec_now (&now_ts);
-                now = TS (now_ts);
-                while (1) {
-                        uint64_t at;
-                        char need_cbk = 0;
-
-                        /*
-                         * This will be overridden with a shorter interval if
-                         * there's an event scheduled sooner. That makes the
-                         * system more responsive in most cases, but doesn't
-                         * include the case where a timer is added while we're
-                         * asleep. It's tempting to use pthread_cond_timedwait,
-                         * with the caveat that we'd be relying on system time
-                         * instead of monotonic time. That's a mess when the
-                         * system time is adjusted.  Another alternative might
-                         * be to use pthread_kill, but that will remain TBD for
-                         * now.
-                         */
-                        sleepts.tv_sec = 1;
-                        sleepts.tv_nsec = 0;
-
-                        LOCK (&reg->lock);
-                        {
-                                /*
-                                 * Using list_for_each and then always breaking
-                                 * after the first iteration might seem strange,
-                                 * but (unlike alternatives) is independent of
-                                 * the underlying list implementation.
-                                 */
-                                list_for_each_entry_safe (event,
-                                             tmp, &reg->active, list) {
-                                        at = TS (event->at);
-                                        if (now >= at) {
-                                                need_cbk = 1;
-                                                event->fired = _gf_true;
-                                                list_del (&event->list);
-                                        } else {
-                                                uint64_t diff = now - at;
-
-                                                if (diff < 1000000000) {
-                                                        sleepts.tv_sec = 0;
-                                                        sleepts.tv_nsec = diff;
-                                                }
-                                        }
-                                        break;
-                                }
-                        }
-                        UNLOCK (&reg->lock);
-                        if (need_cbk) {
-                                old_THIS = NULL;
-                                if (event->xl) {
-                                        old_THIS = THIS;
-                                        THIS = event->xl;
-                                }
-                                event->callbk (event->data);
-                                GF_FREE (event);
-                                if (old_THIS) {
-                                        THIS = old_THIS;
-                                }
+                timespec_now (&now);
+                now_tick = gf_timer_ts_to_tick (reg, &now);
+
+                /* nothing to cascade or fire, skip ahead */
+                if (!reg->pending && reg->tick <= now_tick)
+                        reg->tick = now_tick + 1;
+
+                while (reg->tick <= now_tick)
+                        __gf_timer_run_tick (reg, &expired);
+
+                if (!list_empty (&expired)) {
+                        if (reg->dispatch_count) {
+                                list_append_init (&expired, &reg->dispatch);
+                                pthread_cond_broadcast (&reg->dispatch_cond);
                         } else {
-                                break;
+                                pthread_mutex_unlock (&reg->lock);
+                                gf_timer_run_expired (&expired);
+                                pthread_mutex_lock (&reg->lock);
+                                continue;
                         }
                 }
-                nanosleep (&sleepts, NULL);
+
+                reg->wakeup = __gf_timer_next_tick (reg);
+                gf_timer_deadline (reg, reg->wakeup, &deadline);
+                pthread_cond_timedwait (&reg->cond, &reg->lock, &deadline);
         }
+        pthread_mutex_unlock (&reg->lock);
 
-        LOCK (&reg->lock);
-        {
-                /* Do not call gf_timer_call_cancel(),
-                 * it will lead to deadlock
-                 */
-                list_for_each_entry_safe (event, tmp, &reg->active, list) {
+        return NULL;
+}
+
+
+static void *
+gf_timer_dispatch_proc (void *data)
+{
+        gf_timer_registry_t *reg = data;
+        gf_timer_t          *event = NULL;
+
+        pthread_mutex_lock (&reg->lock);
+        while (!reg->fin) {
+                if (list_empty (&reg->dispatch)) {
+                        pthread_cond_wait (&reg->dispatch_cond, &reg->lock);
+                        continue;
+                }
+
+                event = list_first_entry (&reg->dispatch, gf_timer_t, list);
+                list_del (&event->list);
+
+                pthread_mutex_unlock (&reg->lock);
+                gf_timer_fire (event);
+                pthread_mutex_lock (&reg->lock);
+        }
+        pthread_mutex_unlock (&reg->lock);
+
+        return NULL;
+}
+
+
+static void
+gf_timer_registry_free (gf_timer_registry_t *reg)
+{
+        gf_timer_t *event = NULL;
+        gf_timer_t *tmp = NULL;
+        int         level = 0;
+        int         i = 0;
+
+        /* Do not call gf_timer_call_cancel(),
+         * it will lead to deadlock
+         */
+        for (i = 0; i < GF_TIMER_TVR_SIZE; i++) {
+                list_for_each_entry_safe (event, tmp, &reg->tv1[i], list) {
                         list_del (&event->list);
                         GF_FREE (event);
                 }
         }
-        UNLOCK (&reg->lock);
-        LOCK_DESTROY (&reg->lock);
 
-        return NULL;
+        for (level = 0; level < GF_TIMER_TVN_LEVELS; level++) {
+                for (i = 0; i < GF_TIMER_TVN_SIZE; i++) {
+                        list_for_each_entry_safe (event, tmp,
+                                                  &reg->tvn[level][i], list) {
+                                list_del (&event->list);
+                                GF_FREE (event);
+                        }
+                }
+        }
+
+        list_for_each_entry_safe (event, tmp, &reg->dispatch, list) {
+                list_del (&event->list);
+                GF_FREE (event);
+        }
+
+        pthread_cond_destroy (&reg->dispatch_cond);
+        pthread_cond_destroy (&reg->cond);
+        pthread_mutex_destroy (&reg->lock);
+        GF_FREE (reg->dispatchers);
+        GF_FREE (reg);
+}
+
+
+static int
+gf_timer_dispatchers_start (gf_timer_registry_t *reg, int count)
+{
+        char thread_name[GF_THREAD_NAMEMAX] = {0,};
+        int  ret = 0;
+        int  i = 0;
+
+        reg->dispatchers = GF_CALLOC (count, sizeof (*reg->dispatchers),
+                                      gf_common_mt_gf_timer_registry_t);
+        if (!reg->dispatchers)
+                return -1;
+
+        for (i = 0; i < count; i++) {
+                snprintf (thread_name, sizeof (thread_name), "tmrdsp%d", i);
+                ret = gf_thread_create (&reg->dispatchers[i], NULL,
+                                        gf_timer_dispatch_proc, reg,
+                                        thread_name);
+                if (ret) {
+                        gf_msg (THIS->name, GF_LOG_ERROR, ret,
+                                LG_MSG_PTHREAD_FAILED,
+                                "Thread creation failed");
+                        break;
+                }
+        }
+
+        /* whatever did start is used, none means callbacks are run
+         * inline by gf_timer_proc() */
+        reg->dispatch_count = i;
+
+        return ret;
 }
 
 
@@ -223,6 +517,9 @@ static gf_timer_registry_t *
 gf_timer_registry_init (glusterfs_ctx_t *ctx)
 {
         gf_timer_registry_t *reg = NULL;
+        pthread_condattr_t attr;
+        int level = 0;
+        int i = 0;
         int ret = -1;
 
         LOCK (&ctx->lock);
@@ -238,9 +535,32 @@ gf_timer_registry_init (glusterfs_ctx_t *ctx)
                         UNLOCK (&ctx->lock);
                         goto out;
                 }
+
+                pthread_mutex_init (&reg->lock, NULL);
+                pthread_condattr_init (&attr);
+#ifndef GF_DARWIN_HOST_OS
+                /* deadlines are computed from timespec_now() */
+                pthread_condattr_setclock (&attr, CLOCK_MONOTONIC);
+#endif
+                pthread_cond_init (&reg->cond, &attr);
+                pthread_condattr_destroy (&attr);
+                pthread_cond_init (&reg->dispatch_cond, NULL);
+
+                for (i = 0; i < GF_TIMER_TVR_SIZE; i++)
+                        INIT_LIST_HEAD (&reg->tv1[i]);
+                for (level = 0; level < GF_TIMER_TVN_LEVELS; level++)
+                        for (i = 0; i < GF_TIMER_TVN_SIZE; i++)
+                                INIT_LIST_HEAD (&reg->tvn[level][i]);
+                INIT_LIST_HEAD (&reg->dispatch);
+
+                timespec_now (&reg->epoch);
+
+                if (ctx->cmd_args.timer_dispatch_threads > 0)
+                        gf_timer_dispatchers_start (reg,
+                                  min (ctx->cmd_args.timer_dispatch_threads,
+                                       GF_TIMER_MAX_DISPATCH_THREADS));
+
                 ctx->timer = reg;
-                LOCK_INIT (&reg->lock);
-                INIT_LIST_HEAD (&reg->active);
         }
         UNLOCK (&ctx->lock);
         ret = gf_thread_create (&reg->th, NULL, gf_timer_proc, reg, "timer");
@@ -260,6 +580,7 @@ gf_timer_registry_destroy (glusterfs_ctx_t *ctx)
 {
         pthread_t thr_id;
         gf_timer_registry_t *reg = NULL;
+        int i = 0;
 
         if (ctx == NULL)
                 return;
@@ -275,7 +596,50 @@ gf_timer_registry_destroy (glusterfs_ctx_t *ctx)
                 return;
 
         thr_id = reg->th;
-        reg->fin = 1;
+        pthread_mutex_lock (&reg->lock);
+        {
+                reg->fin = 1;
+                pthread_cond_signal (&reg->cond);
+                pthread_cond_broadcast (&reg->dispatch_cond);
+        }
+        pthread_mutex_unlock (&reg->lock);
+
         pthread_join (thr_id, NULL);
-        GF_FREE (reg);
+        for (i = 0; i < reg->dispatch_count; i++)
+                pthread_join (reg->dispatchers[i], NULL);
+
+        gf_timer_registry_free (reg);
+}
+
+
+void
+gf_timer_registry_dump (glusterfs_ctx_t *ctx)
+{
+        gf_timer_registry_t *reg = NULL;
+        int ret = -1;
+
+        LOCK (&ctx->lock);
+        {
+                reg = ctx->timer;
+        }
+        UNLOCK (&ctx->lock);
+
+        if (!reg)
+                return;
+
+        ret = pthread_mutex_trylock (&reg->lock);
+        if (ret)
+                return;
+        {
+                gf_proc_dump_add_section ("timer");
+                gf_proc_dump_write ("tick_ns", "%d", GF_TIMER_TICK_NS);
+                gf_proc_dump_write ("dispatch_threads", "%d",
+                                    reg->dispatch_count);
+                gf_proc_dump_write ("pending", "%"PRIu64, reg->pending);
+                gf_proc_dump_write ("armed", "%"PRIu64, reg->armed);
+                gf_proc_dump_write ("cancelled", "%"PRIu64, reg->cancelled);
+                gf_proc_dump_write ("expired", "%"PRIu64, reg->expired);
+                gf_proc_dump_write ("cascaded", "%"PRIu64, reg->cascaded);
+        }
+        pthread_mutex_unlock (&reg->lock);
 }
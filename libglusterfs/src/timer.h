@@ -18,6 +18,23 @@
 
 typedef void (*gf_timer_cbk_t) (void *);
 
+/*
+ * Timers are kept in a hierarchical timing wheel, so arming and cancelling
+ * a timer is O(1) regardless of how many are pending. The first level has
+ * one slot per tick, every further level covers GF_TIMER_TVN_SIZE slots of
+ * the level below it and is cascaded down when the level below wraps.
+ */
+#define GF_TIMER_TICK_NS        1000000         /* 1 msec per tick */
+#define GF_TIMER_TVR_BITS       8
+#define GF_TIMER_TVN_BITS       6
+#define GF_TIMER_TVR_SIZE       (1 << GF_TIMER_TVR_BITS)
+#define GF_TIMER_TVN_SIZE       (1 << GF_TIMER_TVN_BITS)
+#define GF_TIMER_TVR_MASK       (GF_TIMER_TVR_SIZE - 1)
+#define GF_TIMER_TVN_MASK       (GF_TIMER_TVN_SIZE - 1)
+#define GF_TIMER_TVN_LEVELS     4
+
+#define GF_TIMER_MAX_DISPATCH_THREADS   16
+
 struct _gf_timer {
         union {
                 struct list_head list;
@@ -27,6 +44,7 @@ struct _gf_timer {
                 };
         };
         struct timespec   at;
+        uint64_t          expires;      /* tick at which the timer fires */
         gf_timer_cbk_t    callbk;
         void             *data;
         xlator_t         *xl;
@@ -36,8 +54,27 @@ struct _gf_timer {
 struct _gf_timer_registry {
         pthread_t        th;
         char             fin;
-        struct list_head active;
-        gf_lock_t        lock;
+        pthread_mutex_t  lock;
+        pthread_cond_t   cond;
+
+        struct timespec  epoch;         /* time of tick 0 */
+        uint64_t         tick;          /* next tick to be run */
+        uint64_t         wakeup;        /* tick gf_timer_proc sleeps until */
+        struct list_head tv1[GF_TIMER_TVR_SIZE];
+        struct list_head tvn[GF_TIMER_TVN_LEVELS][GF_TIMER_TVN_SIZE];
+
+        /* callbacks are run by gf_timer_proc itself unless dispatch
+         * threads are configured (--timer-dispatch-threads) */
+        int              dispatch_count;
+        pthread_t       *dispatchers;
+        pthread_cond_t   dispatch_cond;
+        struct list_head dispatch;
+
+        uint64_t         pending;
+        uint64_t         armed;
+        uint64_t         cancelled;
+        uint64_t         expired;
+        uint64_t         cascaded;
 };
 
 typedef struct _gf_timer gf_timer_t;
@@ -55,4 +92,7 @@ gf_timer_call_cancel (glusterfs_ctx_t *ctx,
 
 void
 gf_timer_registry_destroy (glusterfs_ctx_t *ctx);
+
+void
+gf_timer_registry_dump (glusterfs_ctx_t *ctx);
 #endif /* _TIMER_H */
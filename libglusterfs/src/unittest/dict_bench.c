@@ -0,0 +1,235 @@
+/*
+  Copyright (c) 2018 Red Hat, Inc. <http://www.redhat.com>
+  This file is part of GlusterFS.
+
+  This file is licensed to you under your choice of the GNU Lesser
+  General Public License, version 3 or any later version (LGPLv3 or
+  later), or the GNU General Public License, version 2 (GPLv2), in all
+  cases as published by the Free Software Foundation.
+*/
+
+/*
+ * Microbenchmark of the per fop dict_t cost.
+ *
+ * Mimics the xdata handling of a fop: a dict is created, a few keys are
+ * set, it is serialized for the wire and unserialized on the other side,
+ * copied once (as xlators do when they stash xdata) and destroyed again.
+ * Each step is timed separately, for an increasing number of keys, using
+ * both well known xdata keys and ad-hoc ones.
+ *
+ * usage: dict_bench [-i iterations] [-k max keys]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "glusterfs.h"
+#include "globals.h"
+#include "xlator.h"
+#include "dict.h"
+#include "mem-pool.h"
+#include "mem-types.h"
+
+enum {
+        BENCH_SET,
+        BENCH_SERIALIZE,
+        BENCH_UNSERIALIZE,
+        BENCH_COPY,
+        BENCH_DESTROY,
+        BENCH_MAX
+};
+
+static const char *bench_names[BENCH_MAX] = {
+        [BENCH_SET]         = "new+set",
+        [BENCH_SERIALIZE]   = "serialize",
+        [BENCH_UNSERIALIZE] = "unserialize",
+        [BENCH_COPY]        = "copy",
+        [BENCH_DESTROY]     = "destroy",
+};
+
+static char *well_known_keys[] = {
+        GLUSTERFS_INODELK_COUNT,
+        GLUSTERFS_ENTRYLK_COUNT,
+        GLUSTERFS_POSIXLK_COUNT,
+        GF_CONTENT_KEY,
+        GLUSTERFS_OPEN_FD_COUNT,
+        GLUSTERFS_WRITE_IS_APPEND,
+        GF_GFIDLESS_LOOKUP,
+        GLUSTERFS_INODELK_DOM_COUNT,
+        GLUSTERFS_DURABLE_OP,
+        GLUSTERFS_ACTIVE_FD_COUNT,
+        GLUSTERFS_PARENT_ENTRYLK,
+        GF_PREOP_PARENT_KEY,
+        GF_XATTROP_INDEX_COUNT,
+        GF_XATTROP_DIRTY_COUNT,
+        QUOTA_SIZE_KEY,
+        "link-count",
+};
+
+#define BENCH_KEYS (sizeof (well_known_keys) / sizeof (well_known_keys[0]))
+
+static char *adhoc_keys[BENCH_KEYS];
+
+static double
+bench_now (void)
+{
+        struct timespec ts;
+
+        clock_gettime (CLOCK_MONOTONIC, &ts);
+
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int
+bench_run (char **keys, int nkeys, int iterations, double *elapsed)
+{
+        dict_t *dict = NULL;
+        dict_t *copy = NULL;
+        dict_t *fill = NULL;
+        char    buf[8192];
+        int     len = 0;
+        int     i = 0;
+        int     k = 0;
+        double  t0 = 0;
+        double  t1 = 0;
+
+        for (i = 0; i < iterations; i++) {
+                t0 = bench_now ();
+                dict = dict_new ();
+                if (!dict)
+                        return -1;
+                for (k = 0; k < nkeys; k++) {
+                        if (dict_set_int32 (dict, keys[k], i))
+                                return -1;
+                }
+
+                t1 = bench_now ();
+                elapsed[BENCH_SET] += t1 - t0;
+
+                t0 = t1;
+                len = dict_serialized_length (dict);
+                if ((len < 0) || (len > sizeof (buf)) ||
+                    dict_serialize (dict, buf))
+                        return -1;
+
+                t1 = bench_now ();
+                elapsed[BENCH_SERIALIZE] += t1 - t0;
+
+                t0 = t1;
+                fill = dict_new ();
+                if (!fill || dict_unserialize (buf, len, &fill))
+                        return -1;
+
+                t1 = bench_now ();
+                elapsed[BENCH_UNSERIALIZE] += t1 - t0;
+
+                t0 = t1;
+                copy = dict_copy_with_ref (fill, NULL);
+                if (!copy)
+                        return -1;
+
+                t1 = bench_now ();
+                elapsed[BENCH_COPY] += t1 - t0;
+
+                t0 = t1;
+                dict_unref (copy);
+                dict_unref (fill);
+                dict_unref (dict);
+
+                elapsed[BENCH_DESTROY] += bench_now () - t0;
+        }
+
+        return 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+        glusterfs_ctx_t *ctx = NULL;
+        char           **keys = NULL;
+        double           elapsed[BENCH_MAX];
+        double           total = 0;
+        int              iterations = 200000;
+        int              max_keys = BENCH_KEYS;
+        int              nkeys = 0;
+        int              kind = 0;
+        int              op = 0;
+        int              opt = 0;
+        int              i = 0;
+
+        while ((opt = getopt (argc, argv, "i:k:")) != -1) {
+                switch (opt) {
+                case 'i':
+                        iterations = atoi (optarg);
+                        break;
+                case 'k':
+                        max_keys = atoi (optarg);
+                        break;
+                default:
+                        fprintf (stderr, "usage: %s [-i iterations] "
+                                 "[-k max keys]\n", argv[0]);
+                        return 1;
+                }
+        }
+
+        if (iterations <= 0 || max_keys <= 0 || max_keys > BENCH_KEYS)
+                return 1;
+
+        mem_pools_init_early ();
+        mem_pools_init_late ();
+
+        ctx = glusterfs_ctx_new ();
+        if (!ctx || glusterfs_globals_init (ctx))
+                return 1;
+        THIS->ctx = ctx;
+
+        if (xlator_mem_acct_init (THIS, gf_common_mt_end + 1))
+                return 1;
+
+        ctx->dict_pool = mem_pool_new (dict_t, 4096);
+        ctx->dict_pair_pool = mem_pool_new (data_pair_t, 16384);
+        ctx->dict_data_pool = mem_pool_new (data_t, 16384);
+        if (!ctx->dict_pool || !ctx->dict_pair_pool || !ctx->dict_data_pool)
+                return 1;
+
+        for (i = 0; i < BENCH_KEYS; i++) {
+                if (gf_asprintf (&adhoc_keys[i], "trusted.bench.key-%d",
+                                 i) < 0)
+                        return 1;
+        }
+
+        printf ("%-10s %5s", "keys", "count");
+        for (op = 0; op < BENCH_MAX; op++)
+                printf (" %12s", bench_names[op]);
+        printf (" %12s\n", "ns/fop");
+
+        for (kind = 0; kind < 2; kind++) {
+                keys = kind ? adhoc_keys : well_known_keys;
+
+                for (nkeys = 1; nkeys <= max_keys;
+                     nkeys = (nkeys < 4) ? nkeys + 1 : nkeys * 2) {
+                        memset (elapsed, 0, sizeof (elapsed));
+                        if (bench_run (keys, nkeys, iterations, elapsed)) {
+                                fprintf (stderr, "dict operation failed\n");
+                                return 1;
+                        }
+
+                        total = 0;
+                        printf ("%-10s %5d", kind ? "ad-hoc" : "well-known",
+                                nkeys);
+                        for (op = 0; op < BENCH_MAX; op++) {
+                                printf (" %12.0f",
+                                        elapsed[op] * 1e9 / iterations);
+                                total += elapsed[op];
+                        }
+                        printf (" %12.0f\n", total * 1e9 / iterations);
+                }
+        }
+
+        for (i = 0; i < BENCH_KEYS; i++)
+                GF_FREE (adhoc_keys[i]);
+
+        return 0;
+}
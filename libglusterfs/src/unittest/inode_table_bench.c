@@ -0,0 +1,295 @@
+/*
+  Copyright (c) 2018 Red Hat, Inc. <http://www.redhat.com>
+  This file is part of GlusterFS.
+
+  This file is licensed to you under your choice of the GNU Lesser
+  General Public License, version 3 or any later version (LGPLv3 or
+  later), or the GNU General Public License, version 2 (GPLv2), in all
+  cases as published by the Free Software Foundation.
+*/
+
+/*
+ * Microbenchmark of the inode table lookup paths.
+ *
+ * Links a flat directory of inodes into a classic (single lock) and a
+ * sharded inode table, then has an increasing number of threads run
+ * inode_find(), inode_grep() and inode_link() of already linked entries
+ * against it, reporting the aggregate throughput.
+ *
+ * usage: inode_table_bench [-n inodes] [-i iterations] [-t max threads]
+ *                          [-s shards]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "glusterfs.h"
+#include "globals.h"
+#include "xlator.h"
+#include "inode.h"
+#include "mem-pool.h"
+#include "mem-types.h"
+
+enum {
+        BENCH_FIND,
+        BENCH_GREP,
+        BENCH_LINK,
+        BENCH_MAX
+};
+
+static const char *bench_names[BENCH_MAX] = {
+        [BENCH_FIND] = "inode_find",
+        [BENCH_GREP] = "inode_grep",
+        [BENCH_LINK] = "inode_link",
+};
+
+struct bench_table {
+        inode_table_t  *table;
+        inode_t       **inodes;
+        struct iatt    *iatts;
+        char          **names;
+        int             count;
+};
+
+struct bench_thread {
+        pthread_t           thread;
+        struct bench_table *bt;
+        int                 op;
+        int                 iterations;
+        unsigned int        seed;
+        uint64_t            done;
+};
+
+static pthread_barrier_t bench_barrier;
+
+static double
+bench_now (void)
+{
+        struct timespec ts;
+
+        clock_gettime (CLOCK_MONOTONIC, &ts);
+
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *
+bench_worker (void *data)
+{
+        struct bench_thread *bth = data;
+        struct bench_table  *bt = bth->bt;
+        inode_t             *inode = NULL;
+        int                  i = 0;
+        int                  idx = 0;
+
+        pthread_barrier_wait (&bench_barrier);
+
+        for (i = 0; i < bth->iterations; i++) {
+                idx = rand_r (&bth->seed) % bt->count;
+
+                switch (bth->op) {
+                case BENCH_FIND:
+                        inode = inode_find (bt->table, bt->iatts[idx].ia_gfid);
+                        break;
+                case BENCH_GREP:
+                        inode = inode_grep (bt->table, bt->table->root,
+                                            bt->names[idx]);
+                        break;
+                case BENCH_LINK:
+                        inode = inode_link (bt->inodes[idx], bt->table->root,
+                                            bt->names[idx], &bt->iatts[idx]);
+                        break;
+                }
+
+                if (inode) {
+                        inode_unref (inode);
+                        bth->done++;
+                }
+        }
+
+        return NULL;
+}
+
+static int
+bench_table_init (struct bench_table *bt, xlator_t *xl, int count,
+                  uint32_t shards)
+{
+        inode_t *linked = NULL;
+        int      i = 0;
+
+        bt->count = count;
+        bt->table = inode_table_with_shards (count * 2, xl, shards);
+        bt->inodes = calloc (count, sizeof (*bt->inodes));
+        bt->iatts = calloc (count, sizeof (*bt->iatts));
+        bt->names = calloc (count, sizeof (*bt->names));
+        if (!bt->table || !bt->inodes || !bt->iatts || !bt->names)
+                return -1;
+
+        for (i = 0; i < count; i++) {
+                gf_uuid_generate (bt->iatts[i].ia_gfid);
+                bt->iatts[i].ia_type = IA_IFREG;
+                if (gf_asprintf (&bt->names[i], "file-%d", i) < 0)
+                        return -1;
+
+                bt->inodes[i] = inode_new (bt->table);
+                linked = inode_link (bt->inodes[i], bt->table->root,
+                                     bt->names[i], &bt->iatts[i]);
+                if (linked != bt->inodes[i])
+                        return -1;
+                inode_lookup (linked);
+                inode_unref (linked);
+        }
+
+        return 0;
+}
+
+static void
+bench_table_fini (struct bench_table *bt)
+{
+        int i = 0;
+
+        for (i = 0; i < bt->count; i++) {
+                if (bt->inodes && bt->inodes[i])
+                        inode_unref (bt->inodes[i]);
+                if (bt->names)
+                        GF_FREE (bt->names[i]);
+        }
+
+        if (bt->table)
+                inode_table_destroy (bt->table);
+
+        free (bt->inodes);
+        free (bt->iatts);
+        free (bt->names);
+}
+
+static double
+bench_run (struct bench_table *bt, int op, int threads, int iterations)
+{
+        struct bench_thread *bths = NULL;
+        uint64_t             done = 0;
+        double               start = 0;
+        double               elapsed = 0;
+        int                  i = 0;
+
+        bths = calloc (threads, sizeof (*bths));
+        if (!bths)
+                return 0;
+
+        pthread_barrier_init (&bench_barrier, NULL, threads + 1);
+
+        for (i = 0; i < threads; i++) {
+                bths[i].bt = bt;
+                bths[i].op = op;
+                bths[i].iterations = iterations;
+                bths[i].seed = i + 1;
+                pthread_create (&bths[i].thread, NULL, bench_worker, &bths[i]);
+        }
+
+        pthread_barrier_wait (&bench_barrier);
+        start = bench_now ();
+
+        for (i = 0; i < threads; i++) {
+                pthread_join (bths[i].thread, NULL);
+                done += bths[i].done;
+        }
+
+        elapsed = bench_now () - start;
+
+        pthread_barrier_destroy (&bench_barrier);
+        free (bths);
+
+        if (done != (uint64_t)threads * iterations)
+                fprintf (stderr, "%s: %"PRIu64" of %"PRIu64" lookups "
+                         "failed\n", bench_names[op],
+                         (uint64_t)threads * iterations - done,
+                         (uint64_t)threads * iterations);
+
+        return done / elapsed;
+}
+
+int
+main (int argc, char *argv[])
+{
+        glusterfs_ctx_t     *ctx = NULL;
+        glusterfs_graph_t    graph = {{0, }, };
+        xlator_t             xl = {0, };
+        struct bench_table   bt = {0, };
+        uint32_t             table_shards[2] = {1, 16};
+        int                  count = 65536;
+        int                  iterations = 1000000;
+        int                  max_threads = 8;
+        int                  threads = 0;
+        int                  op = 0;
+        int                  i = 0;
+        int                  opt = 0;
+
+        while ((opt = getopt (argc, argv, "n:i:t:s:")) != -1) {
+                switch (opt) {
+                case 'n':
+                        count = atoi (optarg);
+                        break;
+                case 'i':
+                        iterations = atoi (optarg);
+                        break;
+                case 't':
+                        max_threads = atoi (optarg);
+                        break;
+                case 's':
+                        table_shards[1] = atoi (optarg);
+                        break;
+                default:
+                        fprintf (stderr, "usage: %s [-n inodes] "
+                                 "[-i iterations] [-t max threads] "
+                                 "[-s shards]\n", argv[0]);
+                        return 1;
+                }
+        }
+
+        if (count <= 0 || iterations <= 0 || max_threads <= 0)
+                return 1;
+
+        mem_pools_init_early ();
+        mem_pools_init_late ();
+
+        ctx = glusterfs_ctx_new ();
+        if (!ctx || glusterfs_globals_init (ctx))
+                return 1;
+        THIS->ctx = ctx;
+
+        if (xlator_mem_acct_init (THIS, gf_common_mt_end + 1))
+                return 1;
+
+        graph.xl_count = 1;
+        xl.name = "inode-table-bench";
+        xl.graph = &graph;
+        xl.ctx = ctx;
+
+        printf ("%-12s %8s %8s %16s\n", "op", "shards", "threads",
+                "ops/sec");
+
+        for (i = 0; i < 2; i++) {
+                memset (&bt, 0, sizeof (bt));
+                if (bench_table_init (&bt, &xl, count, table_shards[i])) {
+                        fprintf (stderr, "failed to set up inode table\n");
+                        return 1;
+                }
+
+                for (op = 0; op < BENCH_MAX; op++) {
+                        for (threads = 1; threads <= max_threads;
+                             threads *= 2) {
+                                printf ("%-12s %8u %8d %16.0f\n",
+                                        bench_names[op],
+                                        bt.table->shard_count, threads,
+                                        bench_run (&bt, op, threads,
+                                                   iterations / threads));
+                        }
+                }
+
+                bench_table_fini (&bt);
+        }
+
+        return 0;
+}
@@ -24,22 +24,32 @@
 void
 rpc_clnt_reply_deinit (struct rpc_req *req, struct mem_pool *pool);
 
-struct saved_frame *
+static struct list_head *
+__saved_frames_bucket (struct saved_frames *frames, uint32_t xid)
+{
+        /* xids are handed out in sequence, the low bits spread them */
+        return &frames->buckets[xid & (RPC_CLNT_SAVED_FRAMES_BUCKETS - 1)];
+}
+
+/* moves the frames saved @timeout seconds or longer ago to @list */
+int
 __saved_frames_get_timedout (struct saved_frames *frames, uint32_t timeout,
-                             struct timeval *current)
+                             struct timeval *current, struct list_head *list)
 {
-	struct saved_frame *bailout_frame = NULL, *tmp = NULL;
-
-	if (!list_empty(&frames->sf.list)) {
-		tmp = list_entry (frames->sf.list.next, typeof (*tmp), list);
-		if ((tmp->saved_at.tv_sec + timeout) <= current->tv_sec) {
-			bailout_frame = tmp;
-			list_del_init (&bailout_frame->list);
-			frames->count--;
-		}
+	struct saved_frame *trav = NULL, *tmp = NULL;
+        int                 count = 0;
+
+	list_for_each_entry_safe (trav, tmp, &frames->sf.list, list) {
+		if ((trav->saved_at.tv_sec + timeout) > current->tv_sec)
+                        break;
+
+                list_del_init (&trav->hash);
+                list_move_tail (&trav->list, list);
+                frames->count--;
+                count++;
 	}
 
-	return bailout_frame;
+	return count;
 }
 
 static int
@@ -72,6 +82,7 @@ __saved_frames_put (struct saved_frames *frames, void *frame,
 
         memset (saved_frame, 0, sizeof (*saved_frame));
 	INIT_LIST_HEAD (&saved_frame->list);
+	INIT_LIST_HEAD (&saved_frame->hash);
 
 	saved_frame->capital_this = THIS;
 	saved_frame->frame        = frame;
@@ -83,6 +94,9 @@ __saved_frames_put (struct saved_frames *frames, void *frame,
         else
                 list_add_tail (&saved_frame->list, &frames->sf.list);
 
+        list_add_tail (&saved_frame->hash,
+                       __saved_frames_bucket (frames, rpcreq->xid));
+
 	frames->count++;
 
 out:
@@ -99,7 +113,6 @@ call_bail (void *data)
         rpc_clnt_connection_t *conn = NULL;
         struct timeval         current;
         struct list_head       list;
-        struct saved_frame    *saved_frame = NULL;
         struct saved_frame    *trav = NULL;
         struct saved_frame    *tmp = NULL;
         char                   frame_sent[256] = {0,};
@@ -154,15 +167,9 @@ call_bail (void *data)
                         }
                 }
 
-                do {
-                        saved_frame =
-                                __saved_frames_get_timedout (conn->saved_frames,
-                                                             conn->frame_timeout,
-                                                             &current);
-                        if (saved_frame)
-                                list_add (&saved_frame->list, &list);
-
-                } while (saved_frame);
+                __saved_frames_get_timedout (conn->saved_frames,
+                                             conn->frame_timeout, &current,
+                                             &list);
         }
         pthread_mutex_unlock (&conn->lock);
 
@@ -237,6 +244,7 @@ struct saved_frames *
 saved_frames_new (void)
 {
 	struct saved_frames *saved_frames = NULL;
+        int                  i            = 0;
 
 	saved_frames = GF_CALLOC (1, sizeof (*saved_frames),
                                   gf_common_mt_rpcclnt_savedframe_t);
@@ -247,10 +255,28 @@ saved_frames_new (void)
 	INIT_LIST_HEAD (&saved_frames->sf.list);
 	INIT_LIST_HEAD (&saved_frames->lk_sf.list);
 
+        for (i = 0; i < RPC_CLNT_SAVED_FRAMES_BUCKETS; i++)
+                INIT_LIST_HEAD (&saved_frames->buckets[i]);
+
 	return saved_frames;
 }
 
 
+static struct saved_frame *
+__saved_frame_find (struct saved_frames *frames, int64_t callid)
+{
+	struct saved_frame *tmp = NULL;
+
+	list_for_each_entry (tmp, __saved_frames_bucket (frames, callid),
+                             hash) {
+		if (tmp->rpcreq->xid == callid)
+			return tmp;
+	}
+
+	return NULL;
+}
+
+
 int
 __saved_frame_copy (struct saved_frames *frames, int64_t callid,
                     struct saved_frame *saved_frame)
@@ -263,21 +289,11 @@ __saved_frame_copy (struct saved_frames *frames, int64_t callid,
                 goto out;
         }
 
-	list_for_each_entry (tmp, &frames->sf.list, list) {
-		if (tmp->rpcreq->xid == callid) {
-			*saved_frame = *tmp;
-                        ret = 0;
-			goto out;
-		}
-	}
-
-	list_for_each_entry (tmp, &frames->lk_sf.list, list) {
-		if (tmp->rpcreq->xid == callid) {
-			*saved_frame = *tmp;
-                        ret = 0;
-			goto out;
-		}
-	}
+        tmp = __saved_frame_find (frames, callid);
+        if (tmp) {
+                *saved_frame = *tmp;
+                ret = 0;
+        }
 
 out:
 	return ret;
@@ -288,28 +304,12 @@ struct saved_frame *
 __saved_frame_get (struct saved_frames *frames, int64_t callid)
 {
 	struct saved_frame *saved_frame = NULL;
-	struct saved_frame *tmp = NULL;
-
-	list_for_each_entry (tmp, &frames->sf.list, list) {
-		if (tmp->rpcreq->xid == callid) {
-			list_del_init (&tmp->list);
-			frames->count--;
-			saved_frame = tmp;
-			goto out;
-		}
-	}
 
-	list_for_each_entry (tmp, &frames->lk_sf.list, list) {
-		if (tmp->rpcreq->xid == callid) {
-			list_del_init (&tmp->list);
-			frames->count--;
-			saved_frame = tmp;
-			goto out;
-		}
-	}
-
-out:
+        saved_frame = __saved_frame_find (frames, callid);
 	if (saved_frame) {
+                list_del_init (&saved_frame->list);
+                list_del_init (&saved_frame->hash);
+                frames->count--;
                 THIS  = saved_frame->capital_this;
         }
 
@@ -355,6 +355,7 @@ saved_frames_unwind (struct saved_frames *saved_frames)
                                        trav->rpcreq->conn->rpc_clnt->reqpool);
 
 		list_del_init (&trav->list);
+                list_del_init (&trav->hash);
                 mem_put (trav);
 	}
 }
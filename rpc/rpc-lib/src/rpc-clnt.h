@@ -43,6 +43,9 @@ typedef int (*fop_cbk_fn_t) (struct rpc_req *req, struct iovec *iov, int count,
 
 typedef int (*clnt_fn_t) (call_frame_t *fr, xlator_t *xl, void *args);
 
+/* buckets of the xid hash of struct saved_frames, a power of two */
+#define RPC_CLNT_SAVED_FRAMES_BUCKETS 256
+
 struct saved_frame {
 	union {
 		struct list_head list;
@@ -51,6 +54,8 @@ struct saved_frame {
 			struct saved_frame *frame_prev;
 		};
 	};
+        /* in the bucket of the xid, replies are matched through it */
+        struct list_head         hash;
         void                    *capital_this;
 	void                    *frame;
 	struct timeval           saved_at;
@@ -58,10 +63,12 @@ struct saved_frame {
         rpc_transport_rsp_t      rsp;
 };
 
+/* sf and lk_sf are in the order the calls were made, for bailing out */
 struct saved_frames {
 	int64_t            count;
 	struct saved_frame sf;
 	struct saved_frame lk_sf;
+        struct list_head   buckets[RPC_CLNT_SAVED_FRAMES_BUCKETS];
 };
 
 
@@ -24,14 +24,14 @@
 /**
  * rpcsvc_drc_op_destroy - Destroys the cached reply
  *
- * @param drc - the main drc structure
+ * @param shard - the shard of the reply, locked
  * @param reply - the cached reply to destroy
  * @return NULL if reply is destroyed, reply otherwise
  */
 static drc_cached_op_t *
-rpcsvc_drc_op_destroy (rpcsvc_drc_globals_t *drc, drc_cached_op_t *reply)
+rpcsvc_drc_op_destroy (drc_shard_t *shard, drc_cached_op_t *reply)
 {
-        GF_ASSERT (drc);
+        GF_ASSERT (shard);
         GF_ASSERT (reply);
 
         if (reply->state == DRC_OP_IN_TRANSIT)
@@ -46,8 +46,8 @@ rpcsvc_drc_op_destroy (rpcsvc_drc_globals_t *drc, drc_cached_op_t *reply)
                 GF_FREE (reply->msg.progpayload);
 
         list_del (&reply->global_list);
-        reply->client->op_count--;
-        drc->op_count--;
+        GF_ATOMIC_DEC (reply->client->op_count);
+        shard->op_count--;
         mem_put (reply);
         reply = NULL;
 
@@ -55,36 +55,95 @@ rpcsvc_drc_op_destroy (rpcsvc_drc_globals_t *drc, drc_cached_op_t *reply)
 }
 
 /**
- * rpcsvc_drc_op_rb_unref - This function is used in rb tree cleanup only
+ * rpcsvc_remove_drc_client - Cleanup the drc client
  *
- * @param reply - the cached reply to unref
- * @param drc - the main drc structure
+ * Every cached op holds a reference on its client, so the trees of a
+ * client without references are empty.
+ *
+ * @param client - the drc client to be removed
  * @return void
  */
 static void
-rpcsvc_drc_rb_op_destroy (void *reply, void *drc)
+rpcsvc_remove_drc_client (drc_client_t *client)
 {
-        rpcsvc_drc_op_destroy (drc, (drc_cached_op_t *)reply);
+        int i = 0;
+
+        for (i = 0; i < DRC_SHARDS; i++) {
+                if (client->rbtree[i])
+                        rb_destroy (client->rbtree[i], NULL);
+        }
+        GF_FREE (client);
 }
 
 /**
- * rpcsvc_remove_drc_client - Cleanup the drc client
+ * rpcsvc_drc_client_ref - ref the drc client
  *
- * @param client - the drc client to be removed
- * @return void
+ * @param client - the drc client to ref, which the caller holds a ref on
+ * @return client
  */
-static void
-rpcsvc_remove_drc_client (drc_client_t *client)
+static drc_client_t *
+rpcsvc_drc_client_ref (drc_client_t *client)
 {
-        rb_destroy (client->rbtree, rpcsvc_drc_rb_op_destroy);
-        list_del (&client->client_list);
-        GF_FREE (client);
+        GF_ASSERT (client);
+        GF_ATOMIC_INC (client->ref);
+        return client;
 }
 
 /**
- * rpcsvc_client_lookup - Given a sockaddr_storage, find the client if it exists
+ * rpcsvc_drc_client_tryref - ref the drc client, unless it has no refs left
+ *                            and is being removed
+ *
+ * @param client - the drc client to ref
+ * @return _gf_true if a ref was taken, _gf_false otherwise
+ */
+static gf_boolean_t
+rpcsvc_drc_client_tryref (drc_client_t *client)
+{
+        uint32_t ref = 0;
+
+        do {
+                ref = GF_ATOMIC_GET (client->ref);
+                if (!ref)
+                        return _gf_false;
+        } while (!GF_ATOMIC_CMP_SWAP (client->ref, ref, ref + 1));
+
+        return _gf_true;
+}
+
+/**
+ * rpcsvc_drc_client_unref - unref the drc client, and destroy
+ *                           the client on last unref
  *
  * @param drc - the main drc structure
+ * @param client - the drc client to unref
+ * @return NULL if it is the last unref, client otherwise
+ */
+static drc_client_t *
+rpcsvc_drc_client_unref (rpcsvc_drc_globals_t *drc, drc_client_t *client)
+{
+        GF_ASSERT (drc);
+        GF_ASSERT (GF_ATOMIC_GET (client->ref));
+
+        if (GF_ATOMIC_DEC (client->ref))
+                return client;
+
+        LOCK (&drc->lock);
+        {
+                list_del (&client->client_list);
+                drc->client_count--;
+        }
+        UNLOCK (&drc->lock);
+
+        rpcsvc_remove_drc_client (client);
+
+        return NULL;
+}
+
+/**
+ * rpcsvc_client_lookup - Given a sockaddr_storage, find the client if it
+ *                        exists, and ref it
+ *
+ * @param drc - the main drc structure, with its lock held
  * @param sockaddr - the network address of the client to be looked up
  * @return drc client if it exists, NULL otherwise
  */
@@ -102,7 +161,8 @@ rpcsvc_client_lookup (rpcsvc_drc_globals_t *drc,
 
         list_for_each_entry (client, &drc->clients_head, client_list) {
                 if (gf_sock_union_equal_addr (&client->sock_union,
-                                              (union gf_sock_union *)sockaddr))
+                                              (union gf_sock_union *)sockaddr)
+                    && rpcsvc_drc_client_tryref (client))
                         return client;
         }
 
@@ -154,25 +214,65 @@ drc_compare_reqs (const void *item, const void *rb_node_data, void *param)
 static int
 drc_init_client_cache (rpcsvc_drc_globals_t *drc, drc_client_t *client)
 {
+        int i = 0;
+
         GF_ASSERT (drc);
         GF_ASSERT (client);
 
-        client->rbtree = rb_create (drc_compare_reqs, drc, NULL);
-        if (!client->rbtree) {
-                gf_log (GF_RPCSVC, GF_LOG_DEBUG, "rb tree creation failed");
-                return -1;
+        for (i = 0; i < DRC_SHARDS; i++) {
+                client->rbtree[i] = rb_create (drc_compare_reqs, drc, NULL);
+                if (!client->rbtree[i]) {
+                        gf_log (GF_RPCSVC, GF_LOG_DEBUG,
+                                "rb tree creation failed");
+                        return -1;
+                }
         }
 
         return 0;
 }
 
+/**
+ * drc_client_hash - hash of the address of a client, spreading the ops of
+ *                   different clients with the same xids over the shards
+ *
+ * @param sock_union - network address of the client
+ * @return the hash
+ */
+static uint32_t
+drc_client_hash (union gf_sock_union *sock_union)
+{
+        switch (sock_union->storage.ss_family) {
+        case AF_INET:
+                return SuperFastHash ((char *)&sock_union->sin.sin_addr,
+                                      sizeof (sock_union->sin.sin_addr));
+        case AF_INET6:
+                return SuperFastHash ((char *)&sock_union->sin6.sin6_addr,
+                                      sizeof (sock_union->sin6.sin6_addr));
+        default:
+                return 0;
+        }
+}
+
+/**
+ * drc_shard_index - the shard caching the ops of a client with a given xid
+ *
+ * @param client - the drc client
+ * @param xid - xid of the op
+ * @return index of the shard
+ */
+static uint32_t
+drc_shard_index (drc_client_t *client, uint32_t xid)
+{
+        return ((client->hash ^ xid) * 0x9e3779b1U) >> (32 - DRC_SHARD_BITS);
+}
+
 /**
  * rpcsvc_get_drc_client - find the drc client with given sockaddr, else
  *                         allocate and initialize a new drc client
  *
- * @param drc - the main drc structure
+ * @param drc - the main drc structure, with its lock held
  * @param sockaddr - network address of client
- * @return drc client on success, NULL on failure
+ * @return drc client with a ref taken on success, NULL on failure
  */
 static drc_client_t *
 rpcsvc_get_drc_client (rpcsvc_drc_globals_t *drc,
@@ -193,15 +293,16 @@ rpcsvc_get_drc_client (rpcsvc_drc_globals_t *drc,
         if (!client)
                 goto out;
 
-        client->ref = 0;
+        GF_ATOMIC_INIT (client->ref, 1);
         client->sock_union = (union gf_sock_union)*sockaddr;
-        client->op_count = 0;
+        client->hash = drc_client_hash (&client->sock_union);
+        GF_ATOMIC_INIT (client->op_count, 0);
         INIT_LIST_HEAD (&client->client_list);
 
         if (drc_init_client_cache (drc, client)) {
                 gf_log (GF_RPCSVC, GF_LOG_DEBUG,
                         "initialization of drc client failed");
-                GF_FREE (client);
+                rpcsvc_remove_drc_client (client);
                 client = NULL;
                 goto out;
         }
@@ -242,47 +343,48 @@ rpcsvc_need_drc (rpcsvc_request_t *req)
 }
 
 /**
- * rpcsvc_drc_client_ref - ref the drc client
+ * rpcsvc_drc_shard - find the shard caching the incoming request
  *
- * @param client - the drc client to ref
- * @return client
+ * @param req - incoming request
+ * @return the shard, NULL if the client could not be added to the drc
  */
-static drc_client_t *
-rpcsvc_drc_client_ref (drc_client_t *client)
+drc_shard_t *
+rpcsvc_drc_shard (rpcsvc_request_t *req)
 {
-        GF_ASSERT (client);
-        client->ref++;
-        return client;
-}
+        rpcsvc_drc_globals_t   *drc    = NULL;
+        drc_client_t           *client = NULL;
 
-/**
- * rpcsvc_drc_client_unref - unref the drc client, and destroy
- *                           the client on last unref
- *
- * @param drc - the main drc structure
- * @param client - the drc client to unref
- * @return NULL if it is the last unref, client otherwise
- */
-static drc_client_t *
-rpcsvc_drc_client_unref (rpcsvc_drc_globals_t *drc, drc_client_t *client)
-{
-        GF_ASSERT (drc);
-        GF_ASSERT (client->ref);
+        GF_ASSERT (req);
 
-        client->ref--;
-        if (!client->ref) {
-                drc->client_count--;
-                rpcsvc_remove_drc_client (client);
-                client = NULL;
+        drc = req->svc->drc;
+
+        /* only for connections accepted before the drc was turned on.
+           Requests of the same transport can get here at the same time,
+           so the client is looked up and set under the drc lock, and only
+           one of them takes the reference. */
+        client = req->trans->drc_client;
+        if (!client) {
+                LOCK (&drc->lock);
+                {
+                        client = req->trans->drc_client;
+                        if (!client) {
+                                client = rpcsvc_get_drc_client (drc,
+                                               &req->trans->peerinfo.sockaddr);
+                                req->trans->drc_client = client;
+                        }
+                }
+                UNLOCK (&drc->lock);
+                if (!client)
+                        return NULL;
         }
 
-        return client;
+        return &drc->shards[drc_shard_index (client, req->xid)];
 }
 
 /**
  * rpcsvc_drc_lookup - lookup a request to see if it is already cached
  *
- * @param req - incoming request
+ * @param req - incoming request, with the lock of its shard held
  * @return cached reply of req if found, NULL otherwise
  */
 drc_cached_op_t *
@@ -299,22 +401,15 @@ rpcsvc_drc_lookup (rpcsvc_request_t *req)
 
         GF_ASSERT (req);
 
-        if (!req->trans->drc_client) {
-                client = rpcsvc_get_drc_client (req->svc->drc,
-                                                &req->trans->peerinfo.sockaddr);
-                if (!client)
-                        goto out;
-
-                req->trans->drc_client
-                        = rpcsvc_drc_client_ref (client);
-        }
-
         client = req->trans->drc_client;
+        if (!client)
+                goto out;
 
-        if (client->op_count == 0)
+        if (GF_ATOMIC_GET (client->op_count) == 0)
                 goto out;
 
-        reply = rb_find (client->rbtree, &new);
+        reply = rb_find (client->rbtree[drc_shard_index (client, req->xid)],
+                         &new);
 
  out:
         return reply;
@@ -352,7 +447,8 @@ rpcsvc_send_cached_reply (rpcsvc_request_t *req, drc_cached_op_t *reply)
 /**
  * rpcsvc_cache_reply - cache the reply for the processed request 'req'
  *
- * @param req - processed request
+ * @param req - processed request, with the lock of the shard of its reply
+ *              held
  * @param iobref - iobref structure of the reply
  * @param rpchdr - rpc header of the reply
  * @param rpchdrcount - size of rpchdr
@@ -398,14 +494,15 @@ rpcsvc_cache_reply (rpcsvc_request_t *req, struct iobref *iobref,
 }
 
 /**
- * rpcsvc_vacate_drc_entries - free up some percentage of drc cache
+ * rpcsvc_vacate_drc_entries - free up some percentage of a drc shard
  *                             based on the lru factor
  *
  * @param drc - the main drc structure
+ * @param shard - the shard to free up, locked
  * @return void
  */
 static void
-rpcsvc_vacate_drc_entries (rpcsvc_drc_globals_t *drc)
+rpcsvc_vacate_drc_entries (rpcsvc_drc_globals_t *drc, drc_shard_t *shard)
 {
         uint32_t            i           = 0;
         uint32_t            n           = 0;
@@ -414,19 +511,21 @@ rpcsvc_vacate_drc_entries (rpcsvc_drc_globals_t *drc)
         drc_client_t       *client      = NULL;
 
         GF_ASSERT (drc);
+        GF_ASSERT (shard);
 
-        n = drc->global_cache_size / drc->lru_factor;
+        n = max (shard->cache_size / drc->lru_factor, 1);
 
-        list_for_each_entry_safe_reverse (reply, tmp, &drc->cache_head, global_list) {
+        list_for_each_entry_safe_reverse (reply, tmp, &shard->cache_head,
+                                          global_list) {
                 /* Don't delete ops that are in transit */
                 if (reply->state == DRC_OP_IN_TRANSIT)
                         continue;
 
                 client = reply->client;
 
-                rb_delete (client->rbtree, reply);
+                rb_delete (client->rbtree[reply->shard], reply);
 
-                rpcsvc_drc_op_destroy (drc, reply);
+                rpcsvc_drc_op_destroy (shard, reply);
                 rpcsvc_drc_client_unref (drc, client);
                 i++;
                 if (i >= n)
@@ -435,10 +534,11 @@ rpcsvc_vacate_drc_entries (rpcsvc_drc_globals_t *drc)
 }
 
 /**
- * rpcsvc_add_op_to_cache - insert the cached op into the client rbtree and drc list
+ * rpcsvc_add_op_to_cache - insert the cached op into the client rbtree and
+ *                          the lru list of its shard
  *
  * @param drc - the main drc structure
- * @param reply - the op to be inserted
+ * @param reply - the op to be inserted, with the lock of its shard held
  * @return 0 on success, -1 on failure
  */
 static int
@@ -446,17 +546,20 @@ rpcsvc_add_op_to_cache (rpcsvc_drc_globals_t *drc, drc_cached_op_t *reply)
 {
         drc_client_t        *client         = NULL;
         drc_cached_op_t    **tmp_reply      = NULL;
+        drc_shard_t         *shard          = NULL;
 
         GF_ASSERT (drc);
         GF_ASSERT (reply);
 
         client = reply->client;
+        shard = rpcsvc_drc_op_shard (drc, reply);
 
-        /* cache is full, free up some space */
-        if (drc->op_count >= drc->global_cache_size)
-                rpcsvc_vacate_drc_entries (drc);
+        /* shard is full, free up some space */
+        if (shard->op_count >= shard->cache_size)
+                rpcsvc_vacate_drc_entries (drc, shard);
 
-        tmp_reply = (drc_cached_op_t **)rb_probe (client->rbtree, reply);
+        tmp_reply = (drc_cached_op_t **)rb_probe (client->rbtree[reply->shard],
+                                                  reply);
         if (!tmp_reply) {
                 /* mem alloc failed */
                 return -1;
@@ -467,9 +570,9 @@ rpcsvc_add_op_to_cache (rpcsvc_drc_globals_t *drc, drc_cached_op_t *reply)
                 return -1;
         }
 
-        client->op_count++;
-        list_add (&reply->global_list, &drc->cache_head);
-        drc->op_count++;
+        GF_ATOMIC_INC (client->op_count);
+        list_add (&reply->global_list, &shard->cache_head);
+        shard->op_count++;
 
         return 0;
 }
@@ -477,7 +580,7 @@ rpcsvc_add_op_to_cache (rpcsvc_drc_globals_t *drc, drc_cached_op_t *reply)
 /**
  * rpcsvc_cache_request - cache the in-transition incoming request
  *
- * @param req - incoming request
+ * @param req - incoming request, with the lock of its shard held
  * @return 0 on success, -1 on failure
  */
 int
@@ -507,6 +610,7 @@ rpcsvc_cache_request (rpcsvc_request_t *req)
         reply->prognum = req->prognum;
         reply->progversion = req->progver;
         reply->procnum = req->procnum;
+        reply->shard = drc_shard_index (client, req->xid);
         reply->state = DRC_OP_IN_TRANSIT;
         req->reply = reply;
         INIT_LIST_HEAD (&reply->global_list);
@@ -514,7 +618,8 @@ rpcsvc_cache_request (rpcsvc_request_t *req)
         ret = rpcsvc_add_op_to_cache (drc, reply);
         if (ret) {
                 req->reply = NULL;
-                rpcsvc_drc_op_destroy (drc, reply);
+                rpcsvc_drc_op_destroy (rpcsvc_drc_op_shard (drc, reply),
+                                       reply);
                 rpcsvc_drc_client_unref (drc, client);
                 gf_log (GF_RPCSVC, GF_LOG_DEBUG, "Failed to add op to drc cache");
         }
@@ -537,6 +642,9 @@ rpcsvc_drc_priv (rpcsvc_drc_globals_t *drc)
         char                     key[GF_DUMP_MAX_BUF_LEN]  = {0};
         drc_client_t            *client                    = NULL;
         char                     ip[INET6_ADDRSTRLEN]      = {0};
+        uint32_t                 op_count                  = 0;
+        uint64_t                 cache_hits                = 0;
+        uint64_t                 intransit_hits            = 0;
 
         if (!drc || drc->status == DRC_UNINITIATED) {
                 gf_log (GF_RPCSVC, GF_LOG_DEBUG, "DRC is "
@@ -546,6 +654,14 @@ rpcsvc_drc_priv (rpcsvc_drc_globals_t *drc)
 
         gf_proc_dump_add_section("rpc.drc");
 
+        /* statistics only, the shards are not locked */
+        for (i = 0; i < DRC_SHARDS; i++) {
+                op_count += drc->shards[i].op_count;
+                cache_hits += drc->shards[i].cache_hits;
+                intransit_hits += drc->shards[i].intransit_hits;
+        }
+        i = 0;
+
         if (TRY_LOCK (&drc->lock))
                 return -1;
 
@@ -556,7 +672,7 @@ rpcsvc_drc_priv (rpcsvc_drc_globals_t *drc)
         gf_proc_dump_write (key, "%d", drc->client_count);
 
         gf_proc_dump_build_key (key, "drc", "current_cache_size");
-        gf_proc_dump_write (key, "%d", drc->op_count);
+        gf_proc_dump_write (key, "%u", op_count);
 
         gf_proc_dump_build_key (key, "drc", "max_cache_size");
         gf_proc_dump_write (key, "%d", drc->global_cache_size);
@@ -564,11 +680,17 @@ rpcsvc_drc_priv (rpcsvc_drc_globals_t *drc)
         gf_proc_dump_build_key (key, "drc", "lru_factor");
         gf_proc_dump_write (key, "%d", drc->lru_factor);
 
+        gf_proc_dump_build_key (key, "drc", "shard_count");
+        gf_proc_dump_write (key, "%d", DRC_SHARDS);
+
+        gf_proc_dump_build_key (key, "drc", "max_shard_cache_size");
+        gf_proc_dump_write (key, "%u", drc->shards[0].cache_size);
+
         gf_proc_dump_build_key (key, "drc", "duplicate_request_count");
-        gf_proc_dump_write (key, "%d", drc->cache_hits);
+        gf_proc_dump_write (key, "%"PRIu64, cache_hits);
 
         gf_proc_dump_build_key (key, "drc", "in_transit_duplicate_requests");
-        gf_proc_dump_write (key, "%d", drc->intransit_hits);
+        gf_proc_dump_write (key, "%"PRIu64, intransit_hits);
 
         list_for_each_entry (client, &drc->clients_head, client_list) {
                 gf_proc_dump_build_key (key, "client", "%d.ip-address", i);
@@ -589,9 +711,10 @@ rpcsvc_drc_priv (rpcsvc_drc_globals_t *drc)
                 }
 
                 gf_proc_dump_build_key (key, "client", "%d.ref_count", i);
-                gf_proc_dump_write (key, "%d", client->ref);
+                gf_proc_dump_write (key, "%u", GF_ATOMIC_GET (client->ref));
                 gf_proc_dump_build_key (key, "client", "%d.op_count", i);
-                gf_proc_dump_write (key, "%d", client->op_count);
+                gf_proc_dump_write (key, "%u",
+                                    GF_ATOMIC_GET (client->op_count));
                 i++;
         }
 
@@ -627,34 +750,41 @@ rpcsvc_drc_notify (rpcsvc_t *svc, void *xl,
             drc->type == DRC_TYPE_NONE)
                 return 0;
 
-        LOCK (&drc->lock);
-        {
-                trans = (rpc_transport_t *)data;
-                client = rpcsvc_get_drc_client (drc, &trans->peerinfo.sockaddr);
-                if (!client)
-                        goto unlock;
+        trans = (rpc_transport_t *)data;
 
-                switch (event) {
-                case RPCSVC_EVENT_ACCEPT:
-                        trans->drc_client = rpcsvc_drc_client_ref (client);
-                        ret = 0;
+        switch (event) {
+        case RPCSVC_EVENT_ACCEPT:
+                LOCK (&drc->lock);
+                {
+                        client = rpcsvc_get_drc_client (drc,
+                                                &trans->peerinfo.sockaddr);
+                        trans->drc_client = client;
+                }
+                UNLOCK (&drc->lock);
+                if (!client)
                         break;
 
-                case RPCSVC_EVENT_DISCONNECT:
-                        ret = 0;
-                        if (list_empty (&drc->clients_head))
-                                break;
-                        /* should be the last unref */
+                ret = 0;
+                break;
+
+        case RPCSVC_EVENT_DISCONNECT:
+                ret = 0;
+                LOCK (&drc->lock);
+                {
+                        client = trans->drc_client;
                         trans->drc_client = NULL;
-                        rpcsvc_drc_client_unref (drc, client);
+                }
+                UNLOCK (&drc->lock);
+                if (!client)
                         break;
+                /* the client stays while its ops are cached */
+                rpcsvc_drc_client_unref (drc, client);
+                break;
 
-                default:
-                        break;
-                }
+        default:
+                break;
         }
-unlock:
-        UNLOCK (&drc->lock);
+
         return ret;
 }
 
@@ -673,6 +803,7 @@ rpcsvc_drc_init (rpcsvc_t *svc, dict_t *options)
         uint32_t                    drc_size       = 0;
         uint32_t                    drc_factor     = 0;
         rpcsvc_drc_globals_t       *drc            = NULL;
+        int                         i              = 0;
 
         GF_ASSERT (svc);
         GF_ASSERT (options);
@@ -742,7 +873,14 @@ rpcsvc_drc_init (rpcsvc_t *svc, dict_t *options)
         drc->lru_factor = (drc_lru_factor_t) drc_factor;
 
         INIT_LIST_HEAD (&drc->clients_head);
-        INIT_LIST_HEAD (&drc->cache_head);
+
+        /* every shard caches its share of the ops */
+        for (i = 0; i < DRC_SHARDS; i++) {
+                LOCK_INIT (&drc->shards[i].lock);
+                drc->shards[i].cache_size = (drc->global_cache_size +
+                                             DRC_SHARDS - 1) / DRC_SHARDS;
+                INIT_LIST_HEAD (&drc->shards[i].cache_head);
+        }
 
         ret = rpcsvc_register_notify (svc, rpcsvc_drc_notify, THIS);
         if (ret) {
@@ -770,6 +908,7 @@ int
 rpcsvc_drc_deinit (rpcsvc_t *svc)
 {
         rpcsvc_drc_globals_t *drc  = NULL;
+        int                   i    = 0;
 
         if (!svc)
                 return (-1);
@@ -786,6 +925,9 @@ rpcsvc_drc_deinit (rpcsvc_t *svc)
         }
         UNLOCK (&drc->lock);
 
+        for (i = 0; i < DRC_SHARDS; i++)
+                LOCK_DESTROY (&drc->shards[i].lock);
+
         GF_FREE (drc);
         svc->drc = NULL;
 
@@ -14,17 +14,21 @@
 #include "rpcsvc-common.h"
 #include "rpcsvc.h"
 #include "locking.h"
+#include "atomic.h"
 #include "dict.h"
 #include "rb.h"
 
 /* per-client cache structure */
 struct drc_client {
-        uint32_t                   ref;
+        /* a client without references is on its way out, and can not be
+         * referenced again */
+        gf_atomic_uint32_t         ref;
         union gf_sock_union        sock_union;
-        /* pointers to the cache */
-        struct rb_table           *rbtree;
+        uint32_t                   hash;
+        /* pointers to the cache, one tree per shard */
+        struct rb_table           *rbtree[DRC_SHARDS];
         /* no. of ops currently cached */
-        uint32_t                   op_count;
+        gf_atomic_uint32_t         op_count;
         struct list_head           client_list;
 };
 
@@ -39,8 +43,24 @@ struct drc_cached_op {
         struct list_head               client_list;
         struct list_head               global_list;
         int32_t                        ref;
+        uint32_t                       shard;
 };
 
+/* Cached ops are spread over DRC_SHARDS shards by client and xid. Looking
+ * up, adding, and evicting ops takes the lock of their shard only; the lock
+ * of drc_globals is taken for the list of clients. */
+struct drc_shard {
+        gf_lock_t                 lock;
+        /* max no. of ops cached in the shard */
+        uint32_t                  cache_size;
+        uint32_t                  op_count;
+        uint64_t                  cache_hits;
+        uint64_t                  intransit_hits;
+        /* lru list of the cached ops */
+        struct list_head          cache_head;
+};
+typedef struct drc_shard drc_shard_t;
+
 /* global drc definitions */
 enum drc_status {
         DRC_UNINITIATED,
@@ -57,20 +77,23 @@ struct drc_globals {
         /* configurable size parameter */
         uint32_t                  global_cache_size;
         drc_lru_factor_t          lru_factor;
+        /* protects the list of clients */
         gf_lock_t                 lock;
         drc_status_t              status;
-        uint32_t                  op_count;
-        uint64_t                  cache_hits;
-        uint64_t                  intransit_hits;
         struct mem_pool          *mempool;
-        struct list_head          cache_head;
+        drc_shard_t               shards[DRC_SHARDS];
         uint32_t                  client_count;
         struct list_head          clients_head;
 };
 
+#define rpcsvc_drc_op_shard(drc, op) (&(drc)->shards[(op)->shard])
+
 int
 rpcsvc_need_drc (rpcsvc_request_t *req);
 
+drc_shard_t *
+rpcsvc_drc_shard (rpcsvc_request_t *req);
+
 drc_cached_op_t *
 rpcsvc_drc_lookup (rpcsvc_request_t *req);
 
@@ -0,0 +1,436 @@
+/*
+  Copyright (c) 2018 Red Hat, Inc. <http://www.redhat.com>
+  This file is part of GlusterFS.
+
+  This file is licensed to you under your choice of the GNU Lesser
+  General Public License, version 3 or any later version (LGPLv3 or
+  later), or the GNU General Public License, version 2 (GPLv2), in all
+  cases as published by the Free Software Foundation.
+*/
+
+#include <fnmatch.h>
+
+#include "rpc-fairq.h"
+#include "rpc-transport.h"
+#include "client_t.h"
+#include "hashfn.h"
+#include "timespec.h"
+#include "statedump.h"
+#include "mem-pool.h"
+#include "logging.h"
+
+rpcsvc_fq_conf_t *
+rpcsvc_fq_conf_new (void)
+{
+        rpcsvc_fq_conf_t *conf = NULL;
+
+        conf = GF_CALLOC (1, sizeof (*conf), gf_common_mt_rpcsvc_fq_t);
+        if (!conf)
+                return NULL;
+
+        LOCK_INIT (&conf->lock);
+        conf->op_cost = RPCSVC_FQ_DEFAULT_OP_COST;
+
+        return conf;
+}
+
+static void
+rpcsvc_fq_weights_free (struct rpcsvc_fq_weight *weights, int nweights)
+{
+        int i = 0;
+
+        for (i = 0; i < nweights; i++)
+                GF_FREE (weights[i].pattern);
+        GF_FREE (weights);
+}
+
+/* Parses "pattern:weight[,pattern:weight...]". */
+static int
+rpcsvc_fq_parse_weights (const char *str, struct rpcsvc_fq_weight **weights,
+                         int *nweights)
+{
+        struct rpcsvc_fq_weight *w = NULL;
+        char                    *dup = NULL;
+        char                    *entry = NULL;
+        char                    *saveptr = NULL;
+        char                    *sep = NULL;
+        int                      count = 1;
+        int                      n = 0;
+        int                      weight = 0;
+        int                      ret = -1;
+        const char              *p = NULL;
+
+        *weights = NULL;
+        *nweights = 0;
+
+        if (!str || !*str)
+                return 0;
+
+        for (p = str; *p; p++)
+                if (*p == ',')
+                        count++;
+
+        w = GF_CALLOC (count, sizeof (*w), gf_common_mt_rpcsvc_fq_t);
+        dup = gf_strdup (str);
+        if (!w || !dup)
+                goto out;
+
+        for (entry = strtok_r (dup, ", ", &saveptr); entry;
+             entry = strtok_r (NULL, ", ", &saveptr)) {
+                sep = strrchr (entry, ':');
+                if (!sep || sep == entry) {
+                        gf_log (GF_RPCSVC, GF_LOG_ERROR, "invalid fair-share "
+                                "weight '%s', expected pattern:weight", entry);
+                        goto out;
+                }
+                *sep = '\0';
+
+                if (gf_string2int (sep + 1, &weight) || weight < 1 ||
+                    weight > RPCSVC_FQ_MAX_WEIGHT) {
+                        gf_log (GF_RPCSVC, GF_LOG_ERROR, "invalid fair-share "
+                                "weight '%s' for %s (1-%d)", sep + 1, entry,
+                                RPCSVC_FQ_MAX_WEIGHT);
+                        goto out;
+                }
+
+                w[n].pattern = gf_strdup (entry);
+                if (!w[n].pattern)
+                        goto out;
+                w[n].weight = weight;
+                n++;
+        }
+
+        *weights = w;
+        *nweights = n;
+        w = NULL;
+        n = 0;
+        ret = 0;
+out:
+        if (w)
+                rpcsvc_fq_weights_free (w, n);
+        GF_FREE (dup);
+        return ret;
+}
+
+int
+rpcsvc_fq_reconfigure (rpcsvc_fq_conf_t *conf, dict_t *options)
+{
+        struct rpcsvc_fq_weight *weights = NULL;
+        struct rpcsvc_fq_weight *old = NULL;
+        gf_boolean_t             enabled = _gf_false;
+        uint64_t                 op_cost = RPCSVC_FQ_DEFAULT_OP_COST;
+        char                    *str = NULL;
+        int                      nweights = 0;
+        int                      nold = 0;
+
+        if (dict_get_str (options, "rpc.fair-share", &str) == 0 &&
+            gf_string2boolean (str, &enabled)) {
+                gf_log (GF_RPCSVC, GF_LOG_ERROR, "invalid value '%s' of "
+                        "rpc.fair-share", str);
+                return -1;
+        }
+
+        str = NULL;
+        if (dict_get_str (options, "rpc.fair-share-op-cost", &str) == 0 &&
+            gf_string2bytesize_uint64 (str, &op_cost)) {
+                gf_log (GF_RPCSVC, GF_LOG_ERROR, "invalid value '%s' of "
+                        "rpc.fair-share-op-cost", str);
+                return -1;
+        }
+
+        if (dict_get_str (options, "rpc.fair-share-weights", &str))
+                str = NULL;
+        if (rpcsvc_fq_parse_weights (str, &weights, &nweights))
+                return -1;
+
+        LOCK (&conf->lock);
+        {
+                old = conf->weights;
+                nold = conf->nweights;
+                conf->weights = weights;
+                conf->nweights = nweights;
+                conf->op_cost = op_cost;
+                conf->gen++;
+
+                if (conf->enabled != enabled)
+                        gf_log (GF_RPCSVC, GF_LOG_INFO, "fair sharing of "
+                                "requests among clients %s",
+                                enabled ? "enabled" : "disabled");
+                conf->enabled = enabled;
+        }
+        UNLOCK (&conf->lock);
+
+        rpcsvc_fq_weights_free (old, nold);
+
+        return 0;
+}
+
+rpcsvc_fq_t *
+rpcsvc_fq_new (void)
+{
+        rpcsvc_fq_t *fq = NULL;
+        int          i = 0;
+
+        fq = GF_CALLOC (1, sizeof (*fq), gf_common_mt_rpcsvc_fq_t);
+        if (!fq)
+                return NULL;
+
+        for (i = 0; i < RPCSVC_FQ_BUCKETS; i++)
+                INIT_LIST_HEAD (&fq->buckets[i]);
+        INIT_LIST_HEAD (&fq->active);
+
+        return fq;
+}
+
+static void
+rpcsvc_fq_flow_free (struct rpcsvc_fq_flow *flow)
+{
+        list_del_init (&flow->hash);
+        GF_FREE (flow->name);
+        GF_FREE (flow);
+}
+
+static const char *
+rpcsvc_fq_request_flow_name (rpcsvc_request_t *req)
+{
+        client_t *client = req->trans->xl_private;
+
+        if (client && client->client_uid)
+                return client->client_uid;
+
+        return req->trans->peerinfo.identifier;
+}
+
+static int
+rpcsvc_fq_weight (rpcsvc_fq_conf_t *conf, const char *name)
+{
+        int i = 0;
+
+        for (i = 0; i < conf->nweights; i++) {
+                if (fnmatch (conf->weights[i].pattern, name, 0) == 0)
+                        return conf->weights[i].weight;
+        }
+
+        return 1;
+}
+
+/* Frees the flows which had nothing queued for a while. */
+static void
+__rpcsvc_fq_reap (rpcsvc_fq_t *fq, time_t now)
+{
+        struct rpcsvc_fq_flow *flow = NULL;
+        struct rpcsvc_fq_flow *tmp = NULL;
+        int                    i = 0;
+
+        if (now - fq->reaped < RPCSVC_FQ_IDLE_SECS)
+                return;
+        fq->reaped = now;
+
+        for (i = 0; i < RPCSVC_FQ_BUCKETS; i++) {
+                list_for_each_entry_safe (flow, tmp, &fq->buckets[i], hash) {
+                        if (!list_empty (&flow->requests) ||
+                            now - flow->last < RPCSVC_FQ_IDLE_SECS)
+                                continue;
+
+                        rpcsvc_fq_flow_free (flow);
+                        fq->flows--;
+                }
+        }
+}
+
+static struct rpcsvc_fq_flow *
+__rpcsvc_fq_flow_get (rpcsvc_fq_t *fq, const char *name)
+{
+        struct rpcsvc_fq_flow *flow = NULL;
+        struct list_head      *bucket = NULL;
+
+        bucket = &fq->buckets[gf_dm_hashfn (name, strlen (name)) %
+                              RPCSVC_FQ_BUCKETS];
+
+        list_for_each_entry (flow, bucket, hash) {
+                if (strcmp (flow->name, name) == 0)
+                        return flow;
+        }
+
+        flow = GF_CALLOC (1, sizeof (*flow), gf_common_mt_rpcsvc_fq_flow_t);
+        if (!flow)
+                return NULL;
+
+        flow->name = gf_strdup (name);
+        if (!flow->name) {
+                GF_FREE (flow);
+                return NULL;
+        }
+
+        INIT_LIST_HEAD (&flow->active);
+        INIT_LIST_HEAD (&flow->requests);
+        list_add (&flow->hash, bucket);
+        fq->flows++;
+
+        return flow;
+}
+
+/* Returns -1 if the request could not be queued (out of memory). */
+int
+__rpcsvc_fq_enqueue (rpcsvc_fq_t *fq, rpcsvc_fq_conf_t *conf,
+                     rpcsvc_request_t *req)
+{
+        struct rpcsvc_fq_flow *flow = NULL;
+        const char            *name = NULL;
+        uint64_t               op_cost = 0;
+        uint32_t               gen = 0;
+        size_t                 bytes = 0;
+
+        name = rpcsvc_fq_request_flow_name (req);
+        if (!name)
+                return -1;
+
+        timespec_now (&req->queued_at);
+        __rpcsvc_fq_reap (fq, req->queued_at.tv_sec);
+
+        flow = __rpcsvc_fq_flow_get (fq, name);
+        if (!flow)
+                return -1;
+
+        LOCK (&conf->lock);
+        {
+                op_cost = conf->op_cost;
+                gen = conf->gen;
+                if (!flow->weight || flow->gen != gen) {
+                        flow->weight = rpcsvc_fq_weight (conf, name);
+                        flow->gen = gen;
+                }
+        }
+        UNLOCK (&conf->lock);
+
+        bytes = iov_length (req->msg, req->count);
+        req->fq_cost = op_cost + bytes;
+
+        if (list_empty (&flow->requests)) {
+                flow->deficit = 0;
+                flow->credited = _gf_false;
+                list_add_tail (&flow->active, &fq->active);
+        }
+        list_add_tail (&req->request_list, &flow->requests);
+
+        flow->queued++;
+        flow->bytes += bytes;
+        flow->last = req->queued_at.tv_sec;
+        fq->queued++;
+
+        return 0;
+}
+
+static void
+rpcsvc_fq_account_wait (struct rpcsvc_fq_flow *flow, rpcsvc_request_t *req)
+{
+        struct timespec now = {0, };
+        struct timespec delta = {0, };
+        uint64_t        wait = 0;
+
+        timespec_now (&now);
+        timespec_sub (&req->queued_at, &now, &delta);
+        wait = delta.tv_sec * 1000000 + delta.tv_nsec / 1000;
+
+        flow->wait_total += wait;
+        if (wait > flow->wait_max)
+                flow->wait_max = wait;
+        flow->dispatched++;
+        flow->last = now.tv_sec;
+}
+
+/* Deficit round robin: the flow at the head of the active list is
+ * credited a quantum once per turn, and is served for as long as that
+ * covers the cost of its next request. */
+rpcsvc_request_t *
+__rpcsvc_fq_dequeue (rpcsvc_fq_t *fq)
+{
+        struct rpcsvc_fq_flow *flow = NULL;
+        rpcsvc_request_t      *req = NULL;
+
+        while (!list_empty (&fq->active)) {
+                flow = list_entry (fq->active.next, typeof (*flow), active);
+                req = list_entry (flow->requests.next, typeof (*req),
+                                  request_list);
+
+                if (!flow->credited) {
+                        flow->deficit += (int64_t)RPCSVC_FQ_QUANTUM *
+                                         flow->weight;
+                        flow->credited = _gf_true;
+                }
+
+                if (flow->deficit < req->fq_cost) {
+                        flow->credited = _gf_false;
+                        list_move_tail (&flow->active, &fq->active);
+                        continue;
+                }
+
+                flow->deficit -= req->fq_cost;
+                list_del_init (&req->request_list);
+                fq->queued--;
+
+                if (list_empty (&flow->requests)) {
+                        /* an idle flow does not keep its credit */
+                        flow->deficit = 0;
+                        flow->credited = _gf_false;
+                        list_del_init (&flow->active);
+                }
+
+                rpcsvc_fq_account_wait (flow, req);
+
+                return req;
+        }
+
+        return NULL;
+}
+
+void
+__rpcsvc_fq_dump (rpcsvc_fq_t *fq, const char *progname)
+{
+        struct rpcsvc_fq_flow *flow = NULL;
+        char                   key[GF_DUMP_MAX_BUF_LEN] = {0, };
+        uint64_t               depth = 0;
+        int                    i = 0;
+        int                    n = 0;
+
+        gf_proc_dump_build_key (key, progname, "fair-share.flows");
+        gf_proc_dump_write (key, "%d", fq->flows);
+        gf_proc_dump_build_key (key, progname, "fair-share.queued");
+        gf_proc_dump_write (key, "%"PRIu64, fq->queued);
+
+        for (i = 0; i < RPCSVC_FQ_BUCKETS; i++) {
+                list_for_each_entry (flow, &fq->buckets[i], hash) {
+                        depth = flow->queued - flow->dispatched;
+
+                        gf_proc_dump_build_key (key, progname,
+                                                "fair-share.flow%d.name", n);
+                        gf_proc_dump_write (key, "%s", flow->name);
+                        gf_proc_dump_build_key (key, progname,
+                                                "fair-share.flow%d.weight", n);
+                        gf_proc_dump_write (key, "%d", flow->weight);
+                        gf_proc_dump_build_key (key, progname,
+                                                "fair-share.flow%d.queue_depth",
+                                                n);
+                        gf_proc_dump_write (key, "%"PRIu64, depth);
+                        gf_proc_dump_build_key (key, progname,
+                                                "fair-share.flow%d.dispatched",
+                                                n);
+                        gf_proc_dump_write (key, "%"PRIu64, flow->dispatched);
+                        gf_proc_dump_build_key (key, progname,
+                                                "fair-share.flow%d.bytes", n);
+                        gf_proc_dump_write (key, "%"PRIu64, flow->bytes);
+                        gf_proc_dump_build_key (key, progname,
+                                                "fair-share.flow%d.avg_wait_usec",
+                                                n);
+                        gf_proc_dump_write (key, "%"PRIu64,
+                                            flow->dispatched ?
+                                            flow->wait_total / flow->dispatched
+                                            : 0);
+                        gf_proc_dump_build_key (key, progname,
+                                                "fair-share.flow%d.max_wait_usec",
+                                                n);
+                        gf_proc_dump_write (key, "%"PRIu64, flow->wait_max);
+                        n++;
+                }
+        }
+}
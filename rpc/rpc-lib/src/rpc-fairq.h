@@ -0,0 +1,114 @@
+/*
+  Copyright (c) 2018 Red Hat, Inc. <http://www.redhat.com>
+  This file is part of GlusterFS.
+
+  This file is licensed to you under your choice of the GNU Lesser
+  General Public License, version 3 or any later version (LGPLv3 or
+  later), or the GNU General Public License, version 2 (GPLv2), in all
+  cases as published by the Free Software Foundation.
+*/
+
+#ifndef RPC_FAIRQ_H
+#define RPC_FAIRQ_H
+
+/*
+ * Fair sharing of the request handler threads of a program among its
+ * clients.
+ *
+ * With fair sharing enabled, requests of an ownthread program are not
+ * queued in the order they were received, but in one queue (a "flow") per
+ * client, and the handler threads take them from the flows in deficit
+ * round robin order: every turn a flow may spend RPCSVC_FQ_QUANTUM times
+ * its weight, and a request costs rpc.fair-share-op-cost plus its size in
+ * bytes. A client sending large writes, or a lot of small requests, can
+ * then no longer delay the requests of everyone else.
+ *
+ * Flows are named after the client_uid of the client, or after the peer
+ * address of the connection until the client is known. Weights are set
+ * with rpc.fair-share-weights, a list of "pattern:weight" entries; the
+ * pattern is matched against the flow name, and the first match wins.
+ *
+ * Functions starting with "__" expect the queue_lock of the program to be
+ * held.
+ */
+
+#include "rpcsvc.h"
+#include "locking.h"
+#include "dict.h"
+
+#define RPCSVC_FQ_QUANTUM               (128 * GF_UNIT_KB)
+#define RPCSVC_FQ_DEFAULT_OP_COST       4096
+#define RPCSVC_FQ_MAX_WEIGHT            64
+#define RPCSVC_FQ_BUCKETS               64
+/* idle flows are freed after this many seconds */
+#define RPCSVC_FQ_IDLE_SECS             300
+
+struct rpcsvc_fq_weight {
+        char                   *pattern;
+        int                     weight;
+};
+
+/* configuration shared by the fair queues of all programs */
+struct rpcsvc_fq_conf {
+        gf_lock_t               lock;
+        gf_boolean_t            enabled;
+        uint64_t                op_cost;
+        struct rpcsvc_fq_weight *weights;
+        int                     nweights;
+        /* changes with every reconfigure, flows then look up their
+         * weight again */
+        uint32_t                gen;
+};
+
+struct rpcsvc_fq_flow {
+        struct list_head        hash;
+        /* in the active list of the queue while it has requests */
+        struct list_head        active;
+        struct list_head        requests;
+        char                   *name;
+        int                     weight;
+        uint32_t                gen;
+        int64_t                 deficit;
+        gf_boolean_t            credited;
+
+        uint64_t                queued;
+        uint64_t                dispatched;
+        uint64_t                bytes;
+        uint64_t                wait_total;     /* usec */
+        uint64_t                wait_max;       /* usec */
+        time_t                  last;
+};
+
+struct rpcsvc_fq {
+        struct list_head        buckets[RPCSVC_FQ_BUCKETS];
+        struct list_head        active;
+        int                     flows;
+        uint64_t                queued;
+        time_t                  reaped;
+};
+
+typedef struct rpcsvc_fq_conf rpcsvc_fq_conf_t;
+typedef struct rpcsvc_fq rpcsvc_fq_t;
+
+rpcsvc_fq_conf_t *
+rpcsvc_fq_conf_new (void);
+
+int
+rpcsvc_fq_reconfigure (rpcsvc_fq_conf_t *conf, dict_t *options);
+
+rpcsvc_fq_t *
+rpcsvc_fq_new (void);
+
+int
+__rpcsvc_fq_enqueue (rpcsvc_fq_t *fq, rpcsvc_fq_conf_t *conf,
+                     rpcsvc_request_t *req);
+
+rpcsvc_request_t *
+__rpcsvc_fq_dequeue (rpcsvc_fq_t *fq);
+
+void
+__rpcsvc_fq_dump (rpcsvc_fq_t *fq, const char *progname);
+
+#define __rpcsvc_fq_empty(fq) (!(fq) || list_empty (&(fq)->active))
+
+#endif /* RPC_FAIRQ_H */
@@ -279,7 +279,10 @@ rpc_transport_load (glusterfs_ctx_t *ctx, dict_t *options, char *trans_name)
 	gf_log ("rpc-transport", GF_LOG_DEBUG,
 		"attempt to load file %s", name);
 
-        handle = dlopen (name, RTLD_NOW);
+        /* The last reference to a transport is often dropped by its own
+         * event handler, from the poller thread, so the library has to stay
+         * mapped after the dlclose () in rpc_transport_destroy (). */
+        handle = dlopen (name, RTLD_NOW | RTLD_NODELETE);
 	if (handle == NULL) {
 		gf_log ("rpc-transport", GF_LOG_ERROR, "%s", dlerror ());
 		gf_log ("rpc-transport", GF_LOG_WARNING,
@@ -204,6 +204,9 @@ struct rpc_transport {
 
         uint64_t                   total_bytes_read;
         uint64_t                   total_bytes_write;
+        uint64_t                   total_write_calls;
+        /* write calls not made, thanks to queued messages sent together */
+        uint64_t                   total_writes_saved;
         uint32_t                   xid; /* RPC/XID used for callbacks */
 
         struct list_head           list;
@@ -81,6 +81,8 @@ typedef struct rpcsvc_state {
         gf_boolean_t            addr_namelookup;
         /* determine whether throttling is needed, by default OFF */
         gf_boolean_t            throttle;
+        /* fair sharing of the ownthread programs among clients */
+        struct rpcsvc_fq_conf   *fq;
 } rpcsvc_t;
 
 /* DRC START */
@@ -127,6 +129,11 @@ typedef enum drc_policy drc_policy_t;
 #define DRC_DEFAULT_CACHE_SIZE         0x20000
 #define DRC_DEFAULT_LRU_FACTOR         DRC_LRU_25_PC
 
+/* The cache is split in shards by client and xid, each with a lock, an LRU
+ * list and a share of the cache size of its own. */
+#define DRC_SHARD_BITS                 4
+#define DRC_SHARDS                     (1 << DRC_SHARD_BITS)
+
 /* DRC END */
 
 #endif /* #ifndef _RPCSVC_COMMON_H */
@@ -24,6 +24,7 @@
 #include "rpc-common-xdr.h"
 #include "syncop.h"
 #include "rpc-drc.h"
+#include "rpc-fairq.h"
 #include "protocol-common.h"
 
 #include <errno.h>
@@ -578,6 +579,13 @@ rpcsvc_check_and_reply_error (int ret, call_frame_t *frame, void *opaque)
         return 0;
 }
 
+static gf_boolean_t
+__rpcsvc_program_queue_empty (rpcsvc_program_t *program)
+{
+        return (list_empty (&program->request_queue) &&
+                __rpcsvc_fq_empty (program->fq));
+}
+
 int
 rpcsvc_handle_rpc_call (rpcsvc_t *svc, rpc_transport_t *trans,
                         rpc_transport_pollin_t *msg)
@@ -590,7 +598,7 @@ rpcsvc_handle_rpc_call (rpcsvc_t *svc, rpc_transport_t *trans,
         gf_boolean_t            is_unix        = _gf_false, empty = _gf_false;
         gf_boolean_t            unprivileged   = _gf_false;
         drc_cached_op_t        *reply          = NULL;
-        rpcsvc_drc_globals_t   *drc            = NULL;
+        drc_shard_t            *shard          = NULL;
 
         if (!trans || !svc)
                 return -1;
@@ -648,10 +656,11 @@ rpcsvc_handle_rpc_call (rpcsvc_t *svc, rpc_transport_t *trans,
         }
 
         /* DRC */
-        if (rpcsvc_need_drc (req)) {
-                drc = req->svc->drc;
+        if (rpcsvc_need_drc (req))
+                shard = rpcsvc_drc_shard (req);
 
-                LOCK (&drc->lock);
+        if (shard) {
+                LOCK (&shard->lock);
                 {
                         reply = rpcsvc_drc_lookup (req);
 
@@ -660,8 +669,8 @@ rpcsvc_handle_rpc_call (rpcsvc_t *svc, rpc_transport_t *trans,
                                 gf_log (GF_RPCSVC, GF_LOG_INFO, "duplicate request:"
                                         " XID: 0x%x", req->xid);
                                 ret = rpcsvc_send_cached_reply (req, reply);
-                                drc->cache_hits++;
-                                UNLOCK (&drc->lock);
+                                shard->cache_hits++;
+                                UNLOCK (&shard->lock);
                                 goto out;
 
                         } /* retransmitted request, original op in transit, drop it */
@@ -669,9 +678,9 @@ rpcsvc_handle_rpc_call (rpcsvc_t *svc, rpc_transport_t *trans,
                                 gf_log (GF_RPCSVC, GF_LOG_INFO, "op in transit,"
                                         " discarding. XID: 0x%x", req->xid);
                                 ret = 0;
-                                drc->intransit_hits++;
+                                shard->intransit_hits++;
                                 rpcsvc_request_destroy (req);
-                                UNLOCK (&drc->lock);
+                                UNLOCK (&shard->lock);
                                 goto out;
 
                         } /* fresh request, cache it as in-transit and proceed */
@@ -679,7 +688,7 @@ rpcsvc_handle_rpc_call (rpcsvc_t *svc, rpc_transport_t *trans,
                                 ret = rpcsvc_cache_request (req);
                         }
                 }
-                UNLOCK (&drc->lock);
+                UNLOCK (&shard->lock);
         }
 
         if (req->rpc_err == SUCCESS) {
@@ -706,10 +715,14 @@ rpcsvc_handle_rpc_call (rpcsvc_t *svc, rpc_transport_t *trans,
                 } else if (req->ownthread) {
                         pthread_mutex_lock (&req->prog->queue_lock);
                         {
-                                empty = list_empty (&req->prog->request_queue);
+                                empty = __rpcsvc_program_queue_empty (req->prog);
 
-                                list_add_tail (&req->request_list,
-                                               &req->prog->request_queue);
+                                if (!svc->fq || !svc->fq->enabled ||
+                                    !req->prog->fq ||
+                                    __rpcsvc_fq_enqueue (req->prog->fq, svc->fq,
+                                                         req) < 0)
+                                        list_add_tail (&req->request_list,
+                                                       &req->prog->request_queue);
 
                                 if (empty)
                                         pthread_cond_signal (&req->prog->queue_cond);
@@ -1315,7 +1328,7 @@ rpcsvc_submit_generic (rpcsvc_request_t *req, struct iovec *proghdr,
         size_t                  msglen     = 0;
         size_t                  hdrlen     = 0;
         char                    new_iobref = 0;
-        rpcsvc_drc_globals_t   *drc        = NULL;
+        drc_shard_t            *shard      = NULL;
 
         if ((!req) || (!req->trans))
                 return -1;
@@ -1352,13 +1365,13 @@ rpcsvc_submit_generic (rpcsvc_request_t *req, struct iovec *proghdr,
 
         /* cache the request in the duplicate request cache for appropriate ops */
         if ((req->reply) && (rpcsvc_need_drc (req))) {
-                drc = req->svc->drc;
+                shard = rpcsvc_drc_op_shard (req->svc->drc, req->reply);
 
-                LOCK (&drc->lock);
+                LOCK (&shard->lock);
                 ret = rpcsvc_cache_reply (req, iobref, &recordhdr, 1,
                                           proghdr, hdrcount,
                                           payload, payloadcount);
-                UNLOCK (&drc->lock);
+                UNLOCK (&shard->lock);
                 if (ret < 0) {
                         gf_log (GF_RPCSVC, GF_LOG_ERROR,
                                 "failed to cache reply");
@@ -1955,6 +1968,25 @@ out:
         return ret;
 }
 
+/* The per-client queues go first; request_queue has what was queued while
+ * fair sharing was off, or could not be queued per client. */
+static rpcsvc_request_t *
+__rpcsvc_program_dequeue (rpcsvc_program_t *program)
+{
+        rpcsvc_request_t *req = NULL;
+
+        if (!__rpcsvc_fq_empty (program->fq))
+                return __rpcsvc_fq_dequeue (program->fq);
+
+        if (!list_empty (&program->request_queue)) {
+                req = list_entry (program->request_queue.next,
+                                  typeof (*req), request_list);
+                list_del_init (&req->request_list);
+        }
+
+        return req;
+}
+
 void *
 rpcsvc_request_handler (void *arg)
 {
@@ -1971,12 +2003,12 @@ rpcsvc_request_handler (void *arg)
                 pthread_mutex_lock (&program->queue_lock);
                 {
                         if (!program->alive
-                            && list_empty (&program->request_queue)) {
+                            && __rpcsvc_program_queue_empty (program)) {
                                 done = 1;
                                 goto unlock;
                         }
 
-                        while (list_empty (&program->request_queue) &&
+                        while (__rpcsvc_program_queue_empty (program) &&
                                (program->threadcount <=
                                         program->eventthreadcount)) {
                                 pthread_cond_wait (&program->queue_cond,
@@ -1992,11 +2024,8 @@ rpcsvc_request_handler (void *arg)
                                         "total count:%d",
                                         program->progname,
                                         program->threadcount);
-                        } else if (!list_empty (&program->request_queue)) {
-                                req = list_entry (program->request_queue.next,
-                                                  typeof (*req), request_list);
-
-                                list_del_init (&req->request_list);
+                        } else {
+                                req = __rpcsvc_program_dequeue (program);
                         }
                 }
         unlock:
@@ -2117,12 +2146,17 @@ rpcsvc_program_register (rpcsvc_t *svc, rpcsvc_program_t *program,
         pthread_cond_init (&newprog->queue_cond, NULL);
 
         newprog->alive = _gf_true;
+        newprog->fq = NULL;
 
         /* make sure synctask gets priority over ownthread */
         if (newprog->synctask)
                 newprog->ownthread = _gf_false;
 
         if (newprog->ownthread) {
+                newprog->fq = rpcsvc_fq_new ();
+                if (!newprog->fq)
+                        goto out;
+
                 newprog->eventthreadcount = 1;
                 creates = rpcsvc_spawn_threads (svc, newprog);
 
@@ -2497,6 +2531,52 @@ rpcsvc_set_outstanding_rpc_limit (rpcsvc_t *svc, dict_t *options, int defvalue)
         return (0);
 }
 
+/*
+ * Configure rpc.fair-share, rpc.fair-share-weights and
+ * rpc.fair-share-op-cost. Fair sharing applies to the programs having
+ * their own request handler threads.
+ */
+int
+rpcsvc_set_fair_share (rpcsvc_t *svc, dict_t *options)
+{
+        if ((!svc) || (!options))
+                return (-1);
+
+        if (!svc->fq) {
+                svc->fq = rpcsvc_fq_conf_new ();
+                if (!svc->fq)
+                        return (-1);
+        }
+
+        return rpcsvc_fq_reconfigure (svc->fq, options);
+}
+
+/* Dumps the per-client queues of the programs into the statedump. */
+void
+rpcsvc_fair_share_dump (rpcsvc_t *svc)
+{
+        rpcsvc_program_t *program = NULL;
+
+        if (!svc || !svc->fq)
+                return;
+
+        pthread_rwlock_rdlock (&svc->rpclock);
+        {
+                list_for_each_entry (program, &svc->programs, program) {
+                        if (!program->fq)
+                                continue;
+
+                        pthread_mutex_lock (&program->queue_lock);
+                        {
+                                __rpcsvc_fq_dump (program->fq,
+                                                  program->progname);
+                        }
+                        pthread_mutex_unlock (&program->queue_lock);
+                }
+        }
+        pthread_rwlock_unlock (&svc->rpclock);
+}
+
 /*
  * Enable throttling for rpcsvc_t svc.
  * Returns 0 on success, -1 otherwise.
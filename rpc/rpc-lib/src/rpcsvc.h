@@ -250,6 +250,9 @@ struct rpcsvc_request {
 
         /* request queue in rpcsvc */
         struct list_head         request_list;
+        /* when it was queued, and its cost with fair sharing */
+        struct timespec          queued_at;
+        uint64_t                 fq_cost;
 
         /* Things passed to rpc layer from client */
 
@@ -419,6 +422,9 @@ struct rpcsvc_program {
         /* list member to link to list of registered services with rpcsvc */
         struct list_head        program;
         struct list_head        request_queue;
+        /* per-client queues, used instead of request_queue with fair
+         * sharing enabled */
+        struct rpcsvc_fq       *fq;
         pthread_mutex_t         queue_lock;
         pthread_cond_t          queue_cond;
         pthread_t               thread;
@@ -642,6 +648,12 @@ rpcsvc_set_throttle_off (rpcsvc_t *svc);
 gf_boolean_t
 rpcsvc_get_throttle (rpcsvc_t *svc);
 
+int
+rpcsvc_set_fair_share (rpcsvc_t *svc, dict_t *options);
+
+void
+rpcsvc_fair_share_dump (rpcsvc_t *svc);
+
 int
 rpcsvc_auth_array (rpcsvc_t *svc, char *volname, int *autharr, int arrlen);
 rpcsvc_vector_sizer
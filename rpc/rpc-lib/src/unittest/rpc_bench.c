@@ -0,0 +1,649 @@
+/*
+  Copyright (c) 2018 Red Hat, Inc. <http://www.redhat.com>
+  This file is part of GlusterFS.
+
+  This file is licensed to you under your choice of the GNU Lesser
+  General Public License, version 3 or any later version (LGPLv3 or
+  later), or the GNU General Public License, version 2 (GPLv2), in all
+  cases as published by the Free Software Foundation.
+*/
+
+/*
+ * Loopback benchmark of the rpc layer over the socket transport.
+ *
+ * An rpcsvc program with one procedure, which replies with as many bytes
+ * as it is asked for, is served on 127.0.0.1, and an rpc_clnt keeps a
+ * number of calls outstanding against it. This is done once with the
+ * transport using epoll and once in its io_uring mode, and the throughput
+ * of both is printed. Given a directory with glusterfs.pem, glusterfs.key
+ * and glusterfs.ca (-c), it is done over SSL too, with OpenSSL and with
+ * kernel TLS. Whether io_uring or kernel TLS could really be used is
+ * logged.
+ *
+ * With -D the procedure is non-idempotent, as NFSv3 WRITE, CREATE or
+ * REMOVE are, and every mode is run a second time with the duplicate
+ * request cache of the server turned on. The calls are spread over -k
+ * connections, handled by as many event threads.
+ *
+ * With -R the server holds the requests until all outstanding ones have
+ * arrived, and replies to them newest first, as a brick with many io
+ * threads would reply out of order. The client then has to match every
+ * reply against the full table of outstanding calls; use a large depth.
+ *
+ * The socket transport is loaded from where it is installed.
+ *
+ * usage: rpc_bench [-n calls] [-d depth] [-s reply size] [-p port]
+ *                  [-c ssl directory] [-k connections] [-D] [-R]
+ *                  [-l logfile]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "glusterfs.h"
+#include "globals.h"
+#include "xlator.h"
+#include "stack.h"
+#include "event.h"
+#include "iobuf.h"
+#include "mem-pool.h"
+#include "mem-types.h"
+#include "byte-order.h"
+#include "rpcsvc.h"
+#include "rpc-clnt.h"
+#include "rpc-drc.h"
+
+#define BENCH_PROGRAM   0x2000d0c5
+#define BENCH_VERSION   1
+#define BENCH_NULL      0
+#define BENCH_ECHO      1
+#define BENCH_MAXVALUE  2
+
+#define BENCH_MAX_SIZE  (128 * GF_UNIT_KB)
+#define BENCH_MAX_CONNS 64
+
+#define BENCH_EVENT_POOL_SIZE 16384
+#define BENCH_MEM_TYPES       (gf_common_mt_end + 64)
+
+struct bench_mode {
+        const char   *name;
+        gf_boolean_t  uring;
+        gf_boolean_t  ssl;
+        gf_boolean_t  ktls;
+};
+
+static struct bench_mode bench_modes[] = {
+        {"epoll",    _gf_false, _gf_false, _gf_false},
+        {"io_uring", _gf_true,  _gf_false, _gf_false},
+        {"ssl",      _gf_false, _gf_true,  _gf_false},
+        {"ktls",     _gf_false, _gf_true,  _gf_true},
+};
+
+#define BENCH_MODES (sizeof (bench_modes) / sizeof (bench_modes[0]))
+
+struct bench {
+        struct rpc_clnt  *rpc;
+        pthread_mutex_t   lock;
+        pthread_cond_t    cond;
+        gf_boolean_t      connected;
+        int               to_send;
+        int               pending;
+        uint32_t          size;
+        /* request of every call; the transport may send it later */
+        uint32_t          wire_size;
+        uint64_t          bytes;
+        int               errors;
+};
+
+static char bench_payload[BENCH_MAX_SIZE];
+
+/* requests held by the server with -R */
+static struct {
+        pthread_mutex_t    lock;
+        rpcsvc_request_t **held;
+        int                count;
+        int                batch;
+} bench_reverse;
+
+static double
+bench_now (void)
+{
+        struct timespec ts;
+
+        clock_gettime (CLOCK_MONOTONIC, &ts);
+
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int
+bench_null (rpcsvc_request_t *req)
+{
+        return rpcsvc_submit_generic (req, NULL, 0, NULL, 0, NULL);
+}
+
+static int
+bench_echo_reply (rpcsvc_request_t *req)
+{
+        struct iovec  payload = {0, };
+        uint32_t      size = 0;
+
+        if (req->msg[0].iov_len < sizeof (size)) {
+                req->rpc_err = GARBAGE_ARGS;
+                return RPCSVC_ACTOR_ERROR;
+        }
+
+        memcpy (&size, req->msg[0].iov_base, sizeof (size));
+        size = ntoh32 (size);
+        if (size > BENCH_MAX_SIZE) {
+                req->rpc_err = GARBAGE_ARGS;
+                return RPCSVC_ACTOR_ERROR;
+        }
+
+        payload.iov_base = bench_payload;
+        payload.iov_len = size;
+
+        return rpcsvc_submit_generic (req, NULL, 0, &payload, 1, NULL);
+}
+
+static int
+bench_echo (rpcsvc_request_t *req)
+{
+        if (!bench_reverse.batch)
+                return bench_echo_reply (req);
+
+        pthread_mutex_lock (&bench_reverse.lock);
+        {
+                bench_reverse.held[bench_reverse.count++] = req;
+                if (bench_reverse.count == bench_reverse.batch) {
+                        while (bench_reverse.count)
+                                bench_echo_reply (bench_reverse.held
+                                                  [--bench_reverse.count]);
+                }
+        }
+        pthread_mutex_unlock (&bench_reverse.lock);
+
+        return 0;
+}
+
+static rpcsvc_actor_t bench_actors[BENCH_MAXVALUE] = {
+        [BENCH_NULL] = {"NULL", BENCH_NULL, bench_null, NULL, _gf_true, 0},
+        [BENCH_ECHO] = {"ECHO", BENCH_ECHO, bench_echo, NULL, _gf_true, 0},
+};
+
+static struct rpcsvc_program bench_svc_prog = {
+        .progname  = "bench",
+        .prognum   = BENCH_PROGRAM,
+        .progver   = BENCH_VERSION,
+        .actors    = bench_actors,
+        .numactors = BENCH_MAXVALUE,
+};
+
+static char *bench_procnames[BENCH_MAXVALUE] = {
+        [BENCH_NULL] = "NULL",
+        [BENCH_ECHO] = "ECHO",
+};
+
+static rpc_clnt_prog_t bench_clnt_prog = {
+        .progname  = "bench",
+        .prognum   = BENCH_PROGRAM,
+        .progver   = BENCH_VERSION,
+        .procnames = bench_procnames,
+        .numproc   = BENCH_MAXVALUE,
+};
+
+static int bench_send (struct bench *bench);
+
+static int
+bench_cbk (struct rpc_req *req, struct iovec *iov, int count, void *myframe)
+{
+        call_frame_t *frame = myframe;
+        struct bench *bench = frame->local;
+        gf_boolean_t  more = _gf_false;
+
+        frame->local = NULL;
+        STACK_DESTROY (frame->root);
+
+        pthread_mutex_lock (&bench->lock);
+        {
+                if (req->rpc_status == -1)
+                        bench->errors++;
+                else
+                        bench->bytes += req->rsp[0].iov_len;
+
+                bench->pending--;
+                more = (bench->to_send > 0);
+                if (more)
+                        bench->to_send--;
+                else if (!bench->pending)
+                        pthread_cond_broadcast (&bench->cond);
+        }
+        pthread_mutex_unlock (&bench->lock);
+
+        if (more)
+                bench_send (bench);
+
+        return 0;
+}
+
+static int
+bench_send (struct bench *bench)
+{
+        call_frame_t *frame = NULL;
+        struct iovec  hdr = {0, };
+        int           ret = -1;
+
+        frame = create_frame (THIS, THIS->ctx->pool);
+        if (!frame)
+                goto err;
+        frame->local = bench;
+
+        pthread_mutex_lock (&bench->lock);
+        {
+                bench->pending++;
+        }
+        pthread_mutex_unlock (&bench->lock);
+
+        hdr.iov_base = &bench->wire_size;
+        hdr.iov_len = sizeof (bench->wire_size);
+
+        /* the callback is called on failure too */
+        ret = rpc_clnt_submit (bench->rpc, &bench_clnt_prog, BENCH_ECHO,
+                               bench_cbk, &hdr, 1, NULL, 0, NULL, frame,
+                               NULL, 0, NULL, 0, NULL);
+        return ret;
+
+err:
+        pthread_mutex_lock (&bench->lock);
+        {
+                bench->errors++;
+                if (!bench->pending)
+                        pthread_cond_broadcast (&bench->cond);
+        }
+        pthread_mutex_unlock (&bench->lock);
+
+        return -1;
+}
+
+static int
+bench_notify (struct rpc_clnt *rpc, void *mydata, rpc_clnt_event_t event,
+              void *data)
+{
+        struct bench *bench = mydata;
+
+        if (event != RPC_CLNT_CONNECT)
+                return 0;
+
+        rpc_clnt_set_connected (&rpc->conn);
+
+        pthread_mutex_lock (&bench->lock);
+        {
+                bench->connected = _gf_true;
+                pthread_cond_broadcast (&bench->cond);
+        }
+        pthread_mutex_unlock (&bench->lock);
+
+        return 0;
+}
+
+static int
+bench_ssl_options (dict_t *options, struct bench_mode *mode,
+                   const char *ssldir)
+{
+        char path[PATH_MAX] = {0, };
+        int  ret = 0;
+
+        ret |= dict_set_str (options, "transport.socket.ssl-enabled", "on");
+        ret |= dict_set_str (options, "transport.socket.ssl-ktls",
+                             mode->ktls ? "on" : "off");
+
+        snprintf (path, sizeof (path), "%s/glusterfs.pem", ssldir);
+        ret |= dict_set_dynstr_with_alloc (options,
+                                           "transport.socket.ssl-own-cert",
+                                           path);
+        snprintf (path, sizeof (path), "%s/glusterfs.key", ssldir);
+        ret |= dict_set_dynstr_with_alloc (options,
+                                           "transport.socket.ssl-private-key",
+                                           path);
+        snprintf (path, sizeof (path), "%s/glusterfs.ca", ssldir);
+        ret |= dict_set_dynstr_with_alloc (options,
+                                           "transport.socket.ssl-ca-list",
+                                           path);
+
+        return ret;
+}
+
+static dict_t *
+bench_options (int port, struct bench_mode *mode, const char *ssldir,
+               gf_boolean_t server)
+{
+        dict_t *options = NULL;
+        int     ret = 0;
+
+        options = dict_new ();
+        if (!options)
+                return NULL;
+
+        ret |= dict_set_str (options, "transport-type", "socket");
+        ret |= dict_set_str (options, "transport.address-family", "inet");
+        ret |= dict_set_str (options, "transport.socket.io-uring",
+                             mode->uring ? "on" : "off");
+        if (mode->ssl)
+                ret |= bench_ssl_options (options, mode, ssldir);
+        if (server) {
+                ret |= dict_set_str (options, "transport.socket.bind-address",
+                                     "127.0.0.1");
+                ret |= dict_set_int32 (options, "transport.socket.listen-port",
+                                       port);
+                ret |= dict_set_str (options, "rpc-auth-allow-insecure", "on");
+        } else {
+                ret |= dict_set_str (options, "remote-host", "127.0.0.1");
+                ret |= dict_set_int32 (options, "remote-port", port);
+                ret |= dict_set_int32 (options, "ping-timeout", 0);
+        }
+
+        if (ret) {
+                dict_unref (options);
+                return NULL;
+        }
+
+        return options;
+}
+
+static int
+bench_serve (int port, struct bench_mode *mode, const char *ssldir,
+             gf_boolean_t drc)
+{
+        rpcsvc_t *svc = NULL;
+        dict_t   *options = NULL;
+
+        options = bench_options (port, mode, ssldir, _gf_true);
+        if (!options)
+                return -1;
+
+        if (drc && dict_set_str (options, "nfs.drc", "on"))
+                return -1;
+
+        svc = rpcsvc_init (THIS, THIS->ctx, options, 0);
+        if (!svc || rpcsvc_drc_init (svc, options) ||
+            rpcsvc_create_listeners (svc, options, "bench") <= 0 ||
+            rpcsvc_program_register (svc, &bench_svc_prog, _gf_false))
+                return -1;
+
+        return 0;
+}
+
+static int
+bench_connect (struct bench *bench, int port, struct bench_mode *mode,
+               const char *ssldir)
+{
+        dict_t   *options = NULL;
+
+        options = bench_options (port, mode, ssldir, _gf_false);
+        if (!options)
+                return -1;
+
+        bench->rpc = rpc_clnt_new (options, THIS, "bench", 0);
+        if (!bench->rpc)
+                return -1;
+
+        rpc_clnt_register_notify (bench->rpc, bench_notify, bench);
+        if (rpc_clnt_start (bench->rpc))
+                return -1;
+
+        pthread_mutex_lock (&bench->lock);
+        {
+                while (!bench->connected)
+                        pthread_cond_wait (&bench->cond, &bench->lock);
+        }
+        pthread_mutex_unlock (&bench->lock);
+
+        return 0;
+}
+
+/* every connection makes @calls calls, with @depth of them outstanding */
+static int
+bench_run (struct bench *bench, int conns, int calls, int depth,
+           double *elapsed)
+{
+        double t0 = 0;
+        int    errors = 0;
+        int    i = 0;
+        int    j = 0;
+
+        for (j = 0; j < conns; j++) {
+                bench[j].to_send = calls - depth;
+                bench[j].bytes = 0;
+                bench[j].errors = 0;
+        }
+
+        t0 = bench_now ();
+
+        for (j = 0; j < conns; j++) {
+                for (i = 0; i < depth; i++)
+                        bench_send (&bench[j]);
+        }
+
+        for (j = 0; j < conns; j++) {
+                pthread_mutex_lock (&bench[j].lock);
+                {
+                        while (bench[j].pending || (bench[j].to_send > 0))
+                                pthread_cond_wait (&bench[j].cond,
+                                                   &bench[j].lock);
+                }
+                pthread_mutex_unlock (&bench[j].lock);
+
+                errors += bench[j].errors;
+        }
+
+        *elapsed = bench_now () - t0;
+
+        return errors ? -1 : 0;
+}
+
+static int
+bench_mode_run (struct bench_mode *mode, gf_boolean_t drc, int port,
+                const char *ssldir, int conns, int calls, int depth,
+                int size)
+{
+        struct bench *bench = NULL;
+        char          name[32] = {0, };
+        double        elapsed = 0;
+        uint64_t      bytes = 0;
+        int           j = 0;
+
+        snprintf (name, sizeof (name), "%s%s%s", mode->name,
+                  drc ? "+drc" : "", bench_reverse.batch ? "+rev" : "");
+
+        /* the connections are never torn down */
+        bench = GF_CALLOC (conns, sizeof (*bench), gf_common_mt_char);
+        if (!bench)
+                return -1;
+
+        if (bench_serve (port, mode, ssldir, drc))
+                goto err;
+
+        for (j = 0; j < conns; j++) {
+                pthread_mutex_init (&bench[j].lock, NULL);
+                pthread_cond_init (&bench[j].cond, NULL);
+                bench[j].size = size;
+                bench[j].wire_size = hton32 (size);
+
+                if (bench_connect (&bench[j], port, mode, ssldir))
+                        goto err;
+
+                /* the DRC tells clients apart by address only; like the
+                 * NFS clients of a host, connections use xids of their own */
+                GF_ATOMIC_INIT (bench[j].rpc->xid, (uint64_t)j << 24);
+        }
+
+        /* warm up */
+        if (bench_run (bench, conns, depth, depth, &elapsed) ||
+            bench_run (bench, conns, calls / conns, depth, &elapsed)) {
+                fprintf (stderr, "calls failed\n");
+                return -1;
+        }
+
+        for (j = 0; j < conns; j++)
+                bytes += bench[j].bytes;
+
+        printf ("%-13s %8d %6d %6d %8d %10.3f %10.0f %10.1f\n", name,
+                calls / conns * conns, conns, depth, size, elapsed,
+                calls / conns * conns / elapsed,
+                bytes / elapsed / GF_UNIT_MB);
+
+        return 0;
+err:
+        fprintf (stderr, "setting up the %s connections failed\n", name);
+        return -1;
+}
+
+static void *
+bench_poller (void *data)
+{
+        event_dispatch (data);
+
+        return NULL;
+}
+
+int
+main (int argc, char *argv[])
+{
+        glusterfs_ctx_t *ctx = NULL;
+        pthread_t        poller;
+        char            *logfile = "/dev/null";
+        char            *ssldir = NULL;
+        gf_boolean_t     drc = _gf_false;
+        gf_boolean_t     reverse = _gf_false;
+        int              modes = 2;
+        int              calls = 100000;
+        int              depth = 16;
+        int              conns = 1;
+        int              size = 0;
+        int              port = 24999;
+        int              opt = 0;
+        int              i = 0;
+
+        while ((opt = getopt (argc, argv, "n:d:s:p:c:k:DRl:")) != -1) {
+                switch (opt) {
+                case 'n':
+                        calls = atoi (optarg);
+                        break;
+                case 'd':
+                        depth = atoi (optarg);
+                        break;
+                case 's':
+                        size = atoi (optarg);
+                        break;
+                case 'p':
+                        port = atoi (optarg);
+                        break;
+                case 'c':
+                        ssldir = optarg;
+                        modes = BENCH_MODES;
+                        break;
+                case 'k':
+                        conns = atoi (optarg);
+                        break;
+                case 'D':
+                        drc = _gf_true;
+                        break;
+                case 'R':
+                        reverse = _gf_true;
+                        break;
+                case 'l':
+                        logfile = optarg;
+                        break;
+                default:
+                        fprintf (stderr, "usage: %s [-n calls] [-d depth] "
+                                 "[-s reply size] [-p port] "
+                                 "[-c ssl directory] [-k connections] [-D] "
+                                 "[-R] [-l logfile]\n", argv[0]);
+                        return 1;
+                }
+        }
+
+        if (conns <= 0 || conns > BENCH_MAX_CONNS || depth <= 0 ||
+            calls / conns < depth || size < 0 || size > BENCH_MAX_SIZE)
+                return 1;
+
+        if (drc)
+                bench_actors[BENCH_ECHO].op_type = DRC_NON_IDEMPOTENT;
+
+        /* every batch of held requests has to fill up */
+        if (reverse)
+                calls = calls / (conns * depth) * (conns * depth);
+
+        mem_pools_init_early ();
+        mem_pools_init_late ();
+
+        ctx = glusterfs_ctx_new ();
+        if (!ctx || glusterfs_globals_init (ctx))
+                return 1;
+        THIS->ctx = ctx;
+        /* as in glusterfsd: accepted connections use SSL when the
+         * listener is configured to */
+        ctx->secure_srvr = MGMT_SSL_COPY_IO;
+
+        /* the transport accounts its memory to THIS as well, with types
+         * of its own following the common ones */
+        if (xlator_mem_acct_init (THIS, BENCH_MEM_TYPES))
+                return 1;
+
+        if (reverse) {
+                pthread_mutex_init (&bench_reverse.lock, NULL);
+                bench_reverse.batch = conns * depth;
+                bench_reverse.held = GF_CALLOC (bench_reverse.batch,
+                                                sizeof (rpcsvc_request_t *),
+                                                gf_common_mt_char);
+                if (!bench_reverse.held)
+                        return 1;
+        }
+
+        ctx->pool = GF_CALLOC (1, sizeof (call_pool_t), gf_common_mt_char);
+        if (!ctx->pool)
+                return 1;
+        INIT_LIST_HEAD (&ctx->pool->all_frames);
+        LOCK_INIT (&ctx->pool->lock);
+        ctx->pool->frame_mem_pool = mem_pool_new (call_frame_t, 4096);
+        ctx->pool->stack_mem_pool = mem_pool_new (call_stack_t, 1024);
+        ctx->dict_pool = mem_pool_new (dict_t, 1024);
+        ctx->dict_pair_pool = mem_pool_new (data_pair_t, 1024);
+        ctx->dict_data_pool = mem_pool_new (data_t, 1024);
+        ctx->logbuf_pool = mem_pool_new (log_buf_t, 256);
+        ctx->iobuf_pool = iobuf_pool_new ();
+        ctx->event_pool = event_pool_new (BENCH_EVENT_POOL_SIZE,
+                                          STARTING_EVENT_THREADS);
+        if (!ctx->pool->frame_mem_pool || !ctx->pool->stack_mem_pool ||
+            !ctx->dict_pool || !ctx->dict_pair_pool || !ctx->dict_data_pool ||
+            !ctx->logbuf_pool || !ctx->iobuf_pool || !ctx->event_pool)
+                return 1;
+
+        if (gf_log_init (ctx, logfile, NULL))
+                return 1;
+
+        if (event_reconfigure_threads (ctx->event_pool, conns))
+                return 1;
+
+        if (gf_thread_create (&poller, NULL, bench_poller, ctx->event_pool,
+                              "benchpoll"))
+                return 1;
+
+        printf ("%-13s %8s %6s %6s %8s %10s %10s %10s\n", "mode", "calls",
+                "conns", "depth", "size", "seconds", "calls/s", "MB/s");
+
+        for (i = 0; i < modes; i++) {
+                if (bench_mode_run (&bench_modes[i], _gf_false, port++, ssldir,
+                                    conns, calls, depth, size))
+                        return 1;
+
+                if (drc &&
+                    bench_mode_run (&bench_modes[i], _gf_true, port++, ssldir,
+                                    conns, calls, depth, size))
+                        return 1;
+        }
+
+        return 0;
+}
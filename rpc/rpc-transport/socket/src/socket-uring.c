@@ -0,0 +1,698 @@
+/*
+  Copyright (c) 2018 Red Hat, Inc. <http://www.redhat.com>
+  This file is part of GlusterFS.
+
+  This file is licensed to you under your choice of the GNU Lesser
+  General Public License, version 3 or any later version (LGPLv3 or
+  later), or the GNU General Public License, version 2 (GPLv2), in all
+  cases as published by the Free Software Foundation.
+*/
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <errno.h>
+#include <string.h>
+
+#include "socket-uring.h"
+#include "socket-mem-types.h"
+#include "xlator.h"
+#include "syscall.h"
+#include "common-utils.h"
+
+#ifdef HAVE_IO_URING
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#include <linux/io_uring.h>
+
+/* the one and only group of provided buffers of a ring */
+#define SOCKET_URING_BGID 0
+
+static int
+uring_setup (unsigned entries, struct io_uring_params *params)
+{
+        return syscall (__NR_io_uring_setup, entries, params);
+}
+
+static int
+uring_enter (int fd, unsigned to_submit, unsigned min_complete,
+             unsigned flags)
+{
+        return syscall (__NR_io_uring_enter, fd, to_submit, min_complete,
+                        flags, NULL, 0);
+}
+
+static int
+uring_register (int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+        return syscall (__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+
+static int
+socket_uring_map (struct socket_uring *ring, struct io_uring_params *params)
+{
+        size_t    sq_size = 0;
+        size_t    cq_size = 0;
+        char     *ptr = NULL;
+        unsigned  i = 0;
+
+        sq_size = params->sq_off.array + params->sq_entries * sizeof (unsigned);
+        cq_size = params->cq_off.cqes +
+                  params->cq_entries * sizeof (struct io_uring_cqe);
+
+        /* IORING_FEAT_SINGLE_MMAP: both rings share one mapping */
+        ring->ring_size = max (sq_size, cq_size);
+        ptr = mmap (NULL, ring->ring_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+        if (ptr == MAP_FAILED)
+                return -1;
+        ring->ring = ptr;
+
+        ring->sq_head = (unsigned *) (ptr + params->sq_off.head);
+        ring->sq_tail = (unsigned *) (ptr + params->sq_off.tail);
+        ring->sq_mask = (unsigned *) (ptr + params->sq_off.ring_mask);
+        ring->sq_array = (unsigned *) (ptr + params->sq_off.array);
+        ring->sq_entries = params->sq_entries;
+
+        ring->cq_head = (unsigned *) (ptr + params->cq_off.head);
+        ring->cq_tail = (unsigned *) (ptr + params->cq_off.tail);
+        ring->cq_mask = (unsigned *) (ptr + params->cq_off.ring_mask);
+        ring->cqes = (struct io_uring_cqe *) (ptr + params->cq_off.cqes);
+
+        ring->sqes_size = params->sq_entries * sizeof (struct io_uring_sqe);
+        ptr = mmap (NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+        if (ptr == MAP_FAILED)
+                return -1;
+        ring->sqes = (struct io_uring_sqe *) ptr;
+
+        /* sqes are always used in order */
+        for (i = 0; i < ring->sq_entries; i++)
+                ring->sq_array[i] = i;
+
+        return 0;
+}
+
+
+/* Gives buffer @bid back to the kernel */
+static void
+__socket_uring_recycle (struct socket_uring *ring, unsigned bid)
+{
+        struct io_uring_buf *buf = NULL;
+        unsigned short       tail = 0;
+
+        tail = ring->br->tail;
+        buf = &ring->br->bufs[tail & (ring->br_entries - 1)];
+        buf->addr = (uintptr_t) (ring->buf_base + bid * ring->buf_size);
+        buf->len = ring->buf_size;
+        buf->bid = bid;
+
+        __atomic_store_n (&ring->br->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+
+static int
+socket_uring_buffers (struct socket_uring *ring, struct iobuf_pool *iobuf_pool)
+{
+        struct io_uring_buf_reg reg = {0, };
+        void                   *ptr = NULL;
+        unsigned                i = 0;
+
+        ring->iobuf = iobuf_get2 (iobuf_pool, ring->nbufs * ring->buf_size);
+        if (!ring->iobuf) {
+                errno = ENOMEM;
+                return -1;
+        }
+        ring->buf_base = iobuf_ptr (ring->iobuf);
+
+        ring->br_entries = 1;
+        while (ring->br_entries < ring->nbufs)
+                ring->br_entries <<= 1;
+
+        ring->br_size = ring->br_entries * sizeof (struct io_uring_buf);
+        ptr = mmap (NULL, ring->br_size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED)
+                return -1;
+        ring->br = ptr;
+
+        reg.ring_addr = (uintptr_t) ring->br;
+        reg.ring_entries = ring->br_entries;
+        reg.bgid = SOCKET_URING_BGID;
+        if (uring_register (ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1))
+                return -1;
+
+        for (i = 0; i < ring->nbufs; i++)
+                __socket_uring_recycle (ring, i);
+
+        return 0;
+}
+
+
+struct socket_uring *
+socket_uring_new (int sock, unsigned nbufs, struct iobuf_pool *iobuf_pool)
+{
+        struct socket_uring    *ring = NULL;
+        struct io_uring_params  params = {0, };
+        int                     error = 0;
+
+        if (!nbufs)
+                nbufs = SOCKET_URING_DEFAULT_BUFFERS;
+        if (nbufs > SOCKET_URING_MAX_BUFFERS)
+                nbufs = SOCKET_URING_MAX_BUFFERS;
+
+        ring = GF_CALLOC (1, sizeof (*ring), gf_sock_mt_uring);
+        if (!ring)
+                return NULL;
+
+        pthread_mutex_init (&ring->lock, NULL);
+        ring->fd = -1;
+        ring->sock = sock;
+        ring->nbufs = nbufs;
+        ring->buf_size = SOCKET_URING_BUFFER_SIZE;
+
+        ring->rx = GF_CALLOC (nbufs, sizeof (*ring->rx), gf_sock_mt_uring);
+        if (!ring->rx) {
+                error = ENOMEM;
+                goto err;
+        }
+
+        ring->fd = uring_setup (SOCKET_URING_ENTRIES, &params);
+        if (ring->fd < 0) {
+                error = errno;
+                goto err;
+        }
+
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+                error = ENOSYS;
+                goto err;
+        }
+
+        if (socket_uring_map (ring, &params) ||
+            socket_uring_buffers (ring, iobuf_pool)) {
+                error = errno;
+                goto err;
+        }
+
+        return ring;
+
+err:
+        if (ring->fd >= 0)
+                sys_close (ring->fd);
+        socket_uring_destroy (ring);
+        errno = error;
+
+        return NULL;
+}
+
+
+/* Whatever was prepared or in flight has to be done with already, and the
+ * ring fd is left to the caller. */
+void
+socket_uring_destroy (struct socket_uring *ring)
+{
+        if (!ring)
+                return;
+
+        if (ring->br)
+                munmap (ring->br, ring->br_size);
+        if (ring->sqes)
+                munmap (ring->sqes, ring->sqes_size);
+        if (ring->ring)
+                munmap (ring->ring, ring->ring_size);
+        if (ring->iobuf)
+                iobuf_unref (ring->iobuf);
+
+        pthread_mutex_destroy (&ring->lock);
+        GF_FREE (ring->rx);
+        GF_FREE (ring);
+}
+
+
+static struct io_uring_sqe *
+__socket_uring_get_sqe (struct socket_uring *ring, socket_uring_op_t op)
+{
+        struct io_uring_sqe *sqe = NULL;
+        unsigned             head = 0;
+        unsigned             tail = 0;
+
+        head = __atomic_load_n (ring->sq_head, __ATOMIC_ACQUIRE);
+        tail = *ring->sq_tail + ring->sq_queued;
+        if (tail - head >= ring->sq_entries) {
+                errno = EBUSY;
+                return NULL;
+        }
+
+        sqe = &ring->sqes[tail & *ring->sq_mask];
+        memset (sqe, 0, sizeof (*sqe));
+        sqe->fd = ring->sock;
+        sqe->user_data = op;
+
+        ring->sq_queued++;
+        ring->inflight++;
+
+        return sqe;
+}
+
+
+/* Returns 1 when a recv was prepared, 0 when there was no need or no room
+ * for it. */
+int
+__socket_uring_arm_recv (struct socket_uring *ring)
+{
+        struct io_uring_sqe *sqe = NULL;
+
+        if (ring->rx_armed || ring->rx_eof || ring->rx_error ||
+            (ring->rx_count == ring->nbufs))
+                return 0;
+
+        sqe = __socket_uring_get_sqe (ring, SOCKET_URING_RECV);
+        if (!sqe)
+                return -1;
+
+        sqe->opcode = IORING_OP_RECV;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = SOCKET_URING_BGID;
+
+        ring->rx_armed = _gf_true;
+
+        return 1;
+}
+
+
+/* @msg, and the vector it points to, have to stay untouched until the send
+ * completes. */
+int
+__socket_uring_prep_sendmsg (struct socket_uring *ring, struct msghdr *msg,
+                             gf_boolean_t link)
+{
+        struct io_uring_sqe *sqe = NULL;
+
+        sqe = __socket_uring_get_sqe (ring, SOCKET_URING_SEND);
+        if (!sqe)
+                return -1;
+
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->addr = (uintptr_t) msg;
+        sqe->len = 1;
+        /* a short send breaks the chain */
+        sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+        if (link)
+                sqe->flags = IOSQE_IO_LINK;
+
+        ring->sends++;
+
+        return 0;
+}
+
+
+int
+__socket_uring_prep_poll (struct socket_uring *ring, short events,
+                          gf_boolean_t link)
+{
+        struct io_uring_sqe *sqe = NULL;
+        uint32_t             mask = (unsigned short) events;
+
+        sqe = __socket_uring_get_sqe (ring, SOCKET_URING_POLL);
+        if (!sqe)
+                return -1;
+
+        sqe->opcode = IORING_OP_POLL_ADD;
+#if __BYTE_ORDER == __BIG_ENDIAN
+        mask = (mask << 16) | (mask >> 16);
+#endif
+        sqe->poll32_events = mask;
+        if (link)
+                sqe->flags = IOSQE_IO_LINK;
+
+        return 0;
+}
+
+
+int
+__socket_uring_prep_nop (struct socket_uring *ring)
+{
+        struct io_uring_sqe *sqe = NULL;
+
+        sqe = __socket_uring_get_sqe (ring, SOCKET_URING_NOP);
+        if (!sqe)
+                return -1;
+
+        sqe->opcode = IORING_OP_NOP;
+        sqe->fd = -1;
+
+        return 0;
+}
+
+
+int
+__socket_uring_prep_cancel (struct socket_uring *ring)
+{
+        struct io_uring_sqe *sqe = NULL;
+
+        sqe = __socket_uring_get_sqe (ring, SOCKET_URING_CANCEL);
+        if (!sqe)
+                return -1;
+
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+
+        return 0;
+}
+
+
+/* Submits everything prepared so far with one system call, and waits for
+ * @wait completions. */
+int
+__socket_uring_submit (struct socket_uring *ring, unsigned wait)
+{
+        unsigned  to_submit = 0;
+        int       ret = 0;
+
+        __atomic_store_n (ring->sq_tail, *ring->sq_tail + ring->sq_queued,
+                          __ATOMIC_RELEASE);
+        ring->sq_queued = 0;
+
+        to_submit = *ring->sq_tail -
+                    __atomic_load_n (ring->sq_head, __ATOMIC_ACQUIRE);
+        if (!to_submit && !wait)
+                return 0;
+
+        do {
+                ret = uring_enter (ring->fd, to_submit, wait,
+                                   wait ? IORING_ENTER_GETEVENTS : 0);
+        } while ((ret < 0) && (errno == EINTR));
+
+        return ret;
+}
+
+
+static void
+__socket_uring_recv_done (struct socket_uring *ring, int res, unsigned flags)
+{
+        struct socket_uring_rx *rx = NULL;
+        unsigned                bid = 0;
+
+        if (flags & IORING_CQE_F_BUFFER) {
+                bid = flags >> IORING_CQE_BUFFER_SHIFT;
+                if (res > 0) {
+                        rx = &ring->rx[(ring->rx_head + ring->rx_count) %
+                                       ring->nbufs];
+                        rx->bid = bid;
+                        rx->len = res;
+                        rx->off = 0;
+                        ring->rx_count++;
+                        ring->rx_bytes += res;
+                } else {
+                        __socket_uring_recycle (ring, bid);
+                }
+        }
+
+        if (res == 0)
+                ring->rx_eof = _gf_true;
+        else if ((res < 0) && (res != -ENOBUFS) && (res != -ECANCELED) &&
+                 !ring->rx_error)
+                ring->rx_error = -res;
+
+        /* out of buffers, or the kernel just chose to stop */
+        if (!(flags & IORING_CQE_F_MORE))
+                ring->rx_armed = _gf_false;
+}
+
+
+/* Consumes all completions available; receives are accounted here, all
+ * the rest is handed to @cbk. Returns how many there were. */
+int
+__socket_uring_reap (struct socket_uring *ring, socket_uring_cbk_t cbk,
+                     void *data)
+{
+        struct io_uring_cqe *cqe = NULL;
+        socket_uring_op_t    op = 0;
+        unsigned             head = 0;
+        unsigned             tail = 0;
+        int                  count = 0;
+
+        head = *ring->cq_head;
+        tail = __atomic_load_n (ring->cq_tail, __ATOMIC_ACQUIRE);
+
+        while (head != tail) {
+                cqe = &ring->cqes[head & *ring->cq_mask];
+                op = cqe->user_data;
+
+                if (!(cqe->flags & IORING_CQE_F_MORE))
+                        ring->inflight--;
+
+                if (op == SOCKET_URING_RECV) {
+                        __socket_uring_recv_done (ring, cqe->res, cqe->flags);
+                } else {
+                        if (op == SOCKET_URING_SEND)
+                                ring->sends--;
+                        if (cbk)
+                                cbk (data, op, cqe->res, cqe->flags);
+                }
+
+                head++;
+                count++;
+
+                if (head == tail)
+                        tail = __atomic_load_n (ring->cq_tail,
+                                                __ATOMIC_ACQUIRE);
+        }
+
+        __atomic_store_n (ring->cq_head, head, __ATOMIC_RELEASE);
+
+        return count;
+}
+
+
+/* Cancels whatever is in flight on the socket and waits for it to be
+ * completed. The socket should be shut down already, so that nothing new
+ * gets started meanwhile. */
+void
+__socket_uring_quiesce (struct socket_uring *ring, socket_uring_cbk_t cbk,
+                        void *data)
+{
+        int ret = 0;
+
+        if (!ring->inflight)
+                return;
+
+        if (__socket_uring_prep_cancel (ring)) {
+                /* no room for it; make some */
+                __socket_uring_submit (ring, 0);
+                __socket_uring_prep_cancel (ring);
+        }
+
+        ret = __socket_uring_submit (ring, 0);
+
+        while ((ret >= 0) && (ring->inflight > 0)) {
+                __socket_uring_reap (ring, cbk, data);
+                if (ring->inflight <= 0)
+                        break;
+
+                ret = __socket_uring_submit (ring, 1);
+        }
+
+        __socket_uring_reap (ring, cbk, data);
+}
+
+
+/* Reads what has been received already. Same return values as readv(),
+ * with EAGAIN when nothing is there yet. */
+ssize_t
+__socket_uring_readv (struct socket_uring *ring, const struct iovec *vector,
+                      int count)
+{
+        struct socket_uring_rx *rx = NULL;
+        size_t                  copied = 0;
+        size_t                  offset = 0;
+        size_t                  size = 0;
+        int                     i = 0;
+
+        while (ring->rx_count && (i < count)) {
+                if (offset == vector[i].iov_len) {
+                        i++;
+                        offset = 0;
+                        continue;
+                }
+
+                rx = &ring->rx[ring->rx_head];
+                size = min (rx->len - rx->off, vector[i].iov_len - offset);
+
+                memcpy ((char *) vector[i].iov_base + offset,
+                        ring->buf_base + rx->bid * ring->buf_size + rx->off,
+                        size);
+
+                rx->off += size;
+                offset += size;
+                copied += size;
+
+                if (rx->off == rx->len) {
+                        __socket_uring_recycle (ring, rx->bid);
+                        ring->rx_head = (ring->rx_head + 1) % ring->nbufs;
+                        ring->rx_count--;
+                }
+        }
+
+        ring->rx_bytes -= copied;
+
+        if (copied)
+                return copied;
+
+        if (ring->rx_error) {
+                errno = ring->rx_error;
+                return -1;
+        }
+
+        if (ring->rx_eof)
+                return 0;
+
+        errno = EAGAIN;
+        return -1;
+}
+
+
+static gf_boolean_t   socket_uring_works;
+static pthread_once_t socket_uring_probe_once = PTHREAD_ONCE_INIT;
+
+/* Everything needed is checked on a socketpair: provided buffer rings and
+ * multishot receives are recent additions to io_uring. */
+static void
+socket_uring_probe (void)
+{
+        struct socket_uring *ring = NULL;
+        int                  pair[2] = {-1, -1};
+        char                 byte = 'u';
+
+        if (socketpair (AF_UNIX, SOCK_STREAM, 0, pair))
+                return;
+
+        ring = socket_uring_new (pair[0], 1, THIS->ctx->iobuf_pool);
+        if (!ring) {
+                gf_log ("socket", GF_LOG_DEBUG, "io_uring setup failed (%s)",
+                        strerror (errno));
+                goto out;
+        }
+
+        if (sys_write (pair[1], &byte, 1) != 1)
+                goto out;
+
+        if ((__socket_uring_arm_recv (ring) != 1) ||
+            (__socket_uring_submit (ring, 1) < 0))
+                goto out;
+
+        __socket_uring_reap (ring, NULL, NULL);
+        socket_uring_works = (ring->rx_bytes == 1);
+        if (!socket_uring_works)
+                gf_log ("socket", GF_LOG_DEBUG, "multishot recv failed (%s)",
+                        strerror (ring->rx_error));
+
+        shutdown (pair[0], SHUT_RDWR);
+        __socket_uring_quiesce (ring, NULL, NULL);
+
+out:
+        if (ring) {
+                sys_close (ring->fd);
+                socket_uring_destroy (ring);
+        }
+        sys_close (pair[0]);
+        sys_close (pair[1]);
+}
+
+
+gf_boolean_t
+socket_uring_supported (void)
+{
+        pthread_once (&socket_uring_probe_once, socket_uring_probe);
+
+        return socket_uring_works;
+}
+
+#else /* !HAVE_IO_URING */
+
+gf_boolean_t
+socket_uring_supported (void)
+{
+        return _gf_false;
+}
+
+struct socket_uring *
+socket_uring_new (int sock, unsigned nbufs, struct iobuf_pool *iobuf_pool)
+{
+        errno = ENOSYS;
+        return NULL;
+}
+
+void
+socket_uring_destroy (struct socket_uring *ring)
+{
+}
+
+int
+__socket_uring_arm_recv (struct socket_uring *ring)
+{
+        return 0;
+}
+
+int
+__socket_uring_prep_sendmsg (struct socket_uring *ring, struct msghdr *msg,
+                             gf_boolean_t link)
+{
+        errno = ENOSYS;
+        return -1;
+}
+
+int
+__socket_uring_prep_poll (struct socket_uring *ring, short events,
+                          gf_boolean_t link)
+{
+        errno = ENOSYS;
+        return -1;
+}
+
+int
+__socket_uring_prep_nop (struct socket_uring *ring)
+{
+        errno = ENOSYS;
+        return -1;
+}
+
+int
+__socket_uring_prep_cancel (struct socket_uring *ring)
+{
+        errno = ENOSYS;
+        return -1;
+}
+
+int
+__socket_uring_submit (struct socket_uring *ring, unsigned wait)
+{
+        errno = ENOSYS;
+        return -1;
+}
+
+int
+__socket_uring_reap (struct socket_uring *ring, socket_uring_cbk_t cbk,
+                     void *data)
+{
+        return 0;
+}
+
+void
+__socket_uring_quiesce (struct socket_uring *ring, socket_uring_cbk_t cbk,
+                        void *data)
+{
+}
+
+ssize_t
+__socket_uring_readv (struct socket_uring *ring, const struct iovec *vector,
+                      int count)
+{
+        errno = ENOSYS;
+        return -1;
+}
+
+#endif /* HAVE_IO_URING */
@@ -0,0 +1,142 @@
+/*
+  Copyright (c) 2018 Red Hat, Inc. <http://www.redhat.com>
+  This file is part of GlusterFS.
+
+  This file is licensed to you under your choice of the GNU Lesser
+  General Public License, version 3 or any later version (LGPLv3 or
+  later), or the GNU General Public License, version 2 (GPLv2), in all
+  cases as published by the Free Software Foundation.
+*/
+
+#ifndef _SOCKET_URING_H
+#define _SOCKET_URING_H
+
+/*
+ * io_uring support of the socket transport.
+ *
+ * A connection in io_uring mode owns a ring. Data is received by a single
+ * multishot recv into buffers provided from one iobuf, and is then read by
+ * the usual socket state machine from there. Queued messages are sent as a
+ * chain of linked sendmsg requests. It is the ring fd, not the socket, that
+ * is registered with the event layer: it becomes readable when completions
+ * are pending.
+ *
+ * Functions starting with "__" expect ring->lock to be held.
+ */
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <pthread.h>
+
+#include "iobuf.h"
+
+#define SOCKET_URING_ENTRIES          64
+/* longest chain of linked sends */
+#define SOCKET_URING_MAX_SENDS        32
+#define SOCKET_URING_DEFAULT_BUFFERS  8
+#define SOCKET_URING_MAX_BUFFERS      64
+#define SOCKET_URING_BUFFER_SIZE      (16 * GF_UNIT_KB)
+
+/* what a completion was for */
+typedef enum {
+        SOCKET_URING_RECV = 1,
+        SOCKET_URING_SEND,
+        SOCKET_URING_POLL,
+        SOCKET_URING_NOP,
+        SOCKET_URING_CANCEL,
+} socket_uring_op_t;
+
+struct socket_uring_rx {
+        uint16_t  bid;
+        uint32_t  len;
+        uint32_t  off;
+};
+
+struct socket_uring {
+        pthread_mutex_t         lock;
+        int                     fd;
+        int                     sock;
+
+        void                   *ring;
+        size_t                  ring_size;
+        unsigned               *sq_head;
+        unsigned               *sq_tail;
+        unsigned               *sq_mask;
+        unsigned               *sq_array;
+        unsigned                sq_entries;
+        struct io_uring_sqe    *sqes;
+        size_t                  sqes_size;
+        unsigned                sq_queued;  /* prepared, not yet submitted */
+        unsigned               *cq_head;
+        unsigned               *cq_tail;
+        unsigned               *cq_mask;
+        struct io_uring_cqe    *cqes;
+
+        /* provided buffers */
+        struct io_uring_buf_ring *br;
+        size_t                  br_size;
+        unsigned                br_entries;
+        struct iobuf           *iobuf;
+        char                   *buf_base;
+        unsigned                buf_size;
+        unsigned                nbufs;
+
+        /* received data not read yet, in order */
+        struct socket_uring_rx *rx;
+        unsigned                rx_head;
+        unsigned                rx_count;
+        size_t                  rx_bytes;
+        gf_boolean_t            rx_armed;
+        gf_boolean_t            rx_eof;
+        int                     rx_error;
+
+        /* requests which will still complete */
+        int                     inflight;
+        int                     sends;
+};
+
+typedef void (*socket_uring_cbk_t) (void *data, socket_uring_op_t op,
+                                    int res, unsigned flags);
+
+gf_boolean_t
+socket_uring_supported (void);
+
+struct socket_uring *
+socket_uring_new (int sock, unsigned nbufs, struct iobuf_pool *iobuf_pool);
+
+void
+socket_uring_destroy (struct socket_uring *ring);
+
+int
+__socket_uring_arm_recv (struct socket_uring *ring);
+
+int
+__socket_uring_prep_sendmsg (struct socket_uring *ring, struct msghdr *msg,
+                             gf_boolean_t link);
+
+int
+__socket_uring_prep_poll (struct socket_uring *ring, short events,
+                          gf_boolean_t link);
+
+int
+__socket_uring_prep_nop (struct socket_uring *ring);
+
+int
+__socket_uring_prep_cancel (struct socket_uring *ring);
+
+int
+__socket_uring_submit (struct socket_uring *ring, unsigned wait);
+
+int
+__socket_uring_reap (struct socket_uring *ring, socket_uring_cbk_t cbk,
+                     void *data);
+
+void
+__socket_uring_quiesce (struct socket_uring *ring, socket_uring_cbk_t cbk,
+                        void *data);
+
+ssize_t
+__socket_uring_readv (struct socket_uring *ring, const struct iovec *vector,
+                      int count);
+
+#endif /* _SOCKET_URING_H */
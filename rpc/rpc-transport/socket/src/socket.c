@@ -19,6 +19,7 @@
 #include "common-utils.h"
 #include "compat-errno.h"
 #include "socket-mem-types.h"
+#include "socket-uring.h"
 #include "timer.h"
 
 /* ugly #includes below */
@@ -51,7 +52,10 @@
 #define SSL_DH_PARAM_OPT    "transport.socket.ssl-dh-param"
 #define SSL_EC_CURVE_OPT    "transport.socket.ssl-ec-curve"
 #define SSL_CRL_PATH_OPT    "transport.socket.ssl-crl-path"
+#define SSL_KTLS_OPT        "transport.socket.ssl-ktls"
 #define OWN_THREAD_OPT      "transport.socket.own-thread"
+#define IO_URING_OPT        "transport.socket.io-uring"
+#define IO_URING_BUFS_OPT   "transport.socket.io-uring-buffers"
 
 /* TBD: do automake substitutions etc. (ick) to set these. */
 #if !defined(DEFAULT_ETC_SSL)
@@ -295,6 +299,37 @@ out:
 #define ssl_read_one(t, b, l)  ssl_do((t), (b), (l), (SSL_trinary_func *)SSL_read)
 #define ssl_write_one(t, b, l) ssl_do((t), (b), (l), (SSL_trinary_func *)SSL_write)
 
+/*
+ * With SSL_OP_ENABLE_KTLS, OpenSSL hands the keys of the session to the
+ * kernel (TCP_ULP "tls") at the end of the handshake, where the kernel and
+ * the negotiated cipher allow it. When that happened for both directions,
+ * the records are sealed and opened by the kernel and the connection can
+ * be read and written like a plain one; otherwise OpenSSL keeps doing it.
+ */
+static void
+ssl_setup_ktls (rpc_transport_t *this)
+{
+        socket_private_t *priv = this->private;
+
+        priv->ssl_ktls = _gf_false;
+
+        if (!priv->ssl_ktls_enabled)
+                return;
+
+#ifdef SSL_OP_ENABLE_KTLS
+        if (BIO_get_ktls_send (SSL_get_wbio (priv->ssl_ssl)) &&
+            BIO_get_ktls_recv (SSL_get_rbio (priv->ssl_ssl)) &&
+            !SSL_has_pending (priv->ssl_ssl))
+                priv->ssl_ktls = _gf_true;
+#endif
+
+        gf_log (this->name, GF_LOG_INFO, "%s with %s is %s by the kernel",
+                SSL_get_version (priv->ssl_ssl),
+                SSL_get_cipher_name (priv->ssl_ssl),
+                priv->ssl_ktls ? "handled" : "not handled");
+}
+
+
 static char *
 ssl_setup_connection (rpc_transport_t *this, int server)
 {
@@ -331,6 +366,8 @@ ssl_setup_connection (rpc_transport_t *this, int server)
                 goto ssl_error;
         }
 
+        ssl_setup_ktls (this);
+
         /* Make sure _SSL verification_ succeeded, yielding an identity. */
         if (SSL_get_verify_result(priv->ssl_ssl) != X509_V_OK) {
                 goto ssl_error;
@@ -374,6 +411,7 @@ ssl_teardown_connection (socket_private_t *priv)
                 priv->ssl_ssl = NULL;
         }
         priv->use_ssl = _gf_false;
+        priv->ssl_ktls = _gf_false;
 }
 
 
@@ -387,8 +425,15 @@ __socket_ssl_readv (rpc_transport_t *this, struct iovec *opvector, int opcount)
         priv = this->private;
         sock = priv->sock;
 
-        if (priv->use_ssl) {
+        if (priv->use_ssl && !priv->ssl_ktls) {
                 ret = ssl_read_one (this, opvector->iov_base, opvector->iov_len);
+        } else if (priv->uring) {
+                pthread_mutex_lock (&priv->uring->lock);
+                {
+                        ret = __socket_uring_readv (priv->uring, opvector,
+                                                    opcount);
+                }
+                pthread_mutex_unlock (&priv->uring->lock);
         } else {
                 ret = sys_readv (sock, opvector, IOV_MIN(opcount));
         }
@@ -503,7 +548,7 @@ __does_socket_rwv_error_need_logging (socket_private_t *priv, int write)
 static int
 __socket_rwv (rpc_transport_t *this, struct iovec *vector, int count,
               struct iovec **pending_vector, int *pending_count, size_t *bytes,
-              int write)
+              int write, int flags)
 {
         socket_private_t *priv = NULL;
         int               sock = -1;
@@ -511,6 +556,7 @@ __socket_rwv (rpc_transport_t *this, struct iovec *vector, int count,
         struct iovec     *opvector = NULL;
         int               opcount = 0;
         int               moved = 0;
+        struct msghdr     msg = {0, };
 
         GF_VALIDATE_OR_GOTO ("socket", this, out);
         GF_VALIDATE_OR_GOTO ("socket", this->private, out);
@@ -542,12 +588,17 @@ __socket_rwv (rpc_transport_t *this, struct iovec *vector, int count,
                          */
                         ret = -1;
                 } else if (write) {
-                        if (priv->use_ssl) {
+                        if (priv->use_ssl && !priv->ssl_ktls) {
                                 ret = ssl_write_one (this, opvector->iov_base,
                                                      opvector->iov_len);
+                        } else if (flags) {
+                                msg.msg_iov = opvector;
+                                msg.msg_iovlen = IOV_MIN(opcount);
+                                ret = sendmsg (sock, &msg, flags);
                         } else {
                                 ret = sys_writev (sock, opvector, IOV_MIN(opcount));
                         }
+                        this->total_write_calls++;
 
                         if (ret == 0 || (ret == -1 && errno == EAGAIN)) {
                                 /* done for now */
@@ -650,7 +701,7 @@ __socket_readv (rpc_transport_t *this, struct iovec *vector, int count,
         int ret = -1;
 
         ret = __socket_rwv (this, vector, count,
-                            pending_vector, pending_count, bytes, 0);
+                            pending_vector, pending_count, bytes, 0, 0);
 
         return ret;
 }
@@ -658,12 +709,13 @@ __socket_readv (rpc_transport_t *this, struct iovec *vector, int count,
 
 static int
 __socket_writev (rpc_transport_t *this, struct iovec *vector, int count,
-                 struct iovec **pending_vector, int *pending_count)
+                 struct iovec **pending_vector, int *pending_count,
+                 size_t *bytes, int flags)
 {
         int ret = -1;
 
         ret = __socket_rwv (this, vector, count,
-                            pending_vector, pending_count, NULL, 1);
+                            pending_vector, pending_count, bytes, 1, flags);
 
         return ret;
 }
@@ -943,6 +995,8 @@ __socket_connect_finish (int fd)
 }
 
 
+static void __socket_uring_release (rpc_transport_t *this);
+
 static void
 __socket_reset (rpc_transport_t *this)
 {
@@ -969,7 +1023,14 @@ __socket_reset (rpc_transport_t *this)
 
         memset (&priv->incoming, 0, sizeof (priv->incoming));
 
-        event_unregister_close (this->ctx->event_pool, priv->sock, priv->idx);
+        if (priv->uring) {
+                /* only the ring fd is known to the event layer */
+                __socket_uring_release (this);
+                sys_close (priv->sock);
+        } else {
+                event_unregister_close (this->ctx->event_pool, priv->sock,
+                                        priv->idx);
+        }
 
         priv->sock = -1;
         priv->idx = -1;
@@ -1085,6 +1146,239 @@ out:
 }
 
 
+/* What the completions on the ring of a connection amount to, as events
+ * for socket_event_handler(). */
+struct socket_uring_events {
+        rpc_transport_t *this;
+        int              poll_out;
+        int              poll_err;
+};
+
+
+/* Accounts @bytes of @entry as written. Returns what is left to write. */
+static size_t
+__socket_ioq_entry_advance (struct ioq *entry, size_t bytes)
+{
+        struct iovec *iov = NULL;
+
+        while (bytes && entry->pending_count) {
+                iov = entry->pending_vector;
+                if (bytes >= iov->iov_len) {
+                        bytes -= iov->iov_len;
+                        entry->pending_vector++;
+                        entry->pending_count--;
+                } else {
+                        iov->iov_base += bytes;
+                        iov->iov_len -= bytes;
+                        bytes = 0;
+                }
+        }
+
+        return iov_length (entry->pending_vector, entry->pending_count);
+}
+
+
+static void
+__socket_uring_complete (void *data, socket_uring_op_t op, int res,
+                         unsigned flags)
+{
+        struct socket_uring_events *events = data;
+        rpc_transport_t            *this = events->this;
+        socket_private_t           *priv = this->private;
+        struct ioq                 *entry = NULL;
+
+        switch (op) {
+        case SOCKET_URING_SEND:
+                /* sends complete in the order they were queued in: this
+                 * is always about the first entry */
+                if (list_empty (&priv->ioq))
+                        break;
+                entry = priv->ioq_next;
+
+                if (res > 0) {
+                        this->total_bytes_write += res;
+                        if (!__socket_ioq_entry_advance (entry, res))
+                                __socket_ioq_entry_free (entry);
+                        events->poll_out = 1;
+                } else if ((res == 0) || (res == -EAGAIN)) {
+                        /* wait for POLLOUT before the next attempt */
+                        priv->uring_tx_wait = _gf_true;
+                } else if (res != -ECANCELED) {
+                        if (__does_socket_rwv_error_need_logging (priv, 1)) {
+                                GF_LOG_OCCASIONALLY (priv->log_ctr, this->name,
+                                                     GF_LOG_WARNING,
+                                                     "sendmsg on %s failed "
+                                                     "(%s)",
+                                                     this->peerinfo.identifier,
+                                                     strerror (-res));
+                        }
+                        events->poll_err = 1;
+                }
+                break;
+        case SOCKET_URING_POLL:
+                if (priv->connected == 0) {
+                        /* connect() is over, one way or another */
+                        events->poll_out = 1;
+                        if ((res < 0) || (res & (POLLERR | POLLHUP)))
+                                events->poll_err = 1;
+                }
+                break;
+        default:
+                break;
+        }
+}
+
+
+/* Sends the queued entries as one chain of linked sends. Entries queued
+ * while a chain is in flight go out with the next one. */
+static int
+__socket_uring_churn (rpc_transport_t *this)
+{
+        socket_private_t    *priv = NULL;
+        struct socket_uring *ring = NULL;
+        struct ioq          *entry = NULL;
+        gf_boolean_t         link = _gf_false;
+        int                  count = 0;
+        int                  ret = 0;
+
+        priv = this->private;
+        ring = priv->uring;
+
+        pthread_mutex_lock (&ring->lock);
+        {
+                if (ring->sends || list_empty (&priv->ioq))
+                        goto unlock;
+
+                if (priv->uring_tx_wait) {
+                        ret = __socket_uring_prep_poll (ring, POLLOUT,
+                                                        _gf_true);
+                        if (ret)
+                                goto unlock;
+                        priv->uring_tx_wait = _gf_false;
+                }
+
+                list_for_each_entry (entry, &priv->ioq, list) {
+                        entry->msg.msg_iov = entry->pending_vector;
+                        entry->msg.msg_iovlen = entry->pending_count;
+
+                        count++;
+                        link = ((count < SOCKET_URING_MAX_SENDS) &&
+                                (entry->list.next != &priv->ioq));
+
+                        ret = __socket_uring_prep_sendmsg (ring, &entry->msg,
+                                                           link);
+                        if (ret || !link)
+                                break;
+                }
+
+                if (__socket_uring_submit (ring, 0) < 0) {
+                        ret = -1;
+                        goto unlock;
+                }
+
+                this->total_write_calls++;
+                if (count > 1)
+                        this->total_writes_saved += count - 1;
+        }
+unlock:
+        pthread_mutex_unlock (&ring->lock);
+
+        return ret;
+}
+
+
+/* Sets up the ring of a new connection, which is left to use epoll when
+ * that fails. A client waits for connect() to complete through the ring,
+ * a server starts receiving right away. */
+static void
+__socket_uring_start (rpc_transport_t *this)
+{
+        socket_private_t    *priv = NULL;
+        struct socket_uring *ring = NULL;
+        int                  ret = -1;
+
+        priv = this->private;
+
+        if (!priv->use_uring || priv->use_ssl)
+                return;
+
+        ring = socket_uring_new (priv->sock, priv->uring_buffers,
+                                 this->ctx->iobuf_pool);
+        if (!ring) {
+                gf_log (this->name, GF_LOG_WARNING,
+                        "could not set up io_uring (%s), using epoll",
+                        strerror (errno));
+                return;
+        }
+
+        pthread_mutex_lock (&ring->lock);
+        {
+                if (priv->connected == 1)
+                        ret = __socket_uring_arm_recv (ring);
+                else
+                        ret = __socket_uring_prep_poll (ring, POLLOUT,
+                                                        _gf_false);
+                if (ret >= 0)
+                        ret = __socket_uring_submit (ring, 0);
+        }
+        pthread_mutex_unlock (&ring->lock);
+
+        if (ret < 0) {
+                gf_log (this->name, GF_LOG_WARNING,
+                        "io_uring submission failed (%s), using epoll",
+                        strerror (errno));
+                sys_close (ring->fd);
+                socket_uring_destroy (ring);
+                return;
+        }
+
+        priv->uring = ring;
+        priv->uring_throttled = _gf_false;
+        priv->uring_tx_wait = _gf_false;
+}
+
+
+/* Shuts the socket down and waits for everything in flight on it. Queued
+ * entries may not be freed before: the kernel could still be sending them. */
+static void
+__socket_uring_stop (rpc_transport_t *this)
+{
+        socket_private_t           *priv = this->private;
+        struct socket_uring_events  events = {this, };
+
+        if (!priv->uring)
+                return;
+
+        __socket_shutdown (this);
+
+        pthread_mutex_lock (&priv->uring->lock);
+        {
+                __socket_uring_quiesce (priv->uring, __socket_uring_complete,
+                                        &events);
+        }
+        pthread_mutex_unlock (&priv->uring->lock);
+}
+
+
+/* The socket itself is left open */
+static void
+__socket_uring_release (rpc_transport_t *this)
+{
+        socket_private_t *priv = this->private;
+
+        __socket_uring_stop (this);
+
+        if (priv->idx != -1)
+                event_unregister_close (this->ctx->event_pool,
+                                        priv->uring->fd, priv->idx);
+        else
+                sys_close (priv->uring->fd);
+
+        socket_uring_destroy (priv->uring);
+        priv->uring = NULL;
+}
+
+
 static void
 __socket_ioq_flush (rpc_transport_t *this)
 {
@@ -1096,6 +1390,8 @@ __socket_ioq_flush (rpc_transport_t *this)
 
         priv = this->private;
 
+        __socket_uring_stop (this);
+
         while (!list_empty (&priv->ioq)) {
                 entry = priv->ioq_next;
                 __socket_ioq_entry_free (entry);
@@ -1106,36 +1402,119 @@ out:
 }
 
 
+static void
+__socket_ioq_entry_written (rpc_transport_t *this, struct ioq *entry,
+                            int direct)
+{
+        socket_private_t *priv = NULL;
+        char              a_byte = 0;
+
+        __socket_ioq_entry_free (entry);
+        priv = this->private;
+        if (priv->own_thread) {
+                /*
+                 * The pipe should only remain readable if there are
+                 * more entries after this, so drain the byte
+                 * representing this entry.
+                 */
+                if (!direct && sys_read (priv->pipe[0], &a_byte, 1) < 1) {
+                        gf_log(this->name, GF_LOG_WARNING,
+                               "read error on pipe");
+                }
+        }
+}
+
+
 static int
 __socket_ioq_churn_entry (rpc_transport_t *this, struct ioq *entry, int direct)
 {
         int               ret = -1;
-        socket_private_t *priv = NULL;
-        char              a_byte = 0;
 
         ret = __socket_writev (this, entry->pending_vector,
                                entry->pending_count,
                                &entry->pending_vector,
-                               &entry->pending_count);
+                               &entry->pending_count, NULL, 0);
 
         if (ret == 0) {
                 /* current entry was completely written */
                 GF_ASSERT (entry->pending_count == 0);
-                __socket_ioq_entry_free (entry);
-                priv = this->private;
-                if (priv->own_thread) {
-                        /*
-                         * The pipe should only remain readable if there are
-                         * more entries after this, so drain the byte
-                         * representing this entry.
-                         */
-                        if (!direct && sys_read (priv->pipe[0], &a_byte, 1) < 1) {
-                                gf_log(this->name, GF_LOG_WARNING,
-                                       "read error on pipe");
-                        }
+                __socket_ioq_entry_written (this, entry, direct);
+        }
+
+        return ret;
+}
+
+
+/* Writes as many entries from the head of the queue as fit in the limits
+ * of a batch with a single writev, instead of one per entry. When entries
+ * are left behind, the kernel is told more is coming (MSG_MORE), so that
+ * the tail of the batch is not sent in a short segment of its own.
+ * Returns like __socket_ioq_churn_entry(). */
+static int
+__socket_ioq_churn_batch (rpc_transport_t *this)
+{
+        socket_private_t *priv = NULL;
+        struct iovec      vector[GF_SOCKET_WRITE_BATCH_IOVEC];
+        struct iovec     *pending_vector = NULL;
+        int               pending_count = 0;
+        struct ioq       *entry = NULL;
+        struct ioq       *tmp = NULL;
+        int               count = 0;
+        int               entries = 0;
+        int               written = 0;
+        int               flags = 0;
+        size_t            size = 0;
+        size_t            bytes = 0;
+        size_t            len = 0;
+        uint64_t          calls = 0;
+        int               ret = -1;
+
+        priv = this->private;
+
+        list_for_each_entry (entry, &priv->ioq, list) {
+                if (entries &&
+                    ((count + entry->pending_count >
+                      GF_SOCKET_WRITE_BATCH_IOVEC) ||
+                     (size >= GF_SOCKET_WRITE_BATCH_BYTES))) {
+                        if (this->peerinfo.sockaddr.ss_family != AF_UNIX)
+                                flags = MSG_MORE;
+                        break;
                 }
+
+                memcpy (&vector[count], entry->pending_vector,
+                        entry->pending_count * sizeof (*vector));
+                count += entry->pending_count;
+                size += iov_length (entry->pending_vector,
+                                    entry->pending_count);
+                entries++;
+        }
+
+        if (entries == 1)
+                return __socket_ioq_churn_entry (this, priv->ioq_next, 0);
+
+        calls = this->total_write_calls;
+
+        ret = __socket_writev (this, vector, count, &pending_vector,
+                               &pending_count, &bytes, flags);
+
+        list_for_each_entry_safe (entry, tmp, &priv->ioq, list) {
+                if (written == entries)
+                        break;
+
+                len = iov_length (entry->pending_vector,
+                                  entry->pending_count);
+                if (__socket_ioq_entry_advance (entry, min (bytes, len)))
+                        break;
+
+                bytes -= len;
+                __socket_ioq_entry_written (this, entry, 0);
+                written++;
         }
 
+        calls = this->total_write_calls - calls;
+        if (written > calls)
+                this->total_writes_saved += written - calls;
+
         return ret;
 }
 
@@ -1152,11 +1531,21 @@ __socket_ioq_churn (rpc_transport_t *this)
 
         priv = this->private;
 
+        if (priv->uring) {
+                ret = __socket_uring_churn (this);
+                goto out;
+        }
+
         while (!list_empty (&priv->ioq)) {
-                /* pick next entry */
-                entry = priv->ioq_next;
+                /* SSL writes a vector at a time anyway */
+                if (!priv->use_ssl || priv->ssl_ktls) {
+                        ret = __socket_ioq_churn_batch (this);
+                } else {
+                        /* pick next entry */
+                        entry = priv->ioq_next;
 
-                ret = __socket_ioq_churn_entry (this, entry, 0);
+                        ret = __socket_ioq_churn_entry (this, entry, 0);
+                }
 
                 if (ret != 0)
                         break;
@@ -1334,6 +1723,28 @@ __socket_read_simple_request (rpc_transport_t *this)
 #define rpc_progver_addr(buf) (buf + RPC_MSGTYPE_SIZE + 8)
 #define rpc_procnum_addr(buf) (buf + RPC_MSGTYPE_SIZE + 12)
 
+/* The payload of a vectored request (the data of a WRITE) is read into an
+ * iobuf of its own, which goes down the graph as it is. It is placed at
+ * the start of a page, so that posix can write it with O_DIRECT without
+ * copying it. Iobufs from the arenas of page sized classes and up already
+ * are, only larger ones need to be aligned on purpose.
+ */
+static struct iobuf *
+__socket_payload_iobuf (rpc_transport_t *this, size_t size)
+{
+        struct iobuf *iobuf = NULL;
+
+        iobuf = iobuf_get2 (this->ctx->iobuf_pool, size);
+        if (!iobuf || (size < GF_SOCKET_PAYLOAD_ALIGN) ||
+            !((unsigned long)iobuf_ptr (iobuf) & (GF_SOCKET_PAYLOAD_ALIGN - 1)))
+                return iobuf;
+
+        iobuf_unref (iobuf);
+
+        return iobuf_get_page_aligned (this->ctx->iobuf_pool, size,
+                                       GF_SOCKET_PAYLOAD_ALIGN);
+}
+
 static int
 __socket_read_vectored_request (rpc_transport_t *this, rpcsvc_vector_sizer vector_sizer)
 {
@@ -1455,7 +1866,7 @@ sp_state_read_proghdr_xdata:
                 if (in->payload_vector.iov_base == NULL) {
 
                         size = RPC_FRAGSIZE (in->fraghdr) - frag->bytes_read;
-                        iobuf = iobuf_get2 (this->ctx->iobuf_pool, size);
+                        iobuf = __socket_payload_iobuf (this, size);
                         if (!iobuf) {
                                 ret = -1;
                                 break;
@@ -2453,8 +2864,9 @@ socket_event_poll_in (rpc_transport_t *this, gf_boolean_t notify_handled)
 
 
         if (notify_handled && (ret != -1))
-                event_handled (ctx->event_pool, priv->sock, priv->idx,
-                               priv->gen);
+                event_handled (ctx->event_pool,
+                               priv->uring ? priv->uring->fd : priv->sock,
+                               priv->idx, priv->gen);
 
         if (pollin) {
                 priv->ot_state = OT_CALLBACK;
@@ -2637,6 +3049,121 @@ out:
         return ret;
 }
 
+/* Handler of the ring fd of a connection in io_uring mode. The completions
+ * are turned into the events socket_event_handler() deals with. */
+static int
+socket_uring_event_handler (int fd, int idx, int gen, void *data,
+                            int poll_in, int poll_out, int poll_err)
+{
+        rpc_transport_t            *this          = NULL;
+        socket_private_t           *priv          = NULL;
+        struct socket_uring        *ring          = NULL;
+        struct socket_uring_events  events        = {0, };
+        gf_boolean_t                socket_closed = _gf_false;
+        gf_boolean_t                stale         = _gf_true;
+        size_t                      pending       = 0;
+        size_t                      left          = 0;
+        int                         ret           = -1;
+
+        this = data;
+
+        GF_VALIDATE_OR_GOTO ("socket", this, out);
+        GF_VALIDATE_OR_GOTO ("socket", this->private, out);
+
+        priv = this->private;
+        events.this = this;
+
+        pthread_mutex_lock (&priv->out_lock);
+        {
+                ring = priv->uring;
+                if (ring && (ring->fd == fd)) {
+                        stale = _gf_false;
+
+                        pthread_mutex_lock (&ring->lock);
+                        {
+                                __socket_uring_reap (ring,
+                                                     __socket_uring_complete,
+                                                     &events);
+
+                                poll_in = (!priv->uring_throttled &&
+                                           (ring->rx_bytes || ring->rx_eof ||
+                                            ring->rx_error));
+                                if ((priv->connected == 1) && !ring->sends &&
+                                    !list_empty (&priv->ioq))
+                                        events.poll_out = 1;
+                        }
+                        pthread_mutex_unlock (&ring->lock);
+                }
+        }
+        pthread_mutex_unlock (&priv->out_lock);
+
+        /* the connection was reset meanwhile */
+        if (stale)
+                goto out;
+
+        /* keep the transport around for the rest of the received data */
+        rpc_transport_ref (this);
+
+        ret = socket_event_handler (fd, idx, gen, this, poll_in,
+                                    events.poll_out,
+                                    (poll_err || events.poll_err));
+        if ((ret < 0) || poll_err || events.poll_err)
+                goto unref;
+
+        /* only one message is read per socket_event_handler() */
+        for (;;) {
+                pthread_mutex_lock (&priv->in_lock);
+                {
+                        ring = priv->uring;
+                        if (ring && !priv->uring_throttled) {
+                                pthread_mutex_lock (&ring->lock);
+                                {
+                                        pending = ring->rx_bytes;
+                                }
+                                pthread_mutex_unlock (&ring->lock);
+                        } else {
+                                pending = 0;
+                        }
+                }
+                pthread_mutex_unlock (&priv->in_lock);
+
+                if (!pending || (pending == left))
+                        break;
+                left = pending;
+
+                ret = socket_event_poll_in (this, _gf_false);
+                if (ret < 0) {
+                        socket_closed = socket_event_poll_err (this, gen, idx);
+                        if (socket_closed)
+                                rpc_transport_unref (this);
+                        goto unref;
+                }
+        }
+
+        /* buffers were given back, receive more */
+        pthread_mutex_lock (&priv->out_lock);
+        {
+                ring = priv->uring;
+                if (ring && (priv->connected == 1)) {
+                        pthread_mutex_lock (&ring->lock);
+                        {
+                                if ((__socket_uring_arm_recv (ring) < 0) ||
+                                    (__socket_uring_submit (ring, 0) < 0))
+                                        gf_log (this->name, GF_LOG_WARNING,
+                                                "could not re-arm recv (%s)",
+                                                strerror (errno));
+                        }
+                        pthread_mutex_unlock (&ring->lock);
+                }
+        }
+        pthread_mutex_unlock (&priv->out_lock);
+
+unref:
+        rpc_transport_unref (this);
+out:
+        return ret;
+}
+
 static int poll_err_cnt;
 static void *
 socket_poller (void *ctx)
@@ -3001,8 +3528,11 @@ socket_server_event_handler (int fd, int idx, int gen, void *data,
 
                 new_priv->sock = new_sock;
                 new_priv->own_thread = priv->own_thread;
+                new_priv->use_uring = priv->use_uring;
+                new_priv->uring_buffers = priv->uring_buffers;
 
                 new_priv->ssl_ctx = priv->ssl_ctx;
+                new_priv->ssl_ktls_enabled = priv->ssl_ktls_enabled;
                 if (new_priv->use_ssl && !new_priv->own_thread) {
                         cname = ssl_setup_connection(new_trans, 1);
                         if (!cname) {
@@ -3070,17 +3600,28 @@ socket_server_event_handler (int fd, int idx, int gen, void *data,
                         ret = rpc_transport_notify (this, RPC_TRANSPORT_ACCEPT, new_trans);
 
                         if (ret != -1) {
-                                new_priv->idx =
-                                        event_register (ctx->event_pool,
-                                                        new_sock,
-                                                        socket_event_handler,
-                                                        new_trans,
-                                                        1, 0);
+                                __socket_uring_start (new_trans);
+                                if (new_priv->uring)
+                                        new_priv->idx =
+                                                event_register (ctx->event_pool,
+                                                                new_priv->uring->fd,
+                                                                socket_uring_event_handler,
+                                                                new_trans,
+                                                                1, 0);
+                                else
+                                        new_priv->idx =
+                                                event_register (ctx->event_pool,
+                                                                new_sock,
+                                                                socket_event_handler,
+                                                                new_trans,
+                                                                1, 0);
                                 if (new_priv->idx == -1) {
                                         ret = -1;
                                         gf_log(this->name, GF_LOG_ERROR,
                                                "failed to register the socket "
                                                "with event");
+                                        if (new_priv->uring)
+                                                __socket_uring_release (new_trans);
 
                                         /* event_register() could have failed for some
                                          * reason, implying that the new_sock cannot be
@@ -3538,12 +4079,22 @@ handler:
                                 priv->sock = -1;
                         }
                 } else {
-                        priv->idx = event_register (ctx->event_pool, priv->sock,
-                                                    socket_event_handler,
-                                                    this, 1, 1);
+                        __socket_uring_start (this);
+                        if (priv->uring)
+                                priv->idx = event_register (ctx->event_pool,
+                                                            priv->uring->fd,
+                                                            socket_uring_event_handler,
+                                                            this, 1, 0);
+                        else
+                                priv->idx = event_register (ctx->event_pool,
+                                                            priv->sock,
+                                                            socket_event_handler,
+                                                            this, 1, 1);
                         if (priv->idx == -1) {
                                 gf_log ("", GF_LOG_WARNING,
                                         "failed to register the event");
+                                if (priv->uring)
+                                        __socket_uring_release (this);
                                 sys_close (priv->sock);
                                 priv->sock = -1;
                                 ret = -1;
@@ -3771,7 +4322,7 @@ socket_submit_request (rpc_transport_t *this, rpc_transport_req_t *req)
                 if (!entry)
                         goto unlock;
 
-                if (list_empty (&priv->ioq)) {
+                if (list_empty (&priv->ioq) && !priv->uring) {
                         ret = __socket_ioq_churn_entry (this, entry, 1);
 
                         if (ret == 0) {
@@ -3794,6 +4345,8 @@ socket_submit_request (rpc_transport_t *this, rpc_transport_req_t *req)
                                                "write error on pipe");
                                 }
                         }
+                        if (priv->uring && (__socket_ioq_churn (this) == -1))
+                                __socket_disconnect (this);
                         ret = 0;
                 }
                 if (!priv->own_thread && need_poll_out) {
@@ -3845,7 +4398,7 @@ socket_submit_reply (rpc_transport_t *this, rpc_transport_reply_t *reply)
                 if (!entry)
                         goto unlock;
 
-                if (list_empty (&priv->ioq)) {
+                if (list_empty (&priv->ioq) && !priv->uring) {
                         ret = __socket_ioq_churn_entry (this, entry, 1);
 
                         if (ret == 0) {
@@ -3868,6 +4421,8 @@ socket_submit_reply (rpc_transport_t *this, rpc_transport_reply_t *reply)
                                                "write error on pipe");
                                 }
                         }
+                        if (priv->uring && (__socket_ioq_churn (this) == -1))
+                                __socket_disconnect (this);
                         ret = 0;
                 }
                 if (!priv->own_thread && need_poll_out) {
@@ -3985,7 +4540,21 @@ socket_throttle (rpc_transport_t *this, gf_boolean_t onoff)
                  * on a disconnected transport, which breaks epoll's event to
                  * registered fd mapping. */
 
-                if (priv->connected == 1)
+                if ((priv->connected == 1) && priv->uring) {
+                        /* the ring fd is also needed for the sends: just
+                         * leave the received data alone, until it can no
+                         * longer be stored */
+                        priv->uring_throttled = onoff;
+                        if (!onoff) {
+                                /* have what was stored read */
+                                pthread_mutex_lock (&priv->uring->lock);
+                                {
+                                        if (!__socket_uring_prep_nop (priv->uring))
+                                                __socket_uring_submit (priv->uring, 0);
+                                }
+                                pthread_mutex_unlock (&priv->uring->lock);
+                        }
+                } else if (priv->connected == 1)
                         priv->idx = event_select_on (this->ctx->event_pool,
                                                      priv->sock,
                                                      priv->idx, (int) !onoff,
@@ -4465,6 +5034,22 @@ socket_init (rpc_transport_t *this)
                         crl_path = optstr;
         }
 
+        if (dict_get_str (this->options, SSL_KTLS_OPT, &optstr) == 0) {
+                if (gf_string2boolean (optstr,
+                                       &priv->ssl_ktls_enabled) != 0) {
+                        gf_log (this->name, GF_LOG_WARNING,
+                                "invalid value given for ssl-ktls boolean");
+                }
+        }
+#ifndef SSL_OP_ENABLE_KTLS
+        if (priv->ssl_ktls_enabled) {
+                gf_log (this->name, GF_LOG_WARNING,
+                        "OpenSSL has no kernel TLS support (%s ignored)",
+                        SSL_KTLS_OPT);
+                priv->ssl_ktls_enabled = _gf_false;
+        }
+#endif
+
         gf_log(this->name, priv->ssl_enabled ? GF_LOG_INFO: GF_LOG_DEBUG,
                "SSL support on the I/O path is %s",
                priv->ssl_enabled ? "ENABLED" : "NOT enabled");
@@ -4489,6 +5074,32 @@ socket_init (rpc_transport_t *this)
                "using %s polling thread",
                priv->own_thread ? "private" : "system");
 
+        if (dict_get_str (this->options, IO_URING_OPT, &optstr) == 0) {
+                if (gf_string2boolean (optstr, &priv->use_uring) != 0) {
+                        gf_log (this->name, GF_LOG_WARNING,
+                                "invalid value given for io-uring boolean");
+                }
+        }
+        if (dict_get_uint32 (this->options, IO_URING_BUFS_OPT,
+                             &priv->uring_buffers) == 0) {
+                gf_log (this->name, GF_LOG_DEBUG,
+                        "using %u io_uring buffers", priv->uring_buffers);
+        }
+        if (priv->use_uring) {
+                if (priv->use_ssl || priv->own_thread) {
+                        gf_log (this->name, GF_LOG_WARNING,
+                                "io_uring is not used along with SSL or a "
+                                "private polling thread");
+                        priv->use_uring = _gf_false;
+                } else if (!socket_uring_supported ()) {
+                        gf_log (this->name, GF_LOG_WARNING,
+                                "io_uring is not supported, using epoll");
+                        priv->use_uring = _gf_false;
+                }
+        }
+        gf_log (this->name, priv->use_uring ? GF_LOG_INFO : GF_LOG_DEBUG,
+                "using %s", priv->use_uring ? "io_uring" : "epoll");
+
         if (!priv->mgmt_ssl) {
                 if (!dict_get_int32 (this->options, SSL_CERT_DEPTH_OPT, &cert_depth)) {
                         gf_log (this->name, GF_LOG_INFO,
@@ -4540,6 +5151,19 @@ socket_init (rpc_transport_t *this)
 #ifdef SSL_OP_NO_COMPRESSION
                 SSL_CTX_set_options(priv->ssl_ctx, SSL_OP_NO_COMPRESSION);
 #endif
+#ifdef SSL_OP_ENABLE_KTLS
+                if (priv->ssl_ktls_enabled) {
+                        SSL_CTX_set_options(priv->ssl_ctx, SSL_OP_ENABLE_KTLS);
+                        /*
+                         * An offloaded connection is read like a plain one,
+                         * which fails on anything but data records, so
+                         * nothing else must follow the handshake.
+                         */
+                        SSL_CTX_set_options(priv->ssl_ctx,
+                                            SSL_OP_NO_RENEGOTIATION);
+                        SSL_CTX_set_num_tickets(priv->ssl_ctx, 0);
+                }
+#endif
 
                 if ((bio = BIO_new_file(dh_param, "r")) == NULL) {
                         gf_log(this->name, GF_LOG_ERROR,
@@ -4858,9 +5482,38 @@ struct volume_options options[] = {
         { .key   = {SSL_CRL_PATH_OPT},
           .type  = GF_OPTION_TYPE_STR
         },
+        { .key   = {SSL_KTLS_OPT},
+          .type  = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .op_version = {GD_OP_VERSION_4_1_0},
+          .description = "Have the kernel encrypt and decrypt the records "
+                         "of SSL connections (kTLS), so that they are read "
+                         "and written like plain ones. Connections whose "
+                         "cipher or kernel does not allow it keep using "
+                         "OpenSSL. Ignored if SSL is not enabled."
+        },
         { .key   = {OWN_THREAD_OPT},
           .type  = GF_OPTION_TYPE_BOOL
         },
+        { .key   = {IO_URING_OPT},
+          .type  = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .op_version = {GD_OP_VERSION_4_1_0},
+          .description = "Do the I/O of the connections through io_uring: "
+                         "multishot receives into provided buffers, and "
+                         "linked sends of the queued messages. epoll is "
+                         "used where the kernel lacks support, and with "
+                         "SSL or own-thread."
+        },
+        { .key   = {IO_URING_BUFS_OPT},
+          .type  = GF_OPTION_TYPE_INT,
+          .min   = 1,
+          .max   = SOCKET_URING_MAX_BUFFERS,
+          .default_value = "8",
+          .op_version = {GD_OP_VERSION_4_1_0},
+          .description = "Number of 16KB receive buffers of a connection "
+                         "in io_uring mode."
+        },
         { .key   = {"ssl-own-cert"},
           .op_version = {GD_OP_VERSION_3_7_4},
           .flags      = OPT_FLAG_SETTABLE,
@@ -54,6 +54,13 @@
 #define GF_KEEPALIVE_INTERVAL           (2)
 #define GF_KEEPALIVE_COUNT              (9)
 
+/* limits of the messages of the queue written with a single call */
+#define GF_SOCKET_WRITE_BATCH_IOVEC     (256)
+#define GF_SOCKET_WRITE_BATCH_BYTES     (256 * GF_UNIT_KB)
+
+/* alignment of the payloads of received requests */
+#define GF_SOCKET_PAYLOAD_ALIGN         (4096)
+
 typedef enum {
         SP_STATE_NADA = 0,
         SP_STATE_COMPLETE,
@@ -114,6 +121,7 @@ struct ioq {
         struct iovec      *pending_vector;
         int                pending_count;
         struct iobref     *iobref;
+        struct msghdr      msg;    /* in flight, in io_uring mode */
 };
 
 typedef struct {
@@ -200,6 +208,8 @@ typedef enum {
         OT_PLEASE_DIE,  /* Poller termination requested. */
 } ot_state_t;
 
+struct socket_uring;
+
 typedef struct {
         int32_t                sock;
         int32_t                idx;
@@ -243,6 +253,8 @@ typedef struct {
         int                    ssl_session_id;
         BIO                   *ssl_sbio;
         SSL                   *ssl_ssl;
+        gf_boolean_t           ssl_ktls_enabled;
+        gf_boolean_t           ssl_ktls;        /* offloaded both ways */
         char                  *ssl_own_cert;
         char                  *ssl_private_key;
         char                  *ssl_ca_list;
@@ -253,6 +265,11 @@ typedef struct {
         ot_state_t             ot_state;
         uint32_t               ot_gen;
         gf_boolean_t           is_server;
+        gf_boolean_t           use_uring;
+        uint32_t               uring_buffers;
+        struct socket_uring   *uring;
+        gf_boolean_t           uring_throttled;
+        gf_boolean_t           uring_tx_wait;
         int                    log_ctr;
         GF_REF_DECL;           /* refcount to keep track of socket_poller
                                   threads */
@@ -650,7 +650,6 @@ dict_to_xdr (dict_t *this, gfx_dict *dict)
         int index = 0;
         data_pair_t *dpair = NULL;
         gfx_dict_pair *xpair = NULL;
-        ssize_t size = 0;
 
         /* This is a failure as we expect destination to be valid */
         if (!dict)
@@ -752,10 +751,10 @@ dict_to_xdr (dict_t *this, gfx_dict *dict)
         /* This is required mainly in the RPC layer to understand the
            boundary for proper payload. Hence only send the size of
            variable XDR size. ie, the formula should be:
-           xdr_size = total size - (xdr_size + count + pairs.pairs_len))  */
-        size = xdr_sizeof ((xdrproc_t) xdr_gfx_dict, dict);
-
-        dict->xdr_size = (size > 12) ? (size - 12) : 0;
+           xdr_size = total size - (xdr_size + count + pairs.pairs_len))
+           which is worked out from the pairs, without an extra encoding
+           pass. */
+        dict->xdr_size = xdr_gfx_dict_pairs_size (dict);
 
         ret = 0;
 out:
@@ -766,17 +765,39 @@ out:
         return ret;
 }
 
+/* Whether the bytes of a string or pointer value, left in the received
+ * buffer by xdr_gfx_dict (), are NUL terminated there: either they end
+ * with a NUL, or they are followed by padding, which xdr_gfx_dict ()
+ * zeroes. */
+static inline gf_boolean_t
+xdr_dict_value_terminated (char *val, u_int len)
+{
+        if (len % BYTES_PER_XDR_UNIT)
+                return _gf_true;
+
+        return (len && !val[len - 1]);
+}
+
+/* Builds a dict_t out of a decoded gfx_dict. If @iobref holds the buffer
+ * the gfx_dict was decoded from, and the keys and values of the gfx_dict
+ * were left in there (see xdr-dict.h), the dict takes references on
+ * @iobref and uses them in place instead of copying them. The gfx_dict is
+ * freed either way. */
 static inline int
-xdr_to_dict (gfx_dict *dict, dict_t **to)
+xdr_to_dict_iobref (gfx_dict *dict, dict_t **to, struct iobref *iobref)
 {
         int ret = -1;
         int index = 0;
         char *key = NULL;
         char *value = NULL;
+        u_int len = 0;
         gfx_dict_pair *xpair = NULL;
         dict_t *this = NULL;
+        data_t *data = NULL;
         unsigned char *uuid = NULL;
         struct iatt *iatt = NULL;
+        gf_boolean_t inlined = _gf_false;
+        gf_boolean_t borrow = _gf_false;
 
         if (!to || !dict)
                 goto out;
@@ -791,36 +812,50 @@ xdr_to_dict (gfx_dict *dict, dict_t **to)
         if (!this)
                 goto out;
 
+        inlined = (dict->inlined != 0);
+        borrow = (inlined && iobref);
+
         for (index = 0; index < dict->pairs.pairs_len; index++) {
                 ret = -1;
+                data = NULL;
                 xpair = &dict->pairs.pairs_val[index];
 
                 key = xpair->key.key_val;
                 switch (xpair->value.type) {
                         /* Add more type here */
                 case GF_DATA_TYPE_INT:
-                        ret = dict_set_int64 (this, key,
-                                    xpair->value.gfx_value_u.value_int);
+                        data = data_from_int64 (xpair->value.gfx_value_u.value_int);
                         break;
                 case GF_DATA_TYPE_UINT:
-                        ret = dict_set_uint64 (this, key,
-                                    xpair->value.gfx_value_u.value_uint);
+                        data = data_from_uint64 (xpair->value.gfx_value_u.value_uint);
                         break;
                 case GF_DATA_TYPE_DOUBLE:
                         ret = dict_set_double (this, key,
                                     xpair->value.gfx_value_u.value_dbl);
                         break;
                 case GF_DATA_TYPE_STR:
-                        value = GF_CALLOC (1, xpair->value.gfx_value_u.val_string.val_string_len + 1,
-                                           gf_common_mt_char);
+                        value = xpair->value.gfx_value_u.val_string.val_string_val;
+                        len = xpair->value.gfx_value_u.val_string.val_string_len;
+                        if (borrow && xdr_dict_value_terminated (value, len)) {
+                                data = data_from_iobref (value,
+                                                         strlen (value) + 1,
+                                                         GF_DATA_TYPE_STR,
+                                                         iobref);
+                                break;
+                        }
+                        value = GF_CALLOC (1, len + 1, gf_common_mt_char);
                         if (!value) {
                                 errno = ENOMEM;
                                 goto out;
                         }
-                        memcpy (value, xpair->value.gfx_value_u.val_string.val_string_val,
-                                xpair->value.gfx_value_u.val_string.val_string_len);
-                        free (xpair->value.gfx_value_u.val_string.val_string_val);
-                        ret = dict_set_dynstr (this, key, value);
+                        memcpy (value,
+                                xpair->value.gfx_value_u.val_string.val_string_val,
+                                len);
+                        if (!inlined)
+                                free (xpair->value.gfx_value_u.val_string.val_string_val);
+                        data = data_from_dynstr (value);
+                        if (!data)
+                                GF_FREE (value);
                         break;
                 case GF_DATA_TYPE_GFUUID:
                         uuid = GF_CALLOC (1, sizeof (uuid_t), gf_common_mt_uuid_t);
@@ -841,32 +876,54 @@ xdr_to_dict (gfx_dict *dict, dict_t **to)
                         ret = dict_set_iatt (this, key, iatt, false);
                         break;
                 case GF_DATA_TYPE_PTR:
-                        value = GF_CALLOC (1, xpair->value.gfx_value_u.other.other_len + 1,
-                                           gf_common_mt_char);
+                        value = xpair->value.gfx_value_u.other.other_val;
+                        len = xpair->value.gfx_value_u.other.other_len;
+                        if (borrow && xdr_dict_value_terminated (value, len)) {
+                                data = data_from_iobref (value, len,
+                                                         GF_DATA_TYPE_PTR,
+                                                         iobref);
+                                break;
+                        }
+                        value = GF_CALLOC (1, len + 1, gf_common_mt_char);
                         if (!value) {
                                 errno = ENOMEM;
                                 goto out;
                         }
                         memcpy (value, xpair->value.gfx_value_u.other.other_val,
-                                xpair->value.gfx_value_u.other.other_len);
-                        free (xpair->value.gfx_value_u.other.other_val);
-                        ret = dict_set_dynptr (this, key, value,
-                                               xpair->value.gfx_value_u.other.other_len);
+                                len);
+                        if (!inlined)
+                                free (xpair->value.gfx_value_u.other.other_val);
+                        data = data_from_dynptr (value, len);
+                        if (!data)
+                                GF_FREE (value);
                         break;
                 default:
                         ret = 0;
                         /* Unknown type and ptr type is not sent on wire */
                         break;
                 }
+
+                if (data) {
+                        if (borrow)
+                                ret = dict_set_iobref (this, key, data, iobref);
+                        else
+                                ret = dict_set (this, key, data);
+                        if (ret < 0)
+                                data_destroy (data);
+                }
+
                 if (ret) {
                         gf_msg_debug (THIS->name, ENOMEM,
                                       "failed to set the key (%s) into dict",
                                       key);
                 }
-                free (xpair->key.key_val);
+                if (!inlined)
+                        free (xpair->key.key_val);
         }
 
         free (dict->pairs.pairs_val);
+        dict->pairs.pairs_val = NULL;
+        dict->pairs.pairs_len = 0;
         ret = 0;
 
         /* If everything is fine, assign the dictionary to target */
@@ -880,4 +937,10 @@ out:
         return ret;
 }
 
+static inline int
+xdr_to_dict (gfx_dict *dict, dict_t **to)
+{
+        return xdr_to_dict_iobref (dict, to, NULL);
+}
+
 #endif /* !_GLUSTERFS3_H */
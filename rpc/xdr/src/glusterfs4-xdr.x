@@ -88,6 +88,8 @@ struct auth_glusterfs_params_v3 {
         opaque lk_owner<>;
 };
 
+/* gfx_dict_pair and gfx_dict are encoded by hand, see xdr-dict.h:
+
 struct gfx_dict_pair {
        opaque key<>;
        gfx_value value;
@@ -98,6 +100,8 @@ struct gfx_dict {
        int count;
        gfx_dict_pair pairs<>;
 };
+*/
+%#include "xdr-dict.h"
 
 /* FOPS */
 struct gfx_common_rsp {
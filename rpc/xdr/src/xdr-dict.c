@@ -0,0 +1,355 @@
+/*
+  Copyright (c) 2018 Red Hat, Inc. <http://www.redhat.com>
+  This file is part of GlusterFS.
+
+  This file is licensed to you under your choice of the GNU Lesser
+  General Public License, version 3 or any later version (LGPLv3 or
+  later), or the GNU General Public License, version 2 (GPLv2), in all
+  cases as published by the Free Software Foundation.
+*/
+
+#include <limits.h>
+
+#include "xdr-generic.h"
+#include "glusterfs4-xdr.h"
+
+/* Hand written XDR routines of gfx_dict (see xdr-dict.h). The encoding is
+ * the same the rpcgen generated ones used to produce. */
+
+static u_int gfx_iattx_size;
+
+static u_int
+xdr_gfx_iattx_size (void)
+{
+        gfx_iattx iatt = {0, };
+
+        /* gfx_iattx has a fixed size, compute it only once */
+        if (!gfx_iattx_size)
+                gfx_iattx_size = xdr_sizeof ((xdrproc_t) xdr_gfx_iattx,
+                                             &iatt);
+
+        return gfx_iattx_size;
+}
+
+u_int
+xdr_gfx_dict_pairs_size (gfx_dict *dict)
+{
+        gfx_dict_pair *pair = NULL;
+        u_int          size = 0;
+        u_int          i = 0;
+
+        for (i = 0; i < dict->pairs.pairs_len; i++) {
+                pair = &dict->pairs.pairs_val[i];
+
+                size += BYTES_PER_XDR_UNIT + RNDUP (pair->key.key_len);
+                size += BYTES_PER_XDR_UNIT;
+
+                switch (pair->value.type) {
+                case GF_DATA_TYPE_INT:
+                case GF_DATA_TYPE_UINT:
+                case GF_DATA_TYPE_DOUBLE:
+                        size += 2 * BYTES_PER_XDR_UNIT;
+                        break;
+                case GF_DATA_TYPE_STR:
+                        size += BYTES_PER_XDR_UNIT +
+                                RNDUP (pair->value.gfx_value_u.val_string.val_string_len);
+                        break;
+                case GF_DATA_TYPE_PTR:
+                        size += BYTES_PER_XDR_UNIT +
+                                RNDUP (pair->value.gfx_value_u.other.other_len);
+                        break;
+                case GF_DATA_TYPE_GFUUID:
+                        size += 16;
+                        break;
+                case GF_DATA_TYPE_IATT:
+                        size += xdr_gfx_iattx_size ();
+                        break;
+                default:
+                        break;
+                }
+        }
+
+        return size;
+}
+
+/* Returns the bytes of a key or value to be copied out of the decode
+ * buffer, when a dict can not be left pointing into it. Keys are always
+ * NUL terminated. */
+static char *
+gfx_dict_bytes_dup (char *val, u_int len, bool_t key)
+{
+        char *copy = NULL;
+
+        if (!val || (!len && !key))
+                return NULL;
+
+        copy = malloc (len + (key ? 1 : 0));
+        if (!copy)
+                return NULL;
+
+        memcpy (copy, val, len);
+        if (key)
+                copy[len] = '\0';
+
+        return copy;
+}
+
+static char **
+gfx_value_bytes (gfx_value *v, u_int **len)
+{
+        switch (v->type) {
+        case GF_DATA_TYPE_STR:
+                *len = &v->gfx_value_u.val_string.val_string_len;
+                return &v->gfx_value_u.val_string.val_string_val;
+        case GF_DATA_TYPE_PTR:
+                *len = &v->gfx_value_u.other.other_len;
+                return &v->gfx_value_u.other.other_val;
+        default:
+                return NULL;
+        }
+}
+
+/* Stops pointing into the decode buffer: the first @npairs pairs (and the
+ * key of the next one, with @next_key) get their own copy. On failure
+ * whatever could not be copied is reset, so that the dict can be freed as
+ * a regular one. */
+static bool_t
+gfx_dict_unborrow (gfx_dict *dict, u_int npairs, bool_t next_key)
+{
+        gfx_dict_pair *pair = NULL;
+        char         **val = NULL;
+        u_int         *len = NULL;
+        bool_t         ret = TRUE;
+        u_int          last = npairs + (next_key ? 1 : 0);
+        u_int          i = 0;
+
+        for (i = 0; i < last; i++) {
+                pair = &dict->pairs.pairs_val[i];
+
+                if (ret)
+                        pair->key.key_val =
+                                gfx_dict_bytes_dup (pair->key.key_val,
+                                                    pair->key.key_len,
+                                                    TRUE);
+                else
+                        pair->key.key_val = NULL;
+                if (!pair->key.key_val)
+                        ret = FALSE;
+
+                if (i == npairs)
+                        break;
+
+                val = gfx_value_bytes (&pair->value, &len);
+                if (!val)
+                        continue;
+
+                if (ret)
+                        *val = gfx_dict_bytes_dup (*val, *len, FALSE);
+                else
+                        *val = NULL;
+                if (!*val && *len)
+                        ret = FALSE;
+        }
+
+        dict->inlined = 0;
+
+        return ret;
+}
+
+/* Decodes a variable length opaque. While @inlined is set it is left in
+ * the decode buffer; its padding (if any) is zeroed so that it is NUL
+ * terminated. A key has to be NUL terminated in the buffer, or else it
+ * is copied. @inlined is cleared when the opaque had to be copied. */
+static bool_t
+xdr_gfx_dict_bytes (XDR *xdrs, char **val, u_int *len, bool_t key,
+                    u_int *inlined)
+{
+        u_int  size = 0;
+        char  *buf = NULL;
+
+        if (!xdr_u_int (xdrs, &size))
+                return FALSE;
+
+        if (size > INT_MAX - BYTES_PER_XDR_UNIT)
+                return FALSE;
+
+        if (*inlined) {
+                buf = (char *) XDR_INLINE (xdrs, RNDUP (size));
+                if (buf) {
+                        if (size % BYTES_PER_XDR_UNIT)
+                                buf[size] = '\0';
+
+                        *val = buf;
+                        *len = size;
+
+                        if (!key || (size % BYTES_PER_XDR_UNIT) ||
+                            (size && !buf[size - 1]))
+                                return TRUE;
+
+                        /* a key which would need one more byte; use a
+                         * copy of it, and of everything else */
+                        *inlined = 0;
+                        *val = gfx_dict_bytes_dup (buf, size, key);
+                        return (*val != NULL);
+                }
+
+                *inlined = 0;
+        }
+
+        *len = size;
+        if (!size && !key)
+                return TRUE;
+
+        buf = malloc (size + (key ? 1 : 0));
+        if (!buf)
+                return FALSE;
+
+        if (!xdr_opaque (xdrs, buf, size)) {
+                free (buf);
+                return FALSE;
+        }
+        if (key)
+                buf[size] = '\0';
+
+        *val = buf;
+
+        return TRUE;
+}
+
+static bool_t
+xdr_gfx_dict_decode_pair (XDR *xdrs, gfx_dict *dict, u_int index)
+{
+        gfx_dict_pair *pair = &dict->pairs.pairs_val[index];
+        gfx_value     *v = &pair->value;
+        u_int          inlined = dict->inlined;
+
+        if (!xdr_gfx_dict_bytes (xdrs, &pair->key.key_val, &pair->key.key_len,
+                                 TRUE, &inlined))
+                return FALSE;
+
+        if (dict->inlined && !inlined) {
+                /* the key is already a copy, but everything before it
+                 * is not */
+                if (!gfx_dict_unborrow (dict, index, FALSE))
+                        return FALSE;
+        }
+
+        if (!xdr_gf_dict_data_type_t (xdrs, &v->type))
+                return FALSE;
+
+        switch (v->type) {
+        case GF_DATA_TYPE_INT:
+                return xdr_quad_t (xdrs, &v->gfx_value_u.value_int);
+        case GF_DATA_TYPE_UINT:
+                return xdr_u_quad_t (xdrs, &v->gfx_value_u.value_uint);
+        case GF_DATA_TYPE_DOUBLE:
+                return xdr_double (xdrs, &v->gfx_value_u.value_dbl);
+        case GF_DATA_TYPE_IATT:
+                return xdr_gfx_iattx (xdrs, &v->gfx_value_u.iatt);
+        case GF_DATA_TYPE_GFUUID:
+                return xdr_opaque (xdrs, v->gfx_value_u.uuid, 16);
+        case GF_DATA_TYPE_STR:
+                if (!xdr_gfx_dict_bytes (xdrs,
+                                         &v->gfx_value_u.val_string.val_string_val,
+                                         &v->gfx_value_u.val_string.val_string_len,
+                                         FALSE, &inlined))
+                        return FALSE;
+                break;
+        case GF_DATA_TYPE_PTR:
+                if (!xdr_gfx_dict_bytes (xdrs,
+                                         &v->gfx_value_u.other.other_val,
+                                         &v->gfx_value_u.other.other_len,
+                                         FALSE, &inlined))
+                        return FALSE;
+                break;
+        default:
+                return FALSE;
+        }
+
+        if (dict->inlined && !inlined)
+                return gfx_dict_unborrow (dict, index, TRUE);
+
+        return TRUE;
+}
+
+static bool_t
+xdr_gfx_dict_decode (XDR *xdrs, gfx_dict *objp)
+{
+        u_int  npairs = 0;
+        u_int  i = 0;
+
+        objp->inlined = 0;
+        objp->pairs.pairs_val = NULL;
+        objp->pairs.pairs_len = 0;
+
+        if (!xdr_u_int (xdrs, &objp->xdr_size))
+                return FALSE;
+        if (!xdr_int (xdrs, &objp->count))
+                return FALSE;
+        if (!xdr_u_int (xdrs, &npairs))
+                return FALSE;
+
+        if (!npairs)
+                return TRUE;
+
+        /* every pair takes at least 3 units on the wire */
+        if (npairs > objp->xdr_size / (3 * BYTES_PER_XDR_UNIT))
+                return FALSE;
+
+        objp->pairs.pairs_val = calloc (npairs, sizeof (gfx_dict_pair));
+        if (!objp->pairs.pairs_val)
+                return FALSE;
+
+        objp->inlined = 1;
+
+        for (i = 0; i < npairs; i++) {
+                if (!xdr_gfx_dict_decode_pair (xdrs, objp, i)) {
+                        objp->pairs.pairs_len = i + 1;
+                        xdr_free ((xdrproc_t) xdr_gfx_dict, (char *) objp);
+                        return FALSE;
+                }
+        }
+
+        objp->pairs.pairs_len = npairs;
+
+        return TRUE;
+}
+
+bool_t
+xdr_gfx_dict_pair (XDR *xdrs, gfx_dict_pair *objp)
+{
+        if (!xdr_bytes (xdrs, (char **)&objp->key.key_val,
+                        (u_int *) &objp->key.key_len, ~0))
+                return FALSE;
+        if (!xdr_gfx_value (xdrs, &objp->value))
+                return FALSE;
+
+        return TRUE;
+}
+
+bool_t
+xdr_gfx_dict (XDR *xdrs, gfx_dict *objp)
+{
+        if (xdrs->x_op == XDR_DECODE)
+                return xdr_gfx_dict_decode (xdrs, objp);
+
+        if ((xdrs->x_op == XDR_FREE) && objp->inlined) {
+                /* nothing but the array of pairs is ours */
+                free (objp->pairs.pairs_val);
+                objp->pairs.pairs_val = NULL;
+                objp->pairs.pairs_len = 0;
+                objp->inlined = 0;
+                return TRUE;
+        }
+
+        if (!xdr_u_int (xdrs, &objp->xdr_size))
+                return FALSE;
+        if (!xdr_int (xdrs, &objp->count))
+                return FALSE;
+        if (!xdr_array (xdrs, (char **)&objp->pairs.pairs_val,
+                        (u_int *) &objp->pairs.pairs_len, ~0,
+                        sizeof (gfx_dict_pair), (xdrproc_t) xdr_gfx_dict_pair))
+                return FALSE;
+
+        return TRUE;
+}
@@ -0,0 +1,57 @@
+/*
+  Copyright (c) 2018 Red Hat, Inc. <http://www.redhat.com>
+  This file is part of GlusterFS.
+
+  This file is licensed to you under your choice of the GNU Lesser
+  General Public License, version 3 or any later version (LGPLv3 or
+  later), or the GNU General Public License, version 2 (GPLv2), in all
+  cases as published by the Free Software Foundation.
+*/
+
+#ifndef _XDR_DICT_H
+#define _XDR_DICT_H
+
+/* This is included from the middle of glusterfs4-xdr.h, right after the
+ * definition of gfx_value.
+ *
+ * The wire format of gfx_dict is still the one described in
+ * glusterfs4-xdr.x, but the XDR routines are written by hand: when a
+ * gfx_dict is decoded from a memory buffer, the keys and the string and
+ * pointer values of its pairs are not copied into separately allocated
+ * memory, they point straight into the buffer being decoded. 'inlined' is
+ * set when that was done for all pairs, and such a gfx_dict is only valid
+ * for as long as the buffer it was decoded from.
+ */
+
+struct gfx_dict_pair {
+        struct {
+                u_int key_len;
+                char *key_val;
+        } key;
+        gfx_value value;
+};
+typedef struct gfx_dict_pair gfx_dict_pair;
+
+struct gfx_dict {
+        u_int xdr_size;
+        int count;
+        struct {
+                u_int pairs_len;
+                gfx_dict_pair *pairs_val;
+        } pairs;
+        /* not on the wire */
+        u_int inlined;
+};
+typedef struct gfx_dict gfx_dict;
+
+/* size of the part of an encoded gfx_dict accounted in xdr_size */
+u_int
+xdr_gfx_dict_pairs_size (gfx_dict *dict);
+
+bool_t
+xdr_gfx_dict_pair (XDR *xdrs, gfx_dict_pair *objp);
+
+bool_t
+xdr_gfx_dict (XDR *xdrs, gfx_dict *objp);
+
+#endif /* !_XDR_DICT_H */
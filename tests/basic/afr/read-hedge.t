@@ -0,0 +1,60 @@
+#!/bin/bash
+#Test that reads hedged to another brick when the first one is slow return
+#the right contents, also when a brick goes down.
+
+. $(dirname $0)/../../include.rc
+. $(dirname $0)/../../volume.rc
+
+TESTS_EXPECTED_IN_LOOP=3
+
+function read_hedge_stat {
+        local field=$1
+        local sd=$(generate_mount_statedump $V0)
+        grep -a "^$field=" $sd | cut -f2 -d'=' | tail -1
+        cleanup_mount_statedump $V0
+}
+
+cleanup;
+
+tmp=`mktemp -p ${LOGDIR} -d -t ${0##*/}.XXXXXX`
+
+#Init
+TEST glusterd
+TEST pidof glusterd
+TEST $CLI volume create $V0 replica 3 $H0:$B0/brick{0,1,2}
+TEST $CLI volume set $V0 performance.io-cache off
+TEST $CLI volume set $V0 performance.quick-read off
+TEST $CLI volume set $V0 performance.read-ahead off
+TEST $CLI volume set $V0 cluster.read-subvolume $V0-client-1
+TEST $CLI volume set $V0 cluster.read-hedge-percentile 90
+TEST $CLI volume set $V0 cluster.read-hedge-budget 100
+TEST $CLI volume set $V0 delay-gen posix
+TEST $CLI volume set $V0 delay-gen.delay-duration 100000
+#Few enough slow reads to keep the 90th percentile among the fast ones.
+TEST $CLI volume set $V0 delay-gen.delay-percentage 3
+TEST $CLI volume set $V0 delay-gen.enable read
+TEST $CLI volume start $V0
+TEST $GFS --volfile-id=$V0 --volfile-server=$H0 $M0;
+EXPECT_WITHIN $CHILD_UP_TIMEOUT "1" afr_child_up_status $V0 0
+EXPECT_WITHIN $CHILD_UP_TIMEOUT "1" afr_child_up_status $V0 1
+EXPECT_WITHIN $CHILD_UP_TIMEOUT "1" afr_child_up_status $V0 2
+
+#Test
+TEST dd if=/dev/urandom of=$tmp/file bs=4096 count=256
+cs_file=$(sha1sum $tmp/file | awk '{ print $1 }')
+TEST dd if=$tmp/file of=$M0/file bs=4096 conv=fsync
+
+for i in {1..4}; do
+        EXPECT "$cs_file" echo $(dd if=$M0/file bs=4096 iflag=direct | sha1sum | awk '{ print $1 }')
+done
+TEST [ $(read_hedge_stat read_hedges) -gt 0 ]
+TEST [ $(read_hedge_stat read_hedge_wins) -gt 0 ]
+
+TEST kill_brick $V0 $H0 $B0/brick2
+EXPECT_WITHIN $CHILD_UP_TIMEOUT "0" afr_child_up_status $V0 2
+EXPECT "$cs_file" echo $(dd if=$M0/file bs=4096 iflag=direct | sha1sum | awk '{ print $1 }')
+
+#Cleanup
+EXPECT_WITHIN $UMOUNT_TIMEOUT "Y" force_umount $M0
+TEST rm -rf $tmp
+cleanup
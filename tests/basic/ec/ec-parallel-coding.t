@@ -0,0 +1,56 @@
+#!/bin/bash
+
+# Checks that large writes and reads split among several coding threads
+# produce the same contents, also when data has to be rebuilt from
+# redundancy fragments.
+
+DISPERSE=6
+REDUNDANCY=2
+
+. $(dirname $0)/../../include.rc
+. $(dirname $0)/../../volume.rc
+
+cleanup
+
+tmp=`mktemp -p ${LOGDIR} -d -t ${0##*/}.XXXXXX`
+if [ ! -d $tmp ]; then
+    exit 1
+fi
+
+TEST glusterd
+TEST pidof glusterd
+TEST $CLI volume create $V0 redundancy $REDUNDANCY $H0:$B0/${V0}{0..5}
+TEST $CLI volume set $V0 performance.flush-behind off
+TEST $CLI volume set $V0 performance.io-cache off
+TEST $CLI volume set $V0 performance.quick-read off
+TEST $CLI volume set $V0 performance.read-ahead off
+TEST $CLI volume set $V0 disperse.parallel-coding-threads 4
+TEST $CLI volume set $V0 disperse.parallel-coding-min-size 16KB
+EXPECT 'Created' volinfo_field $V0 'Status'
+TEST $CLI volume start $V0
+EXPECT_WITHIN $PROCESS_UP_TIMEOUT 'Started' volinfo_field $V0 'Status'
+TEST $GFS --volfile-id=/$V0 --volfile-server=$H0 $M0
+EXPECT_WITHIN $CHILD_UP_TIMEOUT "$DISPERSE" ec_child_up_count $V0 0
+
+TEST dd if=/dev/urandom of=$tmp/file bs=1048576 count=8
+cs_file=$(sha1sum $tmp/file | awk '{ print $1 }')
+
+TEST dd if=$tmp/file of=$M0/file bs=1048576 oflag=direct
+EXPECT "$cs_file" echo $(dd if=$M0/file bs=1048576 iflag=direct | sha1sum | awk '{ print $1 }')
+
+# Rebuild the data from the redundancy fragments.
+TEST kill_brick $V0 $H0 $B0/${V0}0
+TEST kill_brick $V0 $H0 $B0/${V0}1
+EXPECT_WITHIN $CHILD_UP_TIMEOUT "4" ec_child_up_count $V0 0
+EXPECT "$cs_file" echo $(dd if=$M0/file bs=1048576 iflag=direct | sha1sum | awk '{ print $1 }')
+
+# Changing the number of threads doesn't need a remount.
+TEST $CLI volume set $V0 disperse.parallel-coding-threads 1
+EXPECT "$cs_file" echo $(dd if=$M0/file bs=1048576 iflag=direct | sha1sum | awk '{ print $1 }')
+TEST $CLI volume set $V0 disperse.parallel-coding-threads 0
+EXPECT "$cs_file" echo $(dd if=$M0/file bs=1048576 iflag=direct | sha1sum | awk '{ print $1 }')
+
+EXPECT_WITHIN $UMOUNT_TIMEOUT "Y" force_umount $M0
+TEST rm -rf $tmp
+
+cleanup
@@ -0,0 +1,68 @@
+#!/bin/bash
+
+# Checks that reads sent to one more brick because the first ones are slow
+# return the right contents, and that the decoding matrices are reused when
+# reads always go to the same bricks.
+
+DISPERSE=6
+REDUNDANCY=2
+
+. $(dirname $0)/../../include.rc
+. $(dirname $0)/../../volume.rc
+
+function get_mount_stat {
+        local sd=$1
+        local section=$2
+        local field=$3
+        grep -a -A7 "stats.$section\]" $sd | grep "^$field=" | cut -f2 -d'='
+}
+
+cleanup
+
+tmp=`mktemp -p ${LOGDIR} -d -t ${0##*/}.XXXXXX`
+if [ ! -d $tmp ]; then
+    exit 1
+fi
+
+TEST glusterd
+TEST pidof glusterd
+TEST $CLI volume create $V0 redundancy $REDUNDANCY $H0:$B0/${V0}{0..5}
+TEST $CLI volume set $V0 performance.flush-behind off
+TEST $CLI volume set $V0 performance.io-cache off
+TEST $CLI volume set $V0 performance.quick-read off
+TEST $CLI volume set $V0 performance.read-ahead off
+TEST $CLI volume set $V0 disperse.read-policy stable
+TEST $CLI volume set $V0 delay-gen posix
+TEST $CLI volume set $V0 delay-gen.delay-duration 50000
+TEST $CLI volume set $V0 delay-gen.delay-percentage 100
+TEST $CLI volume set $V0 delay-gen.enable read
+EXPECT 'Created' volinfo_field $V0 'Status'
+TEST $CLI volume start $V0
+EXPECT_WITHIN $PROCESS_UP_TIMEOUT 'Started' volinfo_field $V0 'Status'
+TEST $GFS --volfile-id=/$V0 --volfile-server=$H0 $M0
+EXPECT_WITHIN $CHILD_UP_TIMEOUT "$DISPERSE" ec_child_up_count $V0 0
+
+TEST dd if=/dev/urandom of=$tmp/file bs=131072 count=16
+cs_file=$(sha1sum $tmp/file | awk '{ print $1 }')
+
+TEST dd if=$tmp/file of=$M0/file bs=131072 oflag=direct
+EXPECT "$cs_file" echo $(dd if=$M0/file bs=131072 iflag=direct | sha1sum | awk '{ print $1 }')
+
+# All reads use the same bricks, so only one matrix has been built.
+statedump=$(generate_mount_statedump $V0)
+EXPECT "1" get_mount_stat $statedump matrix misses
+EXPECT "0" get_mount_stat $statedump read hedges
+cleanup_mount_statedump $V0
+
+# All bricks are slower than the hedge timeout.
+TEST $CLI volume set $V0 disperse.read-hedge-timeout 10
+EXPECT "$cs_file" echo $(dd if=$M0/file bs=131072 iflag=direct | sha1sum | awk '{ print $1 }')
+
+statedump=$(generate_mount_statedump $V0)
+EXPECT "16" get_mount_stat $statedump read hedges
+cleanup_mount_statedump $V0
+
+EXPECT_WITHIN $UMOUNT_TIMEOUT "Y" force_umount $M0
+TEST rm -rf $tmp
+
+cleanup
@@ -0,0 +1,90 @@
+#!/bin/bash
+
+# Checks that a file modified while a brick is down is healed by rebuilding
+# only the modified regions, and that the result is correct.
+
+. $(dirname $0)/../../include.rc
+. $(dirname $0)/../../volume.rc
+
+# Prints "<pending> <size>" from the first file heal info reports as only
+# partially in need of heal.
+function get_heal_info_bytes {
+        $CLI volume heal $V0 info | \
+                sed -n 's/.* - \([0-9]*\) of \([0-9]*\) bytes need heal.*/\1 \2/p' | \
+                head -1
+}
+
+function get_heal_stat {
+        local sd=$1
+        local field=$2
+        grep -a -A4 "stats.heal\]" $sd | grep "^$field=" | cut -f2 -d'=' | head -1
+}
+
+cleanup
+
+tmp=`mktemp -p ${LOGDIR} -d -t ${0##*/}.XXXXXX`
+if [ ! -d $tmp ]; then
+    exit 1
+fi
+
+TEST glusterd
+TEST pidof glusterd
+TEST $CLI volume create $V0 disperse 6 redundancy 2 $H0:$B0/${V0}{0..5}
+TEST $CLI volume heal $V0 disable
+TEST $CLI volume start $V0
+TEST $GFS --volfile-id=/$V0 --volfile-server=$H0 $M0
+EXPECT_WITHIN $CHILD_UP_TIMEOUT "6" ec_child_up_count $V0 0
+
+TEST dd if=/dev/urandom of=$tmp/file bs=1048576 count=32
+TEST cp $tmp/file $M0/file
+
+# Modify a few regions while a brick is down.
+TEST kill_brick $V0 $H0 $B0/${V0}0
+EXPECT_WITHIN $CHILD_UP_TIMEOUT "5" ec_child_up_count $V0 0
+TEST dd if=/dev/urandom of=$tmp/file bs=4096 count=2 seek=700 conv=notrunc
+TEST dd if=/dev/urandom of=$tmp/file bs=4096 count=1 seek=5000 conv=notrunc
+TEST dd if=$tmp/file of=$M0/file bs=4096 count=2 skip=700 seek=700 conv=notrunc,fsync
+TEST dd if=$tmp/file of=$M0/file bs=4096 count=1 skip=5000 seek=5000 conv=notrunc,fsync
+cs_file=$(sha1sum $tmp/file | awk '{ print $1 }')
+
+# The bricks that were up account for the modified regions.
+TEST getfattr -n trusted.ec.heal-map $B0/${V0}1/file
+TEST ! getfattr -n trusted.ec.heal-map $B0/${V0}0/file
+
+TEST $CLI volume start $V0 force
+EXPECT_WITHIN $CHILD_UP_TIMEOUT "6" ec_child_up_count $V0 0
+
+# Heal info tells how much of the file is still to be rebuilt.
+heal_info=($(get_heal_info_bytes))
+EXPECT "^33554432$" echo ${heal_info[1]}
+TEST [ ${heal_info[0]} -gt 0 ]
+TEST [ ${heal_info[0]} -lt ${heal_info[1]} ]
+
+TEST $CLI volume heal $V0 enable
+TEST $CLI volume heal $V0
+EXPECT_WITHIN $HEAL_TIMEOUT "^0$" get_pending_heal_count $V0
+
+# The self-heal daemon only rebuilt the modified regions.
+statedump=$(generate_shd_statedump)
+EXPECT "^0$" get_heal_stat $statedump full
+EXPECT "^1$" get_heal_stat $statedump partial
+TEST [ $(get_heal_stat $statedump skipped) -gt 0 ]
+TEST [ $(get_heal_stat $statedump healed) -lt 33554432 ]
+rm -f $statedump
+
+# After the heal, all bricks have the same map.
+EXPECT "$(getfattr -n trusted.ec.heal-map -e hex $B0/${V0}1/file | grep heal-map)" echo "$(getfattr -n trusted.ec.heal-map -e hex $B0/${V0}0/file | grep heal-map)"
+
+# Read the data using the healed brick.
+TEST kill_brick $V0 $H0 $B0/${V0}1
+TEST kill_brick $V0 $H0 $B0/${V0}2
+EXPECT_WITHIN $CHILD_UP_TIMEOUT "4" ec_child_up_count $V0 0
+EXPECT_WITHIN $UMOUNT_TIMEOUT "Y" force_umount $M0
+TEST $GFS --volfile-id=/$V0 --volfile-server=$H0 $M0
+EXPECT_WITHIN $CHILD_UP_TIMEOUT "4" ec_child_up_count $V0 0
+EXPECT "$cs_file" echo $(sha1sum $M0/file | awk '{ print $1 }')
+
+EXPECT_WITHIN $UMOUNT_TIMEOUT "Y" force_umount $M0
+TEST rm -rf $tmp
+
+cleanup
@@ -0,0 +1,116 @@
+#!/bin/bash
+
+# Checks that small sequential writes combined by ec reach the bricks with
+# the right contents, also when they are appends and when the file is read
+# back from the redundancy fragments, and that combined writes are sent
+# before another client can write the same file.
+
+DISPERSE=6
+REDUNDANCY=2
+
+. $(dirname $0)/../../include.rc
+. $(dirname $0)/../../volume.rc
+
+function get_mount_stat {
+        local sd=$1
+        local field=$2
+        grep -a -A6 "stats.write_combine\]" $sd | grep "^$field=" | cut -f2 -d'='
+}
+
+# Writes a file in blocks of 128 bytes from a mount, keeping it open for a
+# while after the last write so that the data is still combined when the
+# other mount writes it.
+function slow_writer {
+        local src=$1
+        local dst=$2
+        (cat $src; sleep 5) | dd of=$dst bs=128 iflag=fullblock conv=notrunc
+}
+
+cleanup
+
+tmp=`mktemp -p ${LOGDIR} -d -t ${0##*/}.XXXXXX`
+if [ ! -d $tmp ]; then
+    exit 1
+fi
+
+TEST glusterd
+TEST pidof glusterd
+TEST $CLI volume create $V0 redundancy $REDUNDANCY $H0:$B0/${V0}{0..5}
+TEST $CLI volume set $V0 performance.flush-behind off
+TEST $CLI volume set $V0 performance.write-behind off
+TEST $CLI volume set $V0 performance.io-cache off
+TEST $CLI volume set $V0 performance.quick-read off
+TEST $CLI volume set $V0 performance.read-ahead off
+TEST $CLI volume set $V0 disperse.write-combine-size 64KB
+EXPECT 'Created' volinfo_field $V0 'Status'
+TEST $CLI volume start $V0
+EXPECT_WITHIN $PROCESS_UP_TIMEOUT 'Started' volinfo_field $V0 'Status'
+TEST $GFS --volfile-id=/$V0 --volfile-server=$H0 $M0
+EXPECT_WITHIN $CHILD_UP_TIMEOUT "$DISPERSE" ec_child_up_count $V0 0
+
+TEST dd if=/dev/urandom of=$tmp/file bs=1000 count=1000
+cs_file=$(sha1sum $tmp/file | awk '{ print $1 }')
+
+TEST dd if=$tmp/file of=$M0/file bs=1000 conv=fsync
+EXPECT "$cs_file" echo $(sha1sum $M0/file | awk '{ print $1 }')
+
+# Most writes have been sent together with others.
+statedump=$(generate_mount_statedump $V0)
+writes=$(get_mount_stat $statedump writes)
+flushes=$(get_mount_stat $statedump flushes)
+TEST [ $flushes -gt 0 ]
+TEST [ $writes -gt $((flushes * 10)) ]
+cleanup_mount_statedump $V0
+
+TEST dd if=$tmp/file of=$M0/append bs=100 count=5000 oflag=append
+TEST dd if=$tmp/file of=$M0/append bs=100 skip=5000 oflag=append conv=notrunc,fsync
+EXPECT "$cs_file" echo $(sha1sum $M0/append | awk '{ print $1 }')
+
+# Another client writing the same range must wait until combined writes have
+# been sent, both when the lock is released because of the contention and
+# when its eager-lock timer expires.
+TEST $GFS --volfile-id=/$V0 --volfile-server=$H0 $M1
+EXPECT_WITHIN $CHILD_UP_TIMEOUT "$DISPERSE" ec_child_up_count $V0 0 $M1
+
+TEST dd if=/dev/urandom of=$tmp/old bs=128 count=160
+TEST dd if=/dev/urandom of=$tmp/new bs=128 count=160
+cs_new=$(sha1sum $tmp/new | awk '{ print $1 }')
+
+TEST $CLI volume set $V0 disperse.write-combine-timeout 10000
+TEST $CLI volume set $V0 disperse.eager-lock-timeout 60
+TEST $CLI volume set $V0 features.locks-notify-contention on
+TEST touch $M0/contention
+slow_writer $tmp/old $M0/contention &
+writer=$!
+sleep 1
+TEST dd if=$tmp/new of=$M1/contention bs=128 conv=notrunc,fsync
+wait $writer
+EXPECT "$cs_new" echo $(dd if=$M0/contention bs=4096 iflag=direct | sha1sum | awk '{ print $1 }')
+
+TEST $CLI volume set $V0 disperse.eager-lock-timeout 1
+TEST $CLI volume set $V0 features.locks-notify-contention off
+TEST touch $M0/timeout
+slow_writer $tmp/old $M0/timeout &
+writer=$!
+sleep 1
+TEST dd if=$tmp/new of=$M1/timeout bs=128 conv=notrunc,fsync
+wait $writer
+EXPECT "$cs_new" echo $(dd if=$M0/timeout bs=4096 iflag=direct | sha1sum | awk '{ print $1 }')
+
+EXPECT_WITHIN $UMOUNT_TIMEOUT "Y" force_umount $M1
+
+# Rebuild the data from the redundancy fragments.
+TEST kill_brick $V0 $H0 $B0/${V0}0
+TEST kill_brick $V0 $H0 $B0/${V0}1
+EXPECT_WITHIN $CHILD_UP_TIMEOUT "4" ec_child_up_count $V0 0
+EXPECT "$cs_file" echo $(sha1sum $M0/file | awk '{ print $1 }')
+EXPECT "$cs_file" echo $(sha1sum $M0/append | awk '{ print $1 }')
+
+# Writes are still combined while bricks are down.
+TEST dd if=$tmp/file of=$M0/degraded bs=333 conv=fsync
+EXPECT "$cs_file" echo $(sha1sum $M0/degraded | awk '{ print $1 }')
+
+EXPECT_WITHIN $UMOUNT_TIMEOUT "Y" force_umount $M0
+TEST rm -rf $tmp
+
+cleanup
@@ -0,0 +1,518 @@
+/*
+ * Measure the sequential read throughput of protocol/client against the
+ * number of its streams (TCP connections to the brick)
+ *
+ * The client does not connect to the brick directly, but through a relay
+ * that this program runs on the loopback interface. The relay holds every
+ * chunk it forwards for a while, and forwards at most a window of data at a
+ * time per connection and direction, which limits a single connection to
+ * window / delay, like a TCP connection over a link with a long round trip
+ * time. A file is written once, and then read by a number of threads with
+ * 1, 2, ... streams; each thread reads every nth block of it.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include <glusterfs/api/glfs.h>
+
+#define PROGNAME "client-streams-bench"
+
+#define BLOCK_SIZE	(128 * 1024)
+#define WINDOW		(256 * 1024)
+#define MAX_STREAMS	16
+
+struct relay {
+	int			 listen_fd;
+	struct sockaddr_in	 brick;
+	int			 delay_ms;
+	int			 accepted;
+	pthread_mutex_t		 lock;
+};
+
+struct relay_pipe {
+	struct relay		*relay;
+	int			 in;
+	int			 out;
+};
+
+struct job {
+	const char		*brick_path;
+	int			 port;
+	int			 streams;
+	long			 blocks;
+	int			 nthreads;
+};
+
+struct reader {
+	pthread_t		 thread;
+	glfs_fd_t		*fd;
+	int			 index;
+	int			 nthreads;
+	long			 blocks;
+	long			 errors;
+};
+
+static struct relay relay;
+
+void
+usage(FILE *output)
+{
+	fprintf(output, "Usage: " PROGNAME " <host> <brick port> <brick path> "
+		"[delay ms] [size MB] [threads] [max streams]\n");
+}
+
+static int
+write_all(int fd, const char *buf, size_t len)
+{
+	ssize_t ret;
+
+	while (len) {
+		ret = write(fd, buf, len);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			return -1;
+		buf += ret;
+		len -= ret;
+	}
+
+	return 0;
+}
+
+/* one direction of a relayed connection */
+static void *
+relay_pipe(void *data)
+{
+	struct relay_pipe	*rp = data;
+	char			*buf;
+	ssize_t			 len;
+
+	buf = malloc(WINDOW);
+	if (!buf)
+		goto out;
+
+	for (;;) {
+		len = read(rp->in, buf, WINDOW);
+		if (len < 0 && errno == EINTR)
+			continue;
+		if (len <= 0)
+			break;
+
+		usleep(rp->relay->delay_ms * 1000);
+
+		if (write_all(rp->out, buf, len))
+			break;
+	}
+
+	free(buf);
+out:
+	shutdown(rp->in, SHUT_RD);
+	shutdown(rp->out, SHUT_WR);
+	free(rp);
+
+	return NULL;
+}
+
+static int
+relay_start_pipe(struct relay *r, int in, int out)
+{
+	struct relay_pipe	*rp;
+	pthread_t		 thread;
+
+	rp = calloc(1, sizeof(*rp));
+	if (!rp)
+		return -1;
+
+	rp->relay = r;
+	rp->in = in;
+	rp->out = out;
+
+	if (pthread_create(&thread, NULL, relay_pipe, rp)) {
+		free(rp);
+		return -1;
+	}
+	pthread_detach(thread);
+
+	return 0;
+}
+
+static void *
+relay_accept(void *data)
+{
+	struct relay	*r = data;
+	int		 client, brick;
+	int		 one = 1;
+
+	for (;;) {
+		client = accept(r->listen_fd, NULL, NULL);
+		if (client < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		brick = socket(AF_INET, SOCK_STREAM, 0);
+		if (brick < 0 ||
+		    connect(brick, (struct sockaddr *)&r->brick,
+			    sizeof(r->brick))) {
+			perror("connecting to the brick failed");
+			close(client);
+			if (brick >= 0)
+				close(brick);
+			continue;
+		}
+
+		setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		setsockopt(brick, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+		pthread_mutex_lock(&r->lock);
+		r->accepted++;
+		pthread_mutex_unlock(&r->lock);
+
+		if (relay_start_pipe(r, client, brick) ||
+		    relay_start_pipe(r, brick, client)) {
+			close(client);
+			close(brick);
+		}
+	}
+
+	return NULL;
+}
+
+static int
+relay_init(struct relay *r, const char *host, int brick_port, int delay_ms)
+{
+	struct sockaddr_in	 sin = { 0, };
+	socklen_t		 len = sizeof(sin);
+	struct hostent		*he;
+	pthread_t		 thread;
+
+	he = gethostbyname(host);
+	if (!he) {
+		fprintf(stderr, "cannot resolve %s\n", host);
+		return -1;
+	}
+
+	r->brick.sin_family = AF_INET;
+	r->brick.sin_port = htons(brick_port);
+	memcpy(&r->brick.sin_addr, he->h_addr, sizeof(r->brick.sin_addr));
+	r->delay_ms = delay_ms;
+	pthread_mutex_init(&r->lock, NULL);
+
+	r->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (r->listen_fd < 0)
+		return -1;
+
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(r->listen_fd, (struct sockaddr *)&sin, sizeof(sin)) ||
+	    listen(r->listen_fd, 64) ||
+	    getsockname(r->listen_fd, (struct sockaddr *)&sin, &len))
+		return -1;
+
+	if (pthread_create(&thread, NULL, relay_accept, r))
+		return -1;
+	pthread_detach(thread);
+
+	return ntohs(sin.sin_port);
+}
+
+static int
+relay_accepted(struct relay *r)
+{
+	int accepted;
+
+	pthread_mutex_lock(&r->lock);
+	accepted = r->accepted;
+	pthread_mutex_unlock(&r->lock);
+
+	return accepted;
+}
+
+/* a client volfile that connects through the relay */
+static glfs_t *
+client_mount(const char *brick_path, int port, int streams)
+{
+	char	 volfile[] = "/tmp/" PROGNAME ".XXXXXX";
+	FILE	*fp;
+	glfs_t	*fs;
+	int	 fd;
+
+	fd = mkstemp(volfile);
+	if (fd < 0)
+		return NULL;
+
+	fp = fdopen(fd, "w");
+	if (!fp) {
+		close(fd);
+		unlink(volfile);
+		return NULL;
+	}
+
+	fprintf(fp, "volume client\n"
+		"    type protocol/client\n"
+		"    option remote-host 127.0.0.1\n"
+		"    option remote-port %d\n"
+		"    option remote-subvolume %s\n"
+		"    option transport-type socket\n"
+		"    option streams %d\n"
+		"end-volume\n", port, brick_path, streams);
+	fclose(fp);
+
+	fs = glfs_new(PROGNAME);
+	if (!fs)
+		goto out;
+
+	glfs_set_logging(fs, PROGNAME ".log", 7);
+
+	if (glfs_set_volfile(fs, volfile) || glfs_init(fs)) {
+		perror("mounting the volume failed");
+		glfs_fini(fs);
+		fs = NULL;
+	}
+out:
+	unlink(volfile);
+
+	return fs;
+}
+
+static void
+fill_block(char *buf, long block)
+{
+	long i;
+
+	for (i = 0; i < BLOCK_SIZE / sizeof(long); i++)
+		((long *)buf)[i] = block * BLOCK_SIZE + i;
+}
+
+static void *
+reader(void *data)
+{
+	struct reader	*rd = data;
+	char		*buf, *expected;
+	long		 block;
+	ssize_t		 ret;
+
+	buf = malloc(BLOCK_SIZE);
+	expected = malloc(BLOCK_SIZE);
+	if (!buf || !expected) {
+		rd->errors++;
+		goto out;
+	}
+
+	for (block = rd->index; block < rd->blocks; block += rd->nthreads) {
+		ret = glfs_pread(rd->fd, buf, BLOCK_SIZE,
+				 (off_t)block * BLOCK_SIZE, 0, NULL);
+		fill_block(expected, block);
+		if (ret != BLOCK_SIZE || memcmp(buf, expected, BLOCK_SIZE))
+			rd->errors++;
+	}
+out:
+	free(buf);
+	free(expected);
+
+	return NULL;
+}
+
+static int
+write_file(struct job *job)
+{
+	glfs_t		*fs = NULL;
+	glfs_fd_t	*fd = NULL;
+	char		*buf;
+	long		 block;
+	int		 ret = -1;
+
+	buf = malloc(BLOCK_SIZE);
+	if (!buf)
+		return -1;
+
+	fs = client_mount(job->brick_path, job->port, job->streams);
+	if (!fs)
+		goto out;
+
+	fd = glfs_creat(fs, "/streams", O_RDWR | O_TRUNC, 0644);
+	if (!fd) {
+		perror("glfs_creat failed");
+		goto out;
+	}
+
+	for (block = 0; block < job->blocks; block++) {
+		fill_block(buf, block);
+		if (glfs_pwrite(fd, buf, BLOCK_SIZE, (off_t)block * BLOCK_SIZE,
+				0, NULL, NULL) != BLOCK_SIZE) {
+			perror("glfs_pwrite failed");
+			goto out;
+		}
+	}
+
+	ret = 0;
+out:
+	if (fd)
+		glfs_close(fd);
+	free(buf);
+	if (fs)
+		glfs_fini(fs);
+
+	return ret;
+}
+
+static int
+read_file(struct job *job)
+{
+	glfs_t		*fs = NULL;
+	glfs_fd_t	*fd = NULL;
+	struct reader	*readers;
+	struct timespec	 start, end;
+	double		 elapsed;
+	long		 errors = 0;
+	int		 nthreads = job->nthreads;
+	int		 ret = -1;
+	int		 i;
+
+	readers = calloc(nthreads, sizeof(*readers));
+	if (!readers)
+		return -1;
+
+	fs = client_mount(job->brick_path, job->port, job->streams);
+	if (!fs)
+		goto out;
+
+	fd = glfs_open(fs, "/streams", O_RDONLY);
+	if (!fd) {
+		perror("glfs_open failed");
+		goto out;
+	}
+
+	/* give the streams, which connect after the first one, a moment */
+	sleep(1);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (i = 0; i < nthreads; i++) {
+		readers[i].fd = fd;
+		readers[i].index = i;
+		readers[i].nthreads = nthreads;
+		readers[i].blocks = job->blocks;
+		if (pthread_create(&readers[i].thread, NULL, reader,
+				   &readers[i])) {
+			perror("pthread_create failed");
+			nthreads = i;
+			break;
+		}
+	}
+
+	for (i = 0; i < nthreads; i++) {
+		pthread_join(readers[i].thread, NULL);
+		errors += readers[i].errors;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	elapsed = (end.tv_sec - start.tv_sec) +
+		  (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	printf("%2d streams, %d threads: %.3f s, %.1f MB/s, %ld errors\n",
+	       job->streams, nthreads, elapsed,
+	       job->blocks * (BLOCK_SIZE / 1048576.0) / elapsed, errors);
+	fflush(stdout);
+
+	if (!errors)
+		ret = 0;
+out:
+	if (fd)
+		glfs_close(fd);
+	free(readers);
+	if (fs)
+		glfs_fini(fs);
+
+	return ret;
+}
+
+/*
+ * Every job mounts the brick with a glfs instance of its own, and the relay
+ * counts the connections it makes.
+ */
+static int
+run_job(int (*fn)(struct job *), struct job *job)
+{
+	int	accepted;
+
+	accepted = relay_accepted(&relay);
+
+	if (fn(job))
+		return -1;
+
+	accepted = relay_accepted(&relay) - accepted;
+	if (accepted != job->streams) {
+		fprintf(stderr, "%d streams made %d connections\n",
+			job->streams, accepted);
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct job job;
+	int	 delay_ms = 5;
+	long	 size_mb = 64;
+	int	 nthreads = 16;
+	int	 max_streams = 4;
+	int	 port;
+
+	if (argc < 4 || argc > 8) {
+		usage(stderr);
+		exit(EXIT_FAILURE);
+	}
+
+	if (argc > 4)
+		delay_ms = atoi(argv[4]);
+	if (argc > 5)
+		size_mb = atol(argv[5]);
+	if (argc > 6)
+		nthreads = atoi(argv[6]);
+	if (argc > 7)
+		max_streams = atoi(argv[7]);
+	if (delay_ms < 0 || size_mb <= 0 || nthreads <= 0 ||
+	    max_streams <= 0 || max_streams > MAX_STREAMS) {
+		usage(stderr);
+		exit(EXIT_FAILURE);
+	}
+
+	port = relay_init(&relay, argv[1], atoi(argv[2]), delay_ms);
+	if (port < 0) {
+		perror("starting the relay failed");
+		exit(EXIT_FAILURE);
+	}
+
+	job.brick_path = argv[3];
+	job.port = port;
+	job.streams = 1;
+	job.blocks = size_mb * (1048576 / BLOCK_SIZE);
+	job.nthreads = nthreads;
+
+	if (run_job(write_file, &job))
+		exit(EXIT_FAILURE);
+
+	for (job.streams = 1; job.streams <= max_streams; job.streams *= 2) {
+		if (run_job(read_file, &job))
+			exit(EXIT_FAILURE);
+	}
+
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,21 @@
+#!/bin/bash
+
+. $(dirname $0)/../../include.rc
+. $(dirname $0)/../../volume.rc
+
+cleanup
+
+TEST glusterd
+
+TEST $CLI volume create $V0 ${H0}:${B0}/${V0}0
+TEST $CLI volume start $V0
+EXPECT_WITHIN $PROCESS_UP_TIMEOUT "1" brick_up_status $V0 $H0 ${B0}/${V0}0
+
+port=$($CLI volume status $V0 ${H0}:${B0}/${V0}0 --xml | sed -ne 's/.*<port>\([0-9]*\)<\/port>/\1/p')
+
+TEST build_tester $(dirname ${0})/client-streams-bench.c -lgfapi -lpthread
+TEST ./$(dirname ${0})/client-streams-bench ${H0} $port ${B0}/${V0}0 5 16 8 4
+
+cleanup_tester $(dirname ${0})/client-streams-bench
+
+cleanup
@@ -0,0 +1,154 @@
+/*
+ * Measure the FOP throughput of io-threads
+ *
+ * A number of threads send LOOKUPs on the root of a volume described by a
+ * .vol file, iot-sink.vol puts io-threads on top of the sink xlator. Every
+ * LOOKUP gets queued and dispatched by io-threads, but nothing else is done
+ * for it, so the result is the rate at which io-threads can move FOPs from
+ * the callers to its workers.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <glusterfs/api/glfs.h>
+#include <glusterfs/api/glfs-handles.h>
+
+#define PROGNAME "iot-sink-bench"
+
+struct bench_thread {
+	pthread_t		 thread;
+	glfs_t			*fs;
+	struct glfs_object	*root;
+	long			 count;
+	long			 errors;
+};
+
+void
+usage(FILE *output)
+{
+	fprintf(output, "Usage: " PROGNAME " <volfile> [threads] "
+		"[fops per thread]\n");
+}
+
+static void *
+bench_thread(void *data)
+{
+	struct bench_thread	*bt = data;
+	struct stat		 sb;
+	long			 i;
+
+	for (i = 0; i < bt->count; i++) {
+		if (glfs_h_getattrs(bt->fs, bt->root, &sb))
+			bt->errors++;
+	}
+
+	return NULL;
+}
+
+int
+main(int argc, char **argv)
+{
+	int			 ret = EXIT_FAILURE;
+	glfs_t			*fs = NULL;
+	struct glfs_object	*root = NULL;
+	struct bench_thread	*threads = NULL;
+	struct stat		 sb;
+	struct timespec		 start, end;
+	double			 elapsed;
+	long			 count = 100000;
+	long			 errors = 0;
+	int			 nthreads = 16;
+	int			 i;
+
+	if (argc < 2 || argc > 4) {
+		usage(stderr);
+		exit(EXIT_FAILURE);
+	}
+
+	if (!strcmp(argv[1], "-h")) {
+		usage(stdout);
+		exit(EXIT_SUCCESS);
+	}
+
+	if (argc > 2)
+		nthreads = atoi(argv[2]);
+	if (argc > 3)
+		count = atol(argv[3]);
+	if (nthreads <= 0 || count <= 0) {
+		usage(stderr);
+		exit(EXIT_FAILURE);
+	}
+
+	threads = calloc(nthreads, sizeof(*threads));
+	if (!threads) {
+		perror("calloc failed");
+		exit(EXIT_FAILURE);
+	}
+
+	fs = glfs_new(PROGNAME);
+	if (!fs) {
+		perror("glfs_new failed");
+		goto out;
+	}
+
+	glfs_set_logging(fs, PROGNAME ".log", 7);
+
+	if (glfs_set_volfile(fs, argv[1])) {
+		perror("glfs_set_volfile failed");
+		goto out;
+	}
+
+	if (glfs_init(fs)) {
+		perror("glfs_init failed");
+		goto out;
+	}
+
+	root = glfs_h_lookupat(fs, NULL, "/", &sb, 0);
+	if (!root) {
+		perror("glfs_h_lookupat failed");
+		goto out;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (i = 0; i < nthreads; i++) {
+		threads[i].fs = fs;
+		threads[i].root = root;
+		threads[i].count = count;
+		if (pthread_create(&threads[i].thread, NULL, bench_thread,
+				   &threads[i])) {
+			perror("pthread_create failed");
+			nthreads = i;
+			break;
+		}
+	}
+
+	for (i = 0; i < nthreads; i++) {
+		pthread_join(threads[i].thread, NULL);
+		errors += threads[i].errors;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	elapsed = (end.tv_sec - start.tv_sec) +
+		  (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	printf("%d threads, %ld fops: %.3f s, %.0f fops/s, %ld errors\n",
+	       nthreads, nthreads * count, elapsed,
+	       nthreads * count / elapsed, errors);
+
+	if (!errors)
+		ret = EXIT_SUCCESS;
+out:
+	if (root)
+		glfs_h_close(root);
+	if (fs)
+		glfs_fini(fs);
+	free(threads);
+
+	exit(ret);
+}
@@ -0,0 +1,13 @@
+#!/bin/bash
+
+. $(dirname $0)/../../include.rc
+. $(dirname $0)/../../volume.rc
+
+cleanup
+
+TEST build_tester $(dirname ${0})/iot-sink-bench.c -lgfapi -lpthread
+TEST ./$(dirname ${0})/iot-sink-bench $(dirname $0)/iot-sink.vol 8 10000
+
+cleanup_tester $(dirname ${0})/iot-sink-bench
+
+cleanup
@@ -0,0 +1,59 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+#This script checks that the io-threads autoscaler shows up in the brick
+#statedump once it is enabled, and goes away when it is disabled again.
+
+function get_iot_value {
+        local key=$1
+        local statedump=$(generate_brick_statedump $V0 $H0 $B0/${V0}0)
+        local val=$(grep -A 20 "^\[performance/io-threads" $statedump | \
+                    grep "^$key=" | cut -f2- -d'=' | tail -1)
+        rm -f $statedump
+        echo $val
+}
+
+function get_iot_done {
+        get_iot_value "autoscale.$1" | sed 's/.*done=\([0-9]*\).*/\1/'
+}
+
+cleanup;
+
+TEST glusterd
+TEST pidof glusterd
+TEST $CLI volume create $V0 $H0:$B0/${V0}0
+TEST $CLI volume set $V0 performance.iot-autoscale on
+TEST $CLI volume set $V0 performance.iot-autoscale-interval 1
+TEST $CLI volume set $V0 performance.iot-autoscale-min-threads 2
+TEST $CLI volume set $V0 performance.iot-autoscale-max-threads 8
+TEST $CLI volume start $V0
+
+TEST glusterfs --volfile-id=/$V0 --volfile-server=$H0 $M0 --attribute-timeout=0 --entry-timeout=0
+
+for i in {1..20}; do
+        dd if=/dev/zero of=$M0/file$i bs=64k count=4 2>/dev/null
+done
+
+EXPECT "1" get_iot_value autoscale
+EXPECT "2" get_iot_value autoscale_min_threads
+EXPECT "8" get_iot_value autoscale_max_threads
+EXPECT "1" get_iot_value autoscale_interval
+#The creates above go through the normal queue, the writes through the low one
+EXPECT_WITHIN 5 "^[1-9][0-9]*$" get_iot_done NORMAL
+EXPECT_WITHIN 5 "^[1-9][0-9]*$" get_iot_done LOW
+
+#The per-priority lines are only dumped while the autoscaler runs
+TEST $CLI volume set $V0 performance.iot-autoscale off
+EXPECT_WITHIN $CONFIG_UPDATE_TIMEOUT "0" get_iot_value autoscale
+EXPECT "^$" get_iot_value autoscale.NORMAL
+
+TEST $CLI volume set $V0 performance.iot-autoscale on
+EXPECT_WITHIN $CONFIG_UPDATE_TIMEOUT "1" get_iot_value autoscale
+TEST dd if=/dev/zero of=$M0/file0 bs=64k count=4
+
+EXPECT_WITHIN $UMOUNT_TIMEOUT "Y" force_umount $M0
+TEST $CLI volume stop $V0
+
+cleanup;
@@ -4721,6 +4721,8 @@ afr_priv_dump (xlator_t *this)
                 gf_proc_dump_write(key, "%"PRId64, GF_ATOMIC_GET(priv->pending_reads[i]));
                 sprintf (key, "child_latency[%d]", i);
                 gf_proc_dump_write(key, "%"PRId64, priv->child_latency[i]);
+                sprintf (key, "read_hedge_delay[%d]", i);
+                gf_proc_dump_write(key, "%"PRIu64, afr_read_hedge_usec (this, i));
         }
         gf_proc_dump_write("data_self_heal", "%s", priv->data_self_heal);
         gf_proc_dump_write("metadata_self_heal", "%d", priv->metadata_self_heal);
@@ -4734,6 +4736,15 @@ afr_priv_dump (xlator_t *this)
                            priv->background_self_heal_count);
         gf_proc_dump_write("healers", "%d", priv->healers);
         gf_proc_dump_write("read-hash-mode", "%d", priv->hash_mode);
+        gf_proc_dump_write("read-hedge-percentile", "%u",
+                           priv->read_hedge_percentile);
+        gf_proc_dump_write("read-hedge-budget", "%u", priv->read_hedge_budget);
+        gf_proc_dump_write("read_hedges", "%"PRIu64,
+                           GF_ATOMIC_GET (priv->read_hedges));
+        gf_proc_dump_write("read_hedge_wins", "%"PRIu64,
+                           GF_ATOMIC_GET (priv->read_hedge_wins));
+        gf_proc_dump_write("read_hedge_denied", "%"PRIu64,
+                           GF_ATOMIC_GET (priv->read_hedge_denied));
         if (priv->quorum_count == AFR_QUORUM_AUTO) {
                 gf_proc_dump_write ("quorum-type", "auto");
         } else if (priv->quorum_count == 0) {
@@ -5607,11 +5618,13 @@ afr_priv_destroy (afr_private_t *priv)
         }
 
         GF_FREE (priv->pending_reads);
+        GF_FREE (priv->read_latency);
         GF_FREE (priv->local);
         GF_FREE (priv->pending_key);
         GF_FREE (priv->children);
         GF_FREE (priv->child_up);
         GF_FREE (priv->child_latency);
+        LOCK_DESTROY (&priv->hedge_lock);
         LOCK_DESTROY (&priv->lock);
 
         GF_FREE (priv);
@@ -1847,6 +1847,232 @@ afr_readv_cbk (call_frame_t *frame, void *cookie,
 }
 
 
+/* A read sent on its own frames, so that it can also be sent to another
+   child if the first one is slow. The read transaction continues with the
+   first successful answer, or with the last one if all of them fail. */
+typedef struct _afr_readv_hedge {
+        gf_lock_t        lock;
+        call_frame_t    *frame;        /* read transaction, until answered */
+        xlator_t        *this;
+        gf_timer_t      *timer;
+        int              refs;
+        int              pending;      /* reads not answered yet */
+        int              subvol;
+        int              hedge_subvol;
+        struct timespec  start;
+        struct timespec  hedge_start;
+        fd_t            *fd;
+        size_t           size;
+        off_t            offset;
+        uint32_t         flags;
+        dict_t          *xdata;
+} afr_readv_hedge_t;
+
+static void
+afr_readv_hedge_unref (afr_readv_hedge_t *hedge)
+{
+        int refs = 0;
+
+        LOCK (&hedge->lock);
+        {
+                refs = --hedge->refs;
+        }
+        UNLOCK (&hedge->lock);
+
+        if (refs != 0)
+                return;
+
+        fd_unref (hedge->fd);
+        if (hedge->xdata)
+                dict_unref (hedge->xdata);
+        LOCK_DESTROY (&hedge->lock);
+        GF_FREE (hedge);
+}
+
+static int
+afr_readv_hedge_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                     int32_t op_ret, int32_t op_errno, struct iovec *vector,
+                     int32_t count, struct iatt *buf, struct iobref *iobref,
+                     dict_t *xdata)
+{
+        afr_private_t *priv = NULL;
+        afr_local_t *local = NULL;
+        afr_readv_hedge_t *hedge = NULL;
+        call_frame_t *read_frame = NULL;
+        gf_timer_t *timer = NULL;
+        int subvol = (long) cookie;
+
+        priv = this->private;
+        hedge = frame->local;
+        frame->local = NULL;
+
+        if (op_ret >= 0)
+                afr_read_latency_record (this, subvol,
+                                         (subvol == hedge->subvol) ?
+                                         &hedge->start : &hedge->hedge_start);
+
+        /* Each read is pending on its child until it's answered, even if
+           the other one has already been used. */
+        afr_pending_read_decrement (priv, subvol);
+
+        LOCK (&hedge->lock);
+        {
+                hedge->pending--;
+                /* A failure is ignored while the other read can still
+                   succeed. */
+                if (hedge->frame && ((op_ret >= 0) || !hedge->pending)) {
+                        read_frame = hedge->frame;
+                        hedge->frame = NULL;
+                        timer = hedge->timer;
+                        hedge->timer = NULL;
+                }
+        }
+        UNLOCK (&hedge->lock);
+
+        if (timer && (gf_timer_call_cancel (this->ctx, timer) == 0))
+                afr_readv_hedge_unref (hedge);
+
+        if (read_frame) {
+                if ((op_ret >= 0) && (subvol != hedge->subvol))
+                        GF_ATOMIC_INC (priv->read_hedge_wins);
+
+                /* The read transaction drops the pending read of its child
+                   when it unwinds or tries another child, but it has
+                   already been dropped above or will be when the first
+                   read is answered. */
+                local = read_frame->local;
+                afr_pending_read_increment (priv, local->read_subvol);
+
+                afr_readv_cbk (read_frame, cookie, this, op_ret, op_errno,
+                               vector, count, buf, iobref, xdata);
+        }
+
+        afr_readv_hedge_unref (hedge);
+        STACK_DESTROY (frame->root);
+
+        return 0;
+}
+
+static void
+afr_readv_hedge_timeout (void *data)
+{
+        afr_readv_hedge_t *hedge = data;
+        afr_private_t *priv = NULL;
+        afr_local_t *local = NULL;
+        call_frame_t *frame = NULL;
+        xlator_t *this = NULL;
+        int subvol = -1;
+
+        this = hedge->this;
+        priv = this->private;
+
+        LOCK (&hedge->lock);
+        {
+                /* The timer could have been cancelled too late. */
+                if (!hedge->timer || !hedge->frame)
+                        goto unlock;
+                hedge->timer = NULL;
+
+                subvol = afr_read_txn_hedge_subvol (hedge->frame, this);
+                if ((subvol == -1) || !afr_read_hedge_allowed (this))
+                        goto unlock;
+
+                frame = copy_frame (hedge->frame);
+                if (!frame)
+                        goto unlock;
+
+                local = hedge->frame->local;
+                local->read_attempted[subvol] = 1;
+
+                hedge->hedge_subvol = subvol;
+                timespec_now (&hedge->hedge_start);
+                hedge->pending++;
+                hedge->refs++;
+        }
+unlock:
+        UNLOCK (&hedge->lock);
+
+        if (frame) {
+                afr_pending_read_increment (priv, subvol);
+
+                frame->local = hedge;
+                STACK_WIND_COOKIE (frame, afr_readv_hedge_cbk,
+                                   (void *) (long) subvol,
+                                   priv->children[subvol],
+                                   priv->children[subvol]->fops->readv,
+                                   hedge->fd, hedge->size, hedge->offset,
+                                   hedge->flags, hedge->xdata);
+        }
+
+        afr_readv_hedge_unref (hedge);
+}
+
+static int
+afr_readv_hedge (call_frame_t *frame, xlator_t *this, int subvol)
+{
+        afr_local_t *local = NULL;
+        afr_private_t *priv = NULL;
+        afr_readv_hedge_t *hedge = NULL;
+        call_frame_t *read_frame = NULL;
+        struct timespec delay = {0, };
+
+        local = frame->local;
+        priv = this->private;
+
+        if (!priv->read_hedge_percentile)
+                return -1;
+
+        hedge = GF_CALLOC (1, sizeof (*hedge), gf_afr_mt_readv_hedge_t);
+        if (!hedge)
+                return -1;
+
+        read_frame = copy_frame (frame);
+        if (!read_frame) {
+                GF_FREE (hedge);
+                return -1;
+        }
+
+        LOCK_INIT (&hedge->lock);
+        hedge->frame = frame;
+        hedge->this = this;
+        hedge->refs = 1;
+        hedge->pending = 1;
+        hedge->subvol = subvol;
+        hedge->hedge_subvol = -1;
+        hedge->fd = fd_ref (local->fd);
+        hedge->size = local->cont.readv.size;
+        hedge->offset = local->cont.readv.offset;
+        hedge->flags = local->cont.readv.flags;
+        if (local->xdata_req)
+                hedge->xdata = dict_ref (local->xdata_req);
+        timespec_now (&hedge->start);
+
+        /* Reads are always timed, but they are only hedged once the latency
+           of the child is known and there's another child to ask. */
+        if ((afr_read_hedge_delay (this, local->readable, &delay) == 0) &&
+            (afr_read_txn_hedge_subvol (frame, this) != -1)) {
+                LOCK (&hedge->lock);
+                {
+                        hedge->refs++;
+                        hedge->timer = gf_timer_call_after (this->ctx, delay,
+                                                afr_readv_hedge_timeout,
+                                                hedge);
+                        if (!hedge->timer)
+                                hedge->refs--;
+                }
+                UNLOCK (&hedge->lock);
+        }
+
+        read_frame->local = hedge;
+        STACK_WIND_COOKIE (read_frame, afr_readv_hedge_cbk,
+                           (void *) (long) subvol, priv->children[subvol],
+                           priv->children[subvol]->fops->readv, hedge->fd,
+                           hedge->size, hedge->offset, hedge->flags,
+                           hedge->xdata);
+
+        return 0;
+}
+
 int
 afr_readv_wind (call_frame_t *frame, xlator_t *this, int subvol)
 {
@@ -1862,6 +2088,9 @@ afr_readv_wind (call_frame_t *frame, xlator_t *this, int subvol)
 		return 0;
 	}
 
+        if (afr_readv_hedge (frame, this, subvol) == 0)
+                return 0;
+
 	STACK_WIND_COOKIE (frame, afr_readv_cbk, (void *) (long) subvol,
 			   priv->children[subvol],
 			   priv->children[subvol]->fops->readv,
@@ -48,6 +48,8 @@ enum gf_afr_mem_types_ {
         gf_afr_mt_empty_brick_t,
         gf_afr_mt_child_latency_t,
         gf_afr_mt_atomic_t,
+        gf_afr_mt_read_latency_t,
+        gf_afr_mt_readv_hedge_t,
     gf_afr_mt_end
 };
 #endif
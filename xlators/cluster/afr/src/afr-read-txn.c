@@ -30,6 +30,185 @@ afr_pending_read_decrement (afr_private_t *priv, int child_index)
         GF_ATOMIC_DEC(priv->pending_reads[child_index]);
 }
 
+void
+afr_read_latency_record (xlator_t *this, int child_index,
+                         struct timespec *start)
+{
+        afr_private_t *priv = NULL;
+        afr_read_latency_t *latency = NULL;
+        struct timespec now = {0, };
+        struct timespec elapsed = {0, };
+        uint64_t usec = 0;
+        int bucket = 0;
+        int i = 0;
+
+        priv = this->private;
+
+        timespec_now (&now);
+        timespec_sub (start, &now, &elapsed);
+        usec = elapsed.tv_sec * 1000000ULL + elapsed.tv_nsec / 1000;
+
+        while ((bucket < AFR_READ_LATENCY_BUCKETS - 1) &&
+               ((usec >> (bucket + 1)) != 0))
+                bucket++;
+
+        LOCK (&priv->hedge_lock);
+        {
+                latency = &priv->read_latency[child_index];
+                if (latency->count >= AFR_READ_LATENCY_WINDOW) {
+                        latency->count = 0;
+                        for (i = 0; i < AFR_READ_LATENCY_BUCKETS; i++) {
+                                latency->buckets[i] >>= 1;
+                                latency->count += latency->buckets[i];
+                        }
+                }
+                latency->buckets[bucket]++;
+                latency->count++;
+        }
+        UNLOCK (&priv->hedge_lock);
+}
+
+/* Returns the time in microseconds within which @percentile percent of the
+   reads of a child have been answered, or 0 if it's not known yet. */
+static uint64_t
+__afr_read_latency_percentile (afr_read_latency_t *latency,
+                               uint32_t percentile)
+{
+        uint64_t target = 0;
+        uint64_t sum = 0;
+        int i = 0;
+
+        if (!percentile || (latency->count < AFR_READ_LATENCY_MIN_SAMPLES))
+                return 0;
+
+        target = (latency->count * percentile + 99) / 100;
+        for (i = 0; i < AFR_READ_LATENCY_BUCKETS - 1; i++) {
+                sum += latency->buckets[i];
+                if (sum >= target)
+                        break;
+        }
+
+        return 2ULL << i;
+}
+
+uint64_t
+afr_read_hedge_usec (xlator_t *this, int child_index)
+{
+        afr_private_t *priv = NULL;
+        uint64_t usec = 0;
+
+        priv = this->private;
+
+        LOCK (&priv->hedge_lock);
+        {
+                usec = __afr_read_latency_percentile (
+                                        &priv->read_latency[child_index],
+                                        priv->read_hedge_percentile);
+        }
+        UNLOCK (&priv->hedge_lock);
+
+        return usec;
+}
+
+/* Called once for every read that may be hedged. Returns 0 and the time to
+   wait for an answer before hedging the read, or -1 if the latencies of the
+   children aren't known yet. The lowest percentile of the @readable
+   children is used, so that a child that has become slow doesn't make
+   its own reads wait longer before being hedged. */
+int
+afr_read_hedge_delay (xlator_t *this, unsigned char *readable,
+                      struct timespec *delay)
+{
+        afr_private_t *priv = NULL;
+        uint64_t usec = 0;
+        uint64_t tmp = 0;
+        int i = 0;
+
+        priv = this->private;
+
+        LOCK (&priv->hedge_lock);
+        {
+                for (i = 0; i < priv->child_count; i++) {
+                        if (!readable[i])
+                                continue;
+                        tmp = __afr_read_latency_percentile (
+                                        &priv->read_latency[i],
+                                        priv->read_hedge_percentile);
+                        if (tmp && (!usec || (tmp < usec)))
+                                usec = tmp;
+                }
+
+                priv->read_hedge_tokens += priv->read_hedge_budget;
+                if (priv->read_hedge_tokens > AFR_READ_HEDGE_BURST * 100)
+                        priv->read_hedge_tokens = AFR_READ_HEDGE_BURST * 100;
+        }
+        UNLOCK (&priv->hedge_lock);
+
+        if (usec == 0)
+                return -1;
+
+        delay->tv_sec = usec / 1000000;
+        delay->tv_nsec = (usec % 1000000) * 1000;
+
+        return 0;
+}
+
+/* Takes the budget of one hedged read, if there is enough left. */
+gf_boolean_t
+afr_read_hedge_allowed (xlator_t *this)
+{
+        afr_private_t *priv = NULL;
+        gf_boolean_t allowed = _gf_false;
+
+        priv = this->private;
+
+        LOCK (&priv->hedge_lock);
+        {
+                if (priv->read_hedge_tokens >= 100) {
+                        priv->read_hedge_tokens -= 100;
+                        allowed = _gf_true;
+                }
+        }
+        UNLOCK (&priv->hedge_lock);
+
+        if (allowed)
+                GF_ATOMIC_INC (priv->read_hedges);
+        else
+                GF_ATOMIC_INC (priv->read_hedge_denied);
+
+        return allowed;
+}
+
+/* Returns the readable child, not tried yet, with the least outstanding
+   reads, or -1 if there's none. */
+int
+afr_read_txn_hedge_subvol (call_frame_t *frame, xlator_t *this)
+{
+        afr_local_t *local = NULL;
+        afr_private_t *priv = NULL;
+        int64_t pending = 0;
+        int64_t least = 0;
+        int subvol = -1;
+        int i = 0;
+
+        local = frame->local;
+        priv = this->private;
+
+        for (i = 0; i < priv->child_count; i++) {
+                if (!local->readable[i] || !local->child_up[i] ||
+                    local->read_attempted[i])
+                        continue;
+
+                pending = GF_ATOMIC_GET (priv->pending_reads[i]);
+                if ((subvol == -1) || (pending < least)) {
+                        subvol = i;
+                        least = pending;
+                }
+        }
+
+        return subvol;
+}
+
 void
 afr_read_txn_wind (call_frame_t *frame, xlator_t *this, int subvol)
 {
@@ -43,6 +43,23 @@ afr_pending_read_increment (afr_private_t *priv, int child_index);
 void
 afr_pending_read_decrement (afr_private_t *priv, int child_index);
 
+void
+afr_read_latency_record (xlator_t *this, int child_index,
+                         struct timespec *start);
+
+uint64_t
+afr_read_hedge_usec (xlator_t *this, int child_index);
+
+int
+afr_read_hedge_delay (xlator_t *this, unsigned char *readable,
+                      struct timespec *delay);
+
+gf_boolean_t
+afr_read_hedge_allowed (xlator_t *this);
+
+int
+afr_read_txn_hedge_subvol (call_frame_t *frame, xlator_t *this);
+
 call_frame_t *afr_transaction_detach_fop_frame (call_frame_t *frame);
 gf_boolean_t afr_has_quorum (unsigned char *subvols, xlator_t *this);
 gf_boolean_t afr_needs_changelog_update (afr_local_t *local);
@@ -207,6 +207,12 @@ reconfigure (xlator_t *this, dict_t *options)
         GF_OPTION_RECONF ("read-hash-mode", priv->hash_mode,
                           options, uint32, out);
 
+        GF_OPTION_RECONF ("read-hedge-percentile", priv->read_hedge_percentile,
+                          options, uint32, out);
+
+        GF_OPTION_RECONF ("read-hedge-budget", priv->read_hedge_budget,
+                          options, uint32, out);
+
         if (read_subvol) {
                 index = xlator_subvolume_index (this, read_subvol);
                 if (index == -1) {
@@ -398,6 +404,7 @@ init (xlator_t *this)
 
         priv = this->private;
         LOCK_INIT (&priv->lock);
+        LOCK_INIT (&priv->hedge_lock);
 
         child_count = xlator_subvolume_count (this);
 
@@ -448,6 +455,22 @@ init (xlator_t *this)
 
         GF_OPTION_INIT ("read-hash-mode", priv->hash_mode, uint32, out);
 
+        priv->read_latency = GF_CALLOC (sizeof (*priv->read_latency),
+                                        priv->child_count,
+                                        gf_afr_mt_read_latency_t);
+        if (!priv->read_latency) {
+                ret = -ENOMEM;
+                goto out;
+        }
+        GF_ATOMIC_INIT (priv->read_hedges, 0);
+        GF_ATOMIC_INIT (priv->read_hedge_wins, 0);
+        GF_ATOMIC_INIT (priv->read_hedge_denied, 0);
+
+        GF_OPTION_INIT ("read-hedge-percentile", priv->read_hedge_percentile,
+                        uint32, out);
+        GF_OPTION_INIT ("read-hedge-budget", priv->read_hedge_budget, uint32,
+                        out);
+
         priv->favorite_child = -1;
 
         GF_OPTION_INIT ("favorite-child-policy", fav_child_policy, str, out);
@@ -738,6 +761,30 @@ struct volume_options options[] = {
                          "2 = hash by GFID of file and client PID.\n"
                          "3 = brick having the least outstanding read requests."
         },
+        { .key = {"read-hedge-percentile"},
+          .type = GF_OPTION_TYPE_INT,
+          .min = 0,
+          .max = 99,
+          .default_value = "0",
+          .op_version = {GD_OP_VERSION_4_1_0},
+          .flags = OPT_FLAG_CLIENT_OPT | OPT_FLAG_SETTABLE | OPT_FLAG_DOC,
+          .tags = {"replicate"},
+          .description = "If a read hasn't been answered within this "
+                         "percentile of the read latencies of its brick, it "
+                         "is also sent to another readable brick, and the "
+                         "first answer is used. 0 disables hedged reads."
+        },
+        { .key = {"read-hedge-budget"},
+          .type = GF_OPTION_TYPE_INT,
+          .min = 1,
+          .max = 100,
+          .default_value = "10",
+          .op_version = {GD_OP_VERSION_4_1_0},
+          .flags = OPT_FLAG_CLIENT_OPT | OPT_FLAG_SETTABLE | OPT_FLAG_DOC,
+          .tags = {"replicate"},
+          .description = "Maximum percentage of reads that can be hedged, "
+                         "to limit the extra load on the bricks."
+        },
         { .key  = {"choose-local" },
           .type = GF_OPTION_TYPE_BOOL,
           .default_value = "true",
@@ -73,6 +73,22 @@ typedef enum {
         AFR_FAV_CHILD_POLICY_MAX,
 } afr_favorite_child_policy;
 
+/* Latencies of the reads answered by a child, in buckets of powers of two
+ * microseconds. Once the window is full, old samples lose half of their
+ * weight, so that the percentiles follow the recent behaviour of the
+ * child. */
+#define AFR_READ_LATENCY_BUCKETS     24
+#define AFR_READ_LATENCY_WINDOW      1024
+#define AFR_READ_LATENCY_MIN_SAMPLES 32
+
+/* Hedged reads that can be sent in a burst, whatever the budget. */
+#define AFR_READ_HEDGE_BURST 16
+
+typedef struct _afr_read_latency {
+        uint64_t buckets[AFR_READ_LATENCY_BUCKETS];
+        uint64_t count;
+} afr_read_latency_t;
+
 struct afr_nfsd {
         gf_boolean_t     iamnfsd;
         uint32_t         halo_max_latency_msec;
@@ -175,6 +191,20 @@ typedef struct _afr_private {
         gf_boolean_t           full_lock;
         gf_boolean_t           esh_granular;
         gf_boolean_t           consistent_io;
+
+        /* Hedged reads: a read that hasn't been answered within the
+           @read_hedge_percentile latency of its child is also sent to
+           another readable child. @read_hedge_tokens is increased by
+           @read_hedge_budget on each read, and each hedged read costs
+           100. */
+        gf_lock_t              hedge_lock;
+        afr_read_latency_t     *read_latency;
+        uint32_t               read_hedge_percentile;
+        uint32_t               read_hedge_budget;
+        int64_t                read_hedge_tokens;
+        gf_atomic_t            read_hedges;
+        gf_atomic_t            read_hedge_wins;
+        gf_atomic_t            read_hedge_denied;
 } afr_private_t;
 
 
@@ -15,6 +15,9 @@
 
 #define VEX_REG_NONE 0
 
+/* size of the memory operands of the EVEX encoded instructions */
+#define EC_CODE_INTEL_EVEX_SIZE 64
+
 enum _ec_code_intel_reg;
 typedef enum _ec_code_intel_reg ec_code_intel_reg_t;
 
@@ -110,6 +113,7 @@ struct _ec_code_intel {
     ec_code_intel_buffer_t offset;
     ec_code_intel_buffer_t immediate;
     ec_code_intel_buffer_t vex;
+    ec_code_intel_buffer_t evex;
     ec_code_intel_rex_t    rex;
     ec_code_intel_modrm_t  modrm;
     ec_code_intel_sib_t    sib;
@@ -181,4 +185,25 @@ void ec_code_intel_op_xor_m2avx(ec_code_builder_t *builder,
                                 ec_code_intel_reg_t index, uint32_t scale,
                                 int32_t offset, uint32_t dst);
 
+void ec_code_intel_op_vzeroupper(ec_code_builder_t *builder);
+
+void ec_code_intel_op_mov_zmm2zmm(ec_code_builder_t *builder, uint32_t src,
+                                  uint32_t dst);
+void ec_code_intel_op_mov_zmm2m(ec_code_builder_t *builder, uint32_t src,
+                                ec_code_intel_reg_t base,
+                                ec_code_intel_reg_t index, uint32_t scale,
+                                int32_t offset);
+void ec_code_intel_op_mov_m2zmm(ec_code_builder_t *builder,
+                                ec_code_intel_reg_t base,
+                                ec_code_intel_reg_t index, uint32_t scale,
+                                int32_t offset, uint32_t dst);
+void ec_code_intel_op_xor_zmm2zmm(ec_code_builder_t *builder, uint32_t src,
+                                  uint32_t dst);
+void ec_code_intel_op_xor3_zmm(ec_code_builder_t *builder, uint32_t src1,
+                               uint32_t src2, uint32_t dst);
+void ec_code_intel_op_xor_m2zmm(ec_code_builder_t *builder,
+                                ec_code_intel_reg_t base,
+                                ec_code_intel_reg_t index, uint32_t scale,
+                                int32_t offset, uint32_t dst);
+
 #endif /* __EC_CODE_INTEL_H__ */
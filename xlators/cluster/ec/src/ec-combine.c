@@ -13,6 +13,7 @@
 #include "libxlator.h"
 #include "byte-order.h"
 
+#include "ec.h"
 #include "ec-types.h"
 #include "ec-helpers.h"
 #include "ec-common.h"
@@ -254,6 +255,8 @@ ec_value_ignore (char *key)
                      strlen (GF_XATTR_CLRLK_CMD)) == 0) ||
             (strcmp(key, DHT_IATT_IN_XDATA_KEY) == 0) ||
             (strncmp(key, EC_QUOTA_PREFIX, strlen(EC_QUOTA_PREFIX)) == 0) ||
+            /* Bricks being healed don't have the same heal map. */
+            (strcmp(key, EC_XATTR_HEAL_MAP) == 0) ||
             (fnmatch(MARKER_XATTR_PREFIX ".*." XTIME, key, 0) == 0) ||
             (fnmatch(GF_XATTR_MARKER_KEY ".*", key, 0) == 0) ||
             (XATTR_IS_NODE_UUID(key))) {
@@ -921,6 +924,14 @@ void ec_combine (ec_cbk_data_t *newcbk, ec_combine_f combine)
 
     fop->received |= newcbk->mask;
 
+    /* A hedged read may have already completed with the answers of other
+     * bricks, which are being processed now. Late answers are ignored. */
+    if (fop->hedged && (fop->answer != NULL)) {
+        UNLOCK(&fop->lock);
+
+        return;
+    }
+
     item = fop->cbk_list.prev;
     list_for_each_entry(cbk, &fop->cbk_list, list)
     {
@@ -20,6 +20,7 @@
 #include "ec-method.h"
 #include "ec.h"
 #include "ec-messages.h"
+#include "ec-write-combine.h"
 
 #define EC_INVALID_INDEX UINT32_MAX
 #define EC_XATTROP_ALL_WAITING_FLAGS (EC_FLAG_WAITING_XATTROP |\
@@ -190,6 +191,13 @@ ec_select_first_by_read_policy (ec_t *ec, ec_fop_data_t *fop)
                         return SuperFastHash((char *)fop->loc[0].gfid,
                                    sizeof(fop->loc[0].gfid)) % ec->nodes;
                 }
+        } else if (ec->read_policy == EC_STABLE) {
+                /* Reads start at the first brick that is up and not being
+                 * healed, so they use the same bricks, and thus the same
+                 * decoding matrix, while nothing changes. */
+                if ((fop->remaining & ~fop->healing) != 0) {
+                        return gf_bits_index(fop->remaining & ~fop->healing);
+                }
         }
         return 0;
 }
@@ -521,27 +529,40 @@ ec_is_recoverable_error (int32_t op_errno)
 
 void ec_complete(ec_fop_data_t * fop)
 {
+    ec_t *ec = fop->xl->private;
     ec_cbk_data_t * cbk = NULL;
-    int32_t resume = 0, update = 0;
+    gf_timer_t *hedge = NULL;
+    uintptr_t good = 0;
+    int32_t resume = 0, update = 0, winds;
     int healing_count = 0;
 
     LOCK(&fop->lock);
 
     ec_trace("COMPLETE", fop, "");
 
-    if (--fop->winds == 0) {
-        if (fop->answer == NULL) {
-            if (!list_empty(&fop->cbk_list)) {
-                cbk = list_entry(fop->cbk_list.next, ec_cbk_data_t, list);
-                healing_count = gf_bits_count (cbk->mask & fop->healing);
-                    /* fop shouldn't be treated as success if it is not
-                     * successful on at least fop->minimum good copies*/
-                if ((cbk->count - healing_count) >= fop->minimum) {
-                    fop->answer = cbk;
-
-                    update = 1;
-                }
+    /* Once a read has been hedged, it doesn't wait for the slow bricks if
+     * enough answers have already been received. */
+    winds = --fop->winds;
+    if (((winds == 0) || fop->hedged) && (fop->answer == NULL)) {
+        if (!list_empty(&fop->cbk_list)) {
+            cbk = list_entry(fop->cbk_list.next, ec_cbk_data_t, list);
+            healing_count = gf_bits_count (cbk->mask & fop->healing);
+                /* fop shouldn't be treated as success if it is not
+                 * successful on at least fop->minimum good copies*/
+            if ((cbk->count - healing_count) >= fop->minimum) {
+                fop->answer = cbk;
+
+                /* Bricks that haven't answered yet are not bad. */
+                good = cbk->mask |
+                       ((fop->mask ^ fop->remaining) & ~fop->received);
+
+                update = 1;
             }
+        }
+
+        if (update || (winds == 0)) {
+            hedge = fop->hedge;
+            fop->hedge = NULL;
 
             resume = 1;
         }
@@ -549,12 +570,20 @@ void ec_complete(ec_fop_data_t * fop)
 
     UNLOCK(&fop->lock);
 
+    if ((hedge != NULL) && (gf_timer_call_cancel(fop->xl->ctx, hedge) == 0)) {
+        ec_fop_data_release(fop);
+    }
+
+    if (update && (winds > 0)) {
+        GF_ATOMIC_INC(ec->stats.read.early);
+    }
+
     /* ec_update_good() locks inode->lock. This may cause deadlocks with
        fop->lock when used in another order. Since ec_update_good() will not
        be called more than once for each fop, it can be called from outside
        the fop->lock locked region. */
     if (update) {
-        ec_update_good(fop, cbk->mask);
+        ec_update_good(fop, good);
     }
 
     if (resume)
@@ -729,6 +758,7 @@ void ec_dispatch_start(ec_fop_data_t * fop)
 {
     fop->answer = NULL;
     fop->good = 0;
+    fop->hedged = _gf_false;
 
     INIT_LIST_HEAD(&fop->cbk_list);
 
@@ -798,6 +828,83 @@ ec_dispatch_all (ec_fop_data_t *fop)
         }
 }
 
+static void
+ec_read_hedge_cbk(void *data)
+{
+    ec_fop_data_t *fop = data;
+    ec_t *ec = fop->xl->private;
+    uint32_t idx = EC_INVALID_INDEX;
+    uintptr_t mask;
+
+    LOCK(&fop->lock);
+
+    /* If the timer has been cancelled when it was already too late, the
+     * read has completed and there's nothing to do. */
+    if (fop->hedge != NULL) {
+        fop->hedge = NULL;
+
+        if ((fop->winds > 0) && (fop->answer == NULL)) {
+            /* The answer of a brick being healed doesn't count to decode
+             * the data, so the read goes to the next brick after the first
+             * one that is not. */
+            mask = fop->remaining & ~fop->healing;
+            if ((mask >> fop->first) != 0) {
+                idx = gf_bits_index(mask >> fop->first) + fop->first;
+            } else if (mask != 0) {
+                idx = gf_bits_index(mask);
+            }
+            if (idx < EC_MAX_NODES) {
+                fop->remaining ^= 1ULL << idx;
+                fop->hedged = _gf_true;
+
+                ec_trace("HEDGE", fop, "idx=%d", idx);
+
+                fop->winds++;
+                fop->refs++;
+            }
+        }
+    }
+
+    UNLOCK(&fop->lock);
+
+    if (idx < EC_MAX_NODES) {
+        GF_ATOMIC_INC(ec->stats.read.hedges);
+
+        fop->wind(ec, fop, idx);
+    }
+
+    ec_fop_data_release(fop);
+}
+
+/* If the answers of a read take too long, the same read is sent to one
+ * more brick and the first answers that are enough to decode the data are
+ * used. */
+static void
+ec_read_hedge(ec_fop_data_t *fop)
+{
+    ec_t *ec = fop->xl->private;
+    struct timespec delay;
+
+    if ((fop->id != GF_FOP_READ) || (ec->read_hedge_timeout == 0) ||
+        ((fop->remaining & ~fop->healing) == 0)) {
+        return;
+    }
+
+    delay.tv_sec = ec->read_hedge_timeout / 1000;
+    delay.tv_nsec = (ec->read_hedge_timeout % 1000) * 1000000;
+
+    LOCK(&fop->lock);
+
+    fop->refs++;
+    fop->hedge = gf_timer_call_after(fop->xl->ctx, delay, ec_read_hedge_cbk,
+                                     fop);
+    if (fop->hedge == NULL) {
+        fop->refs--;
+    }
+
+    UNLOCK(&fop->lock);
+}
+
 void ec_dispatch_min(ec_fop_data_t * fop)
 {
     ec_t * ec = fop->xl->private;
@@ -821,6 +928,8 @@ void ec_dispatch_min(ec_fop_data_t * fop)
         }
 
         ec_dispatch_mask(fop, mask);
+
+        ec_read_hedge(fop);
     }
 }
 
@@ -1552,6 +1661,22 @@ ec_set_inode_size(ec_fop_data_t *fop, inode_t *inode,
     return found;
 }
 
+gf_boolean_t
+__ec_set_inode_iatt(ec_fop_data_t *fop, inode_t *inode, struct iatt *iatt)
+{
+    ec_inode_t *ctx;
+
+    ctx = __ec_inode_get(inode, fop->xl);
+    if (ctx == NULL) {
+        return _gf_false;
+    }
+
+    ctx->iatt = *iatt;
+    ctx->have_iatt = _gf_true;
+
+    return _gf_true;
+}
+
 static void
 ec_release_stripe_cache (ec_inode_t *ctx)
 {
@@ -1585,6 +1710,7 @@ void ec_clear_inode_info(ec_fop_data_t *fop, inode_t *inode)
     ctx->have_config = _gf_false;
     ctx->have_version = _gf_false;
     ctx->have_size = _gf_false;
+    ctx->have_iatt = _gf_false;
 
     memset(&ctx->config, 0, sizeof(ctx->config));
     memset(ctx->pre_version, 0, sizeof(ctx->pre_version));
@@ -2032,9 +2158,23 @@ ec_lock_next_owner(ec_lock_link_t *link, ec_cbk_data_t *cbk,
 
     lock->release |= release;
 
+    /* Only writes keep the cached attributes up to date. Any other fop that
+     * modifies the inode, even if it failed, makes them unreliable. */
+    if ((fop->id != GF_FOP_WRITE) && (link->update[0] || link->update[1])) {
+        ctx->have_iatt = _gf_false;
+    }
+
     if ((fop->error == 0) && (cbk != NULL) && (cbk->op_ret >= 0)) {
         if (link->update[0]) {
             ctx->post_version[0]++;
+            /* Appending writes lock the whole file, so the real range is
+             * taken from the fop. */
+            if (fop->id == GF_FOP_WRITE) {
+                ec_heal_map_mark(ctx->heal_map, fop->offset, fop->size);
+            } else {
+                ec_heal_map_mark(ctx->heal_map, link->fl_start,
+                                 link->fl_end - link->fl_start + 1);
+            }
         }
         if (link->update[1]) {
             ctx->post_version[1]++;
@@ -2202,6 +2342,12 @@ int32_t ec_update_size_version_done(call_frame_t * frame, void * cookie,
         gf_msg(fop->xl->name, fop_log_level (fop->id, op_errno), op_errno,
                EC_MSG_SIZE_VERS_UPDATE_FAIL,
                "Failed to update version and size");
+
+        /* We don't know which regions have been accounted, so all of them
+         * will be on the next update. */
+        LOCK(&lock->loc.inode->lock);
+        memset(ctx->heal_map, 0xff, sizeof(ctx->heal_map));
+        UNLOCK(&lock->loc.inode->lock);
     } else {
         fop->parent->good &= fop->good;
 
@@ -2237,6 +2383,20 @@ int32_t ec_update_size_version_done(call_frame_t * frame, void * cookie,
     return 0;
 }
 
+static int32_t
+ec_update_heal_map(dict_t *dict, uint64_t version, uint64_t *heal_map)
+{
+    uint64_t map[EC_HEAL_MAP_SIZE];
+    uint32_t i;
+
+    map[0] = version;
+    for (i = 0; i < EC_HEAL_MAP_REGIONS; i++) {
+        map[i + 1] = (heal_map[i / 64] >> (i % 64)) & 1;
+    }
+
+    return ec_dict_set_array(dict, EC_XATTR_HEAL_MAP, map, EC_HEAL_MAP_SIZE);
+}
+
 void
 ec_update_size_version(ec_lock_link_t *link, uint64_t *version,
                        uint64_t size, uint64_t *dirty)
@@ -2244,14 +2404,22 @@ ec_update_size_version(ec_lock_link_t *link, uint64_t *version,
     ec_fop_data_t *fop;
     ec_lock_t *lock;
     ec_inode_t *ctx;
+    ec_t *ec;
     dict_t *dict = NULL;
     uintptr_t   update_on = 0;
+    uint64_t heal_map[EC_HEAL_MAP_WORDS];
 
     int32_t err = -ENOMEM;
 
     fop = link->fop;
     lock = link->lock;
     ctx = lock->ctx;
+    ec = fop->xl->private;
+
+    LOCK(&lock->loc.inode->lock);
+    memcpy(heal_map, ctx->heal_map, sizeof(heal_map));
+    memset(ctx->heal_map, 0, sizeof(ctx->heal_map));
+    UNLOCK(&lock->loc.inode->lock);
 
     ec_trace("UPDATE", fop, "version=%ld/%ld, size=%ld, dirty=%ld/%ld",
              version[0], version[1], size, dirty[0], dirty[1]);
@@ -2297,11 +2465,23 @@ ec_update_size_version(ec_lock_link_t *link, uint64_t *version,
         (void)ec_dict_set_number(dict, EC_XATTR_CONFIG, 0);
     }
 
+    update_on = lock->good_mask | lock->healing;
+
+    /* Bricks not being updated will need to be healed. The regions modified
+     * since the last update are accounted in the heal map, along with the
+     * data versions they represent, so that the heal can tell if the map
+     * covers all the changes the sinks have missed. */
+    if ((lock->loc.inode->ia_type == IA_IFREG) &&
+        (version[EC_DATA_TXN] != 0) && ((ec->node_mask & ~update_on) != 0)) {
+        err = ec_update_heal_map(dict, version[EC_DATA_TXN], heal_map);
+        if (err != 0) {
+            goto out;
+        }
+    }
+
     fop->frame->root->uid = 0;
     fop->frame->root->gid = 0;
 
-    update_on = lock->good_mask | lock->healing;
-
     if (link->lock->fd == NULL) {
             ec_xattrop(fop->frame, fop->xl, update_on, EC_MINIMUM_MIN,
                        ec_update_size_version_done, link, &link->lock->loc,
@@ -2324,6 +2504,10 @@ out:
         dict_unref(dict);
     }
 
+    LOCK(&lock->loc.inode->lock);
+    memset(ctx->heal_map, 0xff, sizeof(ctx->heal_map));
+    UNLOCK(&lock->loc.inode->lock);
+
     ec_fop_set_error(fop, -err);
 
     gf_msg (fop->xl->name, GF_LOG_ERROR, -err, EC_MSG_SIZE_VERS_UPDATE_FAIL,
@@ -2409,6 +2593,7 @@ ec_lock_release(ec_t *ec, inode_t *inode)
         ec_lock_t *lock;
         ec_inode_t *ctx;
         ec_lock_link_t *timer_link = NULL;
+        gf_boolean_t flush = _gf_false;
 
         LOCK(&inode->lock);
 
@@ -2421,6 +2606,13 @@ ec_lock_release(ec_t *ec, inode_t *inode)
                 goto done;
         }
 
+        /* Combined writes are sent while we still own the lock. It will be
+         * released once they have been written. */
+        if (__ec_write_combine_pending(ctx)) {
+                ctx->write_combine.release = flush = _gf_true;
+                goto done;
+        }
+
         gf_msg_debug(ec->xl->name, 0,
                      "Releasing inode %p due to lock contention", inode);
 
@@ -2443,6 +2635,10 @@ done:
         if (timer_link != NULL) {
                 ec_unlock_now(timer_link);
         }
+
+        if (flush) {
+                ec_write_combine_flush(ec->xl, inode);
+        }
 }
 
 void ec_unlock_timer_add(ec_lock_link_t *link);
@@ -2453,6 +2649,7 @@ ec_unlock_timer_del(ec_lock_link_t *link)
         ec_lock_t *lock;
         inode_t *inode;
         gf_boolean_t now = _gf_false;
+        gf_boolean_t flush = _gf_false;
 
         /* If we are here, it means that the timer has expired before having
          * been cancelled. This guarantees that 'link' is still valid because
@@ -2490,13 +2687,24 @@ ec_unlock_timer_del(ec_lock_link_t *link)
                 gf_timer_call_cancel(link->fop->xl->ctx, lock->timer);
                 lock->timer = NULL;
 
-                /* Any fop being processed from now on, will need to wait
-                 * until the next unlock/lock cycle. */
-                lock->release = now = _gf_true;
+                /* Combined writes still need the lock. They are sent now,
+                 * and the lock is kept as if the timer had been cancelled
+                 * by them. */
+                if (__ec_write_combine_pending(lock->ctx)) {
+                        flush = _gf_true;
+                } else {
+                        /* Any fop being processed from now on, will need to
+                         * wait until the next unlock/lock cycle. */
+                        lock->release = now = _gf_true;
+                }
         }
 
         UNLOCK(&inode->lock);
 
+        if (flush) {
+                ec_write_combine_flush(link->fop->xl, inode);
+        }
+
         if (now) {
                 ec_unlock_now(link);
         } else {
@@ -2516,6 +2724,8 @@ ec_unlock_timer_del(ec_lock_link_t *link)
                  * unlock timer wasn't started. We need to start it again if we
                  * are the last reference.
                  *
+                 * The write sending combined data is handled the same way.
+                 *
                  * ec_unlock_timer_add() handles both cases.
                  */
                 ec_unlock_timer_add(link);
@@ -2869,6 +3079,13 @@ void ec_manager(ec_fop_data_t * fop, int32_t error)
     if (fop->state == EC_STATE_START)
     {
         fop->state = EC_STATE_INIT;
+
+        /* Writes already acknowledged must reach the bricks before this fop
+         * starts. If they are still buffered, the fop will be resumed once
+         * they have been written. */
+        if ((error == 0) && ec_write_combine_wait(fop, &error)) {
+            return;
+        }
     }
 
     __ec_manager(fop, error);
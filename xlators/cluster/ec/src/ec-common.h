@@ -55,6 +55,7 @@ typedef enum {
 #define EC_STATE_UNLOCK                       7
 
 #define EC_STATE_DELAYED_START              100
+#define EC_STATE_DELAYED_DISPATCH           101
 
 #define EC_STATE_HEAL_ENTRY_LOOKUP          200
 #define EC_STATE_HEAL_ENTRY_PREPARE         201
@@ -112,6 +113,8 @@ gf_boolean_t ec_set_inode_size(ec_fop_data_t *fop, inode_t *inode,
                                uint64_t size);
 gf_boolean_t __ec_set_inode_size(ec_fop_data_t *fop, inode_t *inode,
                                  uint64_t size);
+gf_boolean_t __ec_set_inode_iatt(ec_fop_data_t *fop, inode_t *inode,
+                                 struct iatt *iatt);
 void ec_clear_inode_info(ec_fop_data_t *fop, inode_t *inode);
 
 void ec_flush_size_version(ec_fop_data_t * fop);
@@ -125,6 +128,7 @@ void ec_sleep(ec_fop_data_t *fop);
 void ec_resume(ec_fop_data_t * fop, int32_t error);
 void ec_resume_parent(ec_fop_data_t * fop, int32_t error);
 
+void __ec_manager(ec_fop_data_t * fop, int32_t error);
 void ec_manager(ec_fop_data_t * fop, int32_t error);
 gf_boolean_t ec_is_recoverable_error (int32_t op_errno);
 void ec_handle_healers_done (ec_fop_data_t *fop);
@@ -1720,12 +1720,87 @@ out:
         return ret;
 }
 
+/* Returns in 'maps' the heal map of each brick. A missing or invalid map is
+ * returned as all 0's, which can only make the sources look like they don't
+ * account for the changes, or the sinks like they miss more regions. */
+static void
+ec_heal_data_get_maps (ec_t *ec, default_args_cbk_t *replies,
+                       unsigned char *output, uint64_t *maps, int which)
+{
+        uint64_t *map  = NULL;
+        dict_t   *dict = NULL;
+        int       i    = 0;
+
+        for (i = 0; i < ec->nodes; i++) {
+                map = &maps[i * EC_HEAL_MAP_SIZE];
+                dict = (which == EC_COMBINE_XDATA) ? replies[i].xdata :
+                                                     replies[i].xattr;
+                if (!output[i] ||
+                    (ec_dict_get_array (dict, EC_XATTR_HEAL_MAP, map,
+                                        EC_HEAL_MAP_SIZE) != 0)) {
+                        memset (map, 0, EC_HEAL_MAP_SIZE * sizeof (*map));
+                }
+        }
+}
+
+/* Only the regions whose counters differ between the sources and a sink
+ * need to be rebuilt, as long as the number of data versions accounted by
+ * the maps matches the number of versions the sink has missed. Otherwise,
+ * some change could be missing from the map and the whole file is
+ * rebuilt. */
+static gf_boolean_t
+ec_heal_data_regions (ec_t *ec, uint64_t *versions, uint64_t *maps,
+                      unsigned char *sources, unsigned char *healed_sinks,
+                      int source, uint64_t *regions)
+{
+        uint64_t *source_map     = NULL;
+        uint64_t *map            = NULL;
+        uint64_t  source_version = 0;
+        uint64_t  version        = 0;
+        int       i              = 0;
+        int       j              = 0;
+
+        memset (regions, 0, EC_HEAL_MAP_WORDS * sizeof (*regions));
+        source_map = &maps[source * EC_HEAL_MAP_SIZE];
+        source_version = versions[source] & ~(1ULL << EC_SELFHEAL_BIT);
+
+        for (i = 0; i < ec->nodes; i++) {
+                map = &maps[i * EC_HEAL_MAP_SIZE];
+                if (sources[i]) {
+                        if (memcmp (map, source_map,
+                                    EC_HEAL_MAP_SIZE * sizeof (*map)) != 0) {
+                                return _gf_false;
+                        }
+                        continue;
+                }
+                if (!healed_sinks[i]) {
+                        continue;
+                }
+
+                /* A sink without any version could have been created by an
+                 * entry heal. */
+                version = versions[i] & ~(1ULL << EC_SELFHEAL_BIT);
+                if ((version == 0) || (version >= source_version) ||
+                    (source_map[0] - map[0] != source_version - version)) {
+                        return _gf_false;
+                }
+
+                for (j = 0; j < EC_HEAL_MAP_REGIONS; j++) {
+                        if (source_map[j + 1] != map[j + 1]) {
+                                regions[j / 64] |= 1ULL << (j % 64);
+                        }
+                }
+        }
+
+        return _gf_true;
+}
+
 int
 __ec_heal_data_prepare (call_frame_t *frame, ec_t *ec, fd_t *fd,
                         unsigned char *locked_on, uint64_t *versions,
-                        uint64_t *dirty, uint64_t *size, unsigned char *sources,
-                        unsigned char *healed_sinks, unsigned char *trim,
-                        struct iatt *stbuf)
+                        uint64_t *dirty, uint64_t *size, uint64_t *maps,
+                        unsigned char *sources, unsigned char *healed_sinks,
+                        unsigned char *trim, struct iatt *stbuf)
 {
         default_args_cbk_t *replies = NULL;
         default_args_cbk_t *fstat_replies = NULL;
@@ -1733,6 +1808,7 @@ __ec_heal_data_prepare (call_frame_t *frame, ec_t *ec, fd_t *fd,
         unsigned char      *fstat_output  = NULL;
         dict_t             *xattrs  = NULL;
         uint64_t           zero_array[2] = {0};
+        uint64_t           zero_map[EC_HEAL_MAP_SIZE] = {0};
         int                source   = 0;
         int                ret      = 0;
         uint64_t           zero_value = 0;
@@ -1749,7 +1825,10 @@ __ec_heal_data_prepare (call_frame_t *frame, ec_t *ec, fd_t *fd,
             dict_set_static_bin (xattrs, EC_XATTR_DIRTY, zero_array,
                                  sizeof (zero_array)) ||
             dict_set_static_bin (xattrs, EC_XATTR_SIZE, &zero_value,
-                                 sizeof (zero_value))) {
+                                 sizeof (zero_value)) ||
+            ((maps != NULL) &&
+             dict_set_static_bin (xattrs, EC_XATTR_HEAL_MAP, zero_map,
+                                  sizeof (zero_map)))) {
                 ret = -ENOMEM;
                 goto out;
         }
@@ -1784,6 +1863,10 @@ __ec_heal_data_prepare (call_frame_t *frame, ec_t *ec, fd_t *fd,
         if (stbuf)
                 *stbuf = replies[source].stat;
 
+        if (maps)
+                ec_heal_data_get_maps (ec, replies, output, maps,
+                                       EC_COMBINE_DICT);
+
         for (i = 0; i < ec->nodes; i++) {
                 if (healed_sinks[i]) {
                         if (replies[i].stat.ia_size)
@@ -1994,10 +2077,13 @@ ec_sync_heal_block (call_frame_t *frame, xlator_t *this, ec_heal_t *heal)
 
 int
 ec_rebuild_data (call_frame_t *frame, ec_t *ec, fd_t *fd, uint64_t size,
-                 unsigned char *sources, unsigned char *healed_sinks)
+                 unsigned char *sources, unsigned char *healed_sinks,
+                 uint64_t *regions)
 {
         ec_heal_t        *heal = NULL;
         int              ret = 0;
+        uint64_t         healed = 0;
+        uint64_t         skipped = 0;
         syncbarrier_t    barrier;
 
         if (syncbarrier_init (&barrier))
@@ -2033,6 +2119,12 @@ ec_rebuild_data (call_frame_t *frame, ec_t *ec, fd_t *fd, uint64_t size,
                         break;
                 }
 
+                if ((regions != NULL) &&
+                    !ec_heal_map_test (regions, heal->offset, heal->size)) {
+                        skipped += min (heal->size, size - heal->offset);
+                        continue;
+                }
+
                 gf_msg_debug (ec->xl->name, 0, "%s: sources: %d, sinks: "
                         "%d, offset: %"PRIu64" bsize: %"PRIu64,
                         uuid_utoa (fd->inode->gfid),
@@ -2043,7 +2135,10 @@ ec_rebuild_data (call_frame_t *frame, ec_t *ec, fd_t *fd, uint64_t size,
                 if (ret < 0)
                         break;
 
+                healed += min (heal->size, size - heal->offset);
         }
+        GF_ATOMIC_ADD (ec->stats.heal.healed, healed);
+        GF_ATOMIC_ADD (ec->stats.heal.skipped, skipped);
         memset (healed_sinks, 0, ec->nodes);
         ec_mask_to_char_array (heal->bad, healed_sinks, ec->nodes);
         fd_unref (heal->fd);
@@ -2098,13 +2193,17 @@ out:
 int
 ec_data_undo_pending (call_frame_t *frame, ec_t *ec, fd_t *fd, dict_t *xattr,
                       uint64_t *versions, uint64_t *dirty, uint64_t *size,
-                      int source, gf_boolean_t erase_dirty, int idx)
+                      uint64_t *maps, int source, gf_boolean_t erase_dirty,
+                      int idx)
 {
         uint64_t versions_xattr[2] = {0};
         uint64_t dirty_xattr[2]    = {0};
         uint64_t allzero[2]        = {0};
+        uint64_t map_xattr[EC_HEAL_MAP_SIZE] = {0};
         uint64_t size_xattr        = 0;
+        gf_boolean_t map_changed   = _gf_false;
         int      ret               = 0;
+        int      i                 = 0;
 
         versions_xattr[EC_DATA_TXN] = hton64(versions[source] - versions[idx]);
         ret = dict_set_static_bin (xattr, EC_XATTR_VERSION,
@@ -2128,9 +2227,22 @@ ec_data_undo_pending (call_frame_t *frame, ec_t *ec, fd_t *fd, dict_t *xattr,
                         goto out;
         }
 
+        /* The healed brick gets the same heal map as the sources, so that
+         * the regions modified from now on can be told apart. */
+        for (i = 0; i < EC_HEAL_MAP_SIZE; i++) {
+                map_xattr[i] = hton64(maps[source * EC_HEAL_MAP_SIZE + i] -
+                                      maps[idx * EC_HEAL_MAP_SIZE + i]);
+                if (map_xattr[i] != 0)
+                        map_changed = _gf_true;
+        }
+        ret = dict_set_static_bin (xattr, EC_XATTR_HEAL_MAP, map_xattr,
+                                   sizeof (map_xattr));
+        if (ret < 0)
+                goto out;
+
         if ((memcmp (versions_xattr, allzero, sizeof (allzero)) == 0) &&
             (memcmp (dirty_xattr, allzero, sizeof (allzero)) == 0) &&
-             (size_xattr == 0)) {
+             (size_xattr == 0) && !map_changed) {
                 ret = 0;
                 goto out;
         }
@@ -2144,7 +2256,8 @@ out:
 int
 __ec_fd_data_adjust_versions (call_frame_t *frame, ec_t *ec, fd_t *fd,
                             unsigned char *sources, unsigned char *healed_sinks,
-                            uint64_t *versions, uint64_t *dirty, uint64_t *size)
+                            uint64_t *versions, uint64_t *dirty, uint64_t *size,
+                            uint64_t *maps)
 {
         dict_t                     *xattr            = NULL;
         int                        i                 = 0;
@@ -2181,7 +2294,8 @@ __ec_fd_data_adjust_versions (call_frame_t *frame, ec_t *ec, fd_t *fd,
                 if (healed_sinks[i]) {
                         ret = ec_data_undo_pending (frame, ec, fd, xattr,
                                                     versions, dirty, size,
-                                                    source, erase_dirty, i);
+                                                    maps, source, erase_dirty,
+                                                    i);
                         if (ret < 0)
                                 goto out;
                 }
@@ -2195,7 +2309,8 @@ __ec_fd_data_adjust_versions (call_frame_t *frame, ec_t *ec, fd_t *fd,
                 if (sources[i]) {
                         ret = ec_data_undo_pending (frame, ec, fd, xattr,
                                                     versions, dirty, size,
-                                                    source, erase_dirty, i);
+                                                    maps, source, erase_dirty,
+                                                    i);
                         if (ret < 0)
                                 continue;
                 }
@@ -2212,7 +2327,7 @@ ec_restore_time_and_adjust_versions (call_frame_t *frame, ec_t *ec, fd_t *fd,
                                      unsigned char *sources,
                                      unsigned char *healed_sinks,
                                      uint64_t *versions, uint64_t *dirty,
-                                     uint64_t *size)
+                                     uint64_t *size, uint64_t *maps)
 {
         unsigned char      *locked_on           = NULL;
         unsigned char      *participants        = NULL;
@@ -2259,7 +2374,8 @@ ec_restore_time_and_adjust_versions (call_frame_t *frame, ec_t *ec, fd_t *fd,
 
                 ret = __ec_heal_data_prepare (frame, ec, fd, locked_on,
                                               postsh_versions, postsh_dirty,
-                                              postsh_size, postsh_sources,
+                                              postsh_size, NULL,
+                                              postsh_sources,
                                               postsh_healed_sinks, postsh_trim,
                                               &source_buf);
                 if (ret < 0)
@@ -2278,7 +2394,8 @@ ec_restore_time_and_adjust_versions (call_frame_t *frame, ec_t *ec, fd_t *fd,
                         goto unlock;
                 }
                 ret = __ec_fd_data_adjust_versions (frame, ec, fd, sources,
-                                           healed_sinks, versions, dirty, size);
+                                           healed_sinks, versions, dirty, size,
+                                           maps);
         }
 unlock:
         cluster_uninodelk (ec->xl_list, locked_on, ec->nodes, replies, output,
@@ -2297,6 +2414,9 @@ __ec_heal_data (call_frame_t *frame, ec_t *ec, fd_t *fd, unsigned char *heal_on,
         uint64_t           *versions     = NULL;
         uint64_t           *dirty        = NULL;
         uint64_t           *size         = NULL;
+        uint64_t           *maps         = NULL;
+        uint64_t           regions[EC_HEAL_MAP_WORDS];
+        gf_boolean_t       partial       = _gf_false;
         unsigned char      *trim         = NULL;
         default_args_cbk_t *replies      = NULL;
         int                ret           = 0;
@@ -2308,6 +2428,7 @@ __ec_heal_data (call_frame_t *frame, ec_t *ec, fd_t *fd, unsigned char *heal_on,
         versions     = alloca0 (ec->nodes * sizeof (*versions));
         dirty        = alloca0 (ec->nodes * sizeof (*dirty));
         size         = alloca0 (ec->nodes * sizeof (*size));
+        maps         = alloca0 (ec->nodes * EC_HEAL_MAP_SIZE * sizeof (*maps));
 
         EC_REPLIES_ALLOC (replies, ec->nodes);
         ret = cluster_inodelk (ec->xl_list, heal_on, ec->nodes, replies,
@@ -2323,19 +2444,23 @@ __ec_heal_data (call_frame_t *frame, ec_t *ec, fd_t *fd, unsigned char *heal_on,
                 }
 
                 ret = __ec_heal_data_prepare (frame, ec, fd, locked_on,
-                                              versions, dirty, size, sources,
-                                              healed_sinks, trim, NULL);
+                                              versions, dirty, size, maps,
+                                              sources, healed_sinks, trim,
+                                              NULL);
                 if (ret < 0)
                         goto unlock;
 
                 if (EC_COUNT(healed_sinks, ec->nodes) == 0) {
                         ret = __ec_fd_data_adjust_versions (frame, ec, fd,
                                                             sources,
-                                        healed_sinks, versions, dirty, size);
+                                        healed_sinks, versions, dirty, size,
+                                        maps);
                         goto unlock;
                 }
 
                 source = ret;
+                partial = ec_heal_data_regions (ec, versions, maps, sources,
+                                                healed_sinks, source, regions);
                 ret = __ec_heal_mark_sinks (frame, ec, fd, versions,
                                             healed_sinks);
                 if (ret < 0)
@@ -2358,14 +2483,20 @@ unlock:
                 EC_COUNT (sources, ec->nodes),
                 EC_COUNT (healed_sinks, ec->nodes));
 
+        if (partial) {
+                GF_ATOMIC_INC (ec->stats.heal.partial);
+        } else {
+                GF_ATOMIC_INC (ec->stats.heal.full);
+        }
+
         ret = ec_rebuild_data (frame, ec, fd, size[source], sources,
-                               healed_sinks);
+                               healed_sinks, partial ? regions : NULL);
         if (ret < 0)
                 goto out;
 
         ret = ec_restore_time_and_adjust_versions (frame, ec, fd, sources,
                                                    healed_sinks, versions,
-                                                   dirty, size);
+                                                   dirty, size, maps);
 out:
         cluster_replies_wipe (replies, ec->nodes);
         return ret;
@@ -3120,6 +3251,101 @@ unlock:
         return ret;
 }
 
+/* Computes how much data of a file needs to be rebuilt. */
+static int32_t
+ec_heal_data_pending (call_frame_t *frame, ec_t *ec, inode_t *inode,
+                      unsigned char *up_subvols, uint64_t *pending,
+                      uint64_t *total)
+{
+        loc_t              loc                        = {0};
+        dict_t             *xdata                     = NULL;
+        uint64_t           zero_array[2]              = {0};
+        uint64_t           zero_map[EC_HEAL_MAP_SIZE] = {0};
+        uint64_t           zero_value                 = 0;
+        uint64_t           regions[EC_HEAL_MAP_WORDS];
+        uint64_t           offset                     = 0;
+        uint64_t           *versions                  = NULL;
+        uint64_t           *dirty                     = NULL;
+        uint64_t           *size                      = NULL;
+        uint64_t           *maps                      = NULL;
+        unsigned char      *sources                   = NULL;
+        unsigned char      *healed_sinks              = NULL;
+        unsigned char      *output                    = NULL;
+        default_args_cbk_t *replies                   = NULL;
+        int                source                     = 0;
+        int                ret                        = 0;
+
+        EC_REPLIES_ALLOC (replies, ec->nodes);
+        output = alloca0 (ec->nodes);
+        sources = alloca0 (ec->nodes);
+        healed_sinks = alloca0 (ec->nodes);
+        versions = alloca0 (ec->nodes * sizeof (*versions));
+        dirty = alloca0 (ec->nodes * sizeof (*dirty));
+        size = alloca0 (ec->nodes * sizeof (*size));
+        maps = alloca0 (ec->nodes * EC_HEAL_MAP_SIZE * sizeof (*maps));
+
+        loc.inode = inode_ref (inode);
+        gf_uuid_copy (loc.gfid, inode->gfid);
+
+        xdata = dict_new ();
+        if (!xdata ||
+            dict_set_static_bin (xdata, EC_XATTR_VERSION, zero_array,
+                                 sizeof (zero_array)) ||
+            dict_set_static_bin (xdata, EC_XATTR_DIRTY, zero_array,
+                                 sizeof (zero_array)) ||
+            dict_set_static_bin (xdata, EC_XATTR_SIZE, &zero_value,
+                                 sizeof (zero_value)) ||
+            dict_set_static_bin (xdata, EC_XATTR_HEAL_MAP, zero_map,
+                                 sizeof (zero_map))) {
+                ret = -ENOMEM;
+                goto out;
+        }
+
+        ret = cluster_lookup (ec->xl_list, up_subvols, ec->nodes, replies,
+                              output, frame, ec->xl, &loc, xdata);
+        if (ret <= ec->fragments) {
+                ret = -ENOTCONN;
+                goto out;
+        }
+
+        source = ec_heal_data_find_direction (ec, replies, versions, dirty,
+                                              size, sources, healed_sinks,
+                                              _gf_false, EC_COMBINE_XDATA);
+        if (source < 0) {
+                ret = source;
+                goto out;
+        }
+
+        *total = size[source];
+        *pending = size[source];
+
+        ec_heal_data_get_maps (ec, replies, output, maps, EC_COMBINE_XDATA);
+        if ((EC_COUNT (healed_sinks, ec->nodes) == 0) ||
+            !ec_heal_data_regions (ec, versions, maps, sources, healed_sinks,
+                                   source, regions)) {
+                ret = 0;
+                goto out;
+        }
+
+        *pending = 0;
+        for (offset = 0; offset < size[source];
+             offset += EC_HEAL_MAP_REGION_SIZE) {
+                if (ec_heal_map_test (regions, offset, 1)) {
+                        *pending += min (EC_HEAL_MAP_REGION_SIZE,
+                                         size[source] - offset);
+                }
+        }
+        ret = 0;
+
+out:
+        cluster_replies_wipe (replies, ec->nodes);
+        loc_wipe (&loc);
+        if (xdata) {
+                dict_unref (xdata);
+        }
+        return ret;
+}
+
 int32_t
 ec_get_heal_info (xlator_t *this, loc_t *entry_loc, dict_t **dict_rsp)
 {
@@ -3129,6 +3355,9 @@ ec_get_heal_info (xlator_t *this, loc_t *entry_loc, dict_t **dict_rsp)
         ec_t            *ec             = NULL;
         unsigned char   *up_subvols     = NULL;
         loc_t           loc             = {0, };
+        uint64_t        pending         = 0;
+        uint64_t        total           = 0;
+        gf_boolean_t    have_pending    = _gf_false;
 
         VALIDATE_OR_GOTO(this, out);
         GF_VALIDATE_OR_GOTO(this->name, entry_loc, out);
@@ -3173,9 +3402,24 @@ ec_get_heal_info (xlator_t *this, loc_t *entry_loc, dict_t **dict_rsp)
                                       &need_heal);
         if (ret < 0)
                 goto out;
+
+        if ((need_heal == EC_HEAL_MUST) && (loc.inode->ia_type == IA_IFREG)) {
+                have_pending = (ec_heal_data_pending (frame, ec, loc.inode,
+                                                      up_subvols, &pending,
+                                                      &total) == 0);
+        }
 set_heal:
         if (need_heal == EC_HEAL_MUST) {
                 ret =  ec_set_heal_info (dict_rsp, "heal");
+                /* The size of the data still to be rebuilt is only an
+                 * additional hint. */
+                if ((ret == 0) && have_pending &&
+                    (dict_set_uint64 (*dict_rsp, "heal-info-pending",
+                                      pending) ||
+                     dict_set_uint64 (*dict_rsp, "heal-info-size", total))) {
+                        gf_msg_debug (this->name, 0, "Failed to set the size "
+                                      "of the data pending heal");
+                }
         } else {
                 ret =  ec_set_heal_info (dict_rsp, "no-heal");
         }
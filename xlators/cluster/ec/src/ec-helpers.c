@@ -730,6 +730,8 @@ ec_inode_t * __ec_inode_get(inode_t * inode, xlator_t * xl)
             memset(ctx, 0, sizeof(*ctx));
             INIT_LIST_HEAD(&ctx->heal);
             INIT_LIST_HEAD(&ctx->stripe_cache.lru);
+            INIT_LIST_HEAD(&ctx->write_combine.list);
+            INIT_LIST_HEAD(&ctx->write_combine.waiting);
             value = (uint64_t)(uintptr_t)ctx;
             if (__inode_ctx_set(inode, xl, &value) != 0)
             {
@@ -850,6 +852,58 @@ ec_is_data_fop (glusterfs_fop_t fop)
         }
         return _gf_false;
 }
+
+void
+ec_heal_map_mark (uint64_t *map, uint64_t offset, uint64_t size)
+{
+        uint64_t first, last;
+
+        if (size == 0) {
+                return;
+        }
+
+        first = offset / EC_HEAL_MAP_REGION_SIZE;
+        if (size > UINT64_MAX - offset) {
+                last = UINT64_MAX / EC_HEAL_MAP_REGION_SIZE;
+        } else {
+                last = (offset + size - 1) / EC_HEAL_MAP_REGION_SIZE;
+        }
+
+        if (last - first >= EC_HEAL_MAP_REGIONS - 1) {
+                memset (map, 0xff, EC_HEAL_MAP_WORDS * sizeof (uint64_t));
+                return;
+        }
+
+        for (; first <= last; first++) {
+                map[(first % EC_HEAL_MAP_REGIONS) / 64] |=
+                                        1ULL << (first % 64);
+        }
+}
+
+gf_boolean_t
+ec_heal_map_test (uint64_t *map, uint64_t offset, uint64_t size)
+{
+        uint64_t first, last;
+
+        if (size == 0) {
+                return _gf_false;
+        }
+
+        first = offset / EC_HEAL_MAP_REGION_SIZE;
+        last = (offset + size - 1) / EC_HEAL_MAP_REGION_SIZE;
+        if (last - first >= EC_HEAL_MAP_REGIONS - 1) {
+                last = first + EC_HEAL_MAP_REGIONS - 1;
+        }
+
+        for (; first <= last; first++) {
+                if (map[(first % EC_HEAL_MAP_REGIONS) / 64] &
+                    (1ULL << (first % 64))) {
+                        return _gf_true;
+                }
+        }
+
+        return _gf_false;
+}
 /*
 gf_boolean_t
 ec_is_metadata_fop (int32_t lock_kind, glusterfs_fop_t fop)
@@ -176,6 +176,12 @@ ec_filter_internal_xattrs (dict_t *xattr);
 gf_boolean_t
 ec_is_data_fop (glusterfs_fop_t fop);
 
+void
+ec_heal_map_mark (uint64_t *map, uint64_t offset, uint64_t size);
+
+gf_boolean_t
+ec_heal_map_test (uint64_t *map, uint64_t offset, uint64_t size);
+
 int32_t
 ec_launch_replace_heal (ec_t *ec);
 
@@ -18,6 +18,7 @@
 #include "ec-combine.h"
 #include "ec-method.h"
 #include "ec-fops.h"
+#include "ec-parallel.h"
 
 /* FOP: access */
 
@@ -1210,8 +1211,12 @@ int32_t ec_readv_rebuild(ec_t * ec, ec_fop_data_t * fop, ec_cbk_data_t * cbk)
             goto out;
         }
 
-        err = ec_method_decode(&ec->matrix, fsize, cbk->mask, values, blocks,
-                               ptr);
+        /* Large reads are decoded by several threads. The data is only
+         * used once the fop is resumed, after all of them have finished,
+         * but the buffers may be released before, so the threads keep
+         * them alive. */
+        err = ec_parallel_decode(fop, fsize, cbk->mask, values, blocks, ptr,
+                                 cbk->buffers, iobref);
         if (err != 0) {
             goto out;
         }
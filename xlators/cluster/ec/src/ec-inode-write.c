@@ -19,6 +19,7 @@
 #include "ec-method.h"
 #include "ec-fops.h"
 #include "ec-mem-types.h"
+#include "ec-parallel.h"
 
 int32_t
 ec_update_writev_cbk (call_frame_t *frame, void *cookie,
@@ -2157,8 +2158,8 @@ ec_writev_encode(ec_fop_data_t *fop)
     for (i = 1; i < ec->nodes; i++) {
         blocks[i] = blocks[i - 1] + fop->vector[1].iov_len;
     }
-    ec_method_encode(&ec->matrix, fop->vector[0].iov_len,
-                     fop->vector[0].iov_base, blocks);
+    ec_parallel_encode(fop, fop->vector[0].iov_len, fop->vector[0].iov_base,
+                       blocks);
 }
 
 int32_t ec_manager_writev(ec_fop_data_t *fop, int32_t state)
@@ -2205,8 +2206,13 @@ int32_t ec_manager_writev(ec_fop_data_t *fop, int32_t state)
             fop->frame->root->uid = fop->uid;
             fop->frame->root->gid = fop->gid;
 
+            /* Large writes are encoded by several threads. The fop is
+             * resumed once all of them have finished. */
             ec_writev_encode(fop);
 
+            return EC_STATE_DELAYED_DISPATCH;
+
+        case EC_STATE_DELAYED_DISPATCH:
             ec_dispatch_all(fop);
 
             return EC_STATE_PREPARE_ANSWER;
@@ -2240,6 +2246,11 @@ int32_t ec_manager_writev(ec_fop_data_t *fop, int32_t state)
                             }
                             cbk->iatt[1].ia_size = size;
                         }
+                        /* Combined writes are answered with these. */
+                        if ((fop->parent == NULL) && (fop->error == 0)) {
+                            __ec_set_inode_iatt(fop, fop->fd->inode,
+                                                &cbk->iatt[1]);
+                        }
                 }
                 UNLOCK(&fop->fd->inode->lock);
 
@@ -2283,6 +2294,7 @@ int32_t ec_manager_writev(ec_fop_data_t *fop, int32_t state)
         case -EC_STATE_INIT:
         case -EC_STATE_LOCK:
         case -EC_STATE_DISPATCH:
+        case -EC_STATE_DELAYED_DISPATCH:
         case -EC_STATE_PREPARE_ANSWER:
         case -EC_STATE_REPORT:
             GF_ASSERT(fop->error != 0);
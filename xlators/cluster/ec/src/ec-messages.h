@@ -99,7 +99,9 @@ GLFS_MSGID(EC,
         EC_MSG_NO_GF,
         EC_MSG_MATRIX_FAILED,
         EC_MSG_DYN_CREATE_FAILED,
-        EC_MSG_DYN_CODEGEN_FAILED
+        EC_MSG_DYN_CODEGEN_FAILED,
+        EC_MSG_THREAD_CREATE_FAILED,
+        EC_MSG_WRITE_COMBINE_FAILED
 );
 
 #endif /* !_EC_MESSAGES_H_ */
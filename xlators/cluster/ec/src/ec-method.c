@@ -212,10 +212,19 @@ ec_method_matrix_get(ec_matrix_list_t *list, uintptr_t mask, uint32_t *rows)
     if (matrix != NULL) {
         list_del_init(&matrix->lru);
         matrix->refs++;
+        list->hits++;
 
         goto out;
     }
 
+    list->misses++;
+
+    /* Building a matrix is expensive, so the cache grows to hold all the
+     * masks that are being used, as long as they don't exceed the limit. */
+    if ((list->count >= list->max) && (list->max < list->limit)) {
+        list->max++;
+    }
+
     if ((list->count >= list->max) && !list_empty(&list->lru)) {
         matrix = list_first_entry(&list->lru, ec_matrix_t, lru);
         list_del_init(&matrix->lru);
@@ -223,6 +232,8 @@ ec_method_matrix_get(ec_matrix_list_t *list, uintptr_t mask, uint32_t *rows)
         ec_method_matrix_remove(list, matrix->mask);
 
         ec_method_matrix_release(matrix);
+
+        list->evictions++;
     } else {
         matrix = mem_get0(list->pool);
         if (matrix == NULL) {
@@ -301,11 +312,12 @@ failed:
 
 int32_t
 ec_method_init(xlator_t *xl, ec_matrix_list_t *list, uint32_t columns,
-               uint32_t rows, uint32_t max, const char *gen)
+               uint32_t rows, uint32_t max, uint32_t limit, const char *gen)
 {
     list->columns = columns;
     list->rows = rows;
     list->max = max;
+    list->limit = limit;
     list->stripe = EC_METHOD_CHUNK_SIZE * list->columns;
     INIT_LIST_HEAD(&list->lru);
     int32_t err;
@@ -319,7 +331,8 @@ ec_method_init(xlator_t *xl, ec_matrix_list_t *list, uint32_t columns,
         goto failed;
     }
 
-    list->objects = GF_MALLOC(sizeof(ec_matrix_t *) * max, ec_mt_ec_matrix_t);
+    list->objects = GF_MALLOC(sizeof(ec_matrix_t *) * limit,
+                              ec_mt_ec_matrix_t);
     if (list->objects == NULL) {
         err = -ENOMEM;
         goto failed_pool;
@@ -415,10 +428,19 @@ ec_method_decode(ec_matrix_list_t *list, size_t size, uintptr_t mask,
                  uint32_t *rows, void **in, void *out)
 {
     ec_matrix_t *matrix;
+    uintptr_t used;
     size_t pos;
     uint32_t i;
 
-    matrix = ec_method_matrix_get(list, mask, rows);
+    /* Only the first fragments are used to decode, so answers from more
+     * bricks than needed share the matrix of the bricks actually used. */
+    used = 0;
+    for (i = 0; (i < list->columns) && (mask != 0); i++) {
+        used |= mask & -mask;
+        mask &= mask - 1;
+    }
+
+    matrix = ec_method_matrix_get(list, used, rows);
     if (EC_IS_ERR(matrix)) {
         return EC_GET_ERR(matrix);
     }
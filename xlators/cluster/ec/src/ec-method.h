@@ -32,7 +32,7 @@
 
 int32_t
 ec_method_init(xlator_t *xl, ec_matrix_list_t *list, uint32_t columns,
-               uint32_t rows, uint32_t max, const char *gen);
+               uint32_t rows, uint32_t max, uint32_t limit, const char *gen);
 
 void ec_method_fini(ec_matrix_list_t *list);
 
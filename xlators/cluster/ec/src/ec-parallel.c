@@ -0,0 +1,313 @@
+/*
+  Copyright (c) 2018 Red Hat, Inc. <http://www.redhat.com>
+  This file is part of GlusterFS.
+
+  This file is licensed to you under your choice of the GNU Lesser
+  General Public License, version 3 or any later version (LGPLv3 or
+  later), or the GNU General Public License, version 2 (GPLv2), in all
+  cases as published by the Free Software Foundation.
+*/
+
+#include "xlator.h"
+#include "common-utils.h"
+
+#include "ec.h"
+#include "ec-messages.h"
+#include "ec-mem-types.h"
+#include "ec-common.h"
+#include "ec-method.h"
+#include "ec-parallel.h"
+
+static int32_t
+ec_parallel_run(ec_t *ec, ec_parallel_job_t *job)
+{
+    if (job->decode) {
+        return ec_method_decode(&ec->matrix, job->size, job->mask, job->rows,
+                                job->blocks, job->data);
+    }
+
+    ec_method_encode(&ec->matrix, job->size, job->data, job->blocks);
+
+    return 0;
+}
+
+static void *
+ec_parallel_worker(void *arg)
+{
+    ec_t *ec = arg;
+    ec_parallel_t *parallel = &ec->parallel;
+    ec_parallel_job_t *job;
+    int32_t err;
+
+    pthread_mutex_lock(&parallel->mutex);
+
+    while (1) {
+        while (list_empty(&parallel->jobs) &&
+               (parallel->threads <= parallel->max_threads)) {
+            pthread_cond_wait(&parallel->cond, &parallel->mutex);
+        }
+        /* Extra threads only leave once there is nothing left to do. */
+        if (list_empty(&parallel->jobs)) {
+            break;
+        }
+
+        job = list_first_entry(&parallel->jobs, ec_parallel_job_t, list);
+        list_del_init(&job->list);
+
+        pthread_mutex_unlock(&parallel->mutex);
+
+        err = ec_parallel_run(ec, job);
+        if (job->in != NULL) {
+            iobref_unref(job->in);
+        }
+        if (job->out != NULL) {
+            iobref_unref(job->out);
+        }
+        ec_resume(job->fop, -err);
+        GF_FREE(job);
+
+        pthread_mutex_lock(&parallel->mutex);
+    }
+
+    parallel->threads--;
+    pthread_cond_broadcast(&parallel->cond);
+
+    pthread_mutex_unlock(&parallel->mutex);
+
+    return NULL;
+}
+
+int32_t
+ec_parallel_init(ec_t *ec)
+{
+    ec_parallel_t *parallel = &ec->parallel;
+
+    INIT_LIST_HEAD(&parallel->jobs);
+    if (pthread_mutex_init(&parallel->mutex, NULL) != 0) {
+        return -1;
+    }
+    if (pthread_cond_init(&parallel->cond, NULL) != 0) {
+        pthread_mutex_destroy(&parallel->mutex);
+        return -1;
+    }
+    parallel->initialized = _gf_true;
+
+    return 0;
+}
+
+void
+ec_parallel_configure(ec_t *ec, uint32_t threads, uint64_t min_size)
+{
+    ec_parallel_t *parallel = &ec->parallel;
+    pthread_t thread;
+
+    pthread_mutex_lock(&parallel->mutex);
+
+    parallel->min_size = min_size;
+    parallel->max_threads = threads;
+    while (parallel->threads < parallel->max_threads) {
+        if (gf_thread_create_detached(&thread, ec_parallel_worker, ec,
+                                      "ecpar") != 0) {
+            gf_msg(ec->xl->name, GF_LOG_WARNING, errno,
+                   EC_MSG_THREAD_CREATE_FAILED,
+                   "Failed to start a coding thread, only %u running",
+                   parallel->threads);
+            parallel->max_threads = parallel->threads;
+            break;
+        }
+        parallel->threads++;
+    }
+    /* Extra threads exit when they wake up. */
+    pthread_cond_broadcast(&parallel->cond);
+
+    pthread_mutex_unlock(&parallel->mutex);
+}
+
+void
+ec_parallel_fini(ec_t *ec)
+{
+    ec_parallel_t *parallel = &ec->parallel;
+
+    /* init may have failed, or not been reached, before the private data
+     * is destroyed. */
+    if (!parallel->initialized) {
+        return;
+    }
+
+    pthread_mutex_lock(&parallel->mutex);
+
+    parallel->max_threads = 0;
+    pthread_cond_broadcast(&parallel->cond);
+    while (parallel->threads > 0) {
+        pthread_cond_wait(&parallel->cond, &parallel->mutex);
+    }
+
+    pthread_mutex_unlock(&parallel->mutex);
+
+    pthread_cond_destroy(&parallel->cond);
+    pthread_mutex_destroy(&parallel->mutex);
+    parallel->initialized = _gf_false;
+}
+
+/* Returns in how many ranges 'units' stripes or chunks are split, counting
+ * the one of the calling thread. */
+static uint32_t
+ec_parallel_parts(ec_t *ec, size_t size, size_t units)
+{
+    ec_parallel_t *parallel = &ec->parallel;
+    uint32_t parts;
+
+    /* Unlocked reads, reconfigure only changes them from time to time. */
+    parts = parallel->threads;
+    if ((parts == 0) || (size < parallel->min_size)) {
+        return 1;
+    }
+    parts++;
+    if (parts > units) {
+        parts = units;
+    }
+
+    return parts;
+}
+
+static ec_parallel_job_t *
+ec_parallel_job_new(ec_fop_data_t *fop, uint32_t count)
+{
+    ec_parallel_job_t *job;
+
+    job = GF_MALLOC(sizeof(ec_parallel_job_t) + sizeof(void *) * count +
+                    sizeof(uint32_t) * count, ec_mt_ec_parallel_job_t);
+    if (job == NULL) {
+        return NULL;
+    }
+    INIT_LIST_HEAD(&job->list);
+    job->fop = fop;
+    job->in = NULL;
+    job->out = NULL;
+    job->rows = (uint32_t *)&job->blocks[count];
+
+    return job;
+}
+
+static void
+ec_parallel_queue(ec_t *ec, struct list_head *jobs, uint32_t count)
+{
+    ec_parallel_t *parallel = &ec->parallel;
+    ec_parallel_job_t *job, *tmp;
+
+    GF_ATOMIC_INC(ec->stats.parallel.fops);
+    GF_ATOMIC_ADD(ec->stats.parallel.jobs, count);
+
+    pthread_mutex_lock(&parallel->mutex);
+
+    list_for_each_entry_safe(job, tmp, jobs, list) {
+        list_move_tail(&job->list, &parallel->jobs);
+    }
+    if (count > 1) {
+        pthread_cond_broadcast(&parallel->cond);
+    } else {
+        pthread_cond_signal(&parallel->cond);
+    }
+
+    pthread_mutex_unlock(&parallel->mutex);
+}
+
+void
+ec_parallel_encode(ec_fop_data_t *fop, size_t size, void *in, void **out)
+{
+    ec_t *ec = fop->xl->private;
+    struct list_head jobs;
+    ec_parallel_job_t *job;
+    size_t stripes, first, last;
+    uint32_t parts, count, i, j;
+
+    stripes = size / ec->matrix.stripe;
+    parts = ec_parallel_parts(ec, size, stripes);
+
+    /* The calling thread keeps the first range, the others go to the
+     * workers. If a job can't be allocated, its range is added to the one
+     * of the calling thread. */
+    INIT_LIST_HEAD(&jobs);
+    count = 0;
+    last = stripes;
+    for (i = parts - 1; i > 0; i--) {
+        first = stripes * i / parts;
+
+        job = ec_parallel_job_new(fop, ec->nodes);
+        if (job == NULL) {
+            break;
+        }
+        job->decode = _gf_false;
+        job->size = (last - first) * ec->matrix.stripe;
+        job->data = in + first * ec->matrix.stripe;
+        for (j = 0; j < ec->nodes; j++) {
+            job->blocks[j] = out[j] + first * EC_METHOD_CHUNK_SIZE;
+        }
+        list_add(&job->list, &jobs);
+        count++;
+
+        ec_sleep(fop);
+
+        last = first;
+    }
+
+    if (count > 0) {
+        ec_parallel_queue(ec, &jobs, count);
+    }
+
+    ec_method_encode(&ec->matrix, last * ec->matrix.stripe, in, out);
+}
+
+int32_t
+ec_parallel_decode(ec_fop_data_t *fop, size_t size, uintptr_t mask,
+                   uint32_t *rows, void **in, void *out,
+                   struct iobref *in_iobref, struct iobref *out_iobref)
+{
+    ec_t *ec = fop->xl->private;
+    struct list_head jobs;
+    ec_parallel_job_t *job;
+    size_t chunks, first, last;
+    uint32_t parts, count, i, j;
+
+    chunks = size / EC_METHOD_CHUNK_SIZE;
+    parts = ec_parallel_parts(ec, size * ec->fragments, chunks);
+
+    INIT_LIST_HEAD(&jobs);
+    count = 0;
+    last = chunks;
+    for (i = parts - 1; i > 0; i--) {
+        first = chunks * i / parts;
+
+        job = ec_parallel_job_new(fop, ec->fragments);
+        if (job == NULL) {
+            break;
+        }
+        job->decode = _gf_true;
+        job->size = (last - first) * EC_METHOD_CHUNK_SIZE;
+        job->data = out + first * EC_METHOD_CHUNK_SIZE * ec->fragments;
+        job->mask = mask;
+        for (j = 0; j < ec->fragments; j++) {
+            job->blocks[j] = in[j] + first * EC_METHOD_CHUNK_SIZE;
+            job->rows[j] = rows[j];
+        }
+        if (in_iobref != NULL) {
+            job->in = iobref_ref(in_iobref);
+        }
+        if (out_iobref != NULL) {
+            job->out = iobref_ref(out_iobref);
+        }
+        list_add(&job->list, &jobs);
+        count++;
+
+        ec_sleep(fop);
+
+        last = first;
+    }
+
+    if (count > 0) {
+        ec_parallel_queue(ec, &jobs, count);
+    }
+
+    return ec_method_decode(&ec->matrix, last * EC_METHOD_CHUNK_SIZE, mask,
+                            rows, in, out);
+}
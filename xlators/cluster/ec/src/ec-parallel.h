@@ -0,0 +1,37 @@
+/*
+  Copyright (c) 2018 Red Hat, Inc. <http://www.redhat.com>
+  This file is part of GlusterFS.
+
+  This file is licensed to you under your choice of the GNU Lesser
+  General Public License, version 3 or any later version (LGPLv3 or
+  later), or the GNU General Public License, version 2 (GPLv2), in all
+  cases as published by the Free Software Foundation.
+*/
+
+#ifndef __EC_PARALLEL_H__
+#define __EC_PARALLEL_H__
+
+#include "xlator.h"
+#include "iobuf.h"
+
+#include "ec-types.h"
+
+/* Large encodes and decodes are split in ranges of stripes that a pool of
+ * worker threads handles together with the calling thread. Every range
+ * given to a worker holds a job of the fop (see ec_sleep()), so the state
+ * machine of the fop only moves on once all of them are done. */
+
+int32_t ec_parallel_init(ec_t *ec);
+
+void ec_parallel_configure(ec_t *ec, uint32_t threads, uint64_t min_size);
+
+void ec_parallel_fini(ec_t *ec);
+
+void ec_parallel_encode(ec_fop_data_t *fop, size_t size, void *in,
+                        void **out);
+
+int32_t ec_parallel_decode(ec_fop_data_t *fop, size_t size, uintptr_t mask,
+                           uint32_t *rows, void **in, void *out,
+                           struct iobref *in_iobref, struct iobref *out_iobref);
+
+#endif /* __EC_PARALLEL_H__ */
@@ -18,6 +18,15 @@
 
 #define EC_GF_MAX_REGS 16
 
+/* Data modified while some brick is not being updated is recorded in
+ * EC_HEAL_MAP_REGIONS counters, so that self-heal only needs to rebuild the
+ * regions whose counters differ between sources and sinks. Region 'i' of
+ * EC_HEAL_MAP_REGION_SIZE bytes is accounted in counter
+ * 'i % EC_HEAL_MAP_REGIONS'. */
+#define EC_HEAL_MAP_REGIONS     128
+#define EC_HEAL_MAP_REGION_SIZE (1024 * 1024)
+#define EC_HEAL_MAP_WORDS       (EC_HEAL_MAP_REGIONS / 64)
+
 enum _ec_heal_need;
 typedef enum _ec_heal_need ec_heal_need_t;
 
@@ -90,6 +99,9 @@ typedef struct _ec_stripe ec_stripe_t;
 struct _ec_stripe_list;
 typedef struct _ec_stripe_list ec_stripe_list_t;
 
+struct _ec_write_combine;
+typedef struct _ec_write_combine ec_write_combine_t;
+
 struct _ec_code_space;
 typedef struct _ec_code_space ec_code_space_t;
 
@@ -121,6 +133,12 @@ typedef struct _ec_self_heald ec_self_heald_t;
 struct _ec_statistics;
 typedef struct _ec_statistics ec_statistics_t;
 
+struct _ec_parallel_job;
+typedef struct _ec_parallel_job ec_parallel_job_t;
+
+struct _ec_parallel;
+typedef struct _ec_parallel ec_parallel_t;
+
 struct _ec;
 typedef struct _ec ec_t;
 
@@ -131,6 +149,7 @@ typedef void (*ec_resume_f)(ec_fop_data_t *, int32_t);
 enum _ec_read_policy {
         EC_ROUND_ROBIN,
         EC_GFID_HASH,
+        EC_STABLE,
         EC_READ_POLICY_MAX
 };
 
@@ -180,20 +199,52 @@ struct _ec_stripe_list {
     uint32_t        max;
 };
 
+/* Small writes acknowledged before having been sent to the bricks. They are
+ * kept while the inode is idle under an eager lock, and sent as a single
+ * write before any other fop on the inode is processed. */
+struct _ec_write_combine {
+    struct list_head  list;     /* Member of ec_t.write_combine while dirty,
+                                   flushing or holding an error. */
+    xlator_t         *xl;
+    inode_t          *inode;    /* Referenced while in the list. */
+    struct iobref    *iobref;
+    void             *data;
+    size_t            max;      /* Size of the buffer. */
+    off_t             offset;   /* File offset of the buffered data. */
+    size_t            size;
+    uint32_t          writes;   /* Writes combined in the buffer. */
+    uint32_t          partial;  /* Writes not covering whole stripes. */
+    struct list_head  waiting;  /* Fops waiting for the buffer to be
+                                   written. */
+    int32_t           error;    /* Error of a previous flush, reported to
+                                   the next write, fsync or flush. */
+    gf_boolean_t      flushing;
+    gf_boolean_t      timer;    /* A flush timer is pending. */
+    gf_boolean_t      release;  /* Another client wants the eager lock,
+                                   which is released once the buffer has
+                                   been written. */
+};
+
 struct _ec_inode {
     ec_lock_t        *inode_lock;
     gf_boolean_t      have_info;
     gf_boolean_t      have_config;
     gf_boolean_t      have_version;
     gf_boolean_t      have_size;
+    gf_boolean_t      have_iatt;
     ec_config_t       config;
     uint64_t          pre_version[2];
     uint64_t          post_version[2];
     uint64_t          pre_size;
     uint64_t          post_size;
     uint64_t          dirty[2];
+    struct iatt       iatt;        /* Attributes returned by the last write
+                                      done under the current lock. */
+    uint64_t          heal_map[EC_HEAL_MAP_WORDS]; /* Regions modified since
+                                                      the last update. */
     struct list_head  heal;
     ec_stripe_list_t  stripe_cache;
+    ec_write_combine_t write_combine;
 };
 
 
@@ -337,6 +388,8 @@ struct _ec_fop_data {
     struct list_head   cbk_list;     /* sorted list of groups of answers */
     struct list_head   answer_list;  /* list of answers */
     struct list_head   pending_list; /* member of ec_t.pending_fops */
+    struct list_head   combine_list; /* member of
+                                        ec_write_combine_t.waiting */
     ec_cbk_data_t     *answer;       /* accepted answer */
     int32_t            lock_count;
     int32_t            locked;
@@ -353,6 +406,9 @@ struct _ec_fop_data {
     uintptr_t          remaining;
     uintptr_t          received; /* Mask of responses */
     uintptr_t          good;
+    gf_timer_t        *hedge;    /* Pending timer of a hedged read. */
+    gf_boolean_t       hedged;   /* An extra brick has been asked because
+                                    the others were too slow. */
 
     uid_t              uid;
     gid_t              gid;
@@ -556,9 +612,14 @@ struct _ec_matrix_list {
     gf_lock_t          lock;
     uint32_t           columns;
     uint32_t           rows;
-    uint32_t           max;
+    uint32_t           max;      /* Current capacity. It grows up to limit
+                                    while the masks in use don't fit. */
+    uint32_t           limit;
     uint32_t           count;
     uint32_t           stripe;
+    uint64_t           hits;
+    uint64_t           misses;
+    uint64_t           evictions;
     struct mem_pool   *pool;
     ec_gf_t           *gf;
     ec_code_t         *code;
@@ -632,6 +693,62 @@ struct _ec_statistics {
                                         requests. (Basically memory allocation
                                         errors). */
         } stripe_cache;
+        struct {
+                gf_atomic_t fops;    /* Encodes or decodes that have been
+                                        split among the worker threads. */
+                gf_atomic_t jobs;    /* Parts given to the worker threads. */
+        } parallel;
+        struct {
+                gf_atomic_t writes;  /* Writes acknowledged once copied to
+                                        a combining buffer. */
+                gf_atomic_t flushes; /* Combining buffers sent to the
+                                        bricks. */
+                gf_atomic_t rmw_avoided; /* Partial stripe writes that
+                                            didn't need a read-modify-write
+                                            cycle of their own. */
+                gf_atomic_t errors;  /* Failed flushes. */
+        } write_combine;
+        struct {
+                gf_atomic_t full;    /* Data heals that rebuilt the whole
+                                        file. */
+                gf_atomic_t partial; /* Data heals that only rebuilt the
+                                        regions modified while the sinks
+                                        were not being updated. */
+                gf_atomic_t healed;  /* Bytes rebuilt by data heals. */
+                gf_atomic_t skipped; /* Bytes that data heals didn't need to
+                                        rebuild. */
+        } heal;
+        struct {
+                gf_atomic_t hedges;  /* Reads sent to an extra brick because
+                                        the first ones were too slow. */
+                gf_atomic_t early;   /* Hedged reads completed without
+                                        waiting for the slow bricks. */
+        } read;
+};
+
+/* A range of stripes to encode, or of chunks to decode, by a worker. */
+struct _ec_parallel_job {
+    struct list_head   list;
+    ec_fop_data_t     *fop;
+    struct iobref     *in;       /* Keep the buffers of a decode alive. */
+    struct iobref     *out;
+    gf_boolean_t       decode;
+    size_t             size;
+    void              *data;     /* Input of encode, output of decode. */
+    uintptr_t          mask;
+    uint32_t          *rows;
+    void              *blocks[]; /* Fragments, followed by the rows. */
+};
+
+struct _ec_parallel {
+    pthread_mutex_t    mutex;
+    pthread_cond_t     cond;
+    struct list_head   jobs;
+    uint32_t           threads;      /* Running worker threads. */
+    uint32_t           max_threads;
+    uint64_t           min_size;     /* Smaller encodes and decodes are done
+                                        by the calling thread alone. */
+    gf_boolean_t       initialized;  /* The mutex and cond are set up. */
 };
 
 struct _ec {
@@ -671,6 +788,12 @@ struct _ec {
     uint32_t           self_heal_window_size; /* max size of read/writes */
     uint32_t           eager_lock_timeout;
     uint32_t           other_eager_lock_timeout;
+    uint64_t           write_combine_size;
+    uint32_t           write_combine_timeout; /* In milliseconds. */
+    uint32_t           write_combine_count; /* Entries of write_combine. */
+    uint32_t           read_hedge_timeout; /* In milliseconds, 0 disables
+                                              hedged reads. */
+    struct list_head   write_combine;
     struct list_head   pending_fops;
     struct list_head   heal_waiting;
     struct list_head   healing;
@@ -682,6 +805,7 @@ struct _ec {
     dict_t            *leaf_to_subvolid;
     ec_read_policy_t   read_policy;
     ec_matrix_list_t   matrix;
+    ec_parallel_t      parallel;
     ec_statistics_t    stats;
 };
 
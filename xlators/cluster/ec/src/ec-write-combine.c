@@ -0,0 +1,553 @@
+/*
+  Copyright (c) 2018 Red Hat, Inc. <http://www.redhat.com>
+  This file is part of GlusterFS.
+
+  This file is licensed to you under your choice of the GNU Lesser
+  General Public License, version 3 or any later version (LGPLv3 or
+  later), or the GNU General Public License, version 2 (GPLv2), in all
+  cases as published by the Free Software Foundation.
+*/
+
+#include "xlator.h"
+#include "timer.h"
+
+#include "ec.h"
+#include "ec-messages.h"
+#include "ec-helpers.h"
+#include "ec-common.h"
+#include "ec-fops.h"
+#include "ec-write-combine.h"
+
+/* While a buffer is dirty, being flushed or holding an error, it's kept in
+ * ec_t.write_combine with a reference to its inode. Both functions must be
+ * called with the inode locked. The reference returned by
+ * __ec_write_combine_put() must be released once the inode is unlocked. */
+static void
+__ec_write_combine_get(ec_t *ec, ec_write_combine_t *wc, inode_t *inode)
+{
+    if (!list_empty(&wc->list)) {
+        return;
+    }
+
+    wc->xl = ec->xl;
+    wc->inode = inode_ref(inode);
+
+    LOCK(&ec->lock);
+
+    list_add_tail(&wc->list, &ec->write_combine);
+    ec->write_combine_count++;
+
+    UNLOCK(&ec->lock);
+}
+
+static inode_t *
+__ec_write_combine_put(ec_t *ec, ec_write_combine_t *wc)
+{
+    if ((wc->size > 0) || wc->flushing || (wc->error != 0) ||
+        list_empty(&wc->list)) {
+        return NULL;
+    }
+
+    LOCK(&ec->lock);
+
+    list_del_init(&wc->list);
+    ec->write_combine_count--;
+
+    UNLOCK(&ec->lock);
+
+    return wc->inode;
+}
+
+static gf_boolean_t
+__ec_write_combine_start(ec_write_combine_t *wc)
+{
+    if ((wc->size == 0) || wc->flushing) {
+        return _gf_false;
+    }
+
+    /* The buffer doesn't change until the flush completes. */
+    wc->flushing = _gf_true;
+
+    return _gf_true;
+}
+
+/* Errors of a flush can only be reported to fops that would have failed if
+ * the writes hadn't been combined. */
+static gf_boolean_t
+ec_write_combine_reports(ec_fop_data_t *fop)
+{
+    return (fop->id == GF_FOP_WRITE) || (fop->id == GF_FOP_FSYNC) ||
+           (fop->id == GF_FOP_FLUSH);
+}
+
+/* Returns whether the eager lock of the inode must be kept until buffered
+ * data has been written. Other clients must not see the file, nor write to
+ * it, before writes already acknowledged to the application. It must be
+ * called with the inode locked. */
+gf_boolean_t
+__ec_write_combine_pending(ec_inode_t *ctx)
+{
+    return (ctx->write_combine.size > 0) || ctx->write_combine.flushing;
+}
+
+static void
+ec_write_combine_done(ec_t *ec, ec_inode_t *ctx, int32_t error)
+{
+    ec_write_combine_t *wc = &ctx->write_combine;
+    ec_fop_data_t *fop, *tmp, *failed = NULL;
+    struct list_head list;
+    struct iobref *iobref;
+    inode_t *inode = wc->inode;
+    inode_t *unref;
+    gf_boolean_t release;
+
+    INIT_LIST_HEAD(&list);
+
+    if (error != 0) {
+        GF_ATOMIC_INC(ec->stats.write_combine.errors);
+
+        gf_msg(ec->xl->name, GF_LOG_WARNING, error,
+               EC_MSG_WRITE_COMBINE_FAILED,
+               "Failed to write %zu bytes of combined writes at offset "
+               "%" PRId64 " of %s", wc->size, wc->offset,
+               uuid_utoa(inode->gfid));
+    }
+
+    LOCK(&inode->lock);
+
+    iobref = wc->iobref;
+    wc->iobref = NULL;
+    wc->data = NULL;
+    wc->size = 0;
+    wc->flushing = _gf_false;
+    if (error != 0) {
+        wc->error = error;
+    }
+    release = wc->release;
+    wc->release = _gf_false;
+
+    list_splice_init(&wc->waiting, &list);
+    if (wc->error != 0) {
+        list_for_each_entry(fop, &list, combine_list) {
+            if (ec_write_combine_reports(fop)) {
+                failed = fop;
+                error = wc->error;
+                wc->error = 0;
+
+                break;
+            }
+        }
+    }
+
+    unref = __ec_write_combine_put(ec, wc);
+
+    UNLOCK(&inode->lock);
+
+    if (iobref != NULL) {
+        iobref_unref(iobref);
+    }
+
+    /* The write is still an owner of the eager lock, so the lock is
+     * released when it finishes. Fops that were waiting for the buffer go
+     * after the other client. */
+    if (release) {
+        ec_lock_release(ec, inode);
+    }
+
+    list_for_each_entry_safe(fop, tmp, &list, combine_list) {
+        list_del_init(&fop->combine_list);
+
+        __ec_manager(fop, (fop == failed) ? error : 0);
+    }
+
+    /* This can destroy ctx. */
+    if (unref != NULL) {
+        inode_unref(unref);
+    }
+}
+
+static int32_t
+ec_write_combine_cbk(call_frame_t *frame, void *cookie, xlator_t *this,
+                     int32_t op_ret, int32_t op_errno, struct iatt *prebuf,
+                     struct iatt *postbuf, dict_t *xdata)
+{
+    ec_inode_t *ctx = frame->cookie;
+
+    if ((op_ret >= 0) && (op_ret < ctx->write_combine.size)) {
+        op_ret = -1;
+        op_errno = EIO;
+    }
+
+    ec_write_combine_done(this->private, ctx, (op_ret < 0) ? op_errno : 0);
+
+    STACK_DESTROY(frame->root);
+
+    return 0;
+}
+
+static void
+ec_write_combine_send(ec_t *ec, ec_inode_t *ctx)
+{
+    ec_write_combine_t *wc = &ctx->write_combine;
+    call_frame_t *frame = NULL;
+    struct iovec vector;
+    fd_t *fd = NULL;
+    uint32_t partial = 0;
+
+    GF_ATOMIC_INC(ec->stats.write_combine.flushes);
+    if (((wc->offset % ec->stripe_size) != 0) ||
+        (((wc->offset + wc->size) % ec->stripe_size) != 0)) {
+        partial = 1;
+    }
+    if (wc->partial > partial) {
+        GF_ATOMIC_ADD(ec->stats.write_combine.rmw_avoided,
+                      wc->partial - partial);
+    }
+
+    fd = fd_anonymous(wc->inode);
+    if (fd == NULL) {
+        goto failed;
+    }
+    frame = create_frame(ec->xl, ec->xl->ctx->pool);
+    if (frame == NULL) {
+        goto failed;
+    }
+    /* The callback also needs it if ec_writev() fails before creating the
+     * fop. */
+    frame->cookie = ctx;
+
+    vector.iov_base = wc->data;
+    vector.iov_len = wc->size;
+
+    /* Passing ctx as the fop data lets ec_write_combine_wait() recognize
+     * this write. */
+    ec_writev(frame, ec->xl, -1, EC_MINIMUM_MIN, ec_write_combine_cbk, ctx,
+              fd, &vector, 1, wc->offset, 0, wc->iobref, NULL);
+
+    fd_unref(fd);
+
+    return;
+
+failed:
+    if (fd != NULL) {
+        fd_unref(fd);
+    }
+
+    ec_write_combine_done(ec, ctx, ENOMEM);
+}
+
+static void
+ec_write_combine_timer_cbk(void *data)
+{
+    ec_write_combine_t *wc = data;
+    inode_t *inode = wc->inode;
+
+    LOCK(&inode->lock);
+
+    wc->timer = _gf_false;
+
+    UNLOCK(&inode->lock);
+
+    ec_write_combine_flush(wc->xl, inode);
+
+    inode_unref(inode);
+}
+
+static void
+ec_write_combine_timer(ec_t *ec, ec_write_combine_t *wc)
+{
+    struct timespec delay;
+    uint32_t timeout;
+
+    /* Send the data well before the eager lock expires, so that releasing
+     * the lock doesn't need to wait for it. */
+    timeout = ec->write_combine_timeout;
+    if (timeout >= ec->eager_lock_timeout * 1000) {
+        timeout = ec->eager_lock_timeout * 500;
+    }
+
+    delay.tv_sec = timeout / 1000;
+    delay.tv_nsec = (timeout % 1000) * 1000000;
+    if (gf_timer_call_after(ec->xl->ctx, delay, ec_write_combine_timer_cbk,
+                            wc) == NULL) {
+        gf_msg(ec->xl->name, GF_LOG_WARNING, ENOMEM,
+               EC_MSG_WRITE_COMBINE_FAILED,
+               "Unable to delay combined writes");
+
+        ec_write_combine_timer_cbk(wc);
+    }
+}
+
+/* Attributes of the file once the buffered data reaching up to @size has
+ * been written. They are based on the ones returned by the last write, so
+ * that the caches above see the size and times grow as they would without
+ * combining. */
+static void
+__ec_write_combine_iatt(ec_inode_t *ctx, uint64_t size, struct iatt *iatt)
+{
+    struct timespec now;
+
+    *iatt = ctx->iatt;
+    if (size > iatt->ia_size) {
+        iatt->ia_blocks += (size - iatt->ia_size + 511) / 512;
+        iatt->ia_size = size;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    iatt->ia_mtime = iatt->ia_ctime = now.tv_sec;
+    iatt->ia_mtime_nsec = iatt->ia_ctime_nsec = now.tv_nsec;
+}
+
+gf_boolean_t
+ec_write_combine(call_frame_t *frame, xlator_t *this, fd_t *fd,
+                 struct iovec *vector, int32_t count, off_t offset,
+                 uint32_t flags, struct iobref *iobref, dict_t *xdata)
+{
+    ec_t *ec = this->private;
+    ec_inode_t *ctx = NULL;
+    ec_fd_t *fd_ctx;
+    ec_lock_t *lock;
+    ec_write_combine_t *wc = NULL;
+    inode_t *inode;
+    struct iatt preop, postop;
+    uint64_t current;
+    size_t size, max;
+    gf_boolean_t combined = _gf_false;
+    gf_boolean_t timer = _gf_false;
+    gf_boolean_t send = _gf_false;
+
+    max = ec->write_combine_size;
+    size = iov_length(vector, count);
+    if ((size == 0) || (size >= max) || (xdata != NULL) || ec->shutdown ||
+        (fd == NULL)) {
+        return _gf_false;
+    }
+    /* Writes the user expects to be stable or to fail right away are never
+     * combined. */
+    if (((fd->flags & O_ACCMODE) == O_RDONLY) ||
+        (((flags | fd->flags) & (O_DIRECT | O_SYNC | O_DSYNC)) != 0)) {
+        return _gf_false;
+    }
+    fd_ctx = ec_fd_get(fd, this);
+    if (fd_ctx == NULL) {
+        return _gf_false;
+    }
+
+    inode = fd->inode;
+
+    LOCK(&inode->lock);
+
+    ctx = __ec_inode_get(inode, this);
+    if (ctx == NULL) {
+        goto unlock;
+    }
+    wc = &ctx->write_combine;
+
+    /* Data can only be kept while this client holds the eager lock and no
+     * other fop is using it, so nobody else can see the file contents
+     * before the buffer is written. */
+    lock = ctx->inode_lock;
+    if ((lock == NULL) || !lock->acquired || lock->release ||
+        (lock->refs_pending > 0) || !list_empty(&lock->owners) ||
+        !list_empty(&lock->waiting) || wc->flushing || (wc->error != 0)) {
+        goto unlock;
+    }
+    /* The write is answered right away, which needs the attributes of the
+     * file. */
+    if (!ctx->have_size || !ctx->have_iatt) {
+        goto unlock;
+    }
+
+    current = ctx->post_size;
+    if ((wc->size > 0) && (wc->offset + wc->size > current)) {
+        current = wc->offset + wc->size;
+    }
+    if ((fd_ctx->flags & O_APPEND) != 0) {
+        offset = current;
+    }
+
+    if (wc->size > 0) {
+        if ((offset != wc->offset + wc->size) ||
+            (size > wc->max - wc->size)) {
+            goto unlock;
+        }
+    } else {
+        if (ec_buffer_alloc(this, max, &wc->iobref, &wc->data) != 0) {
+            goto unlock;
+        }
+        wc->max = max;
+        wc->offset = offset;
+        wc->writes = 0;
+        wc->partial = 0;
+
+        __ec_write_combine_get(ec, wc, inode);
+
+        if (!wc->timer) {
+            wc->timer = timer = _gf_true;
+            inode_ref(inode);
+        }
+    }
+
+    __ec_write_combine_iatt(ctx, current, &preop);
+    if (offset + size > current) {
+        current = offset + size;
+    }
+    __ec_write_combine_iatt(ctx, current, &postop);
+
+    ec_iov_copy_to(wc->data + wc->size, vector, count, 0, size);
+    wc->size += size;
+    wc->writes++;
+    if (((offset % ec->stripe_size) != 0) ||
+        (((offset + size) % ec->stripe_size) != 0)) {
+        wc->partial++;
+    }
+
+    combined = _gf_true;
+
+    /* If another write like this one doesn't fit, don't wait for it. */
+    if (wc->max - wc->size < size) {
+        send = __ec_write_combine_start(wc);
+    }
+
+unlock:
+    UNLOCK(&inode->lock);
+
+    if (!combined) {
+        return _gf_false;
+    }
+
+    GF_ATOMIC_INC(ec->stats.write_combine.writes);
+
+    STACK_UNWIND_STRICT(writev, frame, size, 0, &preop, &postop, NULL);
+
+    if (timer) {
+        ec_write_combine_timer(ec, wc);
+    }
+    if (send) {
+        ec_write_combine_send(ec, ctx);
+    }
+
+    return _gf_true;
+}
+
+gf_boolean_t
+ec_write_combine_wait(ec_fop_data_t *fop, int32_t *error)
+{
+    ec_t *ec = fop->xl->private;
+    ec_inode_t *ctx = NULL;
+    ec_write_combine_t *wc;
+    inode_t *inode = NULL;
+    inode_t *unref = NULL;
+    uint64_t value = 0;
+    gf_boolean_t wait = _gf_false;
+    gf_boolean_t send = _gf_false;
+
+    /* Fops started by other fops are ordered by their parents. */
+    if ((ec->write_combine_count == 0) || (fop->parent != NULL)) {
+        return _gf_false;
+    }
+
+    if (fop->use_fd) {
+        if (fop->fd != NULL) {
+            inode = fop->fd->inode;
+        }
+    } else {
+        inode = fop->loc[0].inode;
+    }
+    if (inode == NULL) {
+        return _gf_false;
+    }
+
+    LOCK(&inode->lock);
+
+    if ((__inode_ctx_get(inode, fop->xl, &value) != 0) || (value == 0)) {
+        goto unlock;
+    }
+    ctx = (ec_inode_t *)(uintptr_t)value;
+
+    /* This is the write that sends the buffer. */
+    if (fop->data == ctx) {
+        goto unlock;
+    }
+
+    wc = &ctx->write_combine;
+    if ((wc->size > 0) || wc->flushing) {
+        list_add_tail(&fop->combine_list, &wc->waiting);
+        wait = _gf_true;
+
+        send = __ec_write_combine_start(wc);
+    } else if ((wc->error != 0) && ec_write_combine_reports(fop)) {
+        *error = wc->error;
+        wc->error = 0;
+
+        unref = __ec_write_combine_put(ec, wc);
+    }
+
+unlock:
+    UNLOCK(&inode->lock);
+
+    if (unref != NULL) {
+        inode_unref(unref);
+    }
+    if (send) {
+        ec_write_combine_send(ec, ctx);
+    }
+
+    return wait;
+}
+
+void
+ec_write_combine_flush(xlator_t *xl, inode_t *inode)
+{
+    ec_inode_t *ctx = NULL;
+    uint64_t value = 0;
+    gf_boolean_t send = _gf_false;
+
+    LOCK(&inode->lock);
+
+    if ((__inode_ctx_get(inode, xl, &value) == 0) && (value != 0)) {
+        ctx = (ec_inode_t *)(uintptr_t)value;
+        send = __ec_write_combine_start(&ctx->write_combine);
+    }
+
+    UNLOCK(&inode->lock);
+
+    if (send) {
+        ec_write_combine_send(xl->private, ctx);
+    }
+}
+
+void
+ec_write_combine_flush_all(ec_t *ec)
+{
+    ec_write_combine_t *wc;
+    inode_t **inodes;
+    uint32_t i, count = 0;
+
+    LOCK(&ec->lock);
+
+    inodes = GF_CALLOC(ec->write_combine_count + 1, sizeof(inode_t *),
+                       gf_common_mt_pointer);
+    if (inodes != NULL) {
+        list_for_each_entry(wc, &ec->write_combine, list) {
+            inodes[count++] = inode_ref(wc->inode);
+        }
+    }
+
+    UNLOCK(&ec->lock);
+
+    if (inodes == NULL) {
+        gf_msg(ec->xl->name, GF_LOG_ERROR, ENOMEM,
+               EC_MSG_WRITE_COMBINE_FAILED,
+               "Unable to flush combined writes");
+
+        return;
+    }
+
+    for (i = 0; i < count; i++) {
+        ec_write_combine_flush(ec->xl, inodes[i]);
+        inode_unref(inodes[i]);
+    }
+
+    GF_FREE(inodes);
+}
@@ -0,0 +1,39 @@
+/*
+  Copyright (c) 2018 Red Hat, Inc. <http://www.redhat.com>
+  This file is part of GlusterFS.
+
+  This file is licensed to you under your choice of the GNU Lesser
+  General Public License, version 3 or any later version (LGPLv3 or
+  later), or the GNU General Public License, version 2 (GPLv2), in all
+  cases as published by the Free Software Foundation.
+*/
+
+#ifndef __EC_WRITE_COMBINE_H__
+#define __EC_WRITE_COMBINE_H__
+
+#include "xlator.h"
+
+#include "ec-types.h"
+
+/* Small writes to a file that this client holds under an idle eager lock
+ * are copied to a per inode buffer and acknowledged at once. Contiguous
+ * writes are appended to the same buffer, which is sent as a single write
+ * when it's full, when a timer expires, when the lock is requested by
+ * another client, or before any other fop on the inode (fsync and flush
+ * included) is processed. This way a sequence of small appends only pays
+ * one read-modify-write cycle of the partial stripes. */
+
+gf_boolean_t ec_write_combine(call_frame_t *frame, xlator_t *this, fd_t *fd,
+                              struct iovec *vector, int32_t count,
+                              off_t offset, uint32_t flags,
+                              struct iobref *iobref, dict_t *xdata);
+
+gf_boolean_t ec_write_combine_wait(ec_fop_data_t *fop, int32_t *error);
+
+gf_boolean_t __ec_write_combine_pending(ec_inode_t *ctx);
+
+void ec_write_combine_flush(xlator_t *xl, inode_t *inode);
+
+void ec_write_combine_flush_all(ec_t *ec);
+
+#endif /* __EC_WRITE_COMBINE_H__ */
@@ -23,11 +23,14 @@
 #include "ec-method.h"
 #include "ec-code.h"
 #include "ec-heald.h"
+#include "ec-parallel.h"
+#include "ec-write-combine.h"
 #include "events.h"
 
 static char *ec_read_policies[EC_READ_POLICY_MAX + 1] = {
         [EC_ROUND_ROBIN] = "round-robin",
         [EC_GFID_HASH] = "gfid-hash",
+        [EC_STABLE] = "stable",
         [EC_READ_POLICY_MAX] = NULL
 };
 
@@ -205,6 +208,7 @@ void __ec_destroy_private(xlator_t * this)
         if (ec->leaf_to_subvolid)
                 dict_unref (ec->leaf_to_subvolid);
 
+        ec_parallel_fini(ec);
         ec_method_fini(&ec->matrix);
 
         GF_FREE(ec);
@@ -258,6 +262,8 @@ reconfigure (xlator_t *this, dict_t *options)
         char     *extensions      = NULL;
         uint32_t heal_wait_qlen   = 0;
         uint32_t background_heals = 0;
+        uint32_t coding_threads   = 0;
+        uint64_t coding_min_size  = 0;
         int32_t  ret              = -1;
         int32_t  err;
 
@@ -299,6 +305,17 @@ reconfigure (xlator_t *this, dict_t *options)
                           options, bool, failed);
         GF_OPTION_RECONF ("stripe-cache", ec->stripe_cache, options, uint32,
                           failed);
+        GF_OPTION_RECONF ("parallel-coding-threads", coding_threads, options,
+                          uint32, failed);
+        GF_OPTION_RECONF ("parallel-coding-min-size", coding_min_size,
+                          options, size_uint64, failed);
+        GF_OPTION_RECONF ("write-combine-size", ec->write_combine_size,
+                          options, size_uint64, failed);
+        GF_OPTION_RECONF ("write-combine-timeout", ec->write_combine_timeout,
+                          options, uint32, failed);
+        GF_OPTION_RECONF ("read-hedge-timeout", ec->read_hedge_timeout,
+                          options, uint32, failed);
+        ec_parallel_configure (ec, coding_threads, coding_min_size);
         ret = 0;
         if (ec_assign_read_policy (ec, read_policy)) {
                 ret = -1;
@@ -545,6 +562,12 @@ ec_notify (xlator_t *this, int32_t event, void *data, void *data2)
                 }
         }
 
+        if (event == GF_EVENT_PARENT_DOWN) {
+                /* Nothing else is combined from now on. */
+                ec->shutdown = _gf_true;
+                ec_write_combine_flush_all(ec);
+        }
+
         LOCK (&ec->lock);
 
         if (event == GF_EVENT_PARENT_UP) {
@@ -555,8 +578,10 @@ ec_notify (xlator_t *this, int32_t event, void *data, void *data2)
                 ec_launch_notify_timer (this, ec);
                 goto unlock;
         } else if (event == GF_EVENT_PARENT_DOWN) {
-                /* If there aren't pending fops running after we have waken up
-                 * them, we immediately propagate the notification. */
+                /* Combined writes have already been sent, so they are
+                 * pending fops. If there aren't pending fops running after we
+                 * have waken up them, we immediately propagate the
+                 * notification. */
                 propagate = ec_disable_delays(ec);
                 goto unlock;
         }
@@ -641,6 +666,18 @@ ec_statistics_init(ec_t *ec)
         GF_ATOMIC_INIT(ec->stats.stripe_cache.evicts, 0);
         GF_ATOMIC_INIT(ec->stats.stripe_cache.allocs, 0);
         GF_ATOMIC_INIT(ec->stats.stripe_cache.errors, 0);
+        GF_ATOMIC_INIT(ec->stats.parallel.fops, 0);
+        GF_ATOMIC_INIT(ec->stats.parallel.jobs, 0);
+        GF_ATOMIC_INIT(ec->stats.write_combine.writes, 0);
+        GF_ATOMIC_INIT(ec->stats.write_combine.flushes, 0);
+        GF_ATOMIC_INIT(ec->stats.write_combine.rmw_avoided, 0);
+        GF_ATOMIC_INIT(ec->stats.write_combine.errors, 0);
+        GF_ATOMIC_INIT(ec->stats.heal.full, 0);
+        GF_ATOMIC_INIT(ec->stats.heal.partial, 0);
+        GF_ATOMIC_INIT(ec->stats.heal.healed, 0);
+        GF_ATOMIC_INIT(ec->stats.heal.skipped, 0);
+        GF_ATOMIC_INIT(ec->stats.read.hedges, 0);
+        GF_ATOMIC_INIT(ec->stats.read.early, 0);
 }
 
 int32_t
@@ -649,6 +686,8 @@ init (xlator_t *this)
     ec_t *ec          = NULL;
     char *read_policy = NULL;
     char *extensions  = NULL;
+    uint32_t coding_threads = 0;
+    uint64_t coding_min_size = 0;
     int32_t err;
 
     if (this->parents == NULL)
@@ -675,6 +714,16 @@ init (xlator_t *this)
     INIT_LIST_HEAD(&ec->pending_fops);
     INIT_LIST_HEAD(&ec->heal_waiting);
     INIT_LIST_HEAD(&ec->healing);
+    INIT_LIST_HEAD(&ec->write_combine);
+
+    if (ec_parallel_init(ec) != 0)
+    {
+        gf_msg (this->name, GF_LOG_ERROR, 0,
+                EC_MSG_XLATOR_INIT_FAIL, "Failed to initialize coding "
+                                         "threads.");
+
+        goto failed;
+    }
 
     ec->fop_pool = mem_pool_new(ec_fop_data_t, 1024);
     ec->cbk_pool = mem_pool_new(ec_cbk_data_t, 4096);
@@ -706,8 +755,11 @@ init (xlator_t *this)
 
     GF_OPTION_INIT("cpu-extensions", extensions, str, failed);
 
+    /* The cache of decoding matrices starts with room for two masks per
+     * brick, but it can grow when more masks are used (for example while
+     * some bricks are down or being healed). */
     err = ec_method_init(this, &ec->matrix, ec->fragments, ec->nodes,
-                         ec->nodes * 2, extensions);
+                         ec->nodes * 2, ec->nodes * 16, extensions);
     if (err != 0) {
         gf_msg (this->name, GF_LOG_ERROR, -err, EC_MSG_MATRIX_FAILED,
                 "Failed to initialize matrix management");
@@ -738,6 +790,17 @@ init (xlator_t *this)
     GF_OPTION_INIT ("optimistic-change-log", ec->optimistic_changelog, bool, failed);
     GF_OPTION_INIT ("parallel-writes", ec->parallel_writes, bool, failed);
     GF_OPTION_INIT ("stripe-cache", ec->stripe_cache, uint32, failed);
+    GF_OPTION_INIT ("parallel-coding-threads", coding_threads, uint32,
+                    failed);
+    GF_OPTION_INIT ("parallel-coding-min-size", coding_min_size,
+                    size_uint64, failed);
+    GF_OPTION_INIT ("write-combine-size", ec->write_combine_size,
+                    size_uint64, failed);
+    GF_OPTION_INIT ("write-combine-timeout", ec->write_combine_timeout,
+                    uint32, failed);
+    GF_OPTION_INIT ("read-hedge-timeout", ec->read_hedge_timeout, uint32,
+                    failed);
+    ec_parallel_configure (ec, coding_threads, coding_min_size);
 
     this->itable = inode_table_new (EC_SHD_INODE_LRU_LIMIT, this);
     if (!this->itable)
@@ -1263,8 +1326,11 @@ int32_t ec_gf_writev(call_frame_t * frame, xlator_t * this, fd_t * fd,
                      struct iovec * vector, int32_t count, off_t offset,
                      uint32_t flags, struct iobref * iobref, dict_t * xdata)
 {
-    ec_writev(frame, this, -1, EC_MINIMUM_MIN, default_writev_cbk, NULL, fd,
-              vector, count, offset, flags, iobref, xdata);
+    if (!ec_write_combine(frame, this, fd, vector, count, offset, flags,
+                          iobref, xdata)) {
+        ec_writev(frame, this, -1, EC_MINIMUM_MIN, default_writev_cbk, NULL,
+                  fd, vector, count, offset, flags, iobref, xdata);
+    }
 
     return 0;
 }
@@ -1324,6 +1390,8 @@ int32_t ec_gf_forget(xlator_t * this, inode_t * inode)
         /* We can only forget an inode if it has been unlocked, so the stripe
          * cache should also be empty. */
         GF_ASSERT(list_empty(&ctx->stripe_cache.lru));
+        /* Combined writes hold a reference on the inode. */
+        GF_ASSERT(list_empty(&ctx->write_combine.list));
         GF_FREE(ctx);
     }
 
@@ -1384,6 +1452,7 @@ int32_t ec_dump_private(xlator_t *this)
     gf_proc_dump_write("healers", "%d", ec->healers);
     gf_proc_dump_write("heal-waiters", "%d", ec->heal_waiters);
     gf_proc_dump_write("read-policy", "%s", ec_read_policies[ec->read_policy]);
+    gf_proc_dump_write("read-hedge-timeout", "%u", ec->read_hedge_timeout);
 
     snprintf(key_prefix, GF_DUMP_MAX_BUF_LEN, "%s.%s.stats.stripe_cache",
              this->type, this->name);
@@ -1404,6 +1473,65 @@ int32_t ec_dump_private(xlator_t *this)
     gf_proc_dump_write("errors", "%llu",
                        GF_ATOMIC_GET(ec->stats.stripe_cache.errors));
 
+    snprintf(key_prefix, GF_DUMP_MAX_BUF_LEN, "%s.%s.stats.parallel",
+             this->type, this->name);
+    gf_proc_dump_add_section(key_prefix);
+
+    gf_proc_dump_write("threads", "%u", ec->parallel.threads);
+    gf_proc_dump_write("fops", "%llu",
+                       GF_ATOMIC_GET(ec->stats.parallel.fops));
+    gf_proc_dump_write("jobs", "%llu",
+                       GF_ATOMIC_GET(ec->stats.parallel.jobs));
+
+    snprintf(key_prefix, GF_DUMP_MAX_BUF_LEN, "%s.%s.stats.write_combine",
+             this->type, this->name);
+    gf_proc_dump_add_section(key_prefix);
+
+    gf_proc_dump_write("pending", "%u", ec->write_combine_count);
+    gf_proc_dump_write("writes", "%llu",
+                       GF_ATOMIC_GET(ec->stats.write_combine.writes));
+    gf_proc_dump_write("flushes", "%llu",
+                       GF_ATOMIC_GET(ec->stats.write_combine.flushes));
+    gf_proc_dump_write("rmw_avoided", "%llu",
+                       GF_ATOMIC_GET(ec->stats.write_combine.rmw_avoided));
+    gf_proc_dump_write("errors", "%llu",
+                       GF_ATOMIC_GET(ec->stats.write_combine.errors));
+
+    snprintf(key_prefix, GF_DUMP_MAX_BUF_LEN, "%s.%s.stats.heal",
+             this->type, this->name);
+    gf_proc_dump_add_section(key_prefix);
+
+    gf_proc_dump_write("full", "%llu", GF_ATOMIC_GET(ec->stats.heal.full));
+    gf_proc_dump_write("partial", "%llu",
+                       GF_ATOMIC_GET(ec->stats.heal.partial));
+    gf_proc_dump_write("healed", "%llu",
+                       GF_ATOMIC_GET(ec->stats.heal.healed));
+    gf_proc_dump_write("skipped", "%llu",
+                       GF_ATOMIC_GET(ec->stats.heal.skipped));
+
+    snprintf(key_prefix, GF_DUMP_MAX_BUF_LEN, "%s.%s.stats.matrix",
+             this->type, this->name);
+    gf_proc_dump_add_section(key_prefix);
+
+    LOCK(&ec->matrix.lock);
+
+    gf_proc_dump_write("hits", "%"PRIu64, ec->matrix.hits);
+    gf_proc_dump_write("misses", "%"PRIu64, ec->matrix.misses);
+    gf_proc_dump_write("evictions", "%"PRIu64, ec->matrix.evictions);
+    gf_proc_dump_write("count", "%u", ec->matrix.count);
+    gf_proc_dump_write("max", "%u", ec->matrix.max);
+    gf_proc_dump_write("limit", "%u", ec->matrix.limit);
+
+    UNLOCK(&ec->matrix.lock);
+
+    snprintf(key_prefix, GF_DUMP_MAX_BUF_LEN, "%s.%s.stats.read",
+             this->type, this->name);
+    gf_proc_dump_add_section(key_prefix);
+
+    gf_proc_dump_write("hedges", "%llu",
+                       GF_ATOMIC_GET(ec->stats.read.hedges));
+    gf_proc_dump_write("early", "%llu", GF_ATOMIC_GET(ec->stats.read.early));
+
     return 0;
 }
 
@@ -1579,7 +1707,7 @@ struct volume_options options[] =
     },
     { .key = {"read-policy" },
       .type = GF_OPTION_TYPE_STR,
-      .value = {"round-robin", "gfid-hash"},
+      .value = {"round-robin", "gfid-hash", "stable"},
       .default_value = "gfid-hash",
       .op_version = {GD_OP_VERSION_3_7_6},
       .flags = OPT_FLAG_SETTABLE | OPT_FLAG_CLIENT_OPT | OPT_FLAG_DOC,
@@ -1587,7 +1715,9 @@ struct volume_options options[] =
       .description = "inode-read fops happen only on 'k' number of bricks in"
               " n=k+m disperse subvolume. 'round-robin' selects the read"
               " subvolume using round-robin algo. 'gfid-hash' selects read"
-              " subvolume based on hash of the gfid of that file/directory.",
+              " subvolume based on hash of the gfid of that file/directory."
+              " 'stable' always reads from the first available bricks, so"
+              " that all reads use the same decoding matrix.",
     },
     { .key   = {"shd-max-threads"},
       .type  = GF_OPTION_TYPE_INT,
@@ -1616,7 +1746,7 @@ struct volume_options options[] =
     {
         .key = { "cpu-extensions" },
         .type = GF_OPTION_TYPE_STR,
-        .value = { "none", "auto", "x64", "sse", "avx" },
+        .value = { "none", "auto", "x64", "sse", "avx", "avx512" },
         .default_value = "auto",
         .op_version = {GD_OP_VERSION_3_9_0},
         .flags = OPT_FLAG_SETTABLE | OPT_FLAG_CLIENT_OPT | OPT_FLAG_DOC,
@@ -1673,5 +1803,70 @@ struct volume_options options[] =
                         "lead to extra memory consumption, maximum "
                         "(cache size * stripe size) Bytes per open file."
     },
+    { .key = {"parallel-coding-threads"},
+      .type = GF_OPTION_TYPE_INT,
+      .min = 0,
+      .max = EC_PARALLEL_MAX_THREADS,
+      .default_value = "0",
+      .op_version = {GD_OP_VERSION_4_1_0},
+      .flags = OPT_FLAG_SETTABLE | OPT_FLAG_CLIENT_OPT | OPT_FLAG_DOC,
+      .tags = {"disperse"},
+      .description = "Number of threads of this volume that help to encode "
+                     "large writes and to decode large reads, together with "
+                     "the thread that handles the request. With 0, the "
+                     "request is encoded or decoded by that thread alone."
+    },
+    { .key = {"parallel-coding-min-size"},
+      .type = GF_OPTION_TYPE_SIZET,
+      .min = 0,
+      .max = 128 * GF_UNIT_MB,
+      .default_value = "512KB",
+      .op_version = {GD_OP_VERSION_4_1_0},
+      .flags = OPT_FLAG_SETTABLE | OPT_FLAG_CLIENT_OPT | OPT_FLAG_DOC,
+      .tags = {"disperse"},
+      .description = "Writes and reads with less data than this are encoded "
+                     "or decoded by the thread that handles them, without "
+                     "the help of parallel-coding-threads."
+    },
+    { .key = {"write-combine-size"},
+      .type = GF_OPTION_TYPE_SIZET,
+      .min = 0,
+      .max = 4 * GF_UNIT_MB,
+      .default_value = "0",
+      .op_version = {GD_OP_VERSION_4_1_0},
+      .flags = OPT_FLAG_SETTABLE | OPT_FLAG_CLIENT_OPT | OPT_FLAG_DOC,
+      .tags = {"disperse"},
+      .description = "Smaller writes to a file held under an eager lock are "
+                     "acknowledged once copied to a buffer of this size, and "
+                     "contiguous ones are sent together to avoid a "
+                     "read-modify-write cycle for each of them. Errors are "
+                     "reported by the next write, fsync or flush. 0 disables "
+                     "it."
+    },
+    { .key = {"write-combine-timeout"},
+      .type = GF_OPTION_TYPE_INT,
+      .min = 1,
+      .max = 10000,
+      .default_value = "100",
+      .op_version = {GD_OP_VERSION_4_1_0},
+      .flags = OPT_FLAG_SETTABLE | OPT_FLAG_CLIENT_OPT | OPT_FLAG_DOC,
+      .tags = {"disperse"},
+      .description = "Maximum time in milliseconds that combined writes are "
+                     "kept before being sent to the bricks. It's never "
+                     "longer than half of eager-lock-timeout."
+    },
+    { .key = {"read-hedge-timeout"},
+      .type = GF_OPTION_TYPE_INT,
+      .min = 0,
+      .max = 60000,
+      .default_value = "0",
+      .op_version = {GD_OP_VERSION_4_1_0},
+      .flags = OPT_FLAG_SETTABLE | OPT_FLAG_CLIENT_OPT | OPT_FLAG_DOC,
+      .tags = {"disperse"},
+      .description = "Time in milliseconds to wait for the answers of a "
+                     "read before sending it to one more brick. The read "
+                     "completes with the first answers that are enough to "
+                     "decode the data. 0 disables hedged reads."
+    },
     { .key = {NULL} }
 };
@@ -19,8 +19,13 @@
 #define EC_XATTR_VERSION EC_XATTR_PREFIX"version"
 #define EC_XATTR_HEAL    EC_XATTR_PREFIX"heal"
 #define EC_XATTR_DIRTY   EC_XATTR_PREFIX"dirty"
+#define EC_XATTR_HEAL_MAP EC_XATTR_PREFIX"heal-map"
 #define EC_STRIPE_CACHE_MAX_SIZE    10
+#define EC_PARALLEL_MAX_THREADS     16
 #define EC_VERSION_SIZE 2
+/* The heal map xattr holds the number of data versions it accounts for,
+ * followed by the counters of each region. */
+#define EC_HEAL_MAP_SIZE (EC_HEAL_MAP_REGIONS + 1)
 #define EC_SHD_INODE_LRU_LIMIT          10
 
 #define EC_MAX_FRAGMENTS EC_METHOD_MAX_FRAGMENTS
@@ -0,0 +1,554 @@
+/*
+  Copyright (c) 2018 Red Hat, Inc. <http://www.redhat.com>
+  This file is part of GlusterFS.
+
+  This file is licensed to you under your choice of the GNU Lesser
+  General Public License, version 3 or any later version (LGPLv3 or
+  later), or the GNU General Public License, version 2 (GPLv2), in all
+  cases as published by the Free Software Foundation.
+*/
+
+/*
+ * Benchmark and conformance check of the encoding and decoding functions
+ * of the disperse translator, without a volume.
+ *
+ * For every configuration (-c, a list of "fragments+redundancy") and
+ * fragment size (-f, a list of sizes, rounded up to whole chunks), random
+ * data is encoded with every code generator this build has, "none" being
+ * the C implementation, or with the ones given by -g. Every generator
+ * must produce the same fragments as the C implementation.
+ *
+ * The fragments are then decoded back for every erasure mask (-e), and the
+ * data must be the original one. A mask is the hex bitmap of the lost
+ * fragments, or one of:
+ *
+ *   parity  the redundancy fragments are lost, only data ones are used
+ *   data    the first data fragments are lost, all parity ones are used
+ *   all     every combination of at most redundancy lost fragments
+ *
+ * As a client does, the first fragments that are not lost are used. Masks
+ * losing more than the redundancy are rejected.
+ *
+ * Throughput is given in GB of file data per second of one core; every
+ * measure encodes or decodes about -m MB, spread over the masks when
+ * there are many. Generators this build does not have, or the cpu does
+ * not support, are skipped. The exit status is not zero if any result is
+ * wrong.
+ *
+ * Dynamic code is written to GLUSTERFS_LIBEXECDIR, which must exist.
+ *
+ * usage: ec_bench [-c configurations] [-f fragment sizes] [-e masks]
+ *                 [-g generators] [-m MB per measure] [-l logfile]
+ *
+ * e.g.   ec_bench -c 8+3,10+4 -f 4KB,128KB -e parity,data,0x81 -g none,avx512
+ *        ec_bench -c 8+4 -f 512 -e all -m 1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "glusterfs.h"
+#include "globals.h"
+#include "xlator.h"
+#include "mem-pool.h"
+#include "common-utils.h"
+
+#include "ec-mem-types.h"
+#include "ec-method.h"
+
+#define BENCH_MAX_CONFIGS 32
+#define BENCH_MAX_SIZES   32
+#define BENCH_MAX_GENS    16
+#define BENCH_MAX_NODES   (EC_METHOD_MAX_FRAGMENTS * 2 - 1)
+/* more than enough for "all" with 16 fragments and 4 of redundancy */
+#define BENCH_MAX_MASKS   (1 << 16)
+/* up to this many masks, each one gets its own line */
+#define BENCH_MASK_LINES  16
+
+#define BENCH_GB (1024.0 * 1024.0 * 1024.0)
+
+struct bench_config {
+    uint32_t fragments;
+    uint32_t redundancy;
+};
+
+struct bench {
+    struct bench_config configs[BENCH_MAX_CONFIGS];
+    uint32_t            nconfigs;
+    size_t              sizes[BENCH_MAX_SIZES];
+    uint32_t            nsizes;
+    const char         *gens[BENCH_MAX_GENS];
+    uint32_t            ngens;
+    const char         *masks;
+    size_t              total;
+};
+
+static double
+bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *
+bench_alloc(size_t size)
+{
+    void *ptr;
+
+    if (posix_memalign(&ptr, EC_METHOD_WORD_SIZE, size) != 0) {
+        return NULL;
+    }
+
+    return ptr;
+}
+
+static int
+bench_parse_configs(struct bench *bench, char *str)
+{
+    struct bench_config *config;
+    char *saveptr = NULL;
+    char *tok;
+
+    for (tok = strtok_r(str, ",", &saveptr); tok != NULL;
+         tok = strtok_r(NULL, ",", &saveptr)) {
+        if (bench->nconfigs >= BENCH_MAX_CONFIGS) {
+            return -1;
+        }
+        config = &bench->configs[bench->nconfigs++];
+        /* the same limits as the translator */
+        if ((sscanf(tok, "%u+%u", &config->fragments,
+                    &config->redundancy) != 2) ||
+            (config->fragments > EC_METHOD_MAX_FRAGMENTS) ||
+            (config->redundancy < 1) ||
+            (config->redundancy >= config->fragments) ||
+            (config->fragments + config->redundancy > BENCH_MAX_NODES)) {
+            fprintf(stderr, "invalid configuration '%s'\n", tok);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int
+bench_parse_sizes(struct bench *bench, char *str)
+{
+    char *saveptr = NULL;
+    char *tok;
+    uint64_t size;
+
+    for (tok = strtok_r(str, ",", &saveptr); tok != NULL;
+         tok = strtok_r(NULL, ",", &saveptr)) {
+        if ((bench->nsizes >= BENCH_MAX_SIZES) ||
+            (gf_string2bytesize_uint64(tok, &size) != 0) || (size == 0)) {
+            fprintf(stderr, "invalid fragment size '%s'\n", tok);
+            return -1;
+        }
+        /* the functions work on whole chunks */
+        size = (size + EC_METHOD_CHUNK_SIZE - 1) / EC_METHOD_CHUNK_SIZE *
+               EC_METHOD_CHUNK_SIZE;
+        bench->sizes[bench->nsizes++] = size;
+    }
+
+    return 0;
+}
+
+static int
+bench_parse_gens(struct bench *bench, char *str)
+{
+    char *saveptr = NULL;
+    char *tok;
+
+    for (tok = strtok_r(str, ",", &saveptr); tok != NULL;
+         tok = strtok_r(NULL, ",", &saveptr)) {
+        if (bench->ngens >= BENCH_MAX_GENS) {
+            return -1;
+        }
+        bench->gens[bench->ngens++] = tok;
+    }
+
+    return 0;
+}
+
+/* Fills the erasure masks of a configuration and returns how many there
+ * are, or -1 if one of them is not valid. */
+static int32_t
+bench_build_masks(struct bench *bench, struct bench_config *config,
+                  uintptr_t *masks)
+{
+    uint32_t nodes = config->fragments + config->redundancy;
+    char *str, *tok, *end;
+    char *saveptr = NULL;
+    uintptr_t mask;
+    int32_t count = 0;
+
+    str = strdup(bench->masks);
+    if (str == NULL) {
+        return -1;
+    }
+
+    for (tok = strtok_r(str, ",", &saveptr); tok != NULL;
+         tok = strtok_r(NULL, ",", &saveptr)) {
+        if (strcmp(tok, "all") == 0) {
+            for (mask = 0; (mask < (1ULL << nodes)) &&
+                           (count < BENCH_MAX_MASKS); mask++) {
+                if (gf_bits_count(mask) <= config->redundancy) {
+                    masks[count++] = mask;
+                }
+            }
+            continue;
+        }
+
+        if (strcmp(tok, "parity") == 0) {
+            mask = ((1ULL << config->redundancy) - 1) << config->fragments;
+        } else if (strcmp(tok, "data") == 0) {
+            mask = (1ULL << config->redundancy) - 1;
+        } else {
+            mask = strtoul(tok, &end, 16);
+            if ((*end != 0) || (mask >= (1ULL << nodes)) ||
+                (gf_bits_count(mask) > config->redundancy)) {
+                fprintf(stderr, "invalid erasure mask '%s' for %u+%u\n", tok,
+                        config->fragments, config->redundancy);
+                count = -1;
+                break;
+            }
+        }
+        if (count < BENCH_MAX_MASKS) {
+            masks[count++] = mask;
+        }
+    }
+
+    free(str);
+
+    return count;
+}
+
+static void
+bench_encode(ec_matrix_list_t *list, size_t size, void *in, void **out,
+             uint32_t nodes)
+{
+    void *blocks[nodes];
+
+    /* ec_method_encode() advances the pointers it is given */
+    memcpy(blocks, out, sizeof(void *) * nodes);
+    ec_method_encode(list, size, in, blocks);
+}
+
+/* Encodes 'data' once with the C implementation into 'ref', which the
+ * fragments of every generator are compared with. */
+static int
+bench_reference(xlator_t *xl, struct bench_config *config, size_t fsize,
+                void *data, void **ref)
+{
+    ec_matrix_list_t list;
+    uint32_t nodes = config->fragments + config->redundancy;
+    uint32_t i;
+
+    if (ec_method_init(xl, &list, config->fragments, nodes, nodes * 2,
+                       nodes * 2, "none") != 0) {
+        fprintf(stderr, "none: ec_method_init failed\n");
+        return -1;
+    }
+
+    for (i = 0; i < nodes; i++) {
+        ref[i] = bench_alloc(fsize);
+        if (ref[i] == NULL) {
+            ec_method_fini(&list);
+            return -1;
+        }
+    }
+    bench_encode(&list, fsize * config->fragments, data, ref, nodes);
+
+    ec_method_fini(&list);
+
+    return 0;
+}
+
+/* Decodes without the fragments in 'lost' and checks the result, then
+ * measures 'loops' more decodes. The first one builds the matrix and its
+ * code, which the translator keeps for the next reads. */
+static int
+bench_decode(ec_matrix_list_t *list, struct bench_config *config,
+             size_t fsize, uintptr_t lost, void **blocks, void *data,
+             void *out, size_t loops, double *elapsed)
+{
+    uint32_t nodes = config->fragments + config->redundancy;
+    void *in[config->fragments];
+    uint32_t rows[config->fragments];
+    uintptr_t mask = 0;
+    uint32_t i, count;
+    double t0;
+    size_t n;
+
+    count = 0;
+    for (i = 0; (i < nodes) && (count < config->fragments); i++) {
+        if ((lost & (1ULL << i)) == 0) {
+            rows[count] = i + 1;
+            in[count] = blocks[i];
+            mask |= 1ULL << i;
+            count++;
+        }
+    }
+
+    memset(out, 0, fsize * config->fragments);
+    if ((ec_method_decode(list, fsize, mask, rows, in, out) != 0) ||
+        (memcmp(out, data, fsize * config->fragments) != 0)) {
+        return -1;
+    }
+
+    t0 = bench_now();
+    for (n = 0; n < loops; n++) {
+        if (ec_method_decode(list, fsize, mask, rows, in, out) != 0) {
+            return -1;
+        }
+    }
+    *elapsed = bench_now() - t0;
+
+    return 0;
+}
+
+/* Returns -1 if any result is wrong. */
+static int
+bench_run(struct bench *bench, xlator_t *xl, const char *gen,
+          struct bench_config *config, size_t fsize, void *data, void **ref,
+          uintptr_t *masks, int32_t nmasks)
+{
+    ec_matrix_list_t list;
+    uint32_t nodes = config->fragments + config->redundancy;
+    size_t size = fsize * config->fragments;
+    void *blocks[nodes];
+    double t0, elapsed, slowest = 0, all = 0;
+    uintptr_t worst = 0;
+    void *out = NULL;
+    size_t loops, n;
+    uint32_t i;
+    int32_t j, failed = 0;
+    int ret = -1;
+
+    memset(blocks, 0, sizeof(blocks));
+
+    if (ec_method_init(xl, &list, config->fragments, nodes, nodes * 2,
+                       nodes * 2, gen) != 0) {
+        fprintf(stderr, "%s: ec_method_init failed\n", gen);
+        return -1;
+    }
+
+    /* an unknown or unsupported generator falls back to another one */
+    if (((list.code->gen == NULL) && (strcmp(gen, "none") != 0)) ||
+        ((list.code->gen != NULL) && (strcmp(list.code->gen->name,
+                                             gen) != 0))) {
+        printf("%-7s not available\n", gen);
+        ret = 0;
+        goto out;
+    }
+
+    for (i = 0; i < nodes; i++) {
+        blocks[i] = bench_alloc(fsize);
+        if (blocks[i] == NULL) {
+            goto out;
+        }
+    }
+    out = bench_alloc(size);
+    if (out == NULL) {
+        goto out;
+    }
+
+    loops = bench->total / size;
+    if (loops == 0) {
+        loops = 1;
+    }
+
+    t0 = bench_now();
+    for (n = 0; n < loops; n++) {
+        bench_encode(&list, size, data, blocks, nodes);
+    }
+    elapsed = bench_now() - t0;
+
+    for (i = 0; i < nodes; i++) {
+        if (memcmp(blocks[i], ref[i], fsize) != 0) {
+            fprintf(stderr, "%s %u+%u %zu: fragment %u differs from the C "
+                    "implementation\n", gen, config->fragments,
+                    config->redundancy, fsize, i);
+            failed++;
+        }
+    }
+
+    printf("%-7s encode %13.2f GB/s\n", gen,
+           size * loops / elapsed / BENCH_GB);
+
+    /* the same amount of data is decoded over all the masks */
+    loops /= nmasks;
+    if (loops == 0) {
+        loops = 1;
+    }
+
+    for (j = 0; j < nmasks; j++) {
+        if (bench_decode(&list, config, fsize, masks[j], blocks, data, out,
+                         loops, &elapsed) != 0) {
+            fprintf(stderr, "%s %u+%u %zu: decoding without %#lx failed\n",
+                    gen, config->fragments, config->redundancy, fsize,
+                    (unsigned long)masks[j]);
+            failed++;
+            continue;
+        }
+        all += elapsed;
+
+        if (nmasks <= BENCH_MASK_LINES) {
+            printf("%-7s decode %#6lx %6.2f GB/s\n", gen,
+                   (unsigned long)masks[j], size * loops / elapsed / BENCH_GB);
+        } else if (elapsed > slowest) {
+            slowest = elapsed;
+            worst = masks[j];
+        }
+    }
+    if ((nmasks > BENCH_MASK_LINES) && (all > 0)) {
+        printf("%-7s decode %6d masks %6.2f GB/s, slowest %#lx %.2f GB/s\n",
+               gen, nmasks, size * loops * nmasks / all / BENCH_GB,
+               (unsigned long)worst, size * loops / slowest / BENCH_GB);
+    }
+
+    if (failed == 0) {
+        ret = 0;
+    }
+
+out:
+    free(out);
+    for (i = 0; i < nodes; i++) {
+        free(blocks[i]);
+    }
+    ec_method_fini(&list);
+
+    return ret;
+}
+
+int
+main(int argc, char *argv[])
+{
+    static struct bench bench;
+    static uintptr_t masks[BENCH_MAX_MASKS];
+    glusterfs_ctx_t *ctx = NULL;
+    char *logfile = "/dev/null";
+    char *configs = "4+2,8+3,8+4,12+4,16+4";
+    char *sizes = "128KB";
+    char *gens = "none,x64,sse,avx,avx512";
+    struct bench_config *config;
+    void *ref[BENCH_MAX_NODES];
+    void *data;
+    size_t size, i;
+    uint32_t c, s, g;
+    int32_t nmasks;
+    int opt, ret = 0;
+
+    bench.masks = "parity,data";
+    bench.total = 1024 * 1024 * 1024;
+
+    while ((opt = getopt(argc, argv, "c:f:e:g:m:l:")) != -1) {
+        switch (opt) {
+        case 'c':
+            configs = optarg;
+            break;
+        case 'f':
+            sizes = optarg;
+            break;
+        case 'e':
+            bench.masks = optarg;
+            break;
+        case 'g':
+            gens = optarg;
+            break;
+        case 'm':
+            bench.total = strtoul(optarg, NULL, 0) * 1024 * 1024;
+            break;
+        case 'l':
+            logfile = optarg;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-c configurations] "
+                            "[-f fragment sizes] [-e masks] "
+                            "[-g generators] [-m MB per measure] "
+                            "[-l logfile]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    configs = strdup(configs);
+    sizes = strdup(sizes);
+    gens = strdup(gens);
+    if (!configs || !sizes || !gens ||
+        bench_parse_configs(&bench, configs) ||
+        bench_parse_sizes(&bench, sizes) || bench_parse_gens(&bench, gens)) {
+        return 1;
+    }
+
+    mem_pools_init_early();
+    mem_pools_init_late();
+
+    ctx = glusterfs_ctx_new();
+    if (!ctx || glusterfs_globals_init(ctx)) {
+        return 1;
+    }
+    THIS->ctx = ctx;
+
+    if (xlator_mem_acct_init(THIS, ec_mt_end + 1)) {
+        return 1;
+    }
+
+    ctx->logbuf_pool = mem_pool_new(log_buf_t, 256);
+    if (!ctx->logbuf_pool) {
+        return 1;
+    }
+
+    if (gf_log_init(ctx, logfile, NULL) == -1) {
+        return 1;
+    }
+
+    for (c = 0; c < bench.nconfigs; c++) {
+        config = &bench.configs[c];
+
+        nmasks = bench_build_masks(&bench, config, masks);
+        if (nmasks <= 0) {
+            return 1;
+        }
+
+        for (s = 0; s < bench.nsizes; s++) {
+            size = bench.sizes[s] * config->fragments;
+
+            data = bench_alloc(size);
+            if (data == NULL) {
+                return 1;
+            }
+            for (i = 0; i < size; i++) {
+                ((uint8_t *)data)[i] = random();
+            }
+
+            printf("%u+%u, %zu bytes per fragment\n", config->fragments,
+                   config->redundancy, bench.sizes[s]);
+
+            memset(ref, 0, sizeof(ref));
+            if (bench_reference(THIS, config, bench.sizes[s], data,
+                                ref) != 0) {
+                return 1;
+            }
+            for (g = 0; g < bench.ngens; g++) {
+                if (bench_run(&bench, THIS, bench.gens[g], config,
+                              bench.sizes[s], data, ref, masks,
+                              nmasks) < 0) {
+                    ret = 1;
+                }
+            }
+
+            for (i = 0; i < BENCH_MAX_NODES; i++) {
+                free(ref[i]);
+            }
+            free(data);
+        }
+    }
+
+    return ret;
+}
@@ -962,6 +962,15 @@ io_stats_dump_global_to_json_logfp (xlator_t *this,
                 data_pair_t *curr = NULL;
 
                 dict_foreach_inline (xattr, curr) {
+                        /* the state of the autoscaling, when enabled */
+                        if (!strncmp (curr->key, IO_THREADS_AUTOSCALE_PREFIX,
+                                      strlen (IO_THREADS_AUTOSCALE_PREFIX))) {
+                                ios_log (this, logfp,
+                                         "\"%s.%s.%s\": \"%d\",",
+                                         key_prefix, str_prefix, curr->key,
+                                         data_to_int32 (curr->value));
+                                continue;
+                        }
                         ios_log (this, logfp,
                                  "\"%s.%s.%s.queue_size\": \"%d\",",
                                  key_prefix, str_prefix, curr->key,
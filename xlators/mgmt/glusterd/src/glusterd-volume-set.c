@@ -1520,6 +1520,16 @@ struct volopt_map_entry glusterd_volopt_map[] = {
           .op_version = 2,
           .flags      = VOLOPT_FLAG_CLIENT_OPT
         },
+        { .key        = "cluster.read-hedge-percentile",
+          .voltype    = "cluster/replicate",
+          .op_version = GD_OP_VERSION_4_1_0,
+          .flags      = VOLOPT_FLAG_CLIENT_OPT
+        },
+        { .key        = "cluster.read-hedge-budget",
+          .voltype    = "cluster/replicate",
+          .op_version = GD_OP_VERSION_4_1_0,
+          .flags      = VOLOPT_FLAG_CLIENT_OPT
+        },
         { .key        = "cluster.self-heal-readdir-size",
           .voltype    = "cluster/replicate",
           .op_version = 2,
@@ -1767,6 +1777,26 @@ struct volopt_map_entry glusterd_volopt_map[] = {
           .option      = "pass-through",
           .op_version  = GD_OP_VERSION_4_1_0
         },
+        { .key         = "performance.iot-autoscale",
+          .voltype     = "performance/io-threads",
+          .option      = "autoscale",
+          .op_version  = GD_OP_VERSION_4_1_0
+        },
+        { .key         = "performance.iot-autoscale-min-threads",
+          .voltype     = "performance/io-threads",
+          .option      = "autoscale-min-threads",
+          .op_version  = GD_OP_VERSION_4_1_0
+        },
+        { .key         = "performance.iot-autoscale-max-threads",
+          .voltype     = "performance/io-threads",
+          .option      = "autoscale-max-threads",
+          .op_version  = GD_OP_VERSION_4_1_0
+        },
+        { .key         = "performance.iot-autoscale-interval",
+          .voltype     = "performance/io-threads",
+          .option      = "autoscale-interval",
+          .op_version  = GD_OP_VERSION_4_1_0
+        },
 
         /* Other perf xlators' options */
         { .key         = "performance.io-cache-pass-through",
@@ -2030,10 +2060,41 @@ struct volopt_map_entry glusterd_volopt_map[] = {
           .type        = NO_DOC,
           .op_version  = GD_OP_VERSION_3_7_0,
         },
+        { .key         = "client.ssl-ktls",
+          .voltype     = "protocol/client",
+          .option      = "transport.socket.ssl-ktls",
+          .op_version  = GD_OP_VERSION_4_1_0,
+          .description = "Let the kernel do the encryption of the SSL "
+                         "client connections (kTLS), where it can."
+        },
+        { .key         = "client.io-uring",
+          .voltype     = "protocol/client",
+          .option      = "transport.socket.io-uring",
+          .op_version  = GD_OP_VERSION_4_1_0,
+          .description = "Use io_uring for the I/O of the client "
+                         "connections, where the kernel supports it."
+        },
+        { .key         = "client.io-uring-buffers",
+          .voltype     = "protocol/client",
+          .option      = "transport.socket.io-uring-buffers",
+          .op_version  = GD_OP_VERSION_4_1_0,
+        },
         { .key         = "client.event-threads",
           .voltype     = "protocol/client",
           .op_version  = GD_OP_VERSION_3_7_0,
         },
+        { .key         = "client.event-batch-size",
+          .voltype     = "protocol/client",
+          .op_version  = GD_OP_VERSION_4_1_0,
+        },
+        { .key         = "client.event-cpus",
+          .voltype     = "protocol/client",
+          .op_version  = GD_OP_VERSION_4_1_0,
+        },
+        { .key         = "client.streams",
+          .voltype     = "protocol/client",
+          .op_version  = GD_OP_VERSION_4_1_0,
+        },
         { .key         = "client.tcp-user-timeout",
           .voltype     = "protocol/client",
           .option      = "transport.tcp-user-timeout",
@@ -2073,6 +2134,11 @@ struct volopt_map_entry glusterd_volopt_map[] = {
           .voltype     = "protocol/server",
           .op_version  = 1
         },
+        { .key         = "server.inode-table-shards",
+          .voltype     = "protocol/server",
+          .option      = "inode-table-shards",
+          .op_version  = GD_OP_VERSION_4_1_0
+        },
         { .key         = AUTH_ALLOW_MAP_KEY,
           .voltype     = "protocol/server",
           .option      = "!server-auth",
@@ -2123,6 +2189,21 @@ struct volopt_map_entry glusterd_volopt_map[] = {
           .type        = GLOBAL_DOC,
           .op_version  = 3
         },
+        { .key         = "server.fair-share",
+          .voltype     = "protocol/server",
+          .option      = "rpc.fair-share",
+          .op_version  = GD_OP_VERSION_4_1_0
+        },
+        { .key         = "server.fair-share-weights",
+          .voltype     = "protocol/server",
+          .option      = "rpc.fair-share-weights",
+          .op_version  = GD_OP_VERSION_4_1_0
+        },
+        { .key         = "server.fair-share-op-cost",
+          .voltype     = "protocol/server",
+          .option      = "rpc.fair-share-op-cost",
+          .op_version  = GD_OP_VERSION_4_1_0
+        },
         { .key         = "server.ssl",
           .voltype     = "protocol/server",
           .option      = "transport.socket.ssl-enabled",
@@ -2160,10 +2241,37 @@ struct volopt_map_entry glusterd_volopt_map[] = {
           .type        = NO_DOC,
           .op_version  = GD_OP_VERSION_3_7_0,
         },
+        { .key         = "server.ssl-ktls",
+          .voltype     = "protocol/server",
+          .option      = "transport.socket.ssl-ktls",
+          .op_version  = GD_OP_VERSION_4_1_0,
+          .description = "Let the kernel do the encryption of the SSL "
+                         "server connections (kTLS), where it can."
+        },
+        { .key         = "server.io-uring",
+          .voltype     = "protocol/server",
+          .option      = "transport.socket.io-uring",
+          .op_version  = GD_OP_VERSION_4_1_0,
+          .description = "Use io_uring for the I/O of the server "
+                         "connections, where the kernel supports it."
+        },
+        { .key         = "server.io-uring-buffers",
+          .voltype     = "protocol/server",
+          .option      = "transport.socket.io-uring-buffers",
+          .op_version  = GD_OP_VERSION_4_1_0,
+        },
         { .key         = "server.event-threads",
           .voltype     = "protocol/server",
           .op_version  = GD_OP_VERSION_3_7_0,
         },
+        { .key         = "server.event-batch-size",
+          .voltype     = "protocol/server",
+          .op_version  = GD_OP_VERSION_4_1_0,
+        },
+        { .key         = "server.event-cpus",
+          .voltype     = "protocol/server",
+          .op_version  = GD_OP_VERSION_4_1_0,
+        },
         { .key         = "server.tcp-user-timeout",
           .voltype     = "protocol/server",
           .option      = "transport.tcp-user-timeout",
@@ -3725,6 +3833,31 @@ struct volopt_map_entry glusterd_volopt_map[] = {
           .op_version = GD_OP_VERSION_4_0_0,
           .flags      = VOLOPT_FLAG_CLIENT_OPT
         },
+        { .key        = "disperse.parallel-coding-threads",
+          .voltype    = "cluster/disperse",
+          .op_version = GD_OP_VERSION_4_1_0,
+          .flags      = VOLOPT_FLAG_CLIENT_OPT
+        },
+        { .key        = "disperse.parallel-coding-min-size",
+          .voltype    = "cluster/disperse",
+          .op_version = GD_OP_VERSION_4_1_0,
+          .flags      = VOLOPT_FLAG_CLIENT_OPT
+        },
+        { .key        = "disperse.write-combine-size",
+          .voltype    = "cluster/disperse",
+          .op_version = GD_OP_VERSION_4_1_0,
+          .flags      = VOLOPT_FLAG_CLIENT_OPT
+        },
+        { .key        = "disperse.write-combine-timeout",
+          .voltype    = "cluster/disperse",
+          .op_version = GD_OP_VERSION_4_1_0,
+          .flags      = VOLOPT_FLAG_CLIENT_OPT
+        },
+        { .key        = "disperse.read-hedge-timeout",
+          .voltype    = "cluster/disperse",
+          .op_version = GD_OP_VERSION_4_1_0,
+          .flags      = VOLOPT_FLAG_CLIENT_OPT
+        },
 
         /* Halo replication options */
         { .key        = "cluster.halo-enabled",
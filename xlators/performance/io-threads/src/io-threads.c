@@ -19,6 +19,7 @@
 #include <stdlib.h>
 #include <sys/time.h>
 #include <time.h>
+#include <sched.h>
 #include "locking.h"
 #include "io-threads-messages.h"
 #include "timespec.h"
@@ -76,8 +77,75 @@ iot_get_ctx (xlator_t *this, client_t *client)
         return ctx;
 }
 
+void
+__iot_enqueue (iot_conf_t *conf, call_stub_t *stub, int pri)
+{
+        client_t                *client = stub->frame->root->client;
+        iot_client_ctx_t        *ctx;
+
+        if (client) {
+                ctx = iot_get_ctx (conf->this, client);
+                if (ctx) {
+                        ctx = &ctx[pri];
+                }
+        } else {
+                ctx = NULL;
+        }
+        if (!ctx) {
+                ctx = &conf->no_client[pri];
+        }
+
+        if (list_empty (&ctx->reqs)) {
+                list_add_tail (&ctx->clients, &conf->clients[pri]);
+        }
+        list_add_tail (&stub->list, &ctx->reqs);
+}
+
+/* Moves what was pushed on the inbox of @pri to the per client queues, in
+ * the order it was pushed. Called with conf->queue_lock[pri] held. */
+void
+__iot_inbox_drain (iot_conf_t *conf, int pri)
+{
+        struct list_head        *head = NULL;
+        struct list_head        *prev = NULL;
+        struct list_head        *next = NULL;
+
+        head = (struct list_head *) GF_ATOMIC_SWAP (conf->inbox[pri], 0);
+
+        /* newest first, turn it around */
+        while (head) {
+                next = head->next;
+                head->next = prev;
+                prev = head;
+                head = next;
+        }
+
+        for (head = prev; head; head = next) {
+                next = head->next;
+                __iot_enqueue (conf, list_entry (head, call_stub_t, list),
+                               pri);
+        }
+}
+
+/* Accounts for one more request of @pri being executed, unless that many
+ * already are. */
+static gf_boolean_t
+iot_take_slot (iot_conf_t *conf, int pri)
+{
+        int64_t count = 0;
+
+        do {
+                count = GF_ATOMIC_GET (conf->ac_iot_count[pri]);
+                if (count >= conf->ac_iot_limit[pri])
+                        return _gf_false;
+        } while (!GF_ATOMIC_CMP_SWAP (conf->ac_iot_count[pri], count,
+                                      count + 1));
+
+        return _gf_true;
+}
+
 call_stub_t *
-__iot_dequeue (iot_conf_t *conf, int *pri)
+iot_dequeue (iot_conf_t *conf, int *pri)
 {
         call_stub_t             *stub = NULL;
         int                     i = 0;
@@ -86,35 +154,49 @@ __iot_dequeue (iot_conf_t *conf, int *pri)
         *pri = -1;
         for (i = 0; i < GF_FOP_PRI_MAX; i++) {
 
-                if (conf->ac_iot_count[i] >= conf->ac_iot_limit[i]) {
+                if (GF_ATOMIC_GET (conf->queue_sizes[i]) == 0) {
                         continue;
                 }
 
-                if (list_empty (&conf->clients[i])) {
+                if (!iot_take_slot (conf, i)) {
                         continue;
                 }
 
-                /* Get the first per-client queue for this priority. */
-                ctx = list_first_entry (&conf->clients[i],
-                                        iot_client_ctx_t, clients);
-                if (!ctx) {
-                        continue;
-                }
+                LOCK (&conf->queue_lock[i]);
+                {
+                        __iot_inbox_drain (conf, i);
 
-                if (list_empty (&ctx->reqs)) {
-                        continue;
+                        if (list_empty (&conf->clients[i])) {
+                                goto unlock;
+                        }
+
+                        /* Get the first per-client queue for this
+                         * priority. */
+                        ctx = list_first_entry (&conf->clients[i],
+                                                iot_client_ctx_t, clients);
+                        if (list_empty (&ctx->reqs)) {
+                                goto unlock;
+                        }
+
+                        /* Get the first request on that queue. */
+                        stub = list_first_entry (&ctx->reqs, call_stub_t,
+                                                 list);
+                        list_del_init (&stub->list);
+                        if (list_empty (&ctx->reqs)) {
+                                list_del_init (&ctx->clients);
+                        } else {
+                                list_rotate_left (&conf->clients[i]);
+                        }
                 }
+        unlock:
+                UNLOCK (&conf->queue_lock[i]);
 
-                /* Get the first request on that queue. */
-                stub = list_first_entry (&ctx->reqs, call_stub_t, list);
-                list_del_init (&stub->list);
-                if (list_empty (&ctx->reqs)) {
-                        list_del_init (&ctx->clients);
-                } else {
-                        list_rotate_left (&conf->clients[i]);
+                if (!stub) {
+                        /* another worker got it first */
+                        GF_ATOMIC_DEC (conf->ac_iot_count[i]);
+                        continue;
                 }
 
-                conf->ac_iot_count[i]++;
                 conf->queue_marked[i] = _gf_false;
                 *pri = i;
                 break;
@@ -123,40 +205,83 @@ __iot_dequeue (iot_conf_t *conf, int *pri)
         if (!stub)
                 return NULL;
 
-        conf->queue_size--;
-        conf->queue_sizes[*pri]--;
+        GF_ATOMIC_DEC (conf->queue_size);
+        GF_ATOMIC_DEC (conf->queue_sizes[*pri]);
 
         return stub;
 }
 
+/* Lock-free, see the inbox in iot_conf_t */
 void
-__iot_enqueue (iot_conf_t *conf, call_stub_t *stub, int pri)
+iot_enqueue (iot_conf_t *conf, call_stub_t *stub, int pri)
 {
-        client_t                *client = stub->frame->root->client;
-        iot_client_ctx_t        *ctx;
+        uintptr_t  head = 0;
 
         if (pri < 0 || pri >= GF_FOP_PRI_MAX)
                 pri = GF_FOP_PRI_MAX-1;
 
-        if (client) {
-                ctx = iot_get_ctx (THIS, client);
-                if (ctx) {
-                        ctx = &ctx[pri];
+        if (conf->autoscale)
+                timespec_now (&stub->queued);
+
+        do {
+                head = GF_ATOMIC_GET (conf->inbox[pri]);
+                stub->list.next = (struct list_head *) head;
+        } while (!GF_ATOMIC_CMP_SWAP (conf->inbox[pri], head,
+                                      (uintptr_t) &stub->list));
+
+        GF_ATOMIC_INC (conf->queue_sizes[pri]);
+        GF_ATOMIC_INC (conf->queue_size);
+
+        sem_post (&conf->sem);
+}
+
+/* Gives up the thread when it was idle for idle-time seconds and there
+ * are others left, when there are more threads than thread-count, or when
+ * the translator goes down. */
+static gf_boolean_t
+iot_worker_exit (iot_conf_t *conf, gf_boolean_t idle)
+{
+        gf_boolean_t bye = _gf_false;
+        int32_t      min_count = IOT_MIN_THREADS;
+
+        pthread_mutex_lock (&conf->mutex);
+        {
+                if (conf->autoscale)
+                        min_count = conf->autoscale_min;
+
+                if (conf->down || (idle && conf->curr_count > min_count) ||
+                    (conf->curr_count > conf->max_count)) {
+                        conf->curr_count--;
+                        if (conf->curr_count == 0)
+                                pthread_cond_broadcast (&conf->cond);
+                        gf_msg_debug (conf->this->name, 0,
+                                      "terminated. conf->curr_count=%d",
+                                      conf->curr_count);
+                        bye = _gf_true;
                 }
-        } else {
-                ctx = NULL;
-        }
-        if (!ctx) {
-                ctx = &conf->no_client[pri];
         }
+        pthread_mutex_unlock (&conf->mutex);
 
-        if (list_empty (&ctx->reqs)) {
-                list_add_tail (&ctx->clients, &conf->clients[pri]);
-        }
-        list_add_tail (&stub->list, &ctx->reqs);
+        return bye;
+}
 
-        conf->queue_size++;
-        conf->queue_sizes[pri]++;
+/* Executes @stub, accounting the time it was queued for and the time it
+ * took for the autoscaling. */
+static void
+iot_resume_timed (iot_conf_t *conf, call_stub_t *stub, int pri)
+{
+        iot_autoscale_t *as = &conf->as[pri];
+        struct timespec  queued = stub->queued;
+        struct timespec  start = {0, };
+        struct timespec  end = {0, };
+
+        timespec_now (&start);
+        call_resume (stub);
+        timespec_now (&end);
+
+        GF_ATOMIC_INC (as->done);
+        GF_ATOMIC_ADD (as->wait_usec, (TS (start) - TS (queued)) / 1000);
+        GF_ATOMIC_ADD (as->service_usec, (TS (end) - TS (start)) / 1000);
 }
 
 void *
@@ -168,92 +293,102 @@ iot_worker (void *data)
         struct timespec   sleep_till = {0, };
         int               ret = 0;
         int               pri = -1;
-        gf_boolean_t      bye = _gf_false;
 
         conf = data;
         this = conf->this;
         THIS = this;
 
         for (;;) {
-                pthread_mutex_lock (&conf->mutex);
-                {
-                        if (pri != -1) {
-                                conf->ac_iot_count[pri]--;
-                                pri = -1;
-                        }
-                        while (conf->queue_size == 0) {
-                                if (conf->down) {
-                                        bye = _gf_true;/*Avoid sleep*/
-                                        break;
-                                }
+                if (pri != -1) {
+                        GF_ATOMIC_DEC (conf->ac_iot_count[pri]);
+                        pri = -1;
+                }
 
-                                clock_gettime (CLOCK_REALTIME_COARSE,
-                                               &sleep_till);
-                                sleep_till.tv_sec += conf->idle_time;
+                /* thread-count was lowered */
+                if ((conf->curr_count > conf->max_count) &&
+                    iot_worker_exit (conf, _gf_false))
+                        break;
 
-                                conf->sleep_count++;
-                                ret = pthread_cond_timedwait (&conf->cond,
-                                                              &conf->mutex,
-                                                              &sleep_till);
-                                conf->sleep_count--;
+                /* on the way down whatever is queued is still executed,
+                 * without waiting for the posts of it */
+                if (!conf->down) {
+                        clock_gettime (CLOCK_REALTIME, &sleep_till);
+                        sleep_till.tv_sec += conf->idle_time;
 
-                                if (conf->down || ret == ETIMEDOUT) {
-                                        bye = _gf_true;
+                        GF_ATOMIC_INC (conf->sleep_count);
+                        do {
+                                ret = sem_timedwait (&conf->sem, &sleep_till);
+                        } while (ret == -1 && errno == EINTR);
+                        GF_ATOMIC_DEC (conf->sleep_count);
+
+                        if (ret == -1 && errno == ETIMEDOUT) {
+                                if (iot_worker_exit (conf, _gf_true))
                                         break;
-                                }
+                                continue;
                         }
+                }
 
-                        if (bye) {
-                                if (conf->down || conf->curr_count > IOT_MIN_THREADS) {
-                                        conf->curr_count--;
-                                        if (conf->curr_count == 0)
-                                           pthread_cond_broadcast (&conf->cond);
-                                        gf_msg_debug (conf->this->name, 0,
-                                                      "terminated. "
-                                                      "conf->curr_count=%d",
-                                                      conf->curr_count);
-                                } else {
-                                        bye = _gf_false;
-                                }
+                stub = iot_dequeue (conf, &pri);
+                if (!stub) {
+                        if (conf->down) {
+                                if (iot_worker_exit (conf, _gf_false))
+                                        break;
+                                continue;
                         }
 
-                        if (!bye)
-                                stub = __iot_dequeue (conf, &pri);
+                        /* only queues at their limit of threads are left;
+                         * hand the post on, and try again */
+                        sem_post (&conf->sem);
+                        sched_yield ();
+                        continue;
                 }
-                pthread_mutex_unlock (&conf->mutex);
 
-                if (stub) { /* guard against spurious wakeups */
-                        if (stub->poison) {
-                                gf_log (this->name, GF_LOG_INFO,
-                                        "Dropping poisoned request %p.", stub);
-                                call_stub_destroy (stub);
-                        } else {
-                                        call_resume (stub);
-                        }
+                if (stub->poison) {
+                        gf_log (this->name, GF_LOG_INFO,
+                                "Dropping poisoned request %p.", stub);
+                        call_stub_destroy (stub);
+                } else if (stub->queued.tv_sec || stub->queued.tv_nsec) {
+                        iot_resume_timed (conf, stub, pri);
+                } else {
+                        call_resume (stub);
                 }
                 stub = NULL;
-
-                if (bye)
-                        break;
         }
 
         return NULL;
 }
 
+/* Threads to be running for what is queued, see __iot_workers_scale () */
+static int
+iot_workers_wanted (iot_conf_t *conf)
+{
+        int       scale = 0;
+        int       i = 0;
+
+        for (i = 0; i < GF_FOP_PRI_MAX; i++)
+                scale += min (GF_ATOMIC_GET (conf->queue_sizes[i]),
+                              conf->ac_iot_limit[i]);
+
+        if (scale < IOT_MIN_THREADS)
+                scale = IOT_MIN_THREADS;
+
+        if (scale > conf->max_count)
+                scale = conf->max_count;
+
+        return scale;
+}
+
 int
 do_iot_schedule (iot_conf_t *conf, call_stub_t *stub, int pri)
 {
         int   ret = 0;
 
-        pthread_mutex_lock (&conf->mutex);
-        {
-                __iot_enqueue (conf, stub, pri);
-
-                pthread_cond_signal (&conf->cond);
+        iot_enqueue (conf, stub, pri);
 
-                ret = __iot_workers_scale (conf);
-        }
-        pthread_mutex_unlock (&conf->mutex);
+        /* conf->mutex is only taken when a thread has to be added */
+        if ((GF_ATOMIC_GET (conf->sleep_count) == 0) &&
+            (conf->curr_count < iot_workers_wanted (conf)))
+                ret = iot_workers_scale (conf);
 
         return ret;
 }
@@ -597,6 +732,53 @@ iot_setxattr (call_frame_t *frame, xlator_t *this, loc_t *loc, dict_t *dict,
         return 0;
 }
 
+/* The autoscaling decisions, for io-stats */
+static int
+iot_autoscale_to_dict (iot_conf_t *conf, dict_t *dict)
+{
+        iot_autoscale_t *as = NULL;
+        char             key[64];
+        int              ret = 0;
+        int              i = 0;
+
+        ret = dict_set_int32 (dict, IO_THREADS_AUTOSCALE_PREFIX
+                              "thread-count", conf->max_count);
+
+        for (i = 0; !ret && i < GF_FOP_PRI_MAX; i++) {
+                as = &conf->as[i];
+
+                snprintf (key, sizeof (key), IO_THREADS_AUTOSCALE_PREFIX
+                          "%s.threads", fop_pri_to_string (i));
+                ret = dict_set_int32 (dict, key, conf->ac_iot_limit[i]);
+                if (ret)
+                        break;
+
+                snprintf (key, sizeof (key), IO_THREADS_AUTOSCALE_PREFIX
+                          "%s.wait_usec", fop_pri_to_string (i));
+                ret = dict_set_int32 (dict, key, as->last_wait_usec);
+                if (ret)
+                        break;
+
+                snprintf (key, sizeof (key), IO_THREADS_AUTOSCALE_PREFIX
+                          "%s.service_usec", fop_pri_to_string (i));
+                ret = dict_set_int32 (dict, key, as->last_service_usec);
+                if (ret)
+                        break;
+
+                snprintf (key, sizeof (key), IO_THREADS_AUTOSCALE_PREFIX
+                          "%s.grows", fop_pri_to_string (i));
+                ret = dict_set_int32 (dict, key, as->grows);
+                if (ret)
+                        break;
+
+                snprintf (key, sizeof (key), IO_THREADS_AUTOSCALE_PREFIX
+                          "%s.shrinks", fop_pri_to_string (i));
+                ret = dict_set_int32 (dict, key, as->shrinks);
+        }
+
+        return ret;
+}
+
 int
 iot_getxattr (call_frame_t *frame, xlator_t *this, loc_t *loc,
               const char *name, dict_t *xdata)
@@ -624,13 +806,19 @@ iot_getxattr (call_frame_t *frame, xlator_t *this, loc_t *loc,
                 for (i = 0; i < GF_FOP_PRI_MAX; i++) {
                         if (dict_set_int32 (depths,
                                             (char *)fop_pri_to_string (i),
-                                            conf->queue_sizes[i]) != 0) {
+                                            GF_ATOMIC_GET (conf->queue_sizes[i])) != 0) {
                                 dict_unref (depths);
                                 depths = NULL;
                                 goto unwind_special_getxattr;
                         }
                 }
 
+                if (conf->autoscale &&
+                    iot_autoscale_to_dict (conf, depths) != 0) {
+                        dict_unref (depths);
+                        depths = NULL;
+                }
+
 unwind_special_getxattr:
                 STACK_UNWIND_STRICT (getxattr, frame, op_ret, op_errno,
                                      depths, xdata);
@@ -815,17 +1003,9 @@ __iot_workers_scale (iot_conf_t *conf)
         int       diff = 0;
         pthread_t thread;
         int       ret = 0;
-        int       i = 0;
         char      thread_name[GF_THREAD_NAMEMAX] = {0,};
 
-        for (i = 0; i < GF_FOP_PRI_MAX; i++)
-                scale += min (conf->queue_sizes[i], conf->ac_iot_limit[i]);
-
-        if (scale < IOT_MIN_THREADS)
-                scale = IOT_MIN_THREADS;
-
-        if (scale > conf->max_count)
-                scale = conf->max_count;
+        scale = iot_workers_wanted (conf);
 
         if (conf->curr_count < scale) {
                 diff = scale - conf->curr_count;
@@ -841,9 +1021,11 @@ __iot_workers_scale (iot_conf_t *conf)
                 if (ret == 0) {
                         conf->curr_count++;
                         gf_msg_debug (conf->this->name, 0,
-                                      "scaled threads to %d (queue_size=%d/%d)",
+                                      "scaled threads to %d "
+                                      "(queue_size=%"PRId64"/%d)",
                                       conf->curr_count,
-                                      conf->queue_size, scale);
+                                      GF_ATOMIC_GET (conf->queue_size),
+                                      scale);
                 } else {
                         break;
                 }
@@ -933,7 +1115,10 @@ int
 iot_priv_dump (xlator_t *this)
 {
         iot_conf_t     *conf   =   NULL;
+        iot_autoscale_t *as    =   NULL;
         char           key_prefix[GF_DUMP_MAX_BUF_LEN];
+        char           key[GF_DUMP_MAX_BUF_LEN];
+        int            i       =   0;
 
         if (!this)
                 return 0;
@@ -949,7 +1134,8 @@ iot_priv_dump (xlator_t *this)
 
         gf_proc_dump_write("maximum_threads_count", "%d", conf->max_count);
         gf_proc_dump_write("current_threads_count", "%d", conf->curr_count);
-        gf_proc_dump_write("sleep_count", "%d", conf->sleep_count);
+        gf_proc_dump_write("sleep_count", "%"PRId64,
+                           GF_ATOMIC_GET (conf->sleep_count));
         gf_proc_dump_write("idle_time", "%d", conf->idle_time);
         gf_proc_dump_write("stack_size", "%zd", conf->stack_size);
         gf_proc_dump_write("high_priority_threads", "%d",
@@ -961,6 +1147,29 @@ iot_priv_dump (xlator_t *this)
         gf_proc_dump_write("least_priority_threads", "%d",
                            conf->ac_iot_limit[GF_FOP_PRI_LEAST]);
 
+        gf_proc_dump_write("autoscale", "%d", conf->autoscale);
+        if (!conf->autoscale)
+                return 0;
+
+        gf_proc_dump_write("autoscale_min_threads", "%d", conf->autoscale_min);
+        gf_proc_dump_write("autoscale_max_threads", "%d", conf->autoscale_max);
+        gf_proc_dump_write("autoscale_interval", "%d",
+                           conf->autoscale_interval);
+
+        for (i = 0; i < GF_FOP_PRI_MAX; i++) {
+                as = &conf->as[i];
+                gf_proc_dump_build_key (key, "autoscale", "%s",
+                                        fop_pri_to_string (i));
+                gf_proc_dump_write (key, "threads=%d, change=%d, done=%"
+                                    PRId64", wait_usec=%"PRId64
+                                    ", service_usec=%"PRId64", busy=%"
+                                    PRId64"%%, grows=%"PRIu64", shrinks=%"
+                                    PRIu64, conf->ac_iot_limit[i],
+                                    as->last_change, as->last_done,
+                                    as->last_wait_usec, as->last_service_usec,
+                                    as->last_busy, as->grows, as->shrinks);
+        }
+
         return 0;
 }
 
@@ -1071,7 +1280,8 @@ iot_watchdog (void *arg)
                         } else {
                                 bad_times[i] = 0;
                         }
-                        priv->queue_marked[i] = (priv->queue_sizes[i] > 0);
+                        priv->queue_marked[i] =
+                                (GF_ATOMIC_GET (priv->queue_sizes[i]) > 0);
                 }
                 pthread_mutex_unlock (&priv->mutex);
                 pthread_setcancelstate (PTHREAD_CANCEL_ENABLE, NULL);
@@ -1123,6 +1333,207 @@ stop_iot_watchdog (xlator_t *this)
         priv->watchdog_running = _gf_false;
 }
 
+/*
+ * Where the autoscaling moves the thread limit of a priority to, from the
+ * averages of the last interval:
+ *
+ *   - requests waited longer than they took to execute, and the threads
+ *     were busy: more threads should help. Unless the fops themselves
+ *     became much slower than usual, which means that what is below us is
+ *     saturated and more threads would only queue there instead of here.
+ *
+ *   - the threads were mostly idle: keep twice what was in use.
+ *
+ * The limit moves by a quarter at a time, so that a few intervals of a
+ * different load are needed for a big change.
+ */
+static int32_t
+iot_autoscale_limit (iot_conf_t *conf, iot_autoscale_t *as, int32_t limit,
+                     int64_t queued)
+{
+        int32_t       step = max (limit / 4, 1);
+        int32_t       used = 0;
+        gf_boolean_t  waiting = _gf_false;
+        gf_boolean_t  saturated = _gf_false;
+
+        if (as->last_done) {
+                waiting = (as->last_wait_usec > as->last_service_usec);
+                saturated = (as->base_service_usec &&
+                             as->last_service_usec >
+                             2 * as->base_service_usec);
+        } else {
+                /* nothing finished, everything is stuck or there was no
+                 * load at all */
+                waiting = (queued > 0);
+        }
+
+        if (waiting && (!as->last_done || as->last_busy >= limit * 75)) {
+                if (saturated)
+                        return max (limit - step, 1);
+                return min (limit + step, conf->autoscale_max);
+        }
+
+        if (!waiting && (as->last_busy * 2 < limit * 100)) {
+                used = (as->last_busy * 2 + 99) / 100;
+                return max (max (limit - step, used), 1);
+        }
+
+        return limit;
+}
+
+/* Takes the measures of the last @elapsed usecs, and sets the thread
+ * limits and thread-count for the next interval. */
+static void
+iot_autoscale_tick (xlator_t *this, iot_conf_t *conf, int64_t elapsed)
+{
+        iot_autoscale_t *as = NULL;
+        int64_t          done = 0;
+        int64_t          wait = 0;
+        int64_t          service = 0;
+        int32_t          limit = 0;
+        int32_t          total = 0;
+        int              i = 0;
+
+        if (elapsed <= 0)
+                return;
+
+        pthread_mutex_lock (&conf->mutex);
+        {
+                for (i = 0; i < GF_FOP_PRI_MAX; i++) {
+                        as = &conf->as[i];
+
+                        done = GF_ATOMIC_SWAP (as->done, 0);
+                        wait = GF_ATOMIC_SWAP (as->wait_usec, 0);
+                        service = GF_ATOMIC_SWAP (as->service_usec, 0);
+
+                        as->last_done = done;
+                        as->last_wait_usec = done ? wait / done : 0;
+                        as->last_service_usec = done ? service / done : 0;
+                        as->last_busy = service * 100 / elapsed;
+
+                        limit = conf->ac_iot_limit[i];
+                        /* least priority is a throttle, it is left as
+                         * configured */
+                        if (i != GF_FOP_PRI_LEAST)
+                                limit = iot_autoscale_limit (conf, as, limit,
+                                        GF_ATOMIC_GET (conf->queue_sizes[i]));
+
+                        as->last_change = limit - conf->ac_iot_limit[i];
+                        if (as->last_change) {
+                                if (as->last_change > 0)
+                                        as->grows++;
+                                else
+                                        as->shrinks++;
+
+                                gf_msg_debug (this->name, 0, "autoscale: %s "
+                                              "threads %d -> %d (wait %"
+                                              PRId64"us, service %"PRId64
+                                              "us, busy %"PRId64"%%)",
+                                              fop_pri_to_string (i),
+                                              conf->ac_iot_limit[i], limit,
+                                              as->last_wait_usec,
+                                              as->last_service_usec,
+                                              as->last_busy);
+                                conf->ac_iot_limit[i] = limit;
+                        }
+                        total += limit;
+
+                        if (done && (!as->base_service_usec ||
+                                     as->last_service_usec <
+                                     as->base_service_usec))
+                                as->base_service_usec = as->last_service_usec;
+                        else if (done)
+                                as->base_service_usec +=
+                                        (as->last_service_usec -
+                                         as->base_service_usec) / 16;
+                }
+
+                total = max (total, conf->autoscale_min);
+                total = min (total, conf->autoscale_max);
+                if (total != conf->max_count)
+                        gf_msg_debug (this->name, 0, "autoscale: "
+                                      "thread-count %d -> %d",
+                                      conf->max_count, total);
+                conf->max_count = total;
+        }
+        pthread_mutex_unlock (&conf->mutex);
+}
+
+static void *
+iot_autoscale (void *arg)
+{
+        xlator_t        *this   = arg;
+        iot_conf_t      *priv   = this->private;
+        struct timespec  last   = {0, };
+        struct timespec  now    = {0, };
+
+        THIS = this;
+
+        timespec_now (&last);
+
+        for (;;) {
+                sleep (priv->autoscale_interval);
+                pthread_setcancelstate (PTHREAD_CANCEL_DISABLE, NULL);
+                timespec_now (&now);
+                iot_autoscale_tick (this, priv,
+                                    (TS (now) - TS (last)) / 1000);
+                last = now;
+                pthread_setcancelstate (PTHREAD_CANCEL_ENABLE, NULL);
+        }
+
+        /* NOTREACHED */
+        return NULL;
+}
+
+static void
+start_iot_autoscale (xlator_t *this)
+{
+        iot_conf_t      *priv   = this->private;
+        int             ret;
+        int             i;
+
+        if (priv->autoscale_running) {
+                return;
+        }
+
+        for (i = 0; i < GF_FOP_PRI_MAX; i++) {
+                GF_ATOMIC_INIT (priv->as[i].done, 0);
+                GF_ATOMIC_INIT (priv->as[i].wait_usec, 0);
+                GF_ATOMIC_INIT (priv->as[i].service_usec, 0);
+        }
+
+        ret = gf_thread_create (&priv->autoscale_thread, NULL, iot_autoscale,
+                                this, "iotscale");
+        if (ret == 0) {
+                priv->autoscale_running = _gf_true;
+        } else {
+                gf_log (this->name, GF_LOG_WARNING,
+                        "pthread_create(iot_autoscale) failed");
+        }
+}
+
+static void
+stop_iot_autoscale (xlator_t *this)
+{
+        iot_conf_t      *priv   = this->private;
+
+        if (!priv->autoscale_running) {
+                return;
+        }
+
+        if (pthread_cancel (priv->autoscale_thread) != 0) {
+                gf_log (this->name, GF_LOG_WARNING,
+                        "pthread_cancel(iot_autoscale) failed");
+        }
+
+        if (pthread_join (priv->autoscale_thread, NULL) != 0) {
+                gf_log (this->name, GF_LOG_WARNING,
+                        "pthread_join(iot_autoscale) failed");
+        }
+
+        priv->autoscale_running = _gf_false;
+}
+
 int
 reconfigure (xlator_t *this, dict_t *options)
 {
@@ -1169,6 +1580,23 @@ reconfigure (xlator_t *this, dict_t *options)
                 stop_iot_watchdog (this);
         }
 
+        GF_OPTION_RECONF ("autoscale-min-threads", conf->autoscale_min,
+                          options, int32, out);
+
+        GF_OPTION_RECONF ("autoscale-max-threads", conf->autoscale_max,
+                          options, int32, out);
+
+        GF_OPTION_RECONF ("autoscale-interval", conf->autoscale_interval,
+                          options, int32, out);
+
+        GF_OPTION_RECONF ("autoscale", conf->autoscale, options, bool, out);
+
+        if (conf->autoscale) {
+                start_iot_autoscale (this);
+        } else {
+                stop_iot_autoscale (this);
+        }
+
 	ret = 0;
 out:
 	return ret;
@@ -1219,6 +1647,16 @@ init (xlator_t *this)
         }
         conf->mutex_inited = _gf_true;
 
+        if (sem_init (&conf->sem, 0, 0) != 0) {
+                ret = errno;
+                gf_msg (this->name, GF_LOG_ERROR, 0,
+                        IO_THREADS_MSG_INIT_FAILED,
+                        "sem_init failed (%d)", ret);
+                goto out;
+        }
+
+        conf->sem_inited = _gf_true;
+
         ret = set_stack_size (conf);
 
         if (ret != 0)
@@ -1250,10 +1688,17 @@ init (xlator_t *this)
 
         conf->this = this;
 
+        GF_ATOMIC_INIT (conf->sleep_count, 0);
+        GF_ATOMIC_INIT (conf->queue_size, 0);
+
         for (i = 0; i < GF_FOP_PRI_MAX; i++) {
+                GF_ATOMIC_INIT (conf->inbox[i], 0);
+                LOCK_INIT (&conf->queue_lock[i]);
                 INIT_LIST_HEAD (&conf->clients[i]);
                 INIT_LIST_HEAD (&conf->no_client[i].clients);
                 INIT_LIST_HEAD (&conf->no_client[i].reqs);
+                GF_ATOMIC_INIT (conf->ac_iot_count[i], 0);
+                GF_ATOMIC_INIT (conf->queue_sizes[i], 0);
         }
 
 	ret = iot_workers_scale (conf);
@@ -1273,6 +1718,20 @@ init (xlator_t *this)
                 start_iot_watchdog (this);
         }
 
+        GF_OPTION_INIT ("autoscale-min-threads", conf->autoscale_min, int32,
+                        out);
+
+        GF_OPTION_INIT ("autoscale-max-threads", conf->autoscale_max, int32,
+                        out);
+
+        GF_OPTION_INIT ("autoscale-interval", conf->autoscale_interval, int32,
+                        out);
+
+        GF_OPTION_INIT ("autoscale", conf->autoscale, bool, out);
+        if (conf->autoscale) {
+                start_iot_autoscale (this);
+        }
+
         ret = 0;
 out:
         if (ret)
@@ -1284,11 +1743,14 @@ out:
 static void
 iot_exit_threads (iot_conf_t *conf)
 {
+        int i = 0;
+
         pthread_mutex_lock (&conf->mutex);
         {
                 conf->down = _gf_true;
                 /*Let all the threads know that xl is going down*/
-                pthread_cond_broadcast (&conf->cond);
+                for (i = 0; i < conf->curr_count; i++)
+                        sem_post (&conf->sem);
                 while (conf->curr_count)/*Wait for threads to exit*/
                         pthread_cond_wait (&conf->cond, &conf->mutex);
         }
@@ -1312,11 +1774,16 @@ void
 fini (xlator_t *this)
 {
 	iot_conf_t *conf = this->private;
+        int         i    = 0;
 
         if (!conf)
                 return;
 
-        if (conf->mutex_inited && conf->cond_inited)
+        /* The autoscale thread takes conf->mutex and changes the limits the
+           worker threads look at, so it's stopped before them. */
+        stop_iot_autoscale (this);
+
+        if (conf->mutex_inited && conf->cond_inited && conf->sem_inited)
                 iot_exit_threads (conf);
 
         if (conf->cond_inited)
@@ -1325,6 +1792,12 @@ fini (xlator_t *this)
         if (conf->mutex_inited)
                 pthread_mutex_destroy (&conf->mutex);
 
+        if (conf->sem_inited) {
+                sem_destroy (&conf->sem);
+                for (i = 0; i < GF_FOP_PRI_MAX; i++)
+                        LOCK_DESTROY (&conf->queue_lock[i]);
+        }
+
         stop_iot_watchdog (this);
 
 	GF_FREE (conf);
@@ -1358,21 +1831,26 @@ iot_disconnect_cbk (xlator_t *this, client_t *client)
                 goto out;
         }
 
-        pthread_mutex_lock (&conf->mutex);
         for (i = 0; i < GF_FOP_PRI_MAX; i++) {
-                ctx = &conf->no_client[i];
-                list_for_each_entry_safe (curr, next, &ctx->reqs, list) {
-                        if (curr->frame->root->client != client) {
-                                continue;
+                LOCK (&conf->queue_lock[i]);
+                {
+                        __iot_inbox_drain (conf, i);
+
+                        ctx = &conf->no_client[i];
+                        list_for_each_entry_safe (curr, next, &ctx->reqs,
+                                                  list) {
+                                if (curr->frame->root->client != client) {
+                                        continue;
+                                }
+                                gf_log (this->name, GF_LOG_INFO,
+                                        "poisoning %s fop at %p for client "
+                                        "%s", gf_fop_list[curr->fop], curr,
+                                        client->client_uid);
+                                curr->poison = _gf_true;
                         }
-                        gf_log (this->name, GF_LOG_INFO,
-                                "poisoning %s fop at %p for client %s",
-                                gf_fop_list[curr->fop], curr,
-                                client->client_uid);
-                        curr->poison = _gf_true;
                 }
+                UNLOCK (&conf->queue_lock[i]);
         }
-        pthread_mutex_unlock (&conf->mutex);
 
 out:
         return 0;
@@ -1540,6 +2018,51 @@ struct volume_options options[] = {
           .tags = {"io-threads"},
           .description = "Enable/Disable io threads translator"
         },
+        { .key  = {"autoscale"},
+          .type = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .op_version = {GD_OP_VERSION_4_1_0},
+          .flags = OPT_FLAG_SETTABLE | OPT_FLAG_DOC,
+          .tags = {"io-threads"},
+          .description = "Adjust the high, normal and low priority thread "
+                         "limits every autoscale-interval seconds, from how "
+                         "long requests waited in the queues and how long "
+                         "they took to execute. thread-count then follows the "
+                         "sum of the limits, between autoscale-min-threads "
+                         "and autoscale-max-threads."
+        },
+        { .key  = {"autoscale-min-threads"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = IOT_MIN_THREADS,
+          .max  = IOT_MAX_THREADS,
+          .default_value = "4",
+          .op_version = {GD_OP_VERSION_4_1_0},
+          .flags = OPT_FLAG_SETTABLE | OPT_FLAG_DOC,
+          .tags = {"io-threads"},
+          .description = "Lowest thread-count the autoscaling goes to, and "
+                         "number of idle threads kept running"
+        },
+        { .key  = {"autoscale-max-threads"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = IOT_MIN_THREADS,
+          .max  = IOT_MAX_THREADS,
+          .default_value = "64",
+          .op_version = {GD_OP_VERSION_4_1_0},
+          .flags = OPT_FLAG_SETTABLE | OPT_FLAG_DOC,
+          .tags = {"io-threads"},
+          .description = "Highest thread-count the autoscaling goes to"
+        },
+        { .key  = {"autoscale-interval"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = 1,
+          .max  = 3600,
+          .default_value = "5",
+          .op_version = {GD_OP_VERSION_4_1_0},
+          .flags = OPT_FLAG_SETTABLE | OPT_FLAG_DOC,
+          .tags = {"io-threads"},
+          .description = "Number of seconds the autoscaling measures the "
+                         "load for, before adjusting the thread limits"
+        },
         { .key  = {NULL},
         },
 };
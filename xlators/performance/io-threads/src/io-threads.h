@@ -43,16 +43,49 @@ typedef struct {
         struct list_head        reqs;
 } iot_client_ctx_t;
 
+/* What the autoscaling measures for a priority, see iot_autoscale () */
+typedef struct {
+        /* added to by the workers during an interval */
+        gf_atomic_t             done;
+        gf_atomic_t             wait_usec;      /* time spent queued */
+        gf_atomic_t             service_usec;   /* time spent in the fop */
+
+        /* averages of the last interval */
+        int64_t                 last_done;
+        int64_t                 last_wait_usec;
+        int64_t                 last_service_usec;
+        int64_t                 last_busy;      /* threads, in 1/100ths */
+        /* service time without contention, slowly follows the average */
+        int64_t                 base_service_usec;
+
+        int                     last_change;    /* of the thread limit */
+        uint64_t                grows;
+        uint64_t                shrinks;
+} iot_autoscale_t;
+
 struct iot_conf {
+        /* the thread count, the watchdog and the way down; requests are
+         * queued and taken without it */
         pthread_mutex_t      mutex;
         pthread_cond_t       cond;
 
+        /* posted once per queued request, the workers wait on it */
+        sem_t                sem;
+
         int32_t              max_count;   /* configured maximum */
         int32_t              curr_count;  /* actual number of threads running */
-        int32_t              sleep_count;
+        gf_atomic_t          sleep_count;
 
         int32_t              idle_time;   /* in seconds */
 
+        /*
+         * Requests are pushed on the inbox of their priority, a lock-free
+         * stack linked through stub->list.next. Workers move them to the
+         * per client queues below, under the queue_lock of the priority,
+         * before they take the next one in round robin order.
+         */
+        gf_atomic_uintptr_t  inbox[GF_FOP_PRI_MAX];
+        gf_lock_t            queue_lock[GF_FOP_PRI_MAX];
         struct list_head     clients[GF_FOP_PRI_MAX];
         /*
          * It turns out that there are several ways a frame can get to us
@@ -63,9 +96,9 @@ struct iot_conf {
         iot_client_ctx_t     no_client[GF_FOP_PRI_MAX];
 
         int32_t              ac_iot_limit[GF_FOP_PRI_MAX];
-        int32_t              ac_iot_count[GF_FOP_PRI_MAX];
-        int                  queue_sizes[GF_FOP_PRI_MAX];
-        int                  queue_size;
+        gf_atomic_t          ac_iot_count[GF_FOP_PRI_MAX];
+        gf_atomic_t          queue_sizes[GF_FOP_PRI_MAX];
+        gf_atomic_t          queue_size;
         pthread_attr_t       w_attr;
         gf_boolean_t         least_priority; /*Enable/Disable least-priority */
 
@@ -74,12 +107,22 @@ struct iot_conf {
         gf_boolean_t         down; /*PARENT_DOWN event is notified*/
         gf_boolean_t         mutex_inited;
         gf_boolean_t         cond_inited;
+        gf_boolean_t         sem_inited;
 
         int32_t             watchdog_secs;
         gf_boolean_t        watchdog_running;
         pthread_t           watchdog_thread;
         gf_boolean_t        queue_marked[GF_FOP_PRI_MAX];
         gf_boolean_t        cleanup_disconnected_reqs;
+
+        /* thread-count and the priority limits follow the load */
+        gf_boolean_t        autoscale;
+        int32_t             autoscale_min;
+        int32_t             autoscale_max;
+        int32_t             autoscale_interval;
+        gf_boolean_t        autoscale_running;
+        pthread_t           autoscale_thread;
+        iot_autoscale_t     as[GF_FOP_PRI_MAX];
 };
 
 typedef struct iot_conf iot_conf_t;
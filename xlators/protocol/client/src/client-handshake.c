@@ -1181,6 +1181,8 @@ client_setvolume_cbk (struct rpc_req *req, struct iovec *iov, int count, void *m
         conf->connecting = 0;
         conf->connected = 1;
 
+        client_streams_start (this);
+
         client_post_handshake (frame, frame->this);
 out:
         if (auth_fail) {
@@ -1392,6 +1394,119 @@ fail:
         return ret;
 }
 
+int
+client_stream_setvolume_cbk (struct rpc_req *req, struct iovec *iov, int count,
+                             void *myframe)
+{
+        call_frame_t     *frame    = NULL;
+        xlator_t         *this     = NULL;
+        clnt_stream_t    *stream   = NULL;
+        gf_setvolume_rsp  rsp      = {0,};
+        int               ret      = 0;
+        int32_t           op_ret   = -1;
+
+        frame = myframe;
+        this  = frame->this;
+        stream = frame->local;
+        frame->local = NULL;
+
+        if (-1 == req->rpc_status) {
+                gf_msg (this->name, GF_LOG_WARNING, ENOTCONN,
+                        PC_MSG_RPC_STATUS_ERROR, "stream %d: received RPC "
+                        "status error", stream->index);
+                goto out;
+        }
+
+        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gf_setvolume_rsp);
+        if (ret < 0) {
+                gf_msg (this->name, GF_LOG_ERROR, EINVAL,
+                        PC_MSG_XDR_DECODING_FAILED, "XDR decoding failed");
+                goto out;
+        }
+
+        if (-1 == rsp.op_ret) {
+                gf_msg (this->name, GF_LOG_WARNING,
+                        gf_error_to_errno (rsp.op_errno), PC_MSG_SETVOLUME_FAIL,
+                        "SETVOLUME of stream %d failed", stream->index);
+                goto out;
+        }
+
+        gf_msg (this->name, GF_LOG_INFO, 0, PC_MSG_REMOTE_VOL_CONNECTED,
+                "Stream %d connected to %s.", stream->index,
+                stream->rpc->conn.name);
+
+        rpc_clnt_set_connected (&stream->rpc->conn);
+        stream->connected = 1;
+        op_ret = 0;
+out:
+        /* retried on the next reconnect */
+        if (op_ret && stream->rpc)
+                rpc_transport_disconnect (stream->rpc->conn.trans, _gf_false);
+
+        free (rsp.dict.dict_val);
+
+        STACK_DESTROY (frame->root);
+
+        return 0;
+}
+
+/*
+ * Sends the SETVOLUME of conf->rpc again on a stream. this->options still
+ * holds its process-uuid, and the credentials of a frame from create_frame ()
+ * are the same too, so the server binds the stream to the same client_t:
+ * locks, leases and fds of the client are then valid on all its streams.
+ */
+int
+client_stream_setvolume (xlator_t *this, clnt_stream_t *stream)
+{
+        int               ret  = 0;
+        gf_setvolume_req  req  = {{0,},};
+        call_frame_t     *fr   = NULL;
+        clnt_conf_t      *conf = NULL;
+
+        conf = this->private;
+
+        ret = dict_serialized_length (this->options);
+        if (ret < 0) {
+                gf_msg (this->name, GF_LOG_ERROR, 0, PC_MSG_DICT_ERROR,
+                        "failed to get serialized length of dict");
+                ret = -1;
+                goto fail;
+        }
+        req.dict.dict_len = ret;
+        req.dict.dict_val = GF_CALLOC (1, req.dict.dict_len,
+                                       gf_client_mt_clnt_req_buf_t);
+        if (!req.dict.dict_val) {
+                ret = -1;
+                goto fail;
+        }
+
+        ret = dict_serialize (this->options, req.dict.dict_val);
+        if (ret < 0) {
+                gf_msg (this->name, GF_LOG_ERROR, 0,
+                        PC_MSG_DICT_SERIALIZE_FAIL, "failed to serialize "
+                        "dictionary");
+                goto fail;
+        }
+
+        ret = -1;
+        fr = create_frame (this, this->ctx->pool);
+        if (!fr)
+                goto fail;
+
+        fr->local = stream;
+        ret = client_submit_request_to (this, stream->rpc, &req, fr,
+                                        conf->handshake, GF_HNDSK_SETVOLUME,
+                                        client_stream_setvolume_cbk, NULL,
+                                        NULL, 0, NULL, 0, NULL,
+                                        (xdrproc_t)xdr_gf_setvolume_req);
+
+fail:
+        GF_FREE (req.dict.dict_val);
+
+        return ret;
+}
+
 int
 select_server_supported_programs (xlator_t *this, gf_prog_detail *prog)
 {
@@ -1536,6 +1651,7 @@ client_query_portmap_cbk (struct rpc_req *req, struct iovec *iov, int count, voi
         conf->disconnect_err_logged = 0;
         config.remote_port = rsp.port;
         rpc_clnt_reconfig (conf->rpc, &config);
+        conf->brick_port = rsp.port;
 
         conf->skip_notify = 1;
         conf->quick_reconnect = 1;
@@ -30,7 +30,6 @@ client_submit_vec_request (xlator_t  *this, void *req, call_frame_t  *frame,
                            struct iobref *iobref, xdrproc_t xdrproc)
 {
         int             ret        = 0;
-        clnt_conf_t    *conf       = NULL;
         struct iovec    iov        = {0, };
         struct iobuf   *iobuf      = NULL;
         int             count      = 0;
@@ -38,8 +37,6 @@ client_submit_vec_request (xlator_t  *this, void *req, call_frame_t  *frame,
         ssize_t         xdr_size   = 0;
         struct rpc_req  rpcreq     = {0, };
 
-        conf = this->private;
-
         if (req && xdrproc) {
                 xdr_size = xdr_sizeof (xdrproc, req);
                 iobuf = iobuf_get2 (this->ctx->iobuf_pool, xdr_size);
@@ -86,7 +83,8 @@ client_submit_vec_request (xlator_t  *this, void *req, call_frame_t  *frame,
         }
 
         /* Send the msg */
-        ret = rpc_clnt_submit (conf->rpc, prog, procnum, cbkfn, &iov, count,
+        ret = rpc_clnt_submit (client_stream_rpc (this, frame, prog, procnum),
+                               prog, procnum, cbkfn, &iov, count,
                                payload, payloadcnt, new_iobref, frame, NULL, 0,
                                NULL, 0, NULL);
         if (ret < 0) {
@@ -51,6 +51,7 @@ client_fini_complete (xlator_t *this)
 
         pthread_spin_destroy (&conf->fd_lock);
         pthread_mutex_destroy (&conf->lock);
+        GF_FREE (conf->stream);
         GF_FREE (conf);
 
 out:
@@ -68,6 +69,30 @@ client_notify_dispatch_uniq (xlator_t *this, int32_t event, void *data, ...)
         return client_notify_dispatch (this, event, data);
 }
 
+/* Once the graph is going away, CHILD_DOWN lets the parent go on to fini ()
+ * and free the xlator, so it is held back until every stream rpc has been
+ * destroyed as well. The last stream to go sends it then. */
+static int
+client_notify_child_down (xlator_t *this)
+{
+        clnt_conf_t  *conf = this->private;
+        gf_boolean_t  hold = _gf_false;
+
+        pthread_mutex_lock (&conf->lock);
+        {
+                if (conf->parent_down && GF_ATOMIC_GET (conf->rpcs) > 1) {
+                        conf->child_down_pending = 1;
+                        hold = _gf_true;
+                }
+        }
+        pthread_mutex_unlock (&conf->lock);
+
+        if (hold)
+                return 0;
+
+        return client_notify_dispatch_uniq (this, GF_EVENT_CHILD_DOWN, NULL);
+}
+
 int
 client_notify_dispatch (xlator_t *this, int32_t event, void *data, ...)
 {
@@ -133,6 +158,23 @@ client_submit_request (xlator_t *this, void *req, call_frame_t *frame,
                        int rsphdr_count, struct iovec *rsp_payload,
                        int rsp_payload_count, struct iobref *rsp_iobref,
                        xdrproc_t xdrproc)
+{
+        return client_submit_request_to (this, NULL, req, frame, prog, procnum,
+                                         cbkfn, iobref, rsphdr, rsphdr_count,
+                                         rsp_payload, rsp_payload_count,
+                                         rsp_iobref, xdrproc);
+}
+
+/* sends the request on @rpc, or on the stream client_stream_rpc () picks
+ * when @rpc is NULL */
+int
+client_submit_request_to (xlator_t *this, struct rpc_clnt *rpc, void *req,
+                          call_frame_t *frame, rpc_clnt_prog_t *prog,
+                          int procnum, fop_cbk_fn_t cbkfn,
+                          struct iobref *iobref, struct iovec *rsphdr,
+                          int rsphdr_count, struct iovec *rsp_payload,
+                          int rsp_payload_count, struct iobref *rsp_iobref,
+                          xdrproc_t xdrproc)
 {
         int             ret        = -1;
         clnt_conf_t    *conf       = NULL;
@@ -220,7 +262,10 @@ client_submit_request (xlator_t *this, void *req, call_frame_t *frame,
         }
 
         /* Send the msg */
-        ret = rpc_clnt_submit (conf->rpc, prog, procnum, cbkfn, &iov, count,
+        if (!rpc)
+                rpc = client_stream_rpc (this, frame, prog, procnum);
+
+        ret = rpc_clnt_submit (rpc, prog, procnum, cbkfn, &iov, count,
                                NULL, 0, new_iobref, frame, rsphdr, rsphdr_count,
                                rsp_payload, rsp_payload_count, rsp_iobref);
 
@@ -2269,9 +2314,7 @@ client_rpc_notify (struct rpc_clnt *rpc, void *mydata, rpc_clnt_event_t event,
                            may get screwed up.. (eg. CHILD_MODIFIED event in
                            replicate), hence make sure events which are passed
                            to parent are genuine */
-                        ret = client_notify_dispatch_uniq (this,
-                                                           GF_EVENT_CHILD_DOWN,
-                                                           NULL);
+                        ret = client_notify_child_down (this);
                         if (ret)
                                 gf_msg (this->name, GF_LOG_INFO, 0,
                                         PC_MSG_CHILD_DOWN_NOTIFY_FAILED,
@@ -2286,6 +2329,10 @@ client_rpc_notify (struct rpc_clnt *rpc, void *mydata, rpc_clnt_event_t event,
                 conf->connected = 0;
                 conf->skip_notify = 0;
 
+                /* the streams belong to this connection, the server has to
+                 * see all of them go to release the fds and locks */
+                client_streams_disable (this);
+
                 if (conf->quick_reconnect) {
                         conf->quick_reconnect = 0;
                         rpc_clnt_cleanup_and_start (rpc);
@@ -2295,7 +2342,8 @@ client_rpc_notify (struct rpc_clnt *rpc, void *mydata, rpc_clnt_event_t event,
                 }
                 break;
         case RPC_CLNT_DESTROY:
-                ret = client_fini_complete (this);
+                if (GF_ATOMIC_DEC (conf->rpcs) == 0)
+                        ret = client_fini_complete (this);
                 break;
 
         default:
@@ -2310,6 +2358,177 @@ out:
 }
 
 
+/* Reads go round robin over the connected streams, writes by the gfid of
+ * the file so that the writes to a file are sent in order. Everything else
+ * stays on conf->rpc. */
+struct rpc_clnt *
+client_stream_rpc (xlator_t *this, call_frame_t *frame, rpc_clnt_prog_t *prog,
+                   int procnum)
+{
+        clnt_conf_t   *conf   = NULL;
+        clnt_local_t  *local  = NULL;
+        clnt_stream_t *stream = NULL;
+        uint32_t       pick   = 0;
+
+        conf = this->private;
+
+        if (conf->streams < 2 || prog != conf->fops)
+                return conf->rpc;
+
+        switch (procnum) {
+        case GFS3_OP_READ:
+                pick = GF_ATOMIC_INC (conf->stream_next);
+                break;
+        case GFS3_OP_WRITE:
+                /* set up by client_fd_fop_prepare_local () */
+                local = frame->local;
+                if (!local || !local->fd || !local->fd->inode)
+                        return conf->rpc;
+                memcpy (&pick, &local->fd->inode->gfid[12], sizeof (pick));
+                break;
+        default:
+                return conf->rpc;
+        }
+
+        pick %= conf->streams;
+        if (pick == 0)
+                return conf->rpc;
+
+        stream = &conf->stream[pick - 1];
+        if (!stream->rpc || !stream->connected)
+                return conf->rpc;
+
+        return stream->rpc;
+}
+
+
+static int
+client_stream_notify (struct rpc_clnt *rpc, void *mydata,
+                      rpc_clnt_event_t event, void *data)
+{
+        clnt_stream_t *stream     = NULL;
+        xlator_t      *this       = NULL;
+        clnt_conf_t   *conf       = NULL;
+        int64_t        left       = 0;
+        gf_boolean_t   child_down = _gf_false;
+        int            ret        = 0;
+
+        stream = mydata;
+        this = stream->this;
+        conf = this->private;
+
+        switch (event) {
+        case RPC_CLNT_CONNECT:
+                gf_msg_debug (this->name, 0, "stream %d: got "
+                              "RPC_CLNT_CONNECT", stream->index);
+
+                rpc->auth_value = conf->rpc->auth_value;
+                ret = client_stream_setvolume (this, stream);
+                if (ret)
+                        rpc_transport_disconnect (rpc->conn.trans, _gf_false);
+                break;
+
+        case RPC_CLNT_DISCONNECT:
+                if (stream->connected)
+                        gf_msg (this->name, GF_LOG_INFO, 0,
+                                PC_MSG_CLIENT_DISCONNECTED, "stream %d "
+                                "disconnected from %s", stream->index,
+                                rpc->conn.name);
+                stream->connected = 0;
+
+                /* reconnect to the brick, not to glusterd */
+                rpc->conn.config.remote_port = conf->brick_port;
+                break;
+
+        case RPC_CLNT_DESTROY:
+                pthread_mutex_lock (&conf->lock);
+                {
+                        left = GF_ATOMIC_DEC (conf->rpcs);
+                        if (left == 1 && conf->child_down_pending) {
+                                conf->child_down_pending = 0;
+                                child_down = _gf_true;
+                        }
+                }
+                pthread_mutex_unlock (&conf->lock);
+
+                if (child_down)
+                        client_notify_dispatch_uniq (this, GF_EVENT_CHILD_DOWN,
+                                                     NULL);
+                if (left == 0)
+                        ret = client_fini_complete (this);
+                break;
+
+        default:
+                break;
+        }
+
+        return ret;
+}
+
+
+/* called once conf->rpc is attached to the brick */
+int
+client_streams_start (xlator_t *this)
+{
+        clnt_conf_t            *conf   = NULL;
+        struct rpc_clnt_config  config = {0, };
+        int                     i      = 0;
+
+        conf = this->private;
+
+        if (conf->parent_down)
+                return 0;
+
+        config.remote_port = conf->brick_port;
+
+        for (i = 0; i < conf->streams - 1; i++) {
+                if (!conf->stream[i].rpc)
+                        continue;
+
+                rpc_clnt_reconfig (conf->stream[i].rpc, &config);
+                rpc_clnt_start (conf->stream[i].rpc);
+        }
+
+        return 0;
+}
+
+
+void
+client_streams_disable (xlator_t *this)
+{
+        clnt_conf_t *conf = NULL;
+        int          i    = 0;
+
+        conf = this->private;
+
+        for (i = 0; i < conf->streams - 1; i++) {
+                if (!conf->stream[i].rpc)
+                        continue;
+
+                conf->stream[i].connected = 0;
+                rpc_clnt_disable (conf->stream[i].rpc);
+        }
+}
+
+static void
+client_streams_destroy (xlator_t *this)
+{
+        clnt_conf_t *conf = NULL;
+        int          i    = 0;
+
+        conf = this->private;
+
+        for (i = 0; i < conf->streams - 1; i++) {
+                if (!conf->stream[i].rpc)
+                        continue;
+
+                rpc_clnt_connection_cleanup (&conf->stream[i].rpc->conn);
+                rpc_clnt_unref (conf->stream[i].rpc);
+                conf->stream[i].rpc = NULL;
+        }
+}
+
+
 int
 notify (xlator_t *this, int32_t event, void *data, ...)
 {
@@ -2341,6 +2560,11 @@ notify (xlator_t *this, int32_t event, void *data, ...)
                 }
                 pthread_mutex_unlock (&conf->lock);
 
+                /* nothing is wound to a graph that is going down, so the
+                 * streams can be let go of here already, their DESTROY
+                 * then releases the CHILD_DOWN of conf->rpc */
+                client_streams_disable (this);
+                client_streams_destroy (this);
                 rpc_clnt_disable (conf->rpc);
                 break;
 
@@ -2419,6 +2643,8 @@ build_client_config (xlator_t *this, clnt_conf_t *conf)
 
         GF_OPTION_INIT ("send-gids", conf->send_gids, bool, out);
 
+        GF_OPTION_INIT ("streams", conf->streams, int32, out);
+
         conf->client_id = glusterfs_leaf_position(this);
 
         ret = client_check_remote_host (this, this->options);
@@ -2461,6 +2687,8 @@ client_destroy_rpc (xlator_t *this)
                 goto out;
 
         if (conf->rpc) {
+                client_streams_destroy (this);
+
                 /* cleanup the saved-frames before last unref */
                 rpc_clnt_connection_cleanup (&conf->rpc->conn);
 
@@ -2479,6 +2707,70 @@ out:
         return ret;
 }
 
+/* the streams are not started here, but by client_streams_start () */
+static int
+client_init_streams (xlator_t *this)
+{
+        clnt_conf_t   *conf   = NULL;
+        clnt_stream_t *stream = NULL;
+        int            ret    = -1;
+        int            i      = 0;
+
+        conf = this->private;
+
+        if (conf->streams < 2)
+                return 0;
+
+        if (!conf->stream) {
+                conf->stream = GF_CALLOC (conf->streams - 1,
+                                          sizeof (*conf->stream),
+                                          gf_client_mt_clnt_stream_t);
+                if (!conf->stream)
+                        goto out;
+        }
+
+        for (i = 0; i < conf->streams - 1; i++) {
+                stream = &conf->stream[i];
+                stream->this = this;
+                stream->index = i + 1;
+                stream->connected = 0;
+
+                stream->rpc = rpc_clnt_new (this->options, this, this->name,
+                                            0);
+                if (!stream->rpc)
+                        goto out;
+
+                ret = rpc_clnt_register_notify (stream->rpc,
+                                                client_stream_notify, stream);
+                if (ret)
+                        goto out;
+                /* from here on the DESTROY of the rpc drops it again */
+                GF_ATOMIC_INC (conf->rpcs);
+
+                /* the server sends its callbacks on any of the
+                 * connections of a client */
+                ret = rpcclnt_cbk_program_register (stream->rpc,
+                                                    &gluster_cbk_prog, this);
+                if (ret)
+                        goto out;
+        }
+
+        ret = 0;
+out:
+        if (ret) {
+                gf_msg (this->name, GF_LOG_WARNING, 0, PC_MSG_RPC_INIT_FAILED,
+                        "failed to set up stream %d, using %d streams",
+                        i + 1, i + 1);
+                if (conf->stream && conf->stream[i].rpc) {
+                        rpc_clnt_unref (conf->stream[i].rpc);
+                        conf->stream[i].rpc = NULL;
+                }
+                conf->streams = i + 1;
+        }
+
+        return 0;
+}
+
 int
 client_init_rpc (xlator_t *this)
 {
@@ -2508,6 +2800,7 @@ client_init_rpc (xlator_t *this)
                         "failed to register notify");
                 goto out;
         }
+        GF_ATOMIC_INC (conf->rpcs);
 
         conf->handshake = &clnt_handshake_prog;
         conf->dump      = &clnt_dump_prog;
@@ -2520,7 +2813,7 @@ client_init_rpc (xlator_t *this)
                 goto out;
         }
 
-        ret = 0;
+        ret = client_init_streams (this);
 
         gf_msg_debug (this->name, 0, "client init successful");
 out:
@@ -2539,6 +2832,23 @@ client_check_event_threads (xlator_t *this, clnt_conf_t *conf, int32_t old,
                                           conf->event_threads);
 }
 
+/* pins the event threads, unless neither the volume did it before nor
+ * it does it now; those may have been pinned on the command line */
+int
+client_check_event_cpus (xlator_t *this, clnt_conf_t *conf, char *cpus)
+{
+        int ret = 0;
+
+        if (!cpus && !conf->event_cpus_set)
+                return 0;
+
+        ret = event_pool_set_cpus (this->ctx->event_pool, cpus);
+        if (!ret)
+                conf->event_cpus_set = (cpus != NULL);
+
+        return ret;
+}
+
 int
 reconfigure (xlator_t *this, dict_t *options)
 {
@@ -2550,6 +2860,7 @@ reconfigure (xlator_t *this, dict_t *options)
         char        *old_remote_host            = NULL;
         char        *new_remote_host            = NULL;
         int32_t      new_nthread                = 0;
+        char        *event_cpus                 = NULL;
         struct rpc_clnt_config rpc_config       = {0,};
 
 	conf = this->private;
@@ -2567,6 +2878,16 @@ reconfigure (xlator_t *this, dict_t *options)
         if (ret)
                 goto out;
 
+        GF_OPTION_RECONF ("event-batch-size", conf->event_batch_size, options,
+                          int32, out);
+        event_pool_set_batch_size (this->ctx->event_pool,
+                                   conf->event_batch_size);
+
+        GF_OPTION_RECONF ("event-cpus", event_cpus, options, str, out);
+        ret = client_check_event_cpus (this, conf, event_cpus);
+        if (ret)
+                goto out;
+
         ret = client_check_remote_host (this, options);
         if (ret)
                 goto out;
@@ -2620,6 +2941,7 @@ init (xlator_t *this)
 {
         int          ret = -1;
         clnt_conf_t *conf = NULL;
+        char        *event_cpus = NULL;
 
         if (this->children) {
                 gf_msg (this->name, GF_LOG_ERROR, EINVAL,
@@ -2650,8 +2972,24 @@ init (xlator_t *this)
         if (ret)
                 goto out;
 
+        /* leave a --event-batch-size given on the command line alone,
+         * unless the volume asks for batching itself */
+        GF_OPTION_INIT ("event-batch-size", conf->event_batch_size, int32,
+                        out);
+        if (conf->event_batch_size > 1)
+                event_pool_set_batch_size (this->ctx->event_pool,
+                                           conf->event_batch_size);
+
+        GF_OPTION_INIT ("event-cpus", event_cpus, str, out);
+        ret = client_check_event_cpus (this, conf, event_cpus);
+        if (ret)
+                goto out;
+
         LOCK_INIT (&conf->rec_lock);
 
+        GF_ATOMIC_INIT (conf->rpcs, 0);
+        GF_ATOMIC_INIT (conf->stream_next, 0);
+
         conf->last_sent_event = -1; /* To start with we don't have any events */
 
         this->private = conf;
@@ -2698,6 +3036,8 @@ fini (xlator_t *this)
 
         conf->destroy = 1;
         if (conf->rpc) {
+                client_streams_destroy (this);
+
                 /* cleanup the saved-frames before last unref */
                 rpc_clnt_connection_cleanup (&conf->rpc->conn);
                 rpc_clnt_unref (conf->rpc);
@@ -2805,11 +3145,35 @@ client_priv_dump (xlator_t *this)
                                    conn->ping_timeout);
                 gf_proc_dump_write("total_bytes_written", "%"PRIu64,
                                    conn->trans->total_bytes_write);
+                gf_proc_dump_write("total_write_calls", "%"PRIu64,
+                                   conn->trans->total_write_calls);
+                gf_proc_dump_write("total_writes_saved", "%"PRIu64,
+                                   conn->trans->total_writes_saved);
                 gf_proc_dump_write("ping_msgs_sent", "%"PRIu64,
                                     conn->pingcnt);
                 gf_proc_dump_write("msgs_sent", "%"PRIu64,
                                     conn->msgcnt);
         }
+
+        gf_proc_dump_write ("streams", "%d", conf->streams);
+        for (i = 0; i < conf->streams - 1; i++) {
+                if (!conf->stream[i].rpc)
+                        continue;
+
+                conn = &conf->stream[i].rpc->conn;
+                gf_proc_dump_build_key (key, "stream", "%d.connected", i + 1);
+                gf_proc_dump_write (key, "%d", conf->stream[i].connected);
+                gf_proc_dump_build_key (key, "stream", "%d.total_bytes_read",
+                                        i + 1);
+                gf_proc_dump_write (key, "%"PRIu64,
+                                    conn->trans->total_bytes_read);
+                gf_proc_dump_build_key (key, "stream",
+                                        "%d.total_bytes_written", i + 1);
+                gf_proc_dump_write (key, "%"PRIu64,
+                                    conn->trans->total_bytes_write);
+                gf_proc_dump_build_key (key, "stream", "%d.msgs_sent", i + 1);
+                gf_proc_dump_write (key, "%"PRIu64, conn->msgcnt);
+        }
         pthread_mutex_unlock(&conf->lock);
 
         return 0;
@@ -2989,6 +3353,39 @@ struct volume_options options[] = {
           .op_version = {GD_OP_VERSION_3_7_0},
           .flags = OPT_FLAG_SETTABLE | OPT_FLAG_DOC
         },
+        { .key   = {"event-batch-size"},
+          .type  = GF_OPTION_TYPE_INT,
+          .min   = 1,
+          .max   = 64,
+          .default_value = "1",
+          .description = "Specifies the number of events an event thread "
+                         "picks up with a single wakeup. Larger values "
+                         "reduce the number of system calls when many "
+                         "connections are busy.",
+          .op_version = {GD_OP_VERSION_4_1_0},
+          .flags = OPT_FLAG_SETTABLE | OPT_FLAG_DOC
+        },
+        { .key   = {"event-cpus"},
+          .type  = GF_OPTION_TYPE_STR,
+          .description = "Pins the event threads to these cpus, one cpu "
+                         "each, given as a list like \"0-3,8\". Threads "
+                         "are not pinned when this is not set.",
+          .op_version = {GD_OP_VERSION_4_1_0},
+          .flags = OPT_FLAG_SETTABLE | OPT_FLAG_DOC
+        },
+        { .key   = {"streams"},
+          .type  = GF_OPTION_TYPE_INT,
+          .min   = 1,
+          .max   = CLIENT_MAX_STREAMS,
+          .default_value = "1",
+          .description = "Number of TCP connections to open to the brick. "
+                         "Reads and writes are spread over them, which "
+                         "helps on links a single connection cannot fill, "
+                         "like ones with a long round trip time. Takes "
+                         "effect on the next mount.",
+          .op_version = {GD_OP_VERSION_4_1_0},
+          .flags = OPT_FLAG_SETTABLE | OPT_FLAG_DOC
+        },
         { .key   = {NULL} },
 };
 
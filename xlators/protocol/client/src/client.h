@@ -176,6 +176,24 @@ typedef enum {
 
 
 
+/* most connections a client opens to its brick */
+#define CLIENT_MAX_STREAMS         16
+
+/*
+ * An additional connection to the brick. Reads and writes are spread over
+ * the streams, while everything else stays on conf->rpc. A stream does no
+ * handshake of its own: it is started when conf->rpc is set up, and sends
+ * the SETVOLUME of conf->rpc again, so that the server binds it to the
+ * same client_t. It is disabled whenever conf->rpc goes down, to keep the
+ * server from holding on to the fds and locks of the client.
+ */
+typedef struct clnt_stream {
+        struct rpc_clnt       *rpc;
+        xlator_t              *this;
+        int                    index;
+        int                    connected; /* SETVOLUME succeeded */
+} clnt_stream_t;
+
 struct clnt_options {
         char *remote_subvolume;
         int   ping_timeout;
@@ -212,6 +230,9 @@ typedef struct clnt_conf {
                                                          excessive disconnect
                                                          logging */
         char                   parent_down;
+        char                   child_down_pending; /* CHILD_DOWN held back
+                                                      until the streams are
+                                                      destroyed */
 	gf_boolean_t           quick_reconnect; /* When reconnecting after
 						   portmap query, do not let
 						   the reconnection happen after
@@ -229,12 +250,23 @@ typedef struct clnt_conf {
 
         int                     event_threads; /* # of event threads
                                                 * configured */
+        int                     event_batch_size; /* events per wakeup of
+                                                   * an event thread */
+        gf_boolean_t            event_cpus_set; /* event threads pinned
+                                                 * by the volume */
 
         gf_boolean_t           destroy; /* if enabled implies fini was called
                                          * on @this xlator instance */
 
         gf_boolean_t           child_up; /* Set to true, when child is up, and
                                           * false, when child is down */
+
+        int                    streams; /* connections to the brick, rpc
+                                         * included */
+        clnt_stream_t         *stream;  /* the streams - 1 others */
+        gf_atomic_uint32_t     stream_next; /* spreads reads */
+        int                    brick_port; /* from the portmapper */
+        gf_atomic_t            rpcs;    /* rpc_clnts not destroyed yet */
 } clnt_conf_t;
 
 typedef struct _client_fd_ctx {
@@ -336,6 +368,26 @@ int client_submit_request (xlator_t *this, void *req,
                            struct iovec *rsphdr, int rsphdr_count,
                            struct iovec *rsp_payload, int rsp_count,
                            struct iobref *rsp_iobref, xdrproc_t xdrproc);
+int client_submit_request_to (xlator_t *this, struct rpc_clnt *rpc, void *req,
+                              call_frame_t *frame, rpc_clnt_prog_t *prog,
+                              int procnum, fop_cbk_fn_t cbk,
+                              struct iobref *iobref,
+                              struct iovec *rsphdr, int rsphdr_count,
+                              struct iovec *rsp_payload, int rsp_count,
+                              struct iobref *rsp_iobref, xdrproc_t xdrproc);
+
+struct rpc_clnt *
+client_stream_rpc (xlator_t *this, call_frame_t *frame, rpc_clnt_prog_t *prog,
+                   int procnum);
+
+int
+client_streams_start (xlator_t *this);
+
+void
+client_streams_disable (xlator_t *this);
+
+int
+client_stream_setvolume (xlator_t *this, clnt_stream_t *stream);
 
 int
 client_submit_compound_request (xlator_t *this, void *req, call_frame_t *frame,
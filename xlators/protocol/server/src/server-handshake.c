@@ -626,7 +626,10 @@ server_setvolume (rpcsvc_request_t *req)
                 goto fail;
         }
 
-        client->client_name = gf_strdup(client_name);
+        /* all the connections of a client share the client_t, see the
+         * "streams" option of protocol/client */
+        if (!client->client_name)
+                client->client_name = gf_strdup(client_name);
 
         gf_msg_debug (this->name, 0, "Connected to %s", client->client_uid);
 
@@ -844,14 +847,16 @@ server_setvolume (rpcsvc_request_t *req)
                            already exist */
 
                         gf_msg_trace (this->name, 0, "creating inode table with"
-                                      " lru_limit=%"PRId32", xlator=%s",
-                                      conf->inode_lru_limit,
+                                      " lru_limit=%"PRId32", shards=%"PRId32
+                                      ", xlator=%s", conf->inode_lru_limit,
+                                      conf->inode_table_shards,
                                       client->bound_xl->name);
 
                         /* TODO: what is this ? */
                         client->bound_xl->itable =
-                                inode_table_new (conf->inode_lru_limit,
-                                                 client->bound_xl);
+                                inode_table_with_shards (conf->inode_lru_limit,
+                                                         client->bound_xl,
+                                                         conf->inode_table_shards);
                 }
         }
         UNLOCK (&conf->itable_lock);
@@ -536,6 +536,12 @@ server_build_config (xlator_t *this, server_conf_t *conf)
                 conf->inode_lru_limit = 16384;
         }
 
+        ret = dict_get_int32 (this->options, "inode-table-shards",
+                              &conf->inode_table_shards);
+        if (ret < 0) {
+                conf->inode_table_shards = 1;
+        }
+
         conf->verify_volfile = 1;
         data = dict_get (this->options, "verify-volfile-checksum");
         if (data) {
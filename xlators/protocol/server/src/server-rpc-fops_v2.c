@@ -3448,7 +3448,7 @@ server4_0_stat (rpcsvc_request_t *req)
         state->resolve.type  = RESOLVE_MUST;
         set_resolve_gfid (frame->root->client, state->resolve.gfid, args.gfid);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_stat_resume);
@@ -3487,7 +3487,7 @@ server4_0_setattr (rpcsvc_request_t *req)
         gfx_stat_to_iattx (&args.stbuf, &state->stbuf);
         state->valid = args.valid;
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_setattr_resume);
@@ -3528,7 +3528,7 @@ server4_0_fallocate(rpcsvc_request_t *req)
         state->size = args.size;
         memcpy(state->resolve.gfid, args.gfid, 16);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_fallocate_resume);
@@ -3568,7 +3568,7 @@ server4_0_discard(rpcsvc_request_t *req)
         state->size = args.size;
         memcpy(state->resolve.gfid, args.gfid, 16);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_discard_resume);
@@ -3608,7 +3608,7 @@ server4_0_zerofill(rpcsvc_request_t *req)
         state->size = args.size;
         memcpy(state->resolve.gfid, args.gfid, 16);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
         ret = 0;
         resolve_and_resume (frame, server4_zerofill_resume);
 
@@ -3641,7 +3641,7 @@ server4_0_ipc (rpcsvc_request_t *req)
         }
 
         bound_xl = frame->root->client->bound_xl;
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
         ret = 0;
         STACK_WIND (frame, server4_ipc_cbk, bound_xl, bound_xl->fops->ipc,
                     args.op, state->xdata);
@@ -3680,7 +3680,7 @@ server4_0_seek (rpcsvc_request_t *req)
         state->what = args.what;
         memcpy(state->resolve.gfid, args.gfid, 16);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_seek_resume);
@@ -3715,7 +3715,7 @@ server4_0_readlink (rpcsvc_request_t *req)
 
         state->size  = args.size;
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_readlink_resume);
@@ -3764,7 +3764,7 @@ server4_0_create (rpcsvc_request_t *req)
                 state->resolve.type = RESOLVE_DONTCARE;
         }
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_create_resume);
@@ -3800,7 +3800,7 @@ server4_0_open (rpcsvc_request_t *req)
 
         state->flags = gf_flags_to_flags (args.flags);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_open_resume);
@@ -3840,7 +3840,7 @@ server4_0_readv (rpcsvc_request_t *req)
 
         memcpy (state->resolve.gfid, args.gfid, 16);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_readv_resume);
@@ -3897,7 +3897,7 @@ server4_0_writev (rpcsvc_request_t *req)
 
         GF_ASSERT (state->size == len);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
 #ifdef GF_TESTING_IO_XDATA
         dict_dump_to_log (state->xdata);
@@ -4078,7 +4078,7 @@ server4_0_fsync (rpcsvc_request_t *req)
         state->flags         = args.data;
         memcpy (state->resolve.gfid, args.gfid, 16);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_fsync_resume);
@@ -4115,7 +4115,7 @@ server4_0_flush (rpcsvc_request_t *req)
         state->resolve.fd_no = args.fd;
         memcpy (state->resolve.gfid, args.gfid, 16);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_flush_resume);
@@ -4153,7 +4153,7 @@ server4_0_ftruncate (rpcsvc_request_t *req)
         state->offset         = args.offset;
         memcpy (state->resolve.gfid, args.gfid, 16);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_ftruncate_resume);
@@ -4189,7 +4189,7 @@ server4_0_fstat (rpcsvc_request_t *req)
         state->resolve.fd_no   = args.fd;
         set_resolve_gfid (frame->root->client, state->resolve.gfid, args.gfid);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_fstat_resume);
@@ -4225,7 +4225,7 @@ server4_0_truncate (rpcsvc_request_t *req)
         memcpy (state->resolve.gfid, args.gfid, 16);
         state->offset        = args.offset;
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_truncate_resume);
@@ -4268,7 +4268,7 @@ server4_0_unlink (rpcsvc_request_t *req)
 
         state->flags = args.xflags;
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_unlink_resume);
@@ -4304,7 +4304,7 @@ server4_0_setxattr (rpcsvc_request_t *req)
         state->flags            = args.flags;
         set_resolve_gfid (frame->root->client, state->resolve.gfid, args.gfid);
 
-        ret = xdr_to_dict (&args.dict, &state->dict);
+        ret = xdr_to_dict_iobref (&args.dict, &state->dict, req->iobref);
         if (ret)
                 gf_msg_debug (THIS->name, EINVAL,
                               "dictionary not received");
@@ -4312,7 +4312,7 @@ server4_0_setxattr (rpcsvc_request_t *req)
         /* There can be some commands hidden in key, check and proceed */
         gf_server_check_setxattr_cmd (frame, state->dict);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_setxattr_resume);
@@ -4349,12 +4349,12 @@ server4_0_fsetxattr (rpcsvc_request_t *req)
         state->flags             = args.flags;
         set_resolve_gfid (frame->root->client, state->resolve.gfid, args.gfid);
 
-        ret = xdr_to_dict (&args.dict, &state->dict);
+        ret = xdr_to_dict_iobref (&args.dict, &state->dict, req->iobref);
         if (ret)
                 gf_msg_debug (THIS->name, EINVAL,
                               "dictionary not received");
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_fsetxattr_resume);
@@ -4391,12 +4391,12 @@ server4_0_fxattrop (rpcsvc_request_t *req)
         state->flags           = args.flags;
         set_resolve_gfid (frame->root->client, state->resolve.gfid, args.gfid);
 
-        ret = xdr_to_dict (&args.dict, &state->dict);
+        ret = xdr_to_dict_iobref (&args.dict, &state->dict, req->iobref);
         if (ret)
                 gf_msg_debug (THIS->name, EINVAL,
                               "dictionary not received");
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_fxattrop_resume);
@@ -4430,12 +4430,12 @@ server4_0_xattrop (rpcsvc_request_t *req)
         state->flags           = args.flags;
         set_resolve_gfid (frame->root->client, state->resolve.gfid, args.gfid);
 
-        ret = xdr_to_dict (&args.dict, &state->dict);
+        ret = xdr_to_dict_iobref (&args.dict, &state->dict, req->iobref);
         if (ret)
                 gf_msg_debug (THIS->name, EINVAL,
                               "dictionary not received");
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_xattrop_resume);
@@ -4477,7 +4477,7 @@ server4_0_getxattr (rpcsvc_request_t *req)
                 gf_server_check_getxattr_cmd (frame, state->name);
         }
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_getxattr_resume);
@@ -4517,7 +4517,7 @@ server4_0_fgetxattr (rpcsvc_request_t *req)
         if (args.namelen)
                 state->name = gf_strdup (args.name);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_fgetxattr_resume);
@@ -4557,7 +4557,7 @@ server4_0_removexattr (rpcsvc_request_t *req)
         set_resolve_gfid (frame->root->client, state->resolve.gfid, args.gfid);
         state->name           = gf_strdup (args.name);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_removexattr_resume);
@@ -4596,7 +4596,7 @@ server4_0_fremovexattr (rpcsvc_request_t *req)
         set_resolve_gfid (frame->root->client, state->resolve.gfid, args.gfid);
         state->name           = gf_strdup (args.name);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_fremovexattr_resume);
@@ -4633,7 +4633,7 @@ server4_0_opendir (rpcsvc_request_t *req)
         state->resolve.type   = RESOLVE_MUST;
         set_resolve_gfid (frame->root->client, state->resolve.gfid, args.gfid);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_opendir_resume);
@@ -4684,7 +4684,7 @@ server4_0_readdirp (rpcsvc_request_t *req)
         set_resolve_gfid (frame->root->client, state->resolve.gfid, args.gfid);
 
         /* here, dict itself works as xdata */
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_readdirp_resume);
@@ -4730,7 +4730,7 @@ server4_0_readdir (rpcsvc_request_t *req)
         state->offset = args.offset;
         set_resolve_gfid (frame->root->client, state->resolve.gfid, args.gfid);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_readdir_resume);
@@ -4766,7 +4766,7 @@ server4_0_fsyncdir (rpcsvc_request_t *req)
         state->flags = args.data;
         set_resolve_gfid (frame->root->client, state->resolve.gfid, args.gfid);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_fsyncdir_resume);
@@ -4811,7 +4811,7 @@ server4_0_mknod (rpcsvc_request_t *req)
         state->dev   = args.dev;
         state->umask = args.umask;
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_mknod_resume);
@@ -4853,7 +4853,7 @@ server4_0_mkdir (rpcsvc_request_t *req)
         state->mode  = args.mode;
         state->umask = args.umask;
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_mkdir_resume);
@@ -4895,7 +4895,7 @@ server4_0_rmdir (rpcsvc_request_t *req)
 
         state->flags = args.xflags;
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_rmdir_resume);
@@ -4964,7 +4964,7 @@ server4_0_inodelk (rpcsvc_request_t *req)
                 break;
         }
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_inodelk_resume);
@@ -5034,7 +5034,7 @@ server4_0_finodelk (rpcsvc_request_t *req)
                 break;
         }
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_finodelk_resume);
@@ -5082,7 +5082,7 @@ server4_0_entrylk (rpcsvc_request_t *req)
         state->cmd            = args.cmd;
         state->type           = args.type;
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_entrylk_resume);
@@ -5127,7 +5127,7 @@ server4_0_fentrylk (rpcsvc_request_t *req)
                 state->name = gf_strdup (args.name);
         state->volume = gf_strdup (args.volume);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_fentrylk_resume);
@@ -5162,7 +5162,7 @@ server4_0_access (rpcsvc_request_t *req)
         set_resolve_gfid (frame->root->client, state->resolve.gfid, args.gfid);
         state->mask          = args.mask;
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_access_resume);
@@ -5205,7 +5205,7 @@ server4_0_symlink (rpcsvc_request_t *req)
         state->name           = gf_strdup (args.linkname);
         state->umask          = args.umask;
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_symlink_resume);
@@ -5246,7 +5246,7 @@ server4_0_link (rpcsvc_request_t *req)
         set_resolve_gfid (frame->root->client, state->resolve2.pargfid,
                           args.newgfid);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_link_resume);
@@ -5291,7 +5291,7 @@ server4_0_rename (rpcsvc_request_t *req)
         set_resolve_gfid (frame->root->client, state->resolve2.pargfid,
                           args.newgfid);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_rename_resume);
@@ -5326,7 +5326,7 @@ server4_0_lease (rpcsvc_request_t *req)
         set_resolve_gfid (frame->root->client, state->resolve.gfid, args.gfid);
         gf_proto_lease_to_lease (&args.lease, &state->lease);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_lease_resume);
@@ -5409,7 +5409,7 @@ server4_0_lk (rpcsvc_request_t *req)
         }
 
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_lk_resume);
@@ -5468,7 +5468,7 @@ server4_0_lookup (rpcsvc_request_t *req)
                                   state->resolve.gfid, args.gfid);
         }
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_lookup_resume);
@@ -5498,7 +5498,7 @@ server4_0_statfs (rpcsvc_request_t *req)
         state->resolve.type   = RESOLVE_MUST;
         set_resolve_gfid (frame->root->client, state->resolve.gfid, args.gfid);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_statfs_resume);
@@ -5534,7 +5534,7 @@ server4_0_getactivelk (rpcsvc_request_t *req)
         set_resolve_gfid (frame->root->client, state->resolve.gfid, args.gfid);
 
         /* here, dict itself works as xdata */
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
 
         ret = 0;
@@ -5572,7 +5572,7 @@ server4_0_setactivelk (rpcsvc_request_t *req)
         set_resolve_gfid (frame->root->client, state->resolve.gfid, args.gfid);
 
         /* here, dict itself works as xdata */
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = unserialize_req_locklist_v2 (&args, &state->locklist);
         if (ret)
@@ -5611,7 +5611,7 @@ server4_0_namelink (rpcsvc_request_t *req)
 
         state->resolve.type = RESOLVE_NOT;
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
         ret = 0;
         resolve_and_resume (frame, server4_namelink_resume);
 
@@ -5653,7 +5653,7 @@ server4_0_icreate (rpcsvc_request_t *req)
 
         state->resolve.type = RESOLVE_NOT;
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
         ret = 0;
         resolve_and_resume (frame, server4_icreate_resume);
 
@@ -5690,7 +5690,7 @@ server4_0_fsetattr (rpcsvc_request_t *req)
         gfx_stat_to_iattx (&args.stbuf, &state->stbuf);
         state->valid = args.valid;
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
         ret = 0;
         resolve_and_resume (frame, server4_fsetattr_resume);
 
@@ -5727,7 +5727,7 @@ server4_0_rchecksum (rpcsvc_request_t *req)
 
         memcpy (state->resolve.gfid, args.gfid, 16);
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
         ret = 0;
         resolve_and_resume (frame, server4_rchecksum_resume);
 out:
@@ -5793,8 +5793,8 @@ server4_0_put (rpcsvc_request_t *req)
                 state->resolve.type = RESOLVE_DONTCARE;
         }
 
-        xdr_to_dict (&args.xattr, &state->dict);
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xattr, &state->dict, req->iobref);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_put_resume);
@@ -5971,7 +5971,7 @@ server4_0_compound (rpcsvc_request_t *req)
                 goto out;
         }
 
-        xdr_to_dict (&args.xdata, &state->xdata);
+        xdr_to_dict_iobref (&args.xdata, &state->xdata, req->iobref);
 
         ret = 0;
         resolve_and_resume (frame, server4_compound_resume);
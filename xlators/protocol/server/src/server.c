@@ -257,6 +257,8 @@ server_priv (xlator_t *this)
         char              key[GF_DUMP_MAX_BUF_LEN] = {0,};
         uint64_t          total_read = 0;
         uint64_t          total_write = 0;
+        uint64_t          total_write_calls = 0;
+        uint64_t          total_writes_saved = 0;
         int32_t           ret  = -1;
 
         GF_VALIDATE_OR_GOTO ("server", this, out);
@@ -275,6 +277,8 @@ server_priv (xlator_t *this)
                 list_for_each_entry (xprt, &conf->xprt_list, list) {
                         total_read  += xprt->total_bytes_read;
                         total_write += xprt->total_bytes_write;
+                        total_write_calls += xprt->total_write_calls;
+                        total_writes_saved += xprt->total_writes_saved;
                 }
         }
         pthread_mutex_unlock (&conf->mutex);
@@ -285,6 +289,14 @@ server_priv (xlator_t *this)
         gf_proc_dump_build_key(key, "server", "total-bytes-write");
         gf_proc_dump_write(key, "%"PRIu64, total_write);
 
+        gf_proc_dump_build_key(key, "server", "total-write-calls");
+        gf_proc_dump_write(key, "%"PRIu64, total_write_calls);
+
+        gf_proc_dump_build_key(key, "server", "total-writes-saved");
+        gf_proc_dump_write(key, "%"PRIu64, total_writes_saved);
+
+        rpcsvc_fair_share_dump (conf->rpc);
+
         ret = 0;
 out:
         if (ret)
@@ -659,6 +671,23 @@ server_check_event_threads (xlator_t *this, server_conf_t *conf, int32_t new)
         return event_reconfigure_threads (pool, target);
 }
 
+/* pins the event threads, unless neither the volume did it before nor
+ * it does it now; those may have been pinned on the command line */
+int
+server_check_event_cpus (xlator_t *this, server_conf_t *conf, char *cpus)
+{
+        int ret = 0;
+
+        if (!cpus && !conf->event_cpus_set)
+                return 0;
+
+        ret = event_pool_set_cpus (this->ctx->event_pool, cpus);
+        if (!ret)
+                conf->event_cpus_set = (cpus != NULL);
+
+        return ret;
+}
+
 int
 server_reconfigure (xlator_t *this, dict_t *options)
 {
@@ -669,11 +698,13 @@ server_reconfigure (xlator_t *this, dict_t *options)
         rpc_transport_t          *xprt = NULL;
         rpc_transport_t          *xp_next = NULL;
         int                       inode_lru_limit;
+        int                       inode_table_shards;
         gf_boolean_t              trace;
         data_t                   *data;
         int                       ret = 0;
         char                     *statedump_path = NULL;
         int32_t                   new_nthread = 0;
+        char                     *event_cpus = NULL;
         char                     *auth_path = NULL;
         char                     *xprt_path = NULL;
         xlator_t                 *oldTHIS;
@@ -724,6 +755,16 @@ server_reconfigure (xlator_t *this, dict_t *options)
                                 &inode_lru_limit);
         }
 
+        /* existing inode tables keep their layout, the new value only
+           applies to the tables created by later handshakes */
+        if (dict_get_int32 (options, "inode-table-shards",
+                            &inode_table_shards) == 0) {
+                conf->inode_table_shards = inode_table_shards;
+                gf_msg_trace (this->name, 0, "Reconfigured "
+                              "inode-table-shards to %d",
+                              conf->inode_table_shards);
+        }
+
         data = dict_get (options, "trace");
         if (data) {
                 ret = gf_string2boolean (data->data, &trace);
@@ -882,6 +923,13 @@ do_rpc:
                 goto out;
         }
 
+        ret = rpcsvc_set_fair_share (rpc_conf, options);
+        if (ret < 0) {
+                gf_msg (this->name, GF_LOG_ERROR, 0, PS_MSG_RPC_CONF_ERROR,
+                        "Failed to reconfigure fair-share");
+                goto out;
+        }
+
         list_for_each_entry (listeners, &(rpc_conf->listeners), list) {
                 if (listeners->trans != NULL) {
                         if (listeners->trans->reconfigure )
@@ -905,6 +953,16 @@ do_rpc:
         if (ret)
                 goto out;
 
+        GF_OPTION_RECONF ("event-batch-size", conf->event_batch_size, options,
+                          int32, out);
+        event_pool_set_batch_size (this->ctx->event_pool,
+                                   conf->event_batch_size);
+
+        GF_OPTION_RECONF ("event-cpus", event_cpus, options, str, out);
+        ret = server_check_event_cpus (this, conf, event_cpus);
+        if (ret)
+                goto out;
+
         /* rpcsvc thread reconfigure should be after events thread
          * reconfigure
          */
@@ -958,6 +1016,10 @@ server_dump_metrics (xlator_t *this, int fd)
                          client->client_uid, xprt->total_bytes_read);
                 dprintf (fd, "%s.total.rpc.%s.bytes_write %lu\n", this->name,
                          client->client_uid, xprt->total_bytes_write);
+                dprintf (fd, "%s.total.rpc.%s.write_calls %lu\n", this->name,
+                         client->client_uid, xprt->total_write_calls);
+                dprintf (fd, "%s.total.rpc.%s.writes_saved %lu\n", this->name,
+                         client->client_uid, xprt->total_writes_saved);
                 dprintf (fd, "%s.total.rpc.%s.outstanding %d\n", this->name,
                          client->client_uid, xprt->outstanding_rpc_count);
         }
@@ -975,6 +1037,7 @@ server_init (xlator_t *this)
         rpcsvc_listener_t *listener = NULL;
         char              *transport_type = NULL;
         char              *statedump_path = NULL;
+        char              *event_cpus = NULL;
         int               total_transport = 0;
 
         GF_VALIDATE_OR_GOTO ("init", this, out);
@@ -1007,6 +1070,19 @@ server_init (xlator_t *this)
         if (ret)
                 goto out;
 
+        /* leave a --event-batch-size given on the command line alone,
+         * unless the volume asks for batching itself */
+        GF_OPTION_INIT ("event-batch-size", conf->event_batch_size, int32,
+                        out);
+        if (conf->event_batch_size > 1)
+                event_pool_set_batch_size (this->ctx->event_pool,
+                                           conf->event_batch_size);
+
+        GF_OPTION_INIT ("event-cpus", event_cpus, str, out);
+        ret = server_check_event_cpus (this, conf, event_cpus);
+        if (ret)
+                goto out;
+
         ret = server_build_config (this, conf);
         if (ret)
                 goto out;
@@ -1099,6 +1175,13 @@ server_init (xlator_t *this)
                 goto out;
         }
 
+        ret = rpcsvc_set_fair_share (conf->rpc, this->options);
+        if (ret < 0) {
+                gf_msg (this->name, GF_LOG_ERROR, 0, PS_MSG_RPC_CONF_ERROR,
+                        "Failed to configure fair-share");
+                goto out;
+        }
+
         /*
          * This is the only place where we want secure_srvr to reflect
          * the data-plane setting.
@@ -1670,6 +1753,18 @@ struct volume_options server_options[] = {
           .op_version = {1},
           .flags = OPT_FLAG_SETTABLE | OPT_FLAG_DOC
         },
+        { .key   = {"inode-table-shards"},
+          .type  = GF_OPTION_TYPE_INT,
+          .min   = 1,
+          .max   = 256,
+          .default_value = "1",
+          .description = "Specifies the number of lock shards of the inode "
+          "table of a brick. With more than one shard, inode lookups do not "
+          "take the table lock and the lru limit is divided among the "
+          "shards. Takes effect on tables created after the change.",
+          .op_version = {GD_OP_VERSION_4_1_0},
+          .flags = OPT_FLAG_SETTABLE | OPT_FLAG_DOC
+        },
         { .key   = {"verify-volfile-checksum"},
           .type  = GF_OPTION_TYPE_BOOL
         },
@@ -1769,6 +1864,38 @@ struct volume_options server_options[] = {
           .op_version = {1},
           .flags = OPT_FLAG_SETTABLE | OPT_FLAG_DOC | OPT_FLAG_GLOBAL
         },
+        { .key   = {"rpc.fair-share"},
+          .type  = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .description = "Share the request handler threads fairly among "
+                         "clients, instead of handling requests in the "
+                         "order they were received.",
+          .op_version = {GD_OP_VERSION_4_1_0},
+          .flags = OPT_FLAG_SETTABLE | OPT_FLAG_DOC
+        },
+        { .key   = {"rpc.fair-share-weights"},
+          .type  = GF_OPTION_TYPE_STR,
+          .default_value = "",
+          .description = "Comma separated list of pattern:weight. A client "
+                         "whose client-uid (which starts with its host "
+                         "name) matches the pattern gets a share of the "
+                         "request handler threads proportional to the "
+                         "weight (1-64). The first match wins, the weight "
+                         "of other clients is 1.",
+          .op_version = {GD_OP_VERSION_4_1_0},
+          .flags = OPT_FLAG_SETTABLE | OPT_FLAG_DOC
+        },
+        { .key   = {"rpc.fair-share-op-cost"},
+          .type  = GF_OPTION_TYPE_SIZET,
+          .min   = 0,
+          .max   = 1 * GF_UNIT_MB,
+          .default_value = "4KB",
+          .description = "Cost of a request, on top of its size in bytes, "
+                         "when sharing the request handler threads among "
+                         "clients.",
+          .op_version = {GD_OP_VERSION_4_1_0},
+          .flags = OPT_FLAG_SETTABLE | OPT_FLAG_DOC
+        },
         { .key   = {"manage-gids"},
           .type  = GF_OPTION_TYPE_BOOL,
           .default_value = "off",
@@ -1795,6 +1922,26 @@ struct volume_options server_options[] = {
           .op_version = {GD_OP_VERSION_3_7_0},
           .flags = OPT_FLAG_SETTABLE | OPT_FLAG_DOC
         },
+        { .key   = {"event-batch-size"},
+          .type  = GF_OPTION_TYPE_INT,
+          .min   = 1,
+          .max   = 64,
+          .default_value = "1",
+          .description = "Specifies the number of events an event thread "
+                         "picks up with a single wakeup. Larger values "
+                         "reduce the number of system calls when many "
+                         "connections are busy.",
+          .op_version = {GD_OP_VERSION_4_1_0},
+          .flags = OPT_FLAG_SETTABLE | OPT_FLAG_DOC
+        },
+        { .key   = {"event-cpus"},
+          .type  = GF_OPTION_TYPE_STR,
+          .description = "Pins the event threads to these cpus, one cpu "
+                         "each, given as a list like \"0-3,8\". Threads "
+                         "are not pinned when this is not set.",
+          .op_version = {GD_OP_VERSION_4_1_0},
+          .flags = OPT_FLAG_SETTABLE | OPT_FLAG_DOC
+        },
         { .key   = {"dynamic-auth"},
           .type  = GF_OPTION_TYPE_BOOL,
           .default_value = "on",
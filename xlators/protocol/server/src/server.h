@@ -106,6 +106,7 @@ struct server_conf {
         rpcsvc_t               *rpc;
         struct rpcsvc_config    rpc_conf;
         int                     inode_lru_limit;
+        int                     inode_table_shards;
         gf_boolean_t            verify_volfile;
         gf_boolean_t            trace;
         char                   *conf_dir;
@@ -121,6 +122,10 @@ struct server_conf {
 
         int                     event_threads; /* # of event threads
                                                 * configured */
+        int                     event_batch_size; /* events per wakeup of
+                                                   * an event thread */
+        gf_boolean_t            event_cpus_set; /* event threads pinned
+                                                 * by the volume */
 
         gf_boolean_t            parent_up;
         gf_boolean_t            dync_auth; /* if set authenticate dynamically,
@@ -1537,6 +1537,25 @@ err:
         return op_ret;
 }
 
+/* whether the vectors can go to an O_DIRECT fd as they are; the socket
+ * transport places write payloads at the start of a page */
+static gf_boolean_t
+__posix_writev_aligned (struct iovec *vector, int count, off_t startoff)
+{
+        int             idx = 0;
+
+        if (startoff & (ALIGN_SIZE - 1))
+                return _gf_false;
+
+        for (idx = 0; idx < count; idx++) {
+                if (((unsigned long)vector[idx].iov_base |
+                     vector[idx].iov_len) & (ALIGN_SIZE - 1))
+                        return _gf_false;
+        }
+
+        return _gf_true;
+}
+
 int32_t
 __posix_writev (int fd, struct iovec *vector, int count, off_t startoff,
                 int odirect)
@@ -1550,7 +1569,7 @@ __posix_writev (int fd, struct iovec *vector, int count, off_t startoff,
         off_t           internal_off = 0;
 
         /* Check for the O_DIRECT flag during open() */
-        if (!odirect)
+        if (!odirect || __posix_writev_aligned (vector, count, startoff))
                 return __posix_pwritev (fd, vector, count, startoff);
 
         for (idx = 0; idx < count; idx++) {